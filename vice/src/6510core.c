@@ -242,6 +242,29 @@
 #error "please define LAST_OPCODE_ADDR"
 #endif
 
+/* Monitor profiler hooks, PROFILE_CONTEXT is non-NULL while it traces this
+   CPU.  */
+#ifdef PROFILE_CONTEXT
+#define PROFILE_INSTRUCTION(clk)                                                       \
+    do {                                                                               \
+        if (PROFILE_CONTEXT != NULL) {                                                 \
+            monitor_profile_instruction(PROFILE_CONTEXT, (uint16_t)reg_pc,             \
+                                        (uint8_t)(p0), (uint8_t)reg_sp, (clk));        \
+        }                                                                              \
+    } while (0)
+
+#define PROFILE_INTERRUPT()                                                            \
+    do {                                                                               \
+        if (PROFILE_CONTEXT != NULL) {                                                 \
+            monitor_profile_interrupt(PROFILE_CONTEXT, (uint16_t)reg_pc,               \
+                                      (uint8_t)reg_sp, CLK);                           \
+        }                                                                              \
+    } while (0)
+#else
+#define PROFILE_INSTRUCTION(clk)
+#define PROFILE_INTERRUPT()
+#endif
+
 #ifndef DRIVE_CPU
 
 #ifndef C64DTV
@@ -401,6 +424,7 @@
                 if (monitor_mask[CALLER] & (MI_STEP)) {                                        \
                     monitor_check_icount_interrupt();                                          \
                 }                                                                              \
+                PROFILE_INTERRUPT();                                                           \
                 if (NMI_CYCLES == 7) {                                                         \
                     FETCH_PARAM_DUMMY(reg_pc);   /* dummy reads */                             \
                     CLK_ADD(CLK, 1);                                                           \
@@ -2206,6 +2230,9 @@ static const uint8_t rewind_fetch_tab[] = {
 
     {
         opcode_t opcode;
+#ifdef PROFILE_CONTEXT
+        CLOCK profile_clk = CLK;
+#endif
 #ifdef DEBUG
         CLOCK debug_clk;
 #ifdef DRIVE_CPU
@@ -2246,6 +2273,8 @@ static const uint8_t rewind_fetch_tab[] = {
 #endif
 #endif
 
+        PROFILE_INSTRUCTION(profile_clk);
+
 #ifdef DEBUG
 #ifdef DRIVE_CPU
         if (TRACEFLG) {
@@ -153,6 +153,29 @@
 #error "please define LAST_OPCODE_ADDR"
 #endif
 
+/* Monitor profiler hooks, PROFILE_CONTEXT is non-NULL while it traces this
+   CPU.  */
+#ifdef PROFILE_CONTEXT
+#define PROFILE_INSTRUCTION(clk)                                                       \
+    do {                                                                               \
+        if (PROFILE_CONTEXT != NULL) {                                                 \
+            monitor_profile_instruction(PROFILE_CONTEXT, (uint16_t)reg_pc,             \
+                                        (uint8_t)(p0), (uint8_t)reg_sp, (clk));        \
+        }                                                                              \
+    } while (0)
+
+#define PROFILE_INTERRUPT()                                                            \
+    do {                                                                               \
+        if (PROFILE_CONTEXT != NULL) {                                                 \
+            monitor_profile_interrupt(PROFILE_CONTEXT, (uint16_t)reg_pc,               \
+                                      (uint8_t)reg_sp, CLK);                           \
+        }                                                                              \
+    } while (0)
+#else
+#define PROFILE_INSTRUCTION(clk)
+#define PROFILE_INTERRUPT()
+#endif
+
 #ifndef C64DTV
 /* Export the local version of the registers.  */
 #define EXPORT_REGISTERS()          \
@@ -323,6 +346,7 @@
                 if (monitor_mask[CALLER] & (MI_STEP)) {                        \
                     monitor_check_icount_interrupt();                          \
                 }                                                              \
+                PROFILE_INTERRUPT();                                           \
                 interrupt_ack_nmi(CPU_INT_STATUS);                             \
                 if (!SKIP_CYCLE) {                                             \
                     LOAD_DUMMY(reg_pc);     /* dummy reads */                  \
@@ -352,6 +376,7 @@
                 if (monitor_mask[CALLER] & (MI_STEP)) {                        \
                     monitor_check_icount_interrupt();                          \
                 }                                                              \
+                PROFILE_INTERRUPT();                                           \
                 interrupt_ack_irq(CPU_INT_STATUS);                             \
                 if (!SKIP_CYCLE) {                                             \
                     LOAD_DUMMY(reg_pc);     /* dummy reads */                  \
@@ -1697,6 +1722,9 @@ static const uint8_t fetch_tab[] = {
 
     {
         opcode_t opcode;
+#ifdef PROFILE_CONTEXT
+        CLOCK profile_clk = CLK;
+#endif
 #if defined (DEBUG) || defined (FEATURE_CPUMEMHISTORY)
         debug_clk = maincpu_clk;
 #endif
@@ -1717,6 +1745,8 @@ static const uint8_t fetch_tab[] = {
         memmap_state &= ~(MEMMAP_STATE_INSTR | MEMMAP_STATE_OPCODE);
 #endif
 
+        PROFILE_INSTRUCTION(profile_clk);
+
 #ifdef DEBUG
         if (TRACEFLG) {
             uint8_t op = (uint8_t)(p0);
@@ -223,6 +223,29 @@
 #error "please define LAST_OPCODE_ADDR"
 #endif
 
+/* Monitor profiler hooks, PROFILE_CONTEXT is non-NULL while it traces this
+   CPU.  */
+#ifdef PROFILE_CONTEXT
+#define PROFILE_INSTRUCTION(clk)                                                       \
+    do {                                                                               \
+        if (PROFILE_CONTEXT != NULL) {                                                 \
+            monitor_profile_instruction(PROFILE_CONTEXT, (uint16_t)reg_pc,             \
+                                        (uint8_t)(p0), (uint8_t)reg_sp, (clk));        \
+        }                                                                              \
+    } while (0)
+
+#define PROFILE_INTERRUPT()                                                            \
+    do {                                                                               \
+        if (PROFILE_CONTEXT != NULL) {                                                 \
+            monitor_profile_interrupt(PROFILE_CONTEXT, (uint16_t)reg_pc,               \
+                                      (uint8_t)reg_sp, CLK);                           \
+        }                                                                              \
+    } while (0)
+#else
+#define PROFILE_INSTRUCTION(clk)
+#define PROFILE_INTERRUPT()
+#endif
+
 #ifndef DRIVE_CPU
 /* Export the local version of the registers.  */
 #define EXPORT_REGISTERS()       \
@@ -305,6 +328,7 @@
                 if (monitor_mask[CALLER] & (MI_STEP)) {                                                       \
                     monitor_check_icount_interrupt();                                                         \
                 }                                                                                             \
+                PROFILE_INTERRUPT();                                                                          \
                 interrupt_ack_nmi(CPU_INT_STATUS);                                                            \
                 if (NMI_CYCLES == 7) {                                                                        \
                     LOAD(reg_pc);   /* dummy reads */                                                         \
@@ -330,6 +354,7 @@
                 if (monitor_mask[CALLER] & (MI_STEP)) {                                                       \
                     monitor_check_icount_interrupt();                                                         \
                 }                                                                                             \
+                PROFILE_INTERRUPT();                                                                          \
                 interrupt_ack_irq(CPU_INT_STATUS);                                                            \
                 if (NMI_CYCLES == 7) {                                                                        \
                     LOAD(reg_pc);   /* dummy reads */                                                         \
@@ -1631,6 +1656,9 @@
 
     {
         opcode_t opcode;
+#ifdef PROFILE_CONTEXT
+        CLOCK profile_clk = CLK;
+#endif
 #ifdef DEBUG
         CLOCK debug_clk;
 #ifdef DRIVE_CPU
@@ -1669,6 +1697,8 @@
 #endif
 #endif
 
+        PROFILE_INSTRUCTION(profile_clk);
+
 #ifdef DEBUG
 #ifdef DRIVE_CPU
         if (TRACEFLG) {
@@ -52,8 +52,12 @@ void alarm_context_init(alarm_context_t *context, const char *name)
 
     context->alarms = NULL;
 
+    context->pending_alarms = lib_malloc(sizeof(pending_alarms_t)
+                                         * ALARM_CONTEXT_INITIAL_PENDING_ALARMS);
     context->num_pending_alarms = 0;
+    context->max_pending_alarms = ALARM_CONTEXT_INITIAL_PENDING_ALARMS;
     context->next_pending_alarm_clk = CLOCK_MAX;
+    context->next_pending_alarm_idx = -1;
 }
 
 void alarm_context_destroy(alarm_context_t *context)
@@ -73,6 +77,7 @@ void alarm_context_destroy(alarm_context_t *context)
         }
     }
 
+    lib_free(context->pending_alarms);
     lib_free(context);
 }
 
@@ -85,6 +90,8 @@ void alarm_context_time_warp(alarm_context_t *context, CLOCK warp_amount,
         return;
     }
 
+    /* All pending alarms move by the same amount, so the heap order is
+       preserved.  */
     for (i = 0; i < context->num_pending_alarms; i++) {
         if (warp_direction > 0) {
             context->pending_alarms[i].clk += warp_amount;
@@ -168,6 +175,7 @@ void alarm_unset(alarm_t *alarm)
 {
     alarm_context_t *context;
     int idx;
+    unsigned int last;
 
     idx = alarm->pending_idx;
 
@@ -176,37 +184,31 @@ void alarm_unset(alarm_t *alarm)
     }
     context = alarm->context;
 
-    if (context->num_pending_alarms > 1) {
-        int last;
+    last = --context->num_pending_alarms;
 
-        last = --context->num_pending_alarms;
+    if ((unsigned int)idx != last) {
+        CLOCK old_clk = context->pending_alarms[idx].clk;
+        CLOCK new_clk = context->pending_alarms[last].clk;
 
-        if (last != idx) {
-            /* Let's copy the struct by hand to make sure stupid compilers
-               don't do stupid things.  */
-            context->pending_alarms[idx].alarm
-                = context->pending_alarms[last].alarm;
-            context->pending_alarms[idx].clk
-                = context->pending_alarms[last].clk;
-
-            context->pending_alarms[idx].alarm->pending_idx = idx;
-        }
-
-        if (context->next_pending_alarm_idx == idx) {
-            alarm_context_update_next_pending(context);
-        } else if (context->next_pending_alarm_idx == last) {
-            context->next_pending_alarm_idx = idx;
+        /* Move the last heap entry into the hole and restore the heap.  */
+        alarm_context_heap_place(context, (unsigned int)idx,
+                                 context->pending_alarms[last].alarm, new_clk);
+        if (new_clk < old_clk) {
+            alarm_context_heap_up(context, (unsigned int)idx);
+        } else {
+            alarm_context_heap_down(context, (unsigned int)idx);
         }
-    } else {
-        context->num_pending_alarms = 0;
-        context->next_pending_alarm_clk = CLOCK_MAX;
-        context->next_pending_alarm_idx = -1;
     }
 
+    alarm_context_update_next_pending(context);
+
     alarm->pending_idx = -1;
 }
 
-void alarm_log_too_many_alarms(void)
+void alarm_context_grow_pending(alarm_context_t *context)
 {
-    log_error(LOG_DEFAULT, "alarm_set(): Too many alarms set!");
+    context->max_pending_alarms *= 2;
+    context->pending_alarms = lib_realloc(context->pending_alarms,
+                                          sizeof(pending_alarms_t)
+                                          * context->max_pending_alarms);
 }
@@ -30,7 +30,8 @@
 
 #include "types.h"
 
-#define ALARM_CONTEXT_MAX_PENDING_ALARMS 0x100
+/* Initial size of the pending alarm heap; it grows on demand.  */
+#define ALARM_CONTEXT_INITIAL_PENDING_ALARMS 0x20
 
 typedef void (*alarm_callback_t)(CLOCK offset, void *data);
 
@@ -45,7 +46,7 @@ struct alarm_s {
     /* Callback to be called when the alarm is dispatched.  */
     alarm_callback_t callback;
 
-    /* Index into the pending alarm list.  If < 0, the alarm is not
+    /* Index into the pending alarm heap.  If < 0, the alarm is not
        pending.  */
     int pending_idx;
 
@@ -74,15 +75,16 @@ struct alarm_context_s {
     /* Alarm list.  */
     struct alarm_s *alarms;
 
-    /* Pending alarm array.  Statically allocated because it's slightly
-       faster this way.  */
-    pending_alarms_t pending_alarms[ALARM_CONTEXT_MAX_PENDING_ALARMS];
+    /* Pending alarms, kept as a binary min-heap ordered by `clk', so the
+       next alarm to dispatch is always at index 0.  */
+    pending_alarms_t *pending_alarms;
     unsigned int num_pending_alarms;
+    unsigned int max_pending_alarms;
 
     /* Clock tick for the next pending alarm.  */
     CLOCK next_pending_alarm_clk;
 
-    /* Pending alarm number.  */
+    /* Pending alarm number (0 if any alarm is pending, -1 otherwise).  */
     int next_pending_alarm_idx;
 };
 typedef struct alarm_context_s alarm_context_t;
@@ -98,7 +100,7 @@ extern alarm_t *alarm_new(alarm_context_t *context, const char *name,
                           alarm_callback_t callback, void *data);
 extern void alarm_destroy(alarm_t *alarm);
 extern void alarm_unset(alarm_t *alarm);
-extern void alarm_log_too_many_alarms(void);
+extern void alarm_context_grow_pending(alarm_context_t *context);
 
 /* ------------------------------------------------------------------------- */
 
@@ -111,23 +113,74 @@ inline static CLOCK alarm_context_next_pending_clk(alarm_context_t *context)
 
 inline static void alarm_context_update_next_pending(alarm_context_t *context)
 {
-    CLOCK next_pending_alarm_clk = CLOCK_MAX;
-    int next_pending_alarm_idx;
-    unsigned int i;
+    if (context->num_pending_alarms > 0) {
+        context->next_pending_alarm_clk = context->pending_alarms[0].clk;
+        context->next_pending_alarm_idx = 0;
+    } else {
+        context->next_pending_alarm_clk = CLOCK_MAX;
+        context->next_pending_alarm_idx = -1;
+    }
+}
 
-    next_pending_alarm_idx = context->next_pending_alarm_idx;
+/* Store `alarm' at heap position `idx' and keep its back index in sync.  */
+inline static void alarm_context_heap_place(alarm_context_t *context,
+                                            unsigned int idx, alarm_t *alarm,
+                                            CLOCK clk)
+{
+    context->pending_alarms[idx].alarm = alarm;
+    context->pending_alarms[idx].clk = clk;
+    alarm->pending_idx = (int)idx;
+}
 
-    for (i = 0; i < context->num_pending_alarms; i++) {
-        CLOCK pending_clk = context->pending_alarms[i].clk;
+/* Move the entry at `idx' towards the root until the heap is valid.  */
+inline static void alarm_context_heap_up(alarm_context_t *context,
+                                         unsigned int idx)
+{
+    alarm_t *alarm = context->pending_alarms[idx].alarm;
+    CLOCK clk = context->pending_alarms[idx].clk;
+
+    while (idx > 0) {
+        unsigned int parent = (idx - 1) >> 1;
 
-        if (pending_clk <= next_pending_alarm_clk) {
-            next_pending_alarm_clk = pending_clk;
-            next_pending_alarm_idx = (int)i;
+        if (context->pending_alarms[parent].clk <= clk) {
+            break;
         }
+        alarm_context_heap_place(context, idx,
+                                 context->pending_alarms[parent].alarm,
+                                 context->pending_alarms[parent].clk);
+        idx = parent;
     }
+    alarm_context_heap_place(context, idx, alarm, clk);
+}
+
+/* Move the entry at `idx' towards the leaves until the heap is valid.  */
+inline static void alarm_context_heap_down(alarm_context_t *context,
+                                           unsigned int idx)
+{
+    alarm_t *alarm = context->pending_alarms[idx].alarm;
+    CLOCK clk = context->pending_alarms[idx].clk;
+    unsigned int num = context->num_pending_alarms;
 
-    context->next_pending_alarm_clk = next_pending_alarm_clk;
-    context->next_pending_alarm_idx = next_pending_alarm_idx;
+    for (;;) {
+        unsigned int child = (idx << 1) + 1;
+
+        if (child >= num) {
+            break;
+        }
+        if (child + 1 < num
+            && context->pending_alarms[child + 1].clk
+               < context->pending_alarms[child].clk) {
+            child++;
+        }
+        if (clk <= context->pending_alarms[child].clk) {
+            break;
+        }
+        alarm_context_heap_place(context, idx,
+                                 context->pending_alarms[child].alarm,
+                                 context->pending_alarms[child].clk);
+        idx = child;
+    }
+    alarm_context_heap_place(context, idx, alarm, clk);
 }
 
 inline static void alarm_context_dispatch(alarm_context_t *context,
@@ -154,36 +207,35 @@ inline static void alarm_set(alarm_t *alarm, CLOCK cpu_clk)
     idx = alarm->pending_idx;
 
     if (idx < 0) {
-        int new_idx;
+        unsigned int new_idx;
 
         /* Not pending yet: add.  */
 
-        new_idx = (int)(context->num_pending_alarms);
-        if (new_idx >= (int)ALARM_CONTEXT_MAX_PENDING_ALARMS) {
-            alarm_log_too_many_alarms();
-            return;
+        new_idx = context->num_pending_alarms;
+        if (new_idx >= context->max_pending_alarms) {
+            alarm_context_grow_pending(context);
         }
 
         context->pending_alarms[new_idx].alarm = alarm;
         context->pending_alarms[new_idx].clk = cpu_clk;
-
         context->num_pending_alarms++;
 
-        if (cpu_clk < context->next_pending_alarm_clk) {
-            context->next_pending_alarm_clk = cpu_clk;
-            context->next_pending_alarm_idx = new_idx;
-        }
-
-        alarm->pending_idx = new_idx;
+        alarm_context_heap_up(context, new_idx);
     } else {
+        CLOCK old_clk;
+
         /* Already pending: modify.  */
 
+        old_clk = context->pending_alarms[idx].clk;
         context->pending_alarms[idx].clk = cpu_clk;
-        if (context->next_pending_alarm_clk > cpu_clk
-            || idx == context->next_pending_alarm_idx) {
-            alarm_context_update_next_pending(context);
+        if (cpu_clk < old_clk) {
+            alarm_context_heap_up(context, (unsigned int)idx);
+        } else if (cpu_clk > old_clk) {
+            alarm_context_heap_down(context, (unsigned int)idx);
         }
     }
+
+    alarm_context_update_next_pending(context);
 }
 
 #endif
@@ -34,6 +34,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+#include "rewind.h"
 #include "uiactions.h"
 #include "uiapi.h"
 #include "uisnapshot.h"
@@ -66,6 +67,12 @@ static void snapshot_quicksave_action(void)
 {
     ui_snapshot_quicksave_snapshot();
 }
+
+/** \brief  Go back to the newest state in the rewind buffer */
+static void snapshot_rewind_action(void)
+{
+    rewind_trigger_step_back(1);
+}
 /* }}} */
 
 /* {{{ History actions */
@@ -134,6 +141,10 @@ static const ui_action_map_t snapshot_actions[] = {
         .action = ACTION_SNAPSHOT_QUICKSAVE,
         .handler = snapshot_quicksave_action
     },
+    {
+        .action = ACTION_SNAPSHOT_REWIND,
+        .handler = snapshot_rewind_action
+    },
 
     /* History actions */
     {
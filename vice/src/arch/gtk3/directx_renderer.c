@@ -36,6 +36,7 @@
 #include <gtk/gtk.h>
 #include <gdk/gdkwin32.h>
 #include <math.h>
+#include <string.h>
 #include <windows.h>
 #include <strsafe.h>
 
@@ -263,7 +264,7 @@ static void vice_directx_update_context(video_canvas_t *canvas, unsigned int wid
     CANVAS_UNLOCK();
 }
 
-/** \brief It's time to draw a complete emulated frame */
+/** \brief It's time to draw the part of the emulated frame that changed */
 static void vice_directx_refresh_rect(video_canvas_t *canvas,
                                      unsigned int xs, unsigned int ys,
                                      unsigned int xi, unsigned int yi,
@@ -271,6 +272,11 @@ static void vice_directx_refresh_rect(video_canvas_t *canvas,
 {
     context_t *context;
     backbuffer_t *backbuffer;
+    unsigned char *frame;
+    bool frame_is_new;
+    unsigned int width;
+    unsigned int height;
+    float pixel_aspect_ratio;
     int pixel_data_size_bytes;
 
     CANVAS_LOCK();
@@ -281,24 +287,56 @@ static void vice_directx_refresh_rect(video_canvas_t *canvas,
         return;
     }
 
-    /* Obtain an unused backbuffer to render to */
-    pixel_data_size_bytes = context->emulated_width_next * context->emulated_height_next * 4;
-    backbuffer = render_queue_get_from_pool(context->render_queue, pixel_data_size_bytes);
+    width = context->emulated_width_next;
+    height = context->emulated_height_next;
+    pixel_aspect_ratio = context->pixel_aspect_ratio_next;
+    pixel_data_size_bytes = width * height * 4;
 
-    if (!backbuffer) {
+    if (pixel_data_size_bytes <= 0) {
         CANVAS_UNLOCK();
         return;
     }
 
-    backbuffer->width = context->emulated_width_next;
-    backbuffer->height = context->emulated_height_next;
-    backbuffer->pixel_aspect_ratio = context->pixel_aspect_ratio_next;
-    backbuffer->interlaced = canvas->videoconfig->interlaced;
-    backbuffer->interlace_field = canvas->videoconfig->interlace_field;
+    /* Render into the complete frame, which keeps the lines outside the rect */
+    frame = render_queue_get_frame(context->render_queue, pixel_data_size_bytes, &frame_is_new);
 
     CANVAS_UNLOCK();
 
-    video_canvas_render(canvas, backbuffer->pixel_data, w, h, xs, ys, xi, yi, backbuffer->width * 4);
+    if (frame_is_new) {
+        /* Nothing to keep yet, so the whole frame is needed */
+        video_canvas_refresh_all(canvas);
+        return;
+    }
+
+    if (h == 0) {
+        /* Nothing changed, just show the last frame again */
+        CANVAS_LOCK();
+        if (context->render_thread) {
+            render_thread_push_job(context->render_thread, render_thread_render);
+        }
+        CANVAS_UNLOCK();
+        return;
+    }
+
+    video_canvas_render(canvas, frame, w, h, xs, ys, xi, yi, width * 4);
+
+    /*
+     * Obtain an unused backbuffer to pass the frame to the render thread.
+     * This may wait for the render thread, so the canvas must not be locked.
+     */
+    backbuffer = render_queue_get_from_pool(context->render_queue, pixel_data_size_bytes);
+
+    if (!backbuffer) {
+        return;
+    }
+
+    memcpy(backbuffer->pixel_data, frame, pixel_data_size_bytes);
+
+    backbuffer->width = width;
+    backbuffer->height = height;
+    backbuffer->pixel_aspect_ratio = pixel_aspect_ratio;
+    backbuffer->interlaced = canvas->videoconfig->interlaced;
+    backbuffer->interlace_field = canvas->videoconfig->interlace_field;
 
     CANVAS_LOCK();
     render_queue_enqueue_for_display(context->render_queue, backbuffer);
@@ -343,13 +381,33 @@ static void vice_directx_set_palette(video_canvas_t *canvas)
     video_render_initraw(canvas->videoconfig);
 }
 
+/** \brief Get the statistics of the render queue */
+static int vice_directx_get_queue_stats(video_canvas_t *canvas, video_render_queue_stats_t *stats)
+{
+    context_t *context;
+    int result = -1;
+
+    CANVAS_LOCK();
+
+    context = canvas->renderer_context;
+    if (context && context->render_queue) {
+        render_queue_get_stats(context->render_queue, stats);
+        result = 0;
+    }
+
+    CANVAS_UNLOCK();
+
+    return result;
+}
+
 vice_renderer_backend_t vice_directx_backend = {
     vice_directx_initialise_canvas,
     vice_directx_update_context,
     vice_directx_destroy_context,
     vice_directx_refresh_rect,
     vice_directx_on_ui_frame_clock,
-    vice_directx_set_palette
+    vice_directx_set_palette,
+    vice_directx_get_queue_stats
 };
 
 #endif
@@ -33,6 +33,7 @@
 #include <assert.h>
 #include <gtk/gtk.h>
 #include <math.h>
+#include <string.h>
 
 #ifdef MACOS_COMPILE
 #include <CoreGraphics/CGDirectDisplay.h>
@@ -200,6 +201,7 @@ static void on_widget_realized(GtkWidget *widget, gpointer data)
 
     glGenTextures(1, &context->current_frame_texture);
     glGenTextures(1, &context->previous_frame_texture);
+    context->current_frame_valid = false;
 
     vice_opengl_renderer_clear_current(context);
 
@@ -326,7 +328,7 @@ static void vice_opengl_update_context(video_canvas_t *canvas, unsigned int widt
     CANVAS_UNLOCK();
 }
 
-/** \brief It's time to draw a complete emulated frame */
+/** \brief It's time to draw the part of the emulated frame that changed */
 static void vice_opengl_refresh_rect(video_canvas_t *canvas,
                                      unsigned int xs, unsigned int ys,
                                      unsigned int xi, unsigned int yi,
@@ -334,6 +336,11 @@ static void vice_opengl_refresh_rect(video_canvas_t *canvas,
 {
     context_t *context;
     backbuffer_t *backbuffer;
+    unsigned char *frame;
+    bool frame_is_new;
+    unsigned int width;
+    unsigned int height;
+    float pixel_aspect_ratio;
     int pixel_data_size_bytes;
 
     CANVAS_LOCK();
@@ -344,32 +351,68 @@ static void vice_opengl_refresh_rect(video_canvas_t *canvas,
         return;
     }
 
-    /* Obtain an unused backbuffer to render to */
-    pixel_data_size_bytes = context->emulated_width_next * context->emulated_height_next * 4;
-    backbuffer = render_queue_get_from_pool(context->render_queue, pixel_data_size_bytes);
+    width = context->emulated_width_next;
+    height = context->emulated_height_next;
+    pixel_aspect_ratio = context->pixel_aspect_ratio_next;
+    pixel_data_size_bytes = width * height * 4;
 
-    if (!backbuffer) {
+    if (pixel_data_size_bytes <= 0) {
         CANVAS_UNLOCK();
         return;
     }
 
-    backbuffer->width = context->emulated_width_next;
-    backbuffer->height = context->emulated_height_next;
-    backbuffer->pixel_aspect_ratio = context->pixel_aspect_ratio_next;
-    backbuffer->interlaced = canvas->videoconfig->interlaced;
-    backbuffer->interlace_field = canvas->videoconfig->interlace_field;
+    /* Render into the complete frame, which keeps the lines outside the rect */
+    frame = render_queue_get_frame(context->render_queue, pixel_data_size_bytes, &frame_is_new);
 
     CANVAS_UNLOCK();
 
-    video_canvas_render(canvas, backbuffer->pixel_data, w, h, xs, ys, xi, yi, backbuffer->width * 4);
+    if (frame_is_new) {
+        /* Nothing to keep yet, so the whole frame is needed */
+        video_canvas_refresh_all(canvas);
+        return;
+    }
+
+    if (h == 0) {
+        /* Nothing changed, just show the last frame again */
+        CANVAS_LOCK();
+        if (context->render_thread) {
+            render_thread_push_job(context->render_thread, render_thread_render);
+        }
+        CANVAS_UNLOCK();
+        return;
+    }
+
+    video_canvas_render(canvas, frame, w, h, xs, ys, xi, yi, width * 4);
+
+    /* A skipped frame leaves a gap in the serials, forcing a full upload */
+    context->frame_serial++;
+
+    /*
+     * Obtain an unused backbuffer to pass the frame to the render thread.
+     * This may wait for the render thread, so the canvas must not be locked.
+     */
+    backbuffer = render_queue_get_from_pool(context->render_queue, pixel_data_size_bytes);
+
+    if (!backbuffer) {
+        return;
+    }
+
+    memcpy(backbuffer->pixel_data, frame, pixel_data_size_bytes);
+
+    backbuffer->width = width;
+    backbuffer->height = height;
+    backbuffer->pixel_aspect_ratio = pixel_aspect_ratio;
+    backbuffer->interlaced = canvas->videoconfig->interlaced;
+    backbuffer->interlace_field = canvas->videoconfig->interlace_field;
+    backbuffer->serial = context->frame_serial;
+    backbuffer->dirty_y = yi < height ? yi : height;
+    backbuffer->dirty_height = h < height - backbuffer->dirty_y ? h : height - backbuffer->dirty_y;
 
     CANVAS_LOCK();
+    /* If the thread no longer runs, the queue frees the backbuffer when destroyed */
+    render_queue_enqueue_for_display(context->render_queue, backbuffer);
     if (context->render_thread) {
-        render_queue_enqueue_for_display(context->render_queue, backbuffer);
         render_thread_push_job(context->render_thread, render_thread_render);
-    } else {
-        /* Thread no longer running, probably shutting down */
-        render_queue_return_to_pool(context->render_queue, backbuffer);
     }
     CANVAS_UNLOCK();
 }
@@ -488,10 +531,21 @@ static void vice_opengl_on_ui_frame_clock(GdkFrameClock *clock, video_canvas_t *
 
 static void update_frame_textures(context_t *context, backbuffer_t *backbuffer)
 {
+    bool partial;
+
     /*
-     * Update the OpenGL texture with the new backbuffer bitmap
+     * Update the OpenGL texture with the new backbuffer bitmap. If the texture
+     * holds the frame just before this one, only the dirty lines are uploaded.
      */
 
+    partial = context->current_frame_valid
+              && backbuffer->serial == context->current_frame_serial + 1
+              && !backbuffer->interlaced
+              && !context->interlaced
+              && backbuffer->interlace_field == context->current_interlace_field
+              && backbuffer->width == context->current_frame_width
+              && backbuffer->height == context->current_frame_height;
+
     if (backbuffer->interlace_field != context->current_interlace_field) {
         /* Retain the previous texture to use in interlaced mode */
         GLuint swap_texture                 = context->previous_frame_texture;
@@ -511,7 +565,16 @@ static void update_frame_textures(context_t *context, backbuffer_t *backbuffer)
     glBindTexture(GL_TEXTURE_2D, context->current_frame_texture);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glPixelStorei(GL_UNPACK_ROW_LENGTH, backbuffer->width);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, backbuffer->width, backbuffer->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, backbuffer->pixel_data);
+    if (partial) {
+        if (backbuffer->dirty_height) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, backbuffer->dirty_y, backbuffer->width, backbuffer->dirty_height, GL_RGBA, GL_UNSIGNED_BYTE,
+                            backbuffer->pixel_data + backbuffer->dirty_y * backbuffer->width * 4);
+        }
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, backbuffer->width, backbuffer->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, backbuffer->pixel_data);
+    }
+    context->current_frame_serial = backbuffer->serial;
+    context->current_frame_valid = true;
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -967,11 +1030,31 @@ static GLuint create_shader_program(char *vertex_shader_filename, char *fragment
 
 /******/
 
+/** \brief Get the statistics of the render queue */
+static int vice_opengl_get_queue_stats(video_canvas_t *canvas, video_render_queue_stats_t *stats)
+{
+    context_t *context;
+    int result = -1;
+
+    CANVAS_LOCK();
+
+    context = canvas->renderer_context;
+    if (context && context->render_queue) {
+        render_queue_get_stats(context->render_queue, stats);
+        result = 0;
+    }
+
+    CANVAS_UNLOCK();
+
+    return result;
+}
+
 vice_renderer_backend_t vice_opengl_backend = {
     vice_opengl_initialise_canvas,
     vice_opengl_update_context,
     vice_opengl_destroy_context,
     vice_opengl_refresh_rect,
     vice_opengl_on_ui_frame_clock,
-    vice_opengl_set_palette
+    vice_opengl_set_palette,
+    vice_opengl_get_queue_stats
 };
@@ -143,6 +143,10 @@ typedef struct vice_opengl_renderer_context_s {
     int current_interlace_field;
     float pixel_aspect_ratio;
 
+    /** \brief serial of the frame in the texture, if current_frame_valid */
+    unsigned int current_frame_serial;
+    bool current_frame_valid;
+
     /** \brief The texture identifier for the GPU's copy of our  machine display. */
     GLuint previous_frame_texture;
     unsigned int previous_frame_width;
@@ -157,6 +161,9 @@ typedef struct vice_opengl_renderer_context_s {
     /** \brief pixel aspect ratio of the next frame to be emulated */
     float pixel_aspect_ratio_next;
 
+    /** \brief serial of the last frame rendered by the emulation */
+    unsigned int frame_serial;
+
     /** \brief when the last frame was rendered */
     unsigned long last_render_time;
 
@@ -25,41 +25,110 @@
  *
  */
 
+
+/*
+ * The emulation thread takes a backbuffer from the pool, renders into it and
+ * queues it for display. The render thread takes it from the queue, displays
+ * it and returns it to the pool. Both the pool and the display queue are rings
+ * written by one thread only, so neither side ever waits for a lock.
+ *
+ * When too many frames are waiting, the emulation thread either takes the
+ * oldest one back from the display queue (dropping it), or waits for the
+ * render thread if RenderQueueBlock is set.
+ */
+
 #include "vice.h"
 #include "render_queue.h"
 
-#include <assert.h>
-#include <pthread.h>
+#include <stdatomic.h>
 #include <string.h>
 
+#include "archdep.h"
 #include "lib.h"
+#include "video.h"
 #include "vsyncapi.h"
 
-#define LOCK() pthread_mutex_lock(&rq->lock)
-#define UNLOCK() pthread_mutex_unlock(&rq->lock)
+/** Slots in a ring, a power of two above RENDER_QUEUE_MAX_BACKBUFFERS */
+#define RING_SIZE 16
 
-typedef struct vice_render_queue_s {
-    pthread_mutex_t lock;
+/** How long the emulation thread waits for the render thread per try */
+#define WAIT_STEP_TICKS (tick_per_second() / 2000)
+
+/** After this long waiting, the oldest frame is dropped anyway */
+#define WAIT_MAX_TICKS (tick_per_second() / 10)
 
-    /** Holds all currently unused backbuffers */
-    backbuffer_t *backbuffer_stack[RENDER_QUEUE_MAX_BACKBUFFERS];
+/** A ring of backbuffers. Only one thread pushes, either thread may pop. */
+typedef struct ring_s {
+    backbuffer_t *_Atomic slots[RING_SIZE];
+    /** Count of pops, the next slot to pop */
+    atomic_uint head;
+    /** Count of pushes, the next slot to push */
+    atomic_uint tail;
+} ring_t;
 
-    /** How many unused backbuffers in the stack */
-    unsigned int backbuffer_stack_size;
+typedef struct vice_render_queue_s {
+    /** Holds all currently unused backbuffers, pushed by the render thread */
+    ring_t pool;
 
-    /** Holds the queue of backbuffers ready to render */
-    backbuffer_t *render_queue[RENDER_QUEUE_MAX_BACKBUFFERS];
+    /** Holds the queue of backbuffers ready to render, pushed by the emulation thread */
+    ring_t display;
 
-    /** How many backbuffers in render queue */
-    unsigned int render_queue_length;
+    /** The complete current frame, partial refreshes only update some lines of it */
+    unsigned char *frame;
 
-    /** Index of next backbuffer to render in render_queue */
-    unsigned int render_queue_next;
+    /** Size of the current frame */
+    unsigned int frame_size_bytes;
 
-    /** Allows discarding of late buffer returns */
-    unsigned int backbuffer_generation;
+    /** Statistics, each written by one thread only */
+    atomic_uint frames_queued;
+    atomic_uint frames_displayed;
+    atomic_uint frames_dropped;
+    atomic_uint latency_avg_us;
+    atomic_uint latency_max_us;
+    atomic_uint wait_ms;
 } render_queue_t;
 
+/** Most frames waiting for display, RenderQueueDepth */
+static atomic_int queue_depth = 2;
+
+/** Wait for the render thread instead of dropping frames, RenderQueueBlock */
+static atomic_int queue_block = 0;
+
+static void ring_push(ring_t *ring, backbuffer_t *backbuffer)
+{
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    atomic_store_explicit(&ring->slots[tail % RING_SIZE], backbuffer, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+static backbuffer_t *ring_pop(ring_t *ring)
+{
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    backbuffer_t *backbuffer;
+
+    /*
+     * The counters only ever grow, so a slot read here is still valid
+     * if the head didn't move in the meantime.
+     */
+    do {
+        if (head == atomic_load_explicit(&ring->tail, memory_order_acquire)) {
+            return NULL;
+        }
+        backbuffer = atomic_load_explicit(&ring->slots[head % RING_SIZE], memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&ring->head, &head, head + 1,
+                                                    memory_order_acq_rel, memory_order_acquire));
+
+    return backbuffer;
+}
+
+static unsigned int ring_length(ring_t *ring)
+{
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    return atomic_load_explicit(&ring->tail, memory_order_acquire) - head;
+}
+
 static void free_backbuffer(backbuffer_t *backbuffer) {
     lib_free(backbuffer->pixel_data);
     lib_free(backbuffer);
@@ -74,19 +143,14 @@ void *render_queue_create(void)
     backbuffer_t *bb;
 
     rq = lib_calloc(1, sizeof(render_queue_t));
-    pthread_mutex_init(&rq->lock, NULL);
 
-    /* Seed the pool with the maximum number of backbuffers */
+    /* Seed the pool with the maximum number of backbuffers, which only get memory when used */
     for (int i = 0; i < RENDER_QUEUE_MAX_BACKBUFFERS; i++) {
 
-        bb = lib_malloc(sizeof(backbuffer_t));
+        bb = lib_calloc(1, sizeof(backbuffer_t));
         bb->pixel_data = lib_malloc(0);
-        bb->pixel_data_size_bytes = 0;
-        bb->width = 0;
-        bb->height = 0;
-        bb->pixel_aspect_ratio = 0.0f;
 
-        rq->backbuffer_stack[rq->backbuffer_stack_size++] = bb;
+        ring_push(&rq->pool, bb);
     }
 
     return rq;
@@ -96,44 +160,86 @@ void *render_queue_create(void)
 void render_queue_destroy(void *render_queue)
 {
     render_queue_t *rq = (render_queue_t *)render_queue;
-    int i;
+    backbuffer_t *bb;
 
     /* The unused backbuffers */
-    for (i = 0; i < rq->backbuffer_stack_size; i++) {
-        free_backbuffer(rq->backbuffer_stack[i]);
+    while ((bb = ring_pop(&rq->pool)) != NULL) {
+        free_backbuffer(bb);
     }
 
     /* The backbuffers queued for rendering */
-    for (i = 0; i < rq->render_queue_length; i++) {
-        free_backbuffer(rq->render_queue[rq->render_queue_next++]);
-        rq->render_queue_next = rq->render_queue_next % RENDER_QUEUE_MAX_BACKBUFFERS;
+    while ((bb = ring_pop(&rq->display)) != NULL) {
+        free_backbuffer(bb);
     }
 
-    pthread_mutex_destroy(&rq->lock);
+    lib_free(rq->frame);
     lib_free(render_queue);
 }
 
 /****/
 
-/** Obtain unused backbuffer for offscreen rendering, or NULL if none available */
+/** Obtain the complete current frame. When the size changes the contents are
+ *  lost, and is_new is set to tell that the whole frame must be rendered. */
+unsigned char *render_queue_get_frame(void *render_queue, int pixel_data_size_bytes, bool *is_new)
+{
+    render_queue_t *rq = (render_queue_t *)render_queue;
+
+    *is_new = false;
+
+    if (!rq->frame || rq->frame_size_bytes != (unsigned int)pixel_data_size_bytes) {
+        lib_free(rq->frame);
+        rq->frame = lib_calloc(1, pixel_data_size_bytes);
+        rq->frame_size_bytes = pixel_data_size_bytes;
+        *is_new = true;
+    }
+
+    return rq->frame;
+}
+
+/** Obtain unused backbuffer for offscreen rendering, or NULL if none available.
+ *  Only called by the emulation thread. */
 backbuffer_t *render_queue_get_from_pool(void *render_queue, int pixel_data_size_bytes)
 {
     render_queue_t *rq = (render_queue_t *)render_queue;
-    backbuffer_t *bb;
+    backbuffer_t *bb = NULL;
+    unsigned int depth = (unsigned int)atomic_load(&queue_depth);
+    tick_t wait_start = 0;
+    bool waited = false;
+
+    /* Make room if too many frames are waiting for display */
+    while (ring_length(&rq->display) >= depth) {
+        if (atomic_load(&queue_block)) {
+            if (!waited) {
+                wait_start = tick_now();
+                waited = true;
+            }
+            if (tick_now_delta(wait_start) < WAIT_MAX_TICKS) {
+                tick_sleep(WAIT_STEP_TICKS);
+                continue;
+            }
+        }
+
+        bb = ring_pop(&rq->display);
+        if (bb) {
+            atomic_fetch_add(&rq->frames_dropped, 1);
+            break;
+        }
+    }
 
-    LOCK();
+    if (waited) {
+        atomic_fetch_add(&rq->wait_ms, TICK_TO_MILLI(tick_now_delta(wait_start)));
+    }
+
+    if (!bb) {
+        bb = ring_pop(&rq->pool);
+    }
 
-    if (!rq->backbuffer_stack_size) {
+    if (!bb) {
         /* no buffers available, skip this frame */
-        UNLOCK();
+        atomic_fetch_add(&rq->frames_dropped, 1);
         return NULL;
     }
 
-    bb = rq->backbuffer_stack[rq->backbuffer_stack_size - 1];
-    rq->backbuffer_stack_size--;
-
-    UNLOCK();
-
     /* Make sure there's at least the requested size in bytes */
     if (bb->pixel_data_size_bytes < pixel_data_size_bytes) {
         lib_free(bb->pixel_data);
@@ -144,72 +250,91 @@ backbuffer_t *render_queue_get_from_pool(void *render_queue, int pixel_data_size
     bb->width = 0;
     bb->height = 0;
     bb->pixel_aspect_ratio = 0.0f;
+    bb->serial = 0;
+    bb->dirty_y = 0;
+    bb->dirty_height = 0;
 
     return bb;
 }
 
-/** Add backbuffer to the queue of backbuffers to be displayed */
+/** Add backbuffer to the queue of backbuffers to be displayed.
+ *  Only called by the emulation thread. */
 void render_queue_enqueue_for_display(void *render_queue, backbuffer_t *backbuffer)
 {
     render_queue_t *rq = (render_queue_t *)render_queue;
 
-    LOCK();
-
-    assert(rq->render_queue_length < RENDER_QUEUE_MAX_BACKBUFFERS);
-
-    rq->render_queue[(rq->render_queue_next + rq->render_queue_length) % RENDER_QUEUE_MAX_BACKBUFFERS] = backbuffer;
-    rq->render_queue_length++;
-
-    UNLOCK();
+    backbuffer->queued_tick = tick_now();
+    ring_push(&rq->display, backbuffer);
+    atomic_fetch_add(&rq->frames_queued, 1);
 }
 
 unsigned int render_queue_length(void *render_queue)
 {
     render_queue_t *rq = (render_queue_t *)render_queue;
 
-    unsigned int render_queue_length;
-
-    LOCK();
-
-    render_queue_length = rq->render_queue_length;
-
-    UNLOCK();
-
-    return render_queue_length;
+    return ring_length(&rq->display);
 }
 
-/** Obtain rendered backbuffer for display, or NULL if none available */
+/** Obtain rendered backbuffer for display, or NULL if none available.
+ *  Only called by the render thread. */
 backbuffer_t *render_queue_dequeue_for_display(void *render_queue)
 {
     render_queue_t *rq = (render_queue_t *)render_queue;
+    backbuffer_t *backbuffer;
+    unsigned int latency;
+    unsigned int avg;
 
-    LOCK();
-
-    /* Are there any available? */
-    if (!rq->render_queue_length) {
-        UNLOCK();
+    backbuffer = ring_pop(&rq->display);
+    if (!backbuffer) {
         return NULL;
     }
 
-    void *backbuffer = rq->render_queue[rq->render_queue_next];
-    rq->render_queue_next = (rq->render_queue_next + 1) % RENDER_QUEUE_MAX_BACKBUFFERS;
-    rq->render_queue_length--;
+    latency = TICK_TO_MICRO(tick_now_delta(backbuffer->queued_tick));
 
-    UNLOCK();
+    /* Moving average over roughly the last 16 frames */
+    avg = atomic_load(&rq->latency_avg_us);
+    atomic_store(&rq->latency_avg_us, avg - avg / 16 + latency / 16);
+    if (latency > atomic_load(&rq->latency_max_us)) {
+        atomic_store(&rq->latency_max_us, latency);
+    }
+    atomic_fetch_add(&rq->frames_displayed, 1);
 
     return backbuffer;
 }
 
+/** Return a displayed backbuffer to the pool. Only called by the render thread. */
 void render_queue_return_to_pool(void *render_queue, backbuffer_t *backbuffer)
 {
     render_queue_t *rq = (render_queue_t *)render_queue;
 
-    LOCK();
+    ring_push(&rq->pool, backbuffer);
+}
+
+/****/
+
+/** Set how many frames may wait for display, from RenderQueueDepth */
+void render_queue_set_depth(int depth)
+{
+    atomic_store(&queue_depth, depth);
+}
 
-    assert(rq->backbuffer_stack_size < RENDER_QUEUE_MAX_BACKBUFFERS);
+/** Set whether to wait for the render thread instead of dropping frames, from RenderQueueBlock */
+void render_queue_set_block(int block)
+{
+    atomic_store(&queue_block, block);
+}
 
-    rq->backbuffer_stack[rq->backbuffer_stack_size] = backbuffer;
-    rq->backbuffer_stack_size++;
+/** Get the statistics of a render queue */
+void render_queue_get_stats(void *render_queue, video_render_queue_stats_t *stats)
+{
+    render_queue_t *rq = (render_queue_t *)render_queue;
 
-    UNLOCK();
+    stats->depth = (unsigned int)atomic_load(&queue_depth);
+    stats->length = ring_length(&rq->display);
+    stats->frames_queued = atomic_load(&rq->frames_queued);
+    stats->frames_displayed = atomic_load(&rq->frames_displayed);
+    stats->frames_dropped = atomic_load(&rq->frames_dropped);
+    stats->latency_avg_us = atomic_load(&rq->latency_avg_us);
+    stats->latency_max_us = atomic_load(&rq->latency_max_us);
+    stats->wait_ms = atomic_load(&rq->wait_ms);
 }
@@ -27,9 +27,16 @@
 #ifndef VICE_RENDER_QUEUE_H
 #define VICE_RENDER_QUEUE_H
 
-#define RENDER_QUEUE_MAX_BACKBUFFERS 2
+/** Most frames that may wait for display, see the RenderQueueDepth resource */
+#define RENDER_QUEUE_MAX_DEPTH 8
+
+/** Waiting frames plus the ones being rendered and displayed */
+#define RENDER_QUEUE_MAX_BACKBUFFERS (RENDER_QUEUE_MAX_DEPTH + 2)
 
 #include <stdbool.h>
+#include <stdint.h>
+
+struct video_render_queue_stats_s;
 
 typedef struct {
     bool interlaced;
@@ -39,15 +46,26 @@ typedef struct {
     unsigned int width;
     unsigned int height;
     float pixel_aspect_ratio;
+    /* Number of the frame, consecutive frames only differ in the dirty lines */
+    unsigned int serial;
+    unsigned int dirty_y;
+    unsigned int dirty_height;
+    /* tick_now() when queued for display */
+    uint32_t queued_tick;
 } backbuffer_t;
 
 void *render_queue_create(void);
 void render_queue_destroy(void *render_queue);
 
+unsigned char *render_queue_get_frame(void *render_queue, int pixel_data_size_bytes, bool *is_new);
 backbuffer_t *render_queue_get_from_pool(void *render_queue, int pixel_data_size_bytes);
 void render_queue_enqueue_for_display(void *render_queue, backbuffer_t *backbuffer);
 unsigned int render_queue_length(void *render_queue);
 backbuffer_t *render_queue_dequeue_for_display(void *render_queue);
 void render_queue_return_to_pool(void *render_queue, backbuffer_t *backbuffer);
 
+void render_queue_set_depth(int depth);
+void render_queue_set_block(int block);
+void render_queue_get_stats(void *render_queue, struct video_render_queue_stats_s *stats);
+
 #endif /* #ifndef VICE_RENDER_QUEUE_H */
@@ -40,6 +40,7 @@
 #include "machine.h"
 #include "palette.h"
 #include "raster.h"
+#include "render_queue.h"
 #include "resources.h"
 #include "ui.h"
 #include "videoarch.h"
@@ -201,16 +202,89 @@ void video_arch_canvas_init(struct video_canvas_s *canvas)
      * it's not a direct video memory buffer.
      */
     canvas->videoconfig->readable = 1;
+
+    /* the renderer backends keep the complete frame between refreshes */
+    canvas->draw_buffer->refresh_partial = 1;
+}
+
+
+/** \brief  Number of frames that may wait for display (RenderQueueDepth)
+ */
+static int render_queue_depth = 2;
+
+/** \brief  Wait for the display instead of dropping frames (RenderQueueBlock)
+ */
+static int render_queue_block = 0;
+
+
+/** \brief  Set RenderQueueDepth resource (integer)
+ *
+ * \param[in]   val     new value
+ * \param[in]   param   extra parameter (unused)
+ *
+ * \return 0 on success, -1 on invalid value
+ */
+static int set_render_queue_depth(int val, void *param)
+{
+    if (val < 1 || val > RENDER_QUEUE_MAX_DEPTH) {
+        return -1;
+    }
+    render_queue_depth = val;
+    render_queue_set_depth(val);
+    return 0;
+}
+
+
+/** \brief  Set RenderQueueBlock resource (bool)
+ *
+ * \param[in]   val     new value
+ * \param[in]   param   extra parameter (unused)
+ *
+ * \return 0
+ */
+static int set_render_queue_block(int val, void *param)
+{
+    render_queue_block = val ? 1 : 0;
+    render_queue_set_block(render_queue_block);
+    return 0;
 }
 
 
+/** \brief  Arch-specific video resources
+ */
+static const resource_int_t resources_int[] = {
+    { "RenderQueueDepth", 2, RES_EVENT_NO, NULL,
+        &render_queue_depth, set_render_queue_depth, NULL },
+    { "RenderQueueBlock", 0, RES_EVENT_NO, NULL,
+        &render_queue_block, set_render_queue_block, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+
+/** \brief  Arch-specific video command line options
+ */
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-renderqueuedepth", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+        NULL, NULL, "RenderQueueDepth", NULL,
+        "<frames>", "Number of frames that may wait for display (1-8)" },
+    { "-renderqueueblock", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+        NULL, NULL, "RenderQueueBlock", (void *)1,
+        NULL, "Wait for the display when the render queue is full" },
+    { "+renderqueueblock", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+        NULL, NULL, "RenderQueueBlock", (void *)0,
+        NULL, "Drop the oldest frame when the render queue is full" },
+    CMDLINE_LIST_END
+};
+
+
 /** \brief  Initialize command line options for generic video resouces
  *
  * \return  0 on success, < 0 on failure
  */
 int video_arch_cmdline_options_init(void)
 {
-    return 0;
+    return cmdline_register_options(cmdline_options);
 }
 
 
@@ -220,7 +294,7 @@ int video_arch_cmdline_options_init(void)
  */
 int video_arch_resources_init(void)
 {
-    return 0;
+    return resources_register_int(resources_int);
 }
 
 /** \brief Clean up any memory held by arch-specific video resources. */
@@ -328,6 +402,20 @@ void video_canvas_refresh(struct video_canvas_s *canvas,
     }
 }
 
+/** \brief Get the statistics of the queue of frames to display.
+ *  \param canvas The canvas whose queue to query
+ *  \param stats  Filled in with the statistics
+ *  \return 0 on success, -1 if the renderer has no queue (yet)
+ */
+int video_canvas_get_render_queue_stats(struct video_canvas_s *canvas,
+                                        video_render_queue_stats_t *stats)
+{
+    if (!canvas || !canvas->renderer_backend) {
+        return -1;
+    }
+    return canvas->renderer_backend->get_queue_stats(canvas, stats);
+}
+
 /** \brief Update canvas size to match the draw buffer size requested
  *         by the emulation core.
  * \param canvas The video canvas to update.
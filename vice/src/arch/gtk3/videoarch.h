@@ -220,6 +220,14 @@ typedef struct vice_renderer_backend_s {
      * \param canvas The canvas being initialized
      */
     void (*set_palette)(video_canvas_t *canvas);
+    /** \brief Get the statistics of the queue of frames to display.
+     *
+     * \param canvas The canvas whose queue to query
+     * \param stats  Filled in with the statistics
+     *
+     * \return 0 on success, -1 if the canvas has no queue (yet)
+     */
+    int (*get_queue_stats)(video_canvas_t *canvas, video_render_queue_stats_t *stats);
 } vice_renderer_backend_t;
 
 #endif
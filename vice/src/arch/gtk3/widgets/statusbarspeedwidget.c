@@ -51,6 +51,7 @@
 #include "uiactions.h"
 #include "uimenu.h"
 #include "uistatusbar.h"
+#include "video.h"
 #include "vsync.h"
 #include "vsyncapi.h"
 
@@ -360,6 +361,7 @@ GtkWidget *statusbar_speed_widget_create(statusbar_speed_widget_state_t *state)
     state->last_shiftlock = -1;
     state->last_mode4080 = -1;
     state->last_diagnostic_pin = -1;
+    state->last_queue_tooltip[0] = '\0';
 
     grid = gtk_grid_new();
     gtk_widget_set_valign(grid, GTK_ALIGN_START);
@@ -479,6 +481,8 @@ void statusbar_speed_widget_update(GtkWidget *widget,
     double vsync_metric_cpu_percent;
     double vsync_metric_emulated_fps;
     int vsync_metric_warp_enabled;
+    video_canvas_t *canvas;
+    video_render_queue_stats_t queue_stats;
     tick_t now;
 
     /*
@@ -633,6 +637,25 @@ void statusbar_speed_widget_update(GtkWidget *widget,
         }
     }
 
+    /* Frame pacing statistics of the display go into the tooltip */
+    canvas = ui_get_canvas_for_window(window_identity);
+    if (canvas != NULL && video_canvas_get_render_queue_stats(canvas, &queue_stats) == 0) {
+        g_snprintf(buffer,
+                   sizeof(buffer),
+                   "Frames displayed: %u, dropped: %u\n"
+                   "Display latency: %.1f ms (max %.1f ms)\n"
+                   "Emulation waited: %u ms",
+                   queue_stats.frames_displayed,
+                   queue_stats.frames_dropped,
+                   queue_stats.latency_avg_us / 1000.0,
+                   queue_stats.latency_max_us / 1000.0,
+                   queue_stats.wait_ms);
+        if (strcmp(buffer, state->last_queue_tooltip) != 0) {
+            gtk_widget_set_tooltip_text(widget, buffer);
+            g_strlcpy(state->last_queue_tooltip, buffer, sizeof(state->last_queue_tooltip));
+        }
+    }
+
 #   undef CPU_DECIMAL_PLACES
 #   undef FPS_DECIMAL_PLACES
 #   undef STR_
@@ -45,6 +45,7 @@ typedef struct statusbar_speed_widget_state_s {
     int last_mode4080;
     int last_capslock;
     int last_diagnostic_pin;
+    char last_queue_tooltip[256];
 } statusbar_speed_widget_state_t;
 
 GtkWidget *speed_menu_popup_create(void);
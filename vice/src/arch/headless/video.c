@@ -168,6 +168,18 @@ void video_canvas_refresh(struct video_canvas_s *canvas,
     /* printf("%s\n", __func__); */
 }
 
+/** \brief Get the statistics of the queue of frames to display.
+ *
+ * The headless UI does not display frames.
+ *
+ * \return -1
+ */
+int video_canvas_get_render_queue_stats(struct video_canvas_s *canvas,
+                                        video_render_queue_stats_t *stats)
+{
+    return -1;
+}
+
 /** \brief Update canvas size to match the draw buffer size requested
  *         by the emulation core.
  * \param canvas The video canvas to update.
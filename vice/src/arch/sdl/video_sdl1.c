@@ -952,6 +952,18 @@ int video_canvas_set_palette(struct video_canvas_s *canvas, struct palette_s *pa
     return 0;
 }
 
+/** \brief Get the statistics of the queue of frames to display.
+ *
+ * The SDL UI displays each frame directly, without a queue.
+ *
+ * \return -1
+ */
+int video_canvas_get_render_queue_stats(struct video_canvas_s *canvas,
+                                        video_render_queue_stats_t *stats)
+{
+    return -1;
+}
+
 /* called from video_viewport_resize */
 void video_canvas_resize(struct video_canvas_s *canvas, char resize_canvas)
 {
@@ -947,6 +947,18 @@ static void sdl_correct_logical_and_minimum_size(void)
     }
 }
 
+/** \brief Get the statistics of the queue of frames to display.
+ *
+ * The SDL UI displays each frame directly, without a queue.
+ *
+ * \return -1
+ */
+int video_canvas_get_render_queue_stats(struct video_canvas_s *canvas,
+                                        video_render_queue_stats_t *stats)
+{
+    return -1;
+}
+
 /** \brief Given a canvas, resizes the associated window to match and allocates textures
  *         for rendering the canvas to the container.
  *
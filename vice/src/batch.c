@@ -0,0 +1,714 @@
+/*
+ * batch.c - Run a list of test programs in one emulator session.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* In batch mode the programs listed in the `-batch' file are autostarted one
+   after the other. A program ends when it writes its exit code to the debug
+   cartridge, or when it runs for more than `-limitcycles' cycles. The machine
+   is then reset and the next program is started, so the emulator and the
+   ROMs are only initialized once for the whole list.
+
+   Speed limiting, rendering of the canvas, sound output and the random
+   autostart delay are disabled while the batch runs. One CSV line per
+   program is written to the summary (stdout unless `-batchsummary' is
+   given):
+
+       program,result,exitcode,cycles
+
+   `result' is one of `exit' (the program wrote to the debug cartridge),
+   `timeout' (the cycle limit was reached), `error' (the program could not
+   be started) or `crash' (the emulator process running it died). The
+   emulator exits with 0 when all programs exited with 0, and with 1
+   otherwise.
+
+   With `-batchjobs', the initialized emulator forks into several worker
+   processes, which share the ROMs and the rest of the startup state
+   copy-on-write. The parent hands out the programs one by one to idle
+   workers and writes the summary, in list order, once all of them are
+   done. Every program starts from the same machine state, so its result
+   does not depend on the worker or on the order.
+
+   The workers are forked while the startup state is the only thing the
+   process has: forking with other threads running would leave the children
+   with locks held by threads that no longer exist. This is why the SID
+   rendering threads are turned off for the batch, and why builds where the
+   emulation runs on its own thread (USE_VICE_THREAD, which the drive,
+   render and encoder thread pools also depend on) run the programs in one
+   process.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_FORK
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "archdep.h"
+#include "autostart.h"
+#include "cmdline.h"
+#include "interrupt.h"
+#include "lib.h"
+#include "log.h"
+#include "machine-video.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "resources.h"
+#include "screenshot.h"
+#include "signals.h"
+#include "types.h"
+#include "util.h"
+#include "vsync.h"
+
+#include "batch.h"
+
+#define BATCH_LINE_MAX  4096
+
+enum {
+    BATCH_RESULT_NONE = 0,
+    BATCH_RESULT_EXIT,
+    BATCH_RESULT_TIMEOUT,
+    BATCH_RESULT_ERROR,
+    BATCH_RESULT_CRASH
+};
+
+static const char * const batch_result_names[] = {
+    "none", "exit", "timeout", "error", "crash"
+};
+
+typedef struct batch_result_s {
+    int result;
+    int exit_code;
+    CLOCK cycles;
+} batch_result_t;
+
+/* Name of the file listing the programs to run.  */
+static char *batch_list_name = NULL;
+
+/* Name of the summary file, stdout if NULL.  */
+static char *batch_summary_name = NULL;
+
+/* Directory for the screenshots taken at the end of each program.  */
+static char *batch_screenshot_dir = NULL;
+
+/* Number of worker processes, 0 for one per CPU.  */
+static int batch_num_jobs = 1;
+
+static char **batch_programs = NULL;
+static int batch_num_programs = 0;
+static int batch_current = -1;
+
+static FILE *batch_summary = NULL;
+
+/* Maximum number of cycles per program, 0 for no limit.  */
+static CLOCK batch_cycle_limit = 0;
+
+/* Machine state before the first program, every program starts from it.  */
+static uint8_t *batch_state = NULL;
+static size_t batch_state_len = 0;
+
+/* Flag: the current program has ended, the next one is pending.  */
+static int batch_program_done = 0;
+
+static int batch_num_failed = 0;
+
+#ifdef HAVE_FORK
+/* Sent by a worker when it has finished a program (or, with `index' -1,
+   when it has just started) and wants the next one.  Smaller than
+   PIPE_BUF, so the messages of several workers never interleave.  */
+typedef struct batch_message_s {
+    int worker;
+    int index;
+    batch_result_t result;
+} batch_message_t;
+
+/* Number of this worker, -1 in the parent or without `-batchjobs'.  */
+static int batch_worker = -1;
+
+/* Pipe to the parent for results, and from the parent for program indices.  */
+static int batch_result_fd = -1;
+static int batch_task_fd = -1;
+
+/* Disk image used by this worker to autostart PRG files, removed at exit.  */
+static char *batch_worker_disk_image = NULL;
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+static int batch_read_list(const char *name)
+{
+    FILE *f;
+    char buf[BATCH_LINE_MAX];
+
+    f = fopen(name, MODE_READ_TEXT);
+    if (f == NULL) {
+        log_error(LOG_DEFAULT, "Batch: cannot open program list `%s'.", name);
+        return -1;
+    }
+
+    while (util_get_line(buf, BATCH_LINE_MAX, f) >= 0) {
+        if (buf[0] == 0 || buf[0] == '#') {
+            continue;
+        }
+        batch_programs = lib_realloc(batch_programs,
+                                     (batch_num_programs + 1) * sizeof(char *));
+        batch_programs[batch_num_programs++] = lib_strdup(buf);
+    }
+    fclose(f);
+
+    if (batch_num_programs == 0) {
+        log_error(LOG_DEFAULT, "Batch: no programs in `%s'.", name);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Add the result of program `index' to the summary.  */
+static void batch_record(int index, const batch_result_t *r)
+{
+    const char *p;
+
+    /* quote the name, it may contain commas */
+    fputc('"', batch_summary);
+    for (p = batch_programs[index]; *p != 0; p++) {
+        if (*p == '"') {
+            fputc('"', batch_summary);
+        }
+        fputc(*p, batch_summary);
+    }
+    fprintf(batch_summary, "\",%s,%d,%"PRIu64"\n",
+            batch_result_names[r->result], r->exit_code, r->cycles);
+    fflush(batch_summary);
+
+    if (r->exit_code != 0) {
+        batch_num_failed++;
+    }
+}
+
+static void batch_finish(void)
+{
+    int failed = batch_num_failed;
+
+#ifdef HAVE_FORK
+    if (batch_worker >= 0) {
+        if (batch_worker_disk_image != NULL) {
+            archdep_remove(batch_worker_disk_image);
+        }
+        batch_shutdown();
+        archdep_vice_exit(0);
+    }
+#endif
+
+    log_message(LOG_DEFAULT, "Batch: %d programs run, %d failed.",
+                batch_num_programs, failed);
+
+    batch_shutdown();
+    archdep_vice_exit(failed ? 1 : 0);
+}
+
+static void batch_save_screenshot(void)
+{
+    char *name;
+
+    name = lib_msprintf("%s" ARCHDEP_DIR_SEP_STR "%d.png",
+                        batch_screenshot_dir, batch_current + 1);
+    if (screenshot_save("PNG", name, machine_video_canvas_get(0)) < 0) {
+        log_warning(LOG_DEFAULT, "Batch: cannot save screenshot `%s'.", name);
+    }
+    lib_free(name);
+}
+
+#ifdef HAVE_FORK
+/* Send `msg' to the parent. A dead parent shows up as an error instead of
+   SIGPIPE.  */
+static int batch_write_message(const batch_message_t *msg)
+{
+    ssize_t len;
+
+    signals_pipe_set();
+    len = write(batch_result_fd, msg, sizeof(*msg));
+    signals_pipe_unset();
+
+    return len == sizeof(*msg) ? 0 : -1;
+}
+#endif
+
+/* Report the result of the current program.  */
+static void batch_write_result(int result, int exit_code, CLOCK cycles)
+{
+    batch_result_t r;
+
+    r.result = result;
+    r.exit_code = exit_code;
+    r.cycles = cycles;
+
+    log_message(LOG_DEFAULT, "Batch: %s: %s(%d) after %"PRIu64" cycles.",
+                batch_programs[batch_current], batch_result_names[result],
+                exit_code, cycles);
+
+    if (batch_screenshot_dir != NULL && result != BATCH_RESULT_ERROR) {
+        batch_save_screenshot();
+    }
+
+#ifdef HAVE_FORK
+    if (batch_worker >= 0) {
+        batch_message_t msg;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.worker = batch_worker;
+        msg.index = batch_current;
+        msg.result = r;
+        if (batch_write_message(&msg) < 0) {
+            log_error(LOG_DEFAULT, "Batch: cannot report to the parent process.");
+            archdep_vice_exit(1);
+        }
+        return;
+    }
+#endif
+
+    batch_record(batch_current, &r);
+}
+
+/* Return the index of the next program to run, -1 when the batch is done.  */
+static int batch_next_program(void)
+{
+#ifdef HAVE_FORK
+    if (batch_worker >= 0) {
+        int index;
+
+        if (read(batch_task_fd, &index, sizeof(index)) != sizeof(index)) {
+            return -1;
+        }
+        return index;
+    }
+#endif
+
+    if (batch_current + 1 < batch_num_programs) {
+        return batch_current + 1;
+    }
+    return -1;
+}
+
+static void batch_run_next(void)
+{
+    if (batch_state == NULL
+        && machine_write_snapshot_memory(&batch_state, &batch_state_len, 0, 0, 0) < 0) {
+        log_warning(LOG_DEFAULT, "Batch: cannot save the initial machine state.");
+        batch_state = NULL;
+    }
+
+    while ((batch_current = batch_next_program()) >= 0) {
+        /* start every program from the same state, regardless of order: a
+           reset alone keeps e.g. the video chip and the drives running */
+        if (batch_state != NULL) {
+            machine_read_snapshot_memory(batch_state, batch_state_len, 0);
+        }
+        lib_rand_seed(lib_rand_get_seed());
+
+        maincpu_clk_limit = batch_cycle_limit;
+        batch_program_done = 0;
+
+        if (autostart_autodetect(batch_programs[batch_current], NULL, 0,
+                                 AUTOSTART_MODE_RUN) >= 0) {
+            return;
+        }
+        batch_write_result(BATCH_RESULT_ERROR, -1, 0);
+    }
+
+    batch_finish();
+}
+
+static void batch_next_trap(uint16_t addr, void *data)
+{
+    batch_run_next();
+}
+
+/* Mark the current program as done and start the next one between two
+   instructions.  */
+static void batch_end_program(int result, int exit_code)
+{
+    if (batch_program_done) {
+        return;
+    }
+    batch_program_done = 1;
+    maincpu_clk_limit = 0;
+
+    /* autostart resets the CPU, which restarts the clock */
+    batch_write_result(result, exit_code, maincpu_clk);
+    interrupt_maincpu_trigger_trap(batch_next_trap, NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef HAVE_FORK
+/* The workers would all write the same disk image when autostarting PRG
+   files, give each of them its own.  */
+static void batch_worker_init_disk_image(void)
+{
+    const char *image;
+    const char *ext;
+
+    if (resources_get_string("AutostartPrgDiskImage", &image) < 0
+        || image == NULL || *image == 0) {
+        return;
+    }
+
+    /* keep the extension, it selects the image type */
+    ext = strrchr(image, '.');
+    if (ext == NULL || strchr(ext, ARCHDEP_DIR_SEP_CHR) != NULL) {
+        ext = image + strlen(image);
+    }
+    batch_worker_disk_image = lib_msprintf("%.*s-%ld%s", (int)(ext - image), image,
+                                           (long)getpid(), ext);
+
+    resources_set_string("AutostartPrgDiskImage", batch_worker_disk_image);
+}
+
+/* Fork `batch_num_jobs' workers and hand out the programs to them. Returns
+   in the workers only, the parent exits when all programs are done.  */
+static int batch_run_jobs(void)
+{
+    int result_pipe[2];
+    int *task_fds;
+    pid_t *pids;
+    batch_result_t *results;
+    batch_message_t msg;
+    int next = 0;
+    int i;
+
+    if (pipe(result_pipe) < 0) {
+        log_error(LOG_DEFAULT, "Batch: cannot create pipe: %s.", strerror(errno));
+        return -1;
+    }
+
+    task_fds = lib_malloc(batch_num_jobs * sizeof(int));
+    pids = lib_malloc(batch_num_jobs * sizeof(pid_t));
+
+    /* don't let the workers inherit buffered output */
+    fflush(NULL);
+
+    for (i = 0; i < batch_num_jobs; i++) {
+        int task_pipe[2];
+
+        if (pipe(task_pipe) < 0) {
+            log_error(LOG_DEFAULT, "Batch: cannot create pipe: %s.", strerror(errno));
+            break;
+        }
+
+        pids[i] = fork();
+        if (pids[i] == 0) {
+            int j;
+
+            for (j = 0; j < i; j++) {
+                close(task_fds[j]);
+            }
+            close(result_pipe[0]);
+            close(task_pipe[1]);
+            lib_free(task_fds);
+            lib_free(pids);
+
+            batch_worker = i;
+            batch_result_fd = result_pipe[1];
+            batch_task_fd = task_pipe[0];
+            batch_worker_init_disk_image();
+
+            /* ask for the first program */
+            memset(&msg, 0, sizeof(msg));
+            msg.worker = i;
+            msg.index = -1;
+            if (batch_write_message(&msg) < 0) {
+                archdep_vice_exit(1);
+            }
+            return 0;
+        }
+
+        close(task_pipe[0]);
+        if (pids[i] < 0) {
+            log_error(LOG_DEFAULT, "Batch: cannot fork: %s.", strerror(errno));
+            close(task_pipe[1]);
+            break;
+        }
+        task_fds[i] = task_pipe[1];
+    }
+    batch_num_jobs = i;
+    close(result_pipe[1]);
+
+    log_message(LOG_DEFAULT, "Batch: running %d programs from `%s' in %d processes.",
+                batch_num_programs, batch_list_name, batch_num_jobs);
+
+    results = lib_calloc(batch_num_programs, sizeof(batch_result_t));
+
+    /* every message is a request for the next program */
+    while (read(result_pipe[0], &msg, sizeof(msg)) == sizeof(msg)) {
+        int task;
+        ssize_t len;
+
+        if (msg.worker < 0 || msg.worker >= batch_num_jobs) {
+            continue;
+        }
+        if (msg.index >= 0 && msg.index < batch_num_programs) {
+            results[msg.index] = msg.result;
+        }
+
+        /* a failed write means the worker has died, which is noticed
+           below; don't let SIGPIPE end the parent */
+        task = next < batch_num_programs ? next++ : -1;
+        signals_pipe_set();
+        len = write(task_fds[msg.worker], &task, sizeof(task));
+        signals_pipe_unset();
+        if (len != sizeof(task)) {
+            continue;
+        }
+    }
+    close(result_pipe[0]);
+
+    /* all workers have exited (or died) */
+    for (i = 0; i < batch_num_jobs; i++) {
+        close(task_fds[i]);
+        waitpid(pids[i], NULL, 0);
+    }
+
+    for (i = 0; i < batch_num_programs; i++) {
+        if (results[i].result == BATCH_RESULT_NONE) {
+            results[i].result = i < next ? BATCH_RESULT_CRASH : BATCH_RESULT_ERROR;
+            results[i].exit_code = -1;
+        }
+        batch_record(i, &results[i]);
+    }
+
+    lib_free(results);
+    lib_free(task_fds);
+    lib_free(pids);
+
+    batch_finish();
+    return 0;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+int batch_is_active(void)
+{
+    return batch_num_programs > 0;
+}
+
+/* Rendering is only needed for the screenshots taken at the end of each
+   program.  */
+int batch_skip_frames(void)
+{
+    return batch_is_active() && batch_screenshot_dir == NULL;
+}
+
+/* Called by the debug cartridges when the program writes its exit code.  */
+void batch_program_exit(int exit_code)
+{
+    if (batch_is_active()) {
+        batch_end_program(BATCH_RESULT_EXIT, exit_code);
+    }
+}
+
+/* Called by the main CPU when `maincpu_clk_limit' has been reached.  */
+void batch_clk_limit_reached(void)
+{
+    if (!batch_is_active()) {
+        log_error(LOG_DEFAULT, "cycle limit reached.");
+        archdep_vice_exit(EXIT_FAILURE);
+    }
+    batch_end_program(BATCH_RESULT_TIMEOUT, -1);
+}
+
+/* Start running the programs given with `-batch', if any. Called once the
+   machine has been initialized.  */
+int batch_start(void)
+{
+    if (batch_list_name == NULL) {
+        return 0;
+    }
+
+    if (batch_read_list(batch_list_name) < 0) {
+        return -1;
+    }
+
+    if (batch_summary_name != NULL) {
+        batch_summary = fopen(batch_summary_name, MODE_WRITE_TEXT);
+        if (batch_summary == NULL) {
+            log_error(LOG_DEFAULT, "Batch: cannot create summary `%s'.",
+                      batch_summary_name);
+            return -1;
+        }
+    } else {
+        batch_summary = stdout;
+    }
+    fprintf(batch_summary, "program,result,exitcode,cycles\n");
+
+    /* `-limitcycles' now applies to every single program, counted like
+       maincpu_clk from the reset before it */
+    batch_cycle_limit = maincpu_clk_limit;
+    if (batch_cycle_limit == 0) {
+        log_warning(LOG_DEFAULT,
+                    "Batch: no cycle limit given, a hanging program stops the batch.");
+    }
+
+    /* run as fast as possible, without producing any output */
+    vsync_set_warp_mode(1);
+    resources_set_string("SoundDeviceName", "dummy");
+
+    /* cycle counts should not depend on the position in the list */
+    resources_set_int("AutostartDelayRandom", 0);
+
+    /* the sound is not played anyway, and no OpenMP threads may be running
+       when the workers are forked */
+    resources_set_int("SidParallel", 0);
+
+    if (batch_num_jobs == 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+        batch_num_jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        if (batch_num_jobs < 1) {
+            batch_num_jobs = 1;
+        }
+    }
+    if (batch_num_jobs > batch_num_programs) {
+        batch_num_jobs = batch_num_programs;
+    }
+
+#ifdef USE_VICE_THREAD
+    if (batch_num_jobs > 1) {
+        log_warning(LOG_DEFAULT,
+                    "Batch: -batchjobs is not supported when the emulation runs on its own thread.");
+        batch_num_jobs = 1;
+    }
+#endif
+
+    if (batch_num_jobs > 1) {
+#ifdef HAVE_FORK
+        if (batch_run_jobs() < 0) {
+            return -1;
+        }
+#else
+        log_warning(LOG_DEFAULT, "Batch: -batchjobs is not supported on this platform.");
+#endif
+    } else {
+        log_message(LOG_DEFAULT, "Batch: running %d programs from `%s'.",
+                    batch_num_programs, batch_list_name);
+    }
+
+    /* the machine state can only be saved between two instructions */
+    interrupt_maincpu_trigger_trap(batch_next_trap, NULL);
+
+    return 0;
+}
+
+void batch_shutdown(void)
+{
+    int i;
+
+    if (batch_summary != NULL && batch_summary != stdout) {
+        fclose(batch_summary);
+    }
+    batch_summary = NULL;
+
+#ifdef HAVE_FORK
+    if (batch_worker >= 0) {
+        close(batch_result_fd);
+        close(batch_task_fd);
+        batch_result_fd = -1;
+        batch_task_fd = -1;
+    }
+    lib_free(batch_worker_disk_image);
+    batch_worker_disk_image = NULL;
+#endif
+
+    for (i = 0; i < batch_num_programs; i++) {
+        lib_free(batch_programs[i]);
+    }
+    lib_free(batch_programs);
+    batch_programs = NULL;
+    batch_num_programs = 0;
+    batch_current = -1;
+
+    lib_free(batch_state);
+    batch_state = NULL;
+
+    lib_free(batch_list_name);
+    batch_list_name = NULL;
+    lib_free(batch_summary_name);
+    batch_summary_name = NULL;
+    lib_free(batch_screenshot_dir);
+    batch_screenshot_dir = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_batch(const char *param, void *extra_param)
+{
+    return util_string_set(&batch_list_name, param);
+}
+
+static int cmdline_batch_summary(const char *param, void *extra_param)
+{
+    return util_string_set(&batch_summary_name, param);
+}
+
+static int cmdline_batch_screenshots(const char *param, void *extra_param)
+{
+    return util_string_set(&batch_screenshot_dir, param);
+}
+
+static int cmdline_batch_jobs(const char *param, void *extra_param)
+{
+    int val = atoi(param);
+
+    if (val < 0) {
+        return -1;
+    }
+    batch_num_jobs = val;
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-batch", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_batch, NULL, NULL, NULL,
+      "<Name>", "Autostart the programs listed in file <name> one after the other and exit" },
+    { "-batchsummary", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_batch_summary, NULL, NULL, NULL,
+      "<Name>", "Write the batch results to file <name> instead of stdout" },
+    { "-batchscreenshots", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_batch_screenshots, NULL, NULL, NULL,
+      "<Directory>", "Save a screenshot at the end of every batch program to <directory>" },
+    { "-batchjobs", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_batch_jobs, NULL, NULL, NULL,
+      "<number>", "Run the batch programs in <number> parallel processes (0: one per CPU)" },
+    CMDLINE_LIST_END
+};
+
+int batch_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
@@ -0,0 +1,37 @@
+/*
+ * batch.h - Run a list of test programs in one emulator session.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_BATCH_H
+#define VICE_BATCH_H
+
+extern int batch_cmdline_options_init(void);
+extern void batch_shutdown(void);
+
+extern int batch_is_active(void);
+extern int batch_skip_frames(void);
+extern int batch_start(void);
+
+extern void batch_program_exit(int exit_code);
+extern void batch_clk_limit_reached(void);
+
+#endif
@@ -1530,6 +1530,25 @@ int machine_read_snapshot(const char *name, int event_mode)
     return err;
 }
 
+int machine_write_snapshot_memory(uint8_t **data, size_t *len, int save_roms,
+                                  int save_disks, int event_mode)
+{
+    int err = c128_snapshot_write_memory(data, len, save_roms, save_disks, event_mode);
+    if ((err < 0) && (snapshot_get_error() == SNAPSHOT_NO_ERROR)) {
+        snapshot_set_error(SNAPSHOT_CANNOT_WRITE_SNAPSHOT);
+    }
+    return err;
+}
+
+int machine_read_snapshot_memory(const uint8_t *data, size_t len, int event_mode)
+{
+    int err = c128_snapshot_read_memory(data, len, event_mode);
+    if ((err < 0) && (snapshot_get_error() == SNAPSHOT_NO_ERROR)) {
+        snapshot_set_error(SNAPSHOT_CANNOT_READ_SNAPSHOT);
+    }
+    return err;
+}
+
 /* ------------------------------------------------------------------------- */
 
 int machine_autodetect_psid(const char *name)
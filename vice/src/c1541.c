@@ -98,6 +98,7 @@
 #include "vdrive.h"
 #include "zipcode.h"
 #include "p64.h"
+#include "resources.h"
 #include "fileio/p00.h"
 
 #include "lib/linenoise-ng/linenoise.h"
@@ -220,6 +221,7 @@ static int validate_cmd(int nargs, char **args);
 static int verbose_cmd(int nargs, char **args);
 static int version_cmd(int nargs, char **args);
 static int write_cmd(int nargs, char **args);
+static int writeback_cmd(int nargs, char **args);
 static int write_geos_cmd(int nargs, char **args);
 
 static int disable_libdebug_output_cmd(int nargs, char **args);
@@ -514,6 +516,13 @@ const command_t command_list[] = {
       "image.",
       1, 2,
       write_cmd },
+    { "writeback",
+      "writeback [<enable> [<seconds>]]",
+      "Keep disk images in memory and write back the changes when they are\n"
+      "detached, or <seconds> after the first change (0: only on detach).\n"
+      "If no argument is given, print the current setting.",
+      0, 2,
+      writeback_cmd },
     { "x",
       "x",
       "Exit (same as 'quit', mirrors monitor 'x')",
@@ -3697,6 +3706,54 @@ static int silent_cmd(int nargs, char **args)
     }
 }
 
+
+/** \brief  Keep disk images in memory and write back the changes later
+ *
+ * Syntax: writeback [\<enable> [\<seconds>]]
+ *
+ * Sets `DiskImageWriteBack` and optionally `DiskImageFlushInterval`. The
+ * images that are already attached are kept in memory from now on as well.
+ *
+ * \param[in]   nargs   argument count
+ * \param[in]   args    argument list
+ *
+ * \return  FD_OK on success, < 0 on failure
+ */
+static int writeback_cmd(int nargs, char **args)
+{
+    int enable = 0;
+    int interval = 0;
+    int i;
+
+    if (nargs == 1) {
+        resources_get_int("DiskImageWriteBack", &enable);
+        resources_get_int("DiskImageFlushInterval", &interval);
+        printf("write-back %s, flush interval %d seconds\n",
+               enable ? "enabled" : "disabled", interval);
+        return FD_OK;
+    }
+
+    if (arg_to_int(args[1], &enable) < 0) {
+        return FD_BADVAL;
+    }
+    if (nargs == 3) {
+        if (arg_to_int(args[2], &interval) < 0
+            || resources_set_int("DiskImageFlushInterval", interval) < 0) {
+            return FD_BADVAL;
+        }
+    }
+    resources_set_int("DiskImageWriteBack", enable);
+
+    if (enable) {
+        for (i = 0; i < NUM_DISK_UNITS; i++) {
+            if (drives[i]->image != NULL) {
+                disk_image_write_back_start(drives[i]->image);
+            }
+        }
+    }
+    return FD_OK;
+}
+
 static int read_cmd(int nargs, char **args)
 {
     char *src_name_petscii, *src_name_ascii;
@@ -5596,6 +5653,12 @@ int main(int argc, char **argv)
        appear on stdout.  */
     log_init_with_fd(stdout);
 
+    /* the disk image resources are the only ones used by c1541 */
+    if (resources_init("c1541") < 0 || disk_image_resources_init() < 0) {
+        fprintf(stderr, "cannot initialize resources\n");
+        return EXIT_FAILURE;
+    }
+
     serial_iec_bus_init();
 
     for (i = 0; i < MAXARG; i++) {
@@ -5721,6 +5784,8 @@ int main(int argc, char **argv)
             lib_free(drives[i]);
         }
     }
+    /* free memory used by the resources */
+    resources_shutdown();
     /* free memory used by archdep */
     archdep_shutdown();
     /* free memory used by the log module */
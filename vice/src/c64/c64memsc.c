@@ -61,6 +61,7 @@
 #include "resources.h"
 #include "reu.h"
 #include "sid.h"
+#include "snapshot.h"
 #include "tpi.h"
 #include "vicii-cycle.h"
 #include "vicii-mem.h"
@@ -109,6 +110,12 @@ static uint32_t mem_read_limit_tab[NUM_CONFIGS][0x101];
 static store_func_ptr_t mem_write_tab_watch[0x101];
 static read_func_ptr_t mem_read_tab_watch[0x101];
 
+/* Write table marking the pages of RAM written to, see
+   `snapshot_dirty_register()'.  */
+static store_func_ptr_t mem_write_tab_dirty[0x101];
+static uint8_t *mem_ram_dirty = NULL;
+static int mem_ram_tracked = 0;
+
 /* Current video bank (0, 1, 2 or 3).  */
 static int vbank;
 
@@ -141,6 +148,9 @@ static void zero_store_watch(uint16_t addr, uint8_t value)
 {
     addr &= 0xff;
     monitor_watch_push_store_addr(addr, e_comp_space);
+    if (mem_ram_tracked) {
+        mem_ram_dirty[0] = 1;
+    }
     mem_write_tab[mem_config][0](addr, value);
 }
 
@@ -153,12 +163,33 @@ static uint8_t read_watch(uint16_t addr)
 static void store_watch(uint16_t addr, uint8_t value)
 {
     monitor_watch_push_store_addr(addr, e_comp_space);
+    if (mem_ram_tracked) {
+        mem_ram_dirty[addr >> 8] = 1;
+    }
+    mem_write_tab[mem_config][addr >> 8](addr, value);
+}
+
+static void zero_store_dirty(uint16_t addr, uint8_t value)
+{
+    addr &= 0xff;
+    mem_ram_dirty[0] = 1;
+    mem_write_tab[mem_config][0](addr, value);
+}
+
+static void store_dirty(uint16_t addr, uint8_t value)
+{
+    mem_ram_dirty[addr >> 8] = 1;
     mem_write_tab[mem_config][addr >> 8](addr, value);
 }
 
 /* called by mem_pla_config_changed(), mem_toggle_watchpoints() */
 static void mem_update_tab_ptrs(int flag)
 {
+    store_func_ptr_t *write_tab;
+
+    /* keep track of the RAM pages written since the last rewind state */
+    write_tab = mem_ram_tracked ? mem_write_tab_dirty : mem_write_tab[mem_config];
+
     if (flag) {
         _mem_read_tab_ptr = mem_read_tab_watch;
         _mem_write_tab_ptr = mem_write_tab_watch;
@@ -168,17 +199,23 @@ static void mem_update_tab_ptrs(int flag)
             _mem_write_tab_ptr_dummy = mem_write_tab_watch;
         } else {
             _mem_read_tab_ptr_dummy = mem_read_tab[mem_config];
-            _mem_write_tab_ptr_dummy = mem_write_tab[mem_config];
+            _mem_write_tab_ptr_dummy = write_tab;
         }
     } else {
         /* all watchpoints disabled */
         _mem_read_tab_ptr = mem_read_tab[mem_config];
-        _mem_write_tab_ptr = mem_write_tab[mem_config];
+        _mem_write_tab_ptr = write_tab;
         _mem_read_tab_ptr_dummy = mem_read_tab[mem_config];
-        _mem_write_tab_ptr_dummy = mem_write_tab[mem_config];
+        _mem_write_tab_ptr_dummy = write_tab;
     }
 }
 
+static void mem_ram_track(int on)
+{
+    mem_ram_tracked = on;
+    mem_update_tab_ptrs(watchpoints_active);
+}
+
 void mem_toggle_watchpoints(int flag, void *context)
 {
     mem_update_tab_ptrs(flag);
@@ -651,6 +688,15 @@ void mem_initialize_memory(void)
         mem_write_tab_watch[i] = store_watch;
     }
 
+    /* setup dirty page tables */
+    mem_write_tab_dirty[0] = zero_store_dirty;
+    for (i = 1; i <= 0x100; i++) {
+        mem_write_tab_dirty[i] = store_dirty;
+    }
+    if (mem_ram_dirty == NULL) {
+        mem_ram_dirty = snapshot_dirty_register(mem_ram, C64_RAM_SIZE, mem_ram_track);
+    }
+
     resources_get_int("BoardType", &board);
 
     /* first init everything to "nothing" */
@@ -761,6 +807,7 @@ void mem_mmu_translate(unsigned int addr, uint8_t **base, int *start, int *limit
 void mem_powerup(void)
 {
     ram_init(mem_ram, 0x10000);
+    snapshot_dirty_mark(mem_ram, 0x10000);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -814,6 +861,7 @@ void mem_set_basic_text(uint16_t start, uint16_t end)
     mem_ram[0x2c] = mem_ram[0xad] = start >> 8;
     mem_ram[0x2d] = mem_ram[0x2f] = mem_ram[0x31] = mem_ram[0xae] = end & 0xff;
     mem_ram[0x2e] = mem_ram[0x30] = mem_ram[0x32] = mem_ram[0xaf] = end >> 8;
+    snapshot_dirty_mark(mem_ram, 0x100);
 }
 
 /* this function should always read from the screen currently used by the kernal
@@ -831,6 +879,7 @@ void mem_inject(uint32_t addr, uint8_t value)
     /* printf("mem_inject addr: %04x  value: %02x\n", addr, value); */
     if (!memory_hacks_ram_inject(addr, value)) {
         mem_ram[addr & 0xffff] = value;
+        snapshot_dirty_mark(mem_ram + (addr & 0xffff), 1);
     }
 }
 
@@ -1226,6 +1275,7 @@ void mem_bank_write(int bank, uint16_t addr, uint8_t byte, void *context)
             break;
     }
     mem_ram[addr] = byte;
+    snapshot_dirty_mark(mem_ram + addr, 1);
 }
 
 /* used by monitor if sfx off */
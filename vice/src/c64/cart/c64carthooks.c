@@ -3558,6 +3558,9 @@ int cartridge_snapshot_write_modules(struct snapshot_s *s)
                 }
                 break;
 #endif
+            case CARTRIDGE_DEBUGCART:
+                /* nothing to save, the cart has no state */
+                break;
 
             default:
                 /* If the cart cannot be saved, we obviously can't load it either.
@@ -4134,6 +4137,11 @@ int cartridge_snapshot_read_modules(struct snapshot_s *s)
                 }
                 break;
 #endif
+            case CARTRIDGE_DEBUGCART:
+                if (resources_set_int("DebugCartEnable", 1) < 0) {
+                    goto fail2;
+                }
+                break;
 
             default:
                 DBG(("CART snapshot read: cart %i handler missing\n", cart_ids[i]));
@@ -35,6 +35,7 @@
 #include "machine.h"
 #include "maincpu.h"
 #include "archdep.h"
+#include "batch.h"
 
 #include "debugcart.h"
 
@@ -73,6 +74,10 @@ static const export_resource_t export_res = {
 static void debugcart_store(uint16_t addr, uint8_t value)
 {
     int n = (int)value;
+    if (batch_is_active()) {
+        batch_program_exit(n);
+        return;
+    }
     fprintf(stdout, "DBGCART: exit(%d) cycles elapsed: %"PRIu64"\n", n, maincpu_clk);
     archdep_vice_exit(n);
 }
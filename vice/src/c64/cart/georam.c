@@ -108,6 +108,10 @@ static uint8_t georam[2];
 static uint8_t *georam_ram = NULL;
 static int old_georam_ram_size = 0;
 
+/* Pages of the image written since the last rewind state, see
+   snapshot_dirty_register().  */
+static uint8_t *georam_ram_dirty = NULL;
+
 static log_t georam_log = LOG_ERR;
 
 static int georam_activate(void);
@@ -196,7 +200,10 @@ static uint8_t georam_io1_read(uint16_t addr)
 
 static void georam_io1_store(uint16_t addr, uint8_t byte)
 {
-    georam_ram[(georam[1] * 16384) + (georam[0] * 256) + addr] = byte;
+    unsigned int offset = (georam[1] * 16384) + (georam[0] * 256) + addr;
+
+    georam_ram[offset] = byte;
+    georam_ram_dirty[offset >> 8] = 1;
 }
 
 static uint8_t georam_io2_peek(uint16_t addr)
@@ -253,6 +260,7 @@ void georam_powerup(void)
     }
     if (georam_ram) {
         ram_init_with_pattern(georam_ram, georam_size, &ramparam);
+        snapshot_dirty_mark(georam_ram, georam_size);
     }
 }
 
@@ -262,7 +270,9 @@ static int georam_activate(void)
         return 0;
     }
 
+    snapshot_dirty_unregister(georam_ram);
     georam_ram = lib_realloc((void *)georam_ram, (size_t)georam_size);
+    georam_ram_dirty = snapshot_dirty_register(georam_ram, georam_size, NULL);
 
     /* Clear newly allocated RAM.  */
     if (georam_size > old_georam_ram_size) {
@@ -307,8 +317,10 @@ static int georam_deactivate(void)
         }
     }
 
+    snapshot_dirty_unregister(georam_ram);
     lib_free(georam_ram);
     georam_ram = NULL;
+    georam_ram_dirty = NULL;
     old_georam_ram_size = 0;
 
     return 0;
@@ -569,6 +581,7 @@ void georam_config_setup(uint8_t *rawcart)
 {
     if (georam_size > 0) {
         memcpy(georam_ram, rawcart, georam_size);
+        snapshot_dirty_mark(georam_ram, georam_size);
     }
 }
 
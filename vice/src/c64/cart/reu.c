@@ -229,6 +229,9 @@ static int reu_dma_active = 0;
 
 /*! \brief pointer to a buffer which holds the REU image.  */
 static uint8_t *reu_ram = NULL;
+/*! \brief pages of reu_ram written since the last rewind state, see
+    snapshot_dirty_register(). */
+static uint8_t *reu_ram_dirty = NULL;
 /*! \brief the old ram size of reu_ram. Used to determine if and how much of the
     buffer has to cleared when resizing the REU. */
 static unsigned int old_reu_ram_size = 0;
@@ -582,6 +585,7 @@ void reu_config_setup(uint8_t *rawcart)
 {
     if (reu_size > 0) {
         memcpy(reu_ram, rawcart, reu_size); /* FIXME */
+        snapshot_dirty_mark(reu_ram, reu_size);
     }
 }
 
@@ -660,6 +664,7 @@ static void reu_init_ram(void)
                 invertblock(0x02ac00 + ((i + b) << 16), 0x2a00);
             }
         }
+        snapshot_dirty_mark(reu_ram, reu_size);
     }
 }
 
@@ -680,7 +685,9 @@ static int reu_activate(void)
         return 0;
     }
 
+    snapshot_dirty_unregister(reu_ram);
     reu_ram = lib_realloc(reu_ram, reu_size);
+    reu_ram_dirty = snapshot_dirty_register(reu_ram, reu_size, NULL);
 
     /* Clear newly allocated RAM.  */
     reu_init_ram();
@@ -724,8 +731,10 @@ static int reu_deactivate(void)
         }
     }
 
+    snapshot_dirty_unregister(reu_ram);
     lib_free(reu_ram);
     reu_ram = NULL;
+    reu_ram_dirty = NULL;
     old_reu_ram_size = 0;
 
     return 0;
@@ -1112,6 +1121,7 @@ inline static void store_to_reu(unsigned int reu_addr, uint8_t value)
     if (reu_addr < rec_options.not_backedup_addresses) {
         assert(reu_addr < reu_size);
         reu_ram[reu_addr] = value;
+        reu_ram_dirty[reu_addr >> 8] = 1;
     } else {
         DEBUG_LOG(DEBUG_LEVEL_NO_DRAM, (reu_log, "--> writing to REU address %05X, but no DRAM!", reu_addr));
     }
@@ -125,6 +125,11 @@ drive_type_info_t *machine_drive_get_type_info_list(void)
     return drive_dummy_list;
 }
 
+int drive_motor_is_on(void)
+{
+    return 0;
+}
+
 int drive_check_expansion2000(int type)
 {
     return 0;
@@ -763,6 +768,11 @@ void *disk_image_fsimage_fd_get(const disk_image_t *image)
     return NULL;
 }
 
+int disk_image_fsimage_is_open(const disk_image_t *image)
+{
+    return 0;
+}
+
 void P64ImageDestroy(PP64Image Instance)
 {
 }
@@ -424,6 +424,17 @@ int machine_read_snapshot(const char *name, int event_mode)
     return c64_snapshot_read(name, event_mode);
 }
 
+int machine_write_snapshot_memory(uint8_t **data, size_t *len, int save_roms,
+                                  int save_disks, int event_mode)
+{
+    return c64_snapshot_write_memory(data, len, save_roms, save_disks, event_mode);
+}
+
+int machine_read_snapshot_memory(const uint8_t *data, size_t len, int event_mode)
+{
+    return c64_snapshot_read_memory(data, len, event_mode);
+}
+
 /* ------------------------------------------------------------------------- */
 
 int machine_autodetect_psid(const char *name)
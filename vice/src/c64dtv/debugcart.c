@@ -28,6 +28,7 @@
 
 /*#include "dtvexport.h"*/
 #include "archdep.h"
+#include "batch.h"
 #include "cartio.h"
 #include "cartridge.h"
 #include "cmdline.h"
@@ -74,6 +75,10 @@ void debugcart_store(uint16_t addr, uint8_t value)
 {
     int n = (int)value;
     if ((debugcart_enabled) && (addr == 0xd7ff)) {
+        if (batch_is_active()) {
+            batch_program_exit(n);
+            return;
+        }
         fprintf(stdout, "DBGCART: exit(%d) cycles elapsed: %lu\n",
                 n, (unsigned long)maincpu_clk); /* CLOCK can be 32 bit or 64 bit
                                                  *  so this will kinda work
@@ -58,17 +58,9 @@
 #define SNAP_MAJOR          1
 #define SNAP_MINOR          0
 
-int cbm2_snapshot_write(const char *name, int save_roms, int save_disks,
-                        int event_mode)
+static int cbm2_snapshot_write_to(snapshot_t *s, int save_roms, int save_disks,
+                                  int event_mode)
 {
-    snapshot_t *s;
-
-    s = snapshot_create(name, SNAP_MAJOR, SNAP_MINOR, machine_get_name());
-
-    if (s == NULL) {
-        return -1;
-    }
-
     sound_snapshot_prepare();
 
     if (maincpu_snapshot_write_module(s) < 0
@@ -85,6 +77,23 @@ int cbm2_snapshot_write(const char *name, int save_roms, int save_disks,
         || tapeport_snapshot_write_module(s, save_disks) < 0
         || keyboard_snapshot_write_module(s) < 0
         || userport_snapshot_write_module(s) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int cbm2_snapshot_write(const char *name, int save_roms, int save_disks,
+                        int event_mode)
+{
+    snapshot_t *s;
+
+    s = snapshot_create(name, SNAP_MAJOR, SNAP_MINOR, machine_get_name());
+    if (s == NULL) {
+        return -1;
+    }
+
+    if (cbm2_snapshot_write_to(s, save_roms, save_disks, event_mode) < 0) {
         snapshot_close(s);
         archdep_remove(name);
         return -1;
@@ -94,17 +103,27 @@ int cbm2_snapshot_write(const char *name, int save_roms, int save_disks,
     return 0;
 }
 
-int cbm2_snapshot_read(const char *name, int event_mode)
+int cbm2_snapshot_write_memory(uint8_t **data, size_t *len, int save_roms,
+                               int save_disks, int event_mode)
 {
     snapshot_t *s;
-    uint8_t minor, major;
-
-    s = snapshot_open(name, &major, &minor, machine_get_name());
 
+    s = snapshot_memory_create(SNAP_MAJOR, SNAP_MINOR, machine_get_name());
     if (s == NULL) {
         return -1;
     }
 
+    if (cbm2_snapshot_write_to(s, save_roms, save_disks, event_mode) < 0) {
+        snapshot_close(s);
+        return -1;
+    }
+
+    *data = snapshot_memory_close(s, len);
+    return 0;
+}
+
+static int cbm2_snapshot_read_from(snapshot_t *s, uint8_t major, uint8_t minor, int event_mode)
+{
     if (!snapshot_version_is_equal(major, minor, SNAP_MAJOR, SNAP_MINOR)) {
         log_error(LOG_DEFAULT, "Snapshot version (%d.%d) not valid: expecting %d.%d.", major, minor, SNAP_MAJOR, SNAP_MINOR);
         snapshot_set_error(SNAPSHOT_MODULE_INCOMPATIBLE);
@@ -128,6 +147,8 @@ int cbm2_snapshot_read(const char *name, int event_mode)
         goto fail;
     }
 
+    snapshot_close(s);
+
     sound_snapshot_finish();
 
     return 0;
@@ -141,3 +162,29 @@ fail:
 
     return -1;
 }
+
+int cbm2_snapshot_read(const char *name, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_open(name, &major, &minor, machine_get_name());
+    if (s == NULL) {
+        return -1;
+    }
+
+    return cbm2_snapshot_read_from(s, major, minor, event_mode);
+}
+
+int cbm2_snapshot_read_memory(const uint8_t *data, size_t len, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_memory_open(data, len, &major, &minor, machine_get_name());
+    if (s == NULL) {
+        return -1;
+    }
+
+    return cbm2_snapshot_read_from(s, major, minor, event_mode);
+}
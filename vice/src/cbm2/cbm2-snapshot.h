@@ -27,8 +27,14 @@
 #ifndef VICE_CBM2_SNAPSHOT_H
 #define VICE_CBM2_SNAPSHOT_H
 
+#include "types.h"
+
 extern int cbm2_snapshot_write(const char *name, int save_roms, int save_disks,
                                int event_mode);
 extern int cbm2_snapshot_read(const char *name, int event_mode);
+extern int cbm2_snapshot_write_memory(uint8_t **data, size_t *len, int save_roms,
+                                      int save_disks, int event_mode);
+extern int cbm2_snapshot_read_memory(const uint8_t *data, size_t len,
+                                     int event_mode);
 
 #endif
@@ -70,20 +70,32 @@
 #define MAXIDS 7
 #define MAXLUNS 8
 
+/* Is there a file or an image of the owner attached to the disk?  */
+int scsi_image_present(struct scsi_context_s *context, int disk)
+{
+    return context->file[disk] != NULL || context->image[disk] != NULL;
+}
+
 static off_t scsi_getmaxsize(struct scsi_context_s *context)
 {
     off_t work;
+    int disk;
 
     /* make sure the target and lun are valid */
     if (context->target >= MAXIDS || context->lun >= MAXLUNS) {
         return 0;
     }
+    disk = (context->target << 3) | context->lun;
 
     /* make sure there is a file associated with the target and lun */
-    if (context->file[(context->target << 3) | context->lun]) {
+    if (scsi_image_present(context, disk)) {
         if (!context->max_imagesize) {
             /* if the max length setting is zero, return the image length */
-            work = archdep_file_size(context->file[(context->target << 3) | context->lun]);
+            if (context->image[disk]) {
+                work = context->image_size(context->image[disk]);
+            } else {
+                work = archdep_file_size(context->file[disk]);
+            }
             /* turn the file size into 512 byte sectors */
             work = (work >> 9) + (work & 511 ? 1 : 0);
             return work;
@@ -103,7 +115,7 @@ static int32_t scsi_imagecheck(struct scsi_context_s *context)
         return 1;
     }
 
-    if (!context->file[(context->target << 3) | context->lun]) {
+    if (!scsi_image_present(context, (context->target << 3) | context->lun)) {
         if ( context->target == 0 && context->lun == 0 &&
             !(context->log & SCSI_LOG_NODISK0) ) {
             CRIT((ERR, "SCSI: no image attached to disk 0;"
@@ -127,6 +139,11 @@ int scsi_image_detach(struct scsi_context_s *context, int disk)
         context->file[disk] = NULL;
         return 0;
     }
+    /* images are closed by the owner */
+    if (context->image[disk]) {
+        context->image[disk] = NULL;
+        return 0;
+    }
 
     return 1;
 }
@@ -163,11 +180,27 @@ int32_t scsi_image_read(struct scsi_context_s *context)
 {
     int32_t i;
     FILE *fhd;
+    void *image;
 
     if (scsi_imagecheck(context)) {
         return -1;
     }
 
+    image = context->image[(context->target << 3) | context->lun];
+    if (image) {
+        off_t offset = (off_t)context->address * 512;
+
+        if (offset + 512 > context->image_size(image)) {
+            /* like below, a read beyond the end returns zeros */
+            memset(context->data_buf, 0, 512);
+        } else if (context->image_read(image, context->data_buf, 512, offset) < 0) {
+            CRIT((ERR, "SCSI: error reading disk %d at sector 0x%x",
+                context->target, context->address));
+            return -4;
+        }
+        goto done;
+    }
+
     fhd = context->file[(context->target << 3) | context->lun];
 
     if (archdep_fseeko(fhd, (off_t)context->address * 512, SEEK_SET) < 0) {
@@ -190,6 +223,7 @@ int32_t scsi_image_read(struct scsi_context_s *context)
         }
     }
 
+done:
     LOG2((LOG, "SCSI: read disk %d at sector 0x%x", context->target,
         context->address));
 
@@ -205,6 +239,7 @@ int32_t scsi_image_read(struct scsi_context_s *context)
 int32_t scsi_image_write(struct scsi_context_s *context)
 {
     FILE *fhd;
+    void *image;
 
     if (scsi_imagecheck(context)) {
         return -1;
@@ -216,6 +251,17 @@ int32_t scsi_image_write(struct scsi_context_s *context)
         context->user_write(context);
     }
 
+    image = context->image[(context->target << 3) | context->lun];
+    if (image) {
+        if (context->image_write(image, context->data_buf, 512,
+                                 (off_t)context->address * 512) < 0) {
+            CRIT((ERR, "SCSI: error writing disk %d at sector 0x%x",
+                context->target, context->address));
+            return -4;
+        }
+        goto done;
+    }
+
     fhd = context->file[(context->target << 3) | context->lun];
 
     if (archdep_fseeko(fhd, (off_t)context->address * 512, SEEK_SET) < 0) {
@@ -231,6 +277,7 @@ int32_t scsi_image_write(struct scsi_context_s *context)
     }
     fflush(fhd);
 
+done:
     LOG2((LOG, "SCSI: write disk %d at sector 0x%x", context->target,
         context->address));
 
@@ -64,6 +64,12 @@ typedef struct scsi_context_s {
     uint32_t limit_imagesize; /* in 512 byte sectors */
     uint32_t log;
     FILE *file[56];
+    /* disks provided by the owner, accessed through the functions below
+       instead of a FILE (e.g. to use the disk image write-back cache) */
+    void *image[56];
+    int (*image_read)(void *image, uint8_t *buf, size_t num, off_t offset);
+    int (*image_write)(void *image, const uint8_t *buf, size_t num, off_t offset);
+    off_t (*image_size)(void *image);
     void *p;
     void (*user_format)(struct scsi_context_s *);
     void (*user_read)(struct scsi_context_s *);
@@ -212,6 +218,7 @@ extern int scsi_image_detach(struct scsi_context_s *context, int disk);
 extern void scsi_image_detach_all(struct scsi_context_s *context);
 extern int scsi_image_attach(struct scsi_context_s *context, int disk,
     char *filename);
+extern int scsi_image_present(struct scsi_context_s *context, int disk);
 extern int32_t scsi_image_read(struct scsi_context_s *context);
 extern int32_t scsi_image_write(struct scsi_context_s *context);
 extern uint8_t scsi_get_bus(struct scsi_context_s *context);
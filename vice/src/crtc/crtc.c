@@ -172,6 +172,7 @@ crtc_t crtc = {
         0,
         0,
         NULL,       /* update_area */
+        NULL,       /* shadow */
         { 0 },
         { 0 },
         NULL,
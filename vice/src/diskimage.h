@@ -113,9 +113,14 @@ extern int disk_image_resources_init(void);
 extern int disk_image_cmdline_options_init(void);
 extern void disk_image_resources_shutdown(void);
 
+extern void disk_image_write_back_start(disk_image_t *image);
+extern int disk_image_flush_all(void);
+extern void disk_image_flush_due(void);
+
 extern void disk_image_fsimage_name_set(disk_image_t *image, const char *name);
 extern const char *disk_image_fsimage_name_get(const disk_image_t *image);
 extern void *disk_image_fsimage_fd_get(const disk_image_t *image);
+extern int disk_image_fsimage_is_open(const disk_image_t *image);
 extern int disk_image_fsimage_create(const char *name, unsigned int type);
 extern int disk_image_fsimage_create_dxm(const char *name, const char *diskname, unsigned int type);
 extern int disk_image_fsimage_create_dhd(const char *name, const char *diskname, unsigned int type);
@@ -139,6 +144,10 @@ extern int disk_image_read_sector(const disk_image_t *image, uint8_t *buf,
                                   const disk_addr_t *dadr);
 extern int disk_image_write_sector(disk_image_t *image, const uint8_t *buf,
                                    const disk_addr_t *dadr);
+extern int disk_image_pread(const disk_image_t *image, void *buf, size_t num,
+                            off_t offset);
+extern int disk_image_pwrite(disk_image_t *image, const void *buf, size_t num,
+                             off_t offset);
 extern int disk_image_check_sector(const disk_image_t *image, unsigned int track,
                                    unsigned int sector);
 extern unsigned int disk_image_sector_per_track(unsigned int format,
@@ -507,6 +507,21 @@ void *disk_image_fsimage_fd_get(const disk_image_t *image)
 }
 
 
+/** \brief  Check whether the file of \a image is open
+ *
+ * Use this instead of disk_image_fsimage_fd_get() when the file is not
+ * accessed, it keeps the image in the write-back cache.
+ *
+ * \param[in]   image   disk image
+ *
+ * \return  1 if the file is open, 0 otherwise
+ */
+int disk_image_fsimage_is_open(const disk_image_t *image)
+{
+    return fsimage_is_open(image);
+}
+
+
 int disk_image_fsimage_create(const char *name, unsigned int type)
 {
     return fsimage_create(name, type);
@@ -696,6 +711,47 @@ int disk_image_write_sector(disk_image_t *image, const uint8_t *buf, const disk_
     return rc;
 }
 
+/** \brief  Read \a num bytes at \a offset of the image file
+ *
+ * For devices that address the image in bytes rather than in sectors, like
+ * the SCSI disks of the CMD HD. Served from memory if the image is kept in
+ * the write-back cache.
+ *
+ * \return 0 on success, -1 on error
+ */
+int disk_image_pread(const disk_image_t *image, void *buf, size_t num, off_t offset)
+{
+    if (image->device != DISK_IMAGE_DEVICE_FS) {
+        log_error(disk_image_log, "Unknown image device %u.", image->device);
+        return -1;
+    }
+
+    return fsimage_pread(image->media.fsimage, buf, num, offset);
+}
+
+/** \brief  Write \a num bytes at \a offset of the image file
+ *
+ * \return 0 on success, -1 on error
+ */
+int disk_image_pwrite(disk_image_t *image, const void *buf, size_t num, off_t offset)
+{
+    if (image->read_only != 0) {
+        log_error(disk_image_log, "Attempt to write to read-only disk image.");
+        return -1;
+    }
+    if (image->device != DISK_IMAGE_DEVICE_FS) {
+        log_error(disk_image_log, "Unknown image device %u.", image->device);
+        return -1;
+    }
+
+    if (fsimage_pwrite(image->media.fsimage, buf, num, offset) < 0) {
+        return -1;
+    }
+    fsimage_sync(image->media.fsimage);
+
+    return 0;
+}
+
 /*-----------------------------------------------------------------------*/
 
 int disk_image_write_half_track(disk_image_t *image, unsigned int half_track,
@@ -754,7 +810,7 @@ void disk_image_init(void)
 
 int disk_image_resources_init(void)
 {
-    return 0;
+    return fsimage_resources_init();
 }
 
 void disk_image_resources_shutdown(void)
@@ -763,7 +819,31 @@ void disk_image_resources_shutdown(void)
 
 int disk_image_cmdline_options_init(void)
 {
-    return 0;
+    return fsimage_cmdline_options_init();
+}
+
+/*-----------------------------------------------------------------------*/
+
+/* Keep an image that is already open in memory, if `DiskImageWriteBack' is
+   enabled.  */
+void disk_image_write_back_start(disk_image_t *image)
+{
+    if (image->device == DISK_IMAGE_DEVICE_FS) {
+        fsimage_cache_start(image);
+    }
+}
+
+/* Write back the changes of all images kept in memory.  */
+int disk_image_flush_all(void)
+{
+    return fsimage_flush_all();
+}
+
+/* Write back the changes of the images kept in memory whose flush interval
+   has passed.  */
+void disk_image_flush_due(void)
+{
+    fsimage_flush_due();
 }
 
 /*-----------------------------------------------------------------------*/
@@ -29,6 +29,11 @@
 #include <stdio.h>
 #include <string.h>
 
+#ifdef USE_VICE_THREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 #include "diskconstants.h"
 #include "diskimage.h"
 #include "drive.h"
@@ -52,7 +57,7 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
     long offset;
     uint8_t *buffer;
     fsimage_t *fsimage = image->media.fsimage;
-    fdc_err_t rf;
+    fdc_err_t rf, *errors;
 
     track = half_track / 2;
 
@@ -76,8 +81,10 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
     }
 
     buffer = lib_calloc(max_sector, 256);
+    errors = lib_malloc(max_sector * sizeof(fdc_err_t));
+    gcr_read_track(raw, buffer, errors, max_sector);
     for (sector = 0; sector < max_sector; sector++) {
-        rf = gcr_read_sector(raw, &buffer[sector * 256], (uint8_t)sector);
+        rf = errors[sector];
         if (rf != CBMDOS_FDC_ERR_OK) {
             log_error(fsimage_dxx_log,
                       "Could not find data sector of T:%u S:%u.",
@@ -101,6 +108,7 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
             }
         }
     }
+    lib_free(errors);
     offset = sectors * 256;
 
 #ifdef HAVE_X64_IMAGE
@@ -108,7 +116,7 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
         offset += X64_HEADER_LENGTH;
     }
 #endif
-    if (util_fpwrite(fsimage->fd, buffer, max_sector * 256, offset) < 0) {
+    if (fsimage_pwrite(fsimage, buffer, max_sector * 256, offset) < 0) {
         log_error(fsimage_dxx_log, "Error writing T:%u to disk image.",
                   track);
         lib_free(buffer);
@@ -126,10 +134,10 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
 #endif
             fsimage->error_info.dirty = 0;
             if (error_info_created) {
-                res = util_fpwrite(fsimage->fd, fsimage->error_info.map,
+                res = fsimage_pwrite(fsimage, fsimage->error_info.map,
                                    fsimage->error_info.len, fsimage->error_info.len * 256);
             } else {
-                res = util_fpwrite(fsimage->fd, fsimage->error_info.map + sectors,
+                res = fsimage_pwrite(fsimage, fsimage->error_info.map + sectors,
                                    max_sector, offset);
             }
             if (res < 0) {
@@ -142,10 +150,117 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
     }
 
     /* Make sure the stream is visible to other readers.  */
-    fflush(fsimage->fd);
+    fsimage_sync(fsimage);
     return 0;
 }
 
+/* A track of a Dxx image to be converted to GCR. */
+typedef struct dxx_gcr_track_s {
+    uint8_t *dest;              /* raw track, `size' bytes */
+    unsigned int size;
+    unsigned long offset;       /* skew, see fsimage_read_dxx_image() */
+    gcr_header_t header;
+    int gap, headergap, synclen;
+    unsigned int sectors;
+    uint8_t *data;              /* `sectors' * 256 bytes */
+    int *error;                 /* fdc_err_t of each sector, -1 if missing */
+    uint8_t *temp;              /* `size' bytes, the track before the skew */
+} dxx_gcr_track_t;
+
+static void fsimage_dxx_convert_track(dxx_gcr_track_t *t)
+{
+    unsigned int sector;
+    uint8_t *ptr = t->temp;
+    gcr_header_t header = t->header;
+
+    /* Clear track to avoid read errors.  */
+    memset(ptr, 0x55, t->size);
+
+    for (sector = 0; sector < t->sectors; sector++) {
+        if (t->error[sector] >= 0) {
+            header.sector = sector;
+            gcr_convert_sector_to_GCR(t->data + sector * 256, ptr, &header,
+                                      t->headergap, t->synclen, t->error[sector]);
+        }
+        ptr += SECTOR_GCR_SIZE_WITH_HEADER + t->headergap + t->gap + (t->synclen * 2);
+    }
+
+    /* copy gcr data to final buffer with offset + wraparound */
+    memcpy(t->dest + t->offset, t->temp, t->size - t->offset);
+    memcpy(t->dest, t->temp + (t->size - t->offset), t->offset);
+}
+
+#ifdef USE_VICE_THREAD
+
+#define DXX_CONVERT_THREADS_MAX 8
+
+typedef struct dxx_convert_job_s {
+    pthread_mutex_t lock;
+    dxx_gcr_track_t *tracks;
+    int num, next;
+} dxx_convert_job_t;
+
+static void *fsimage_dxx_convert_worker(void *data)
+{
+    dxx_convert_job_t *job = data;
+    int i;
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        i = job->next++;
+        pthread_mutex_unlock(&job->lock);
+        if (i >= job->num) {
+            break;
+        }
+        fsimage_dxx_convert_track(&job->tracks[i]);
+    }
+    return NULL;
+}
+
+#endif
+
+/* Convert the tracks to GCR, on several threads if possible. The tracks do
+   not share any memory, and all buffers are allocated beforehand. */
+static void fsimage_dxx_convert_tracks(dxx_gcr_track_t *tracks, int num)
+{
+    int i;
+#ifdef USE_VICE_THREAD
+    pthread_t threads[DXX_CONVERT_THREADS_MAX - 1];
+    dxx_convert_job_t job;
+    int count = 1, started = 0;
+
+#ifdef _SC_NPROCESSORS_ONLN
+    count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (count > DXX_CONVERT_THREADS_MAX) {
+        count = DXX_CONVERT_THREADS_MAX;
+    }
+    if (count > num) {
+        count = num;
+    }
+    if (count > 1) {
+        pthread_mutex_init(&job.lock, NULL);
+        job.tracks = tracks;
+        job.num = num;
+        job.next = 0;
+        while (started < count - 1
+               && pthread_create(&threads[started], NULL, fsimage_dxx_convert_worker, &job) == 0) {
+            started++;
+        }
+        fsimage_dxx_convert_worker(&job);
+        for (i = 0; i < started; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        pthread_mutex_destroy(&job.lock);
+        return;
+    }
+#endif
+
+    for (i = 0; i < num; i++) {
+        fsimage_dxx_convert_track(&tracks[i]);
+    }
+}
+
 int fsimage_read_dxx_image(const disk_image_t *image)
 {
     uint8_t buffer[256], *bam_id;
@@ -162,7 +277,8 @@ int fsimage_read_dxx_image(const disk_image_t *image)
     int sectors;
     long offset;
     unsigned long trackoffset = 0;
-    uint8_t *tempgcr;
+    dxx_gcr_track_t *tracks;
+    int num_tracks = 0, i;
 
     if (image->type == DISK_IMAGE_TYPE_D80
         || image->type == DISK_IMAGE_TYPE_D82) {
@@ -175,7 +291,7 @@ int fsimage_read_dxx_image(const disk_image_t *image)
 
     bam_id[0] = bam_id[1] = 0xa0;
     if (sectors >= 0) {
-        util_fpread(fsimage->fd, buffer, 256, sectors << 8);
+        fsimage_pread(fsimage, buffer, 256, sectors << 8);
     } else {
         return -1;
     }
@@ -218,6 +334,8 @@ int fsimage_read_dxx_image(const disk_image_t *image)
         }
     }
 
+    tracks = lib_malloc(sizeof(dxx_gcr_track_t) * (image->max_half_tracks / 2 + 1));
+
     for (header.track = track = 1; track <= image->max_half_tracks / 2; track++, header.track++) {
         half_track = track * 2 - 2;
 
@@ -231,8 +349,7 @@ int fsimage_read_dxx_image(const disk_image_t *image)
         image->gcr->tracks[half_track].size = track_size;
 
         if (track <= image->tracks) {
-            /* get temp buffer */
-            ptr = tempgcr = lib_malloc(track_size);
+            dxx_gcr_track_t *t = &tracks[num_tracks++];
 
             /* special case for second side of the 1571. If each side was formatted
                separately in one-sided mode, we must start from track 1 again and use
@@ -242,22 +359,26 @@ int fsimage_read_dxx_image(const disk_image_t *image)
 
                 buffer[BAM_ID_1571] = buffer[BAM_ID_1571 + 1] = 0xa0;
                 if (sectors >= 0) {
-                    util_fpread(fsimage->fd, buffer, 256, sectors << 8);
+                    fsimage_pread(fsimage, buffer, 256, sectors << 8);
                 }
                 header.id1 = buffer[BAM_ID_1571]; /* second side, update id and track */
                 header.id2 = buffer[BAM_ID_1571 + 1];
                 header.track = 1;
             }
 
-            gap = disk_image_gap_size(image->type, track);
-            headergap = disk_image_header_gap_size(image->type, track);
-            synclen = disk_image_sync_size(image->type, track);
+            t->dest = ptr;
+            t->size = track_size;
+            t->header = header;
+            t->gap = gap = disk_image_gap_size(image->type, track);
+            t->headergap = headergap = disk_image_header_gap_size(image->type, track);
+            t->synclen = synclen = disk_image_sync_size(image->type, track);
 
-            max_sector = disk_image_sector_per_track(image->type, track);
-
-            /* Clear track to avoid read errors.  */
-            memset(ptr, 0x55, track_size);
+            t->sectors = max_sector = disk_image_sector_per_track(image->type, track);
+            t->data = lib_calloc(max_sector, 256);
+            t->error = lib_malloc(max_sector * sizeof(int));
+            t->temp = lib_malloc(track_size);
 
+            /* the sectors are read here, the GCR conversion is done below */
             for (sector = 0; sector < max_sector; sector++) {
                 sectors = disk_image_check_sector(image, track, sector);
                 offset = sectors * 256;
@@ -267,42 +388,29 @@ int fsimage_read_dxx_image(const disk_image_t *image)
                     offset += X64_HEADER_LENGTH;
                 }
 #endif
+                t->error[sector] = -1;
                 if (sectors >= 0) {
                     rf = CBMDOS_FDC_ERR_DRIVE;
-                    if (util_fpread(fsimage->fd, buffer, 256, offset) >= 0) {
+                    if (fsimage_pread(fsimage, t->data + sector * 256, 256, offset) >= 0) {
                         if (fsimage->error_info.map != NULL) {
                             rf = fsimage->error_info.map[sectors];
                         }
                     }
-                    header.sector = sector;
-                    gcr_convert_sector_to_GCR(buffer, ptr, &header, headergap, synclen, rf);
+                    t->error[sector] = rf;
                 }
-
-                ptr += SECTOR_GCR_SIZE_WITH_HEADER + headergap + gap + (synclen * 2);
             }
 
-#if 0
-            /* copy gcr data to buffer (this creates perfectly aligned tracks) */
-            ptr = image->gcr->tracks[half_track].data;
-            memcpy(ptr, tempgcr, track_size);
-#else
-            /* copy gcr data to final buffer with offset + wraparound */
             /* On real disks, the track skew depends on many factors of which
                none is exactly defined: the mechanical properties of the drive,
                and last not least the code used for formatting the disk. Thus
                the offset we use here is somewhat arbitrary, the choosen values
                are tweaked to be somewhat close to what the skew1.prg program
                shows for the first few tracks. */
-            trackoffset += (ptr - tempgcr) - gap; /* bytes we have written */
+            trackoffset += max_sector * (SECTOR_GCR_SIZE_WITH_HEADER + headergap + gap + (synclen * 2)) - gap; /* bytes we have written */
             trackoffset += (track_size * 100) / 270; /* time it takes to step */
             trackoffset %= track_size;
             /*printf("track: %2u sectors: %2u size: %5u offset: %5lu\n", track, max_sector, track_size, trackoffset);*/
-            ptr = image->gcr->tracks[half_track].data;
-            memset(ptr, 0x55, track_size);
-            memcpy(ptr + trackoffset, tempgcr, track_size - trackoffset);
-            memcpy(ptr, tempgcr + (track_size - trackoffset), track_size - (track_size - trackoffset));
-#endif
-            lib_free(tempgcr);
+            t->offset = trackoffset;
         } else {
             memset(ptr, 0x55, track_size);
         }
@@ -329,6 +437,15 @@ int fsimage_read_dxx_image(const disk_image_t *image)
 #endif
 
     }
+
+    fsimage_dxx_convert_tracks(tracks, num_tracks);
+    for (i = 0; i < num_tracks; i++) {
+        lib_free(tracks[i].data);
+        lib_free(tracks[i].error);
+        lib_free(tracks[i].temp);
+    }
+    lib_free(tracks);
+
     return 0;
 }
 
@@ -372,7 +489,7 @@ int fsimage_dxx_read_sector(const disk_image_t *image, uint8_t *buf, const disk_
 
     if (harderror == 0) {
         if (image->gcr == NULL) {
-            if (util_fpread(fsimage->fd, buf, 256, offset) < 0) {
+            if (fsimage_pread(fsimage, buf, 256, offset) < 0) {
                 log_error(fsimage_dxx_log,
                         "Error reading T:%u S:%u from disk image.",
                         dadr->track, dadr->sector);
@@ -449,7 +566,7 @@ int fsimage_dxx_write_sector(disk_image_t *image, const uint8_t *buf, const disk
         offset += X64_HEADER_LENGTH;
     }
 #endif
-    if (util_fpwrite(fsimage->fd, buf, 256, offset) < 0) {
+    if (fsimage_pwrite(fsimage, buf, 256, offset) < 0) {
         log_error(fsimage_dxx_log, "Error writing T:%u S:%u to disk image.",
                   dadr->track, dadr->sector);
         return -1;
@@ -468,7 +585,7 @@ int fsimage_dxx_write_sector(disk_image_t *image, const uint8_t *buf, const disk
         }
 #endif
         fsimage->error_info.map[sectors] = CBMDOS_FDC_ERR_OK;
-        if (util_fpwrite(fsimage->fd, &fsimage->error_info.map[sectors], 1, offset) < 0) {
+        if (fsimage_pwrite(fsimage, &fsimage->error_info.map[sectors], 1, offset) < 0) {
             log_error(fsimage_dxx_log,
                     "Error writing T:%u S:%u error info to disk image.",
                     dadr->track, dadr->sector);
@@ -476,7 +593,7 @@ int fsimage_dxx_write_sector(disk_image_t *image, const uint8_t *buf, const disk
     }
 
     /* Make sure the stream is visible to other readers.  */
-    fflush(fsimage->fd);
+    fsimage_sync(fsimage);
     return 0;
 }
 
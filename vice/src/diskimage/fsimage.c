@@ -28,6 +28,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "archdep.h"
 #include "diskconstants.h"
@@ -43,10 +45,27 @@
 #include "zfile.h"
 #include "util.h"
 #include "cbmdos.h"
+#include "cmdline.h"
+#include "resources.h"
 
 
 static log_t fsimage_log = LOG_DEFAULT;
 
+/* Flag: keep sector based and GCR images in memory, and write back the
+   changes later?  */
+static int write_back_enabled = 0;
+
+/* Number of seconds after which changes are written back, 0 to write them
+   back only when the image is detached or a snapshot is saved.  */
+static int flush_interval = 5;
+
+/* Images are written back in blocks of this size.  */
+#define CACHE_BLOCK_SHIFT   8
+#define CACHE_BLOCK_SIZE    (1 << CACHE_BLOCK_SHIFT)
+
+/* All images that are currently cached.  */
+static fsimage_t *cached_images = NULL;
+
 
 /** \brief  Set image name
  *
@@ -93,9 +112,308 @@ void *fsimage_fd_get(const disk_image_t *image)
 
     fsimage = image->media.fsimage;
 
+    /* the caller may access the stream directly from now on */
+    fsimage_cache_drop(fsimage);
+
     return (void *)(fsimage->fd);
 }
 
+
+/** \brief  Check whether \a image has an open file
+ *
+ * Unlike fsimage_fd_get(), this leaves the write-back cache alone.
+ *
+ * \param[in]   image   disk image
+ *
+ * \return  1 if the image file is open, 0 otherwise
+ */
+int fsimage_is_open(const disk_image_t *image)
+{
+    return image->media.fsimage->fd != NULL;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Write-back cache.  */
+
+/* With `DiskImageWriteBack', the whole image is read into memory when it is
+   opened. The sector and GCR track functions then read and write through
+   fsimage_pread() and fsimage_pwrite(), which only mark the changed blocks
+   dirty. They are written to the file by fsimage_flush(), when the image is
+   closed, when a snapshot is saved, or `DiskImageFlushInterval' seconds after
+   the first unflushed change.  */
+
+static int fsimage_cache_supported(const disk_image_t *image)
+{
+    switch (image->type) {
+        case DISK_IMAGE_TYPE_D64:
+        case DISK_IMAGE_TYPE_D67:
+        case DISK_IMAGE_TYPE_D71:
+        case DISK_IMAGE_TYPE_D81:
+        case DISK_IMAGE_TYPE_D80:
+        case DISK_IMAGE_TYPE_D82:
+#ifdef HAVE_X64_IMAGE
+        case DISK_IMAGE_TYPE_X64:
+#endif
+        case DISK_IMAGE_TYPE_D1M:
+        case DISK_IMAGE_TYPE_D2M:
+        case DISK_IMAGE_TYPE_D4M:
+        case DISK_IMAGE_TYPE_DHD:
+        case DISK_IMAGE_TYPE_D90:
+        case DISK_IMAGE_TYPE_G64:
+        case DISK_IMAGE_TYPE_G71:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static size_t fsimage_cache_blocks(size_t len)
+{
+    return (len + CACHE_BLOCK_SIZE - 1) >> CACHE_BLOCK_SHIFT;
+}
+
+/** \brief  Keep an open image in memory if `DiskImageWriteBack' is enabled
+ *
+ * Called when an image is opened. Images that were opened before the
+ * resource was enabled can be passed as well.
+ */
+void fsimage_cache_start(disk_image_t *image)
+{
+    fsimage_t *fsimage = image->media.fsimage;
+    off_t len;
+    uint8_t *data;
+
+    if (!write_back_enabled || fsimage->fd == NULL || fsimage->cache.data != NULL
+        || !fsimage_cache_supported(image)) {
+        return;
+    }
+
+    len = archdep_file_size(fsimage->fd);
+    if (len <= 0) {
+        return;
+    }
+
+    data = lib_malloc((size_t)len);
+    if (util_fpread(fsimage->fd, data, (size_t)len, 0) < 0) {
+        log_warning(fsimage_log, "Cannot read `%s' into memory, writing through.",
+                    fsimage->name);
+        lib_free(data);
+        return;
+    }
+
+    fsimage->cache.data = data;
+    fsimage->cache.len = (size_t)len;
+    fsimage->cache.num_blocks = fsimage_cache_blocks((size_t)len);
+    fsimage->cache.dirty = lib_calloc(fsimage->cache.num_blocks, 1);
+    fsimage->cache.num_dirty = 0;
+
+    fsimage->next_cached = cached_images;
+    cached_images = fsimage;
+}
+
+/* Write back the changes and stop caching the image.  */
+void fsimage_cache_drop(fsimage_t *fsimage)
+{
+    fsimage_t **p;
+
+    if (fsimage->cache.data == NULL) {
+        return;
+    }
+
+    fsimage_flush(fsimage);
+
+    for (p = &cached_images; *p != NULL; p = &(*p)->next_cached) {
+        if (*p == fsimage) {
+            *p = fsimage->next_cached;
+            break;
+        }
+    }
+    fsimage->next_cached = NULL;
+
+    lib_free(fsimage->cache.data);
+    lib_free(fsimage->cache.dirty);
+    memset(&fsimage->cache, 0, sizeof(fsimage->cache));
+}
+
+/** \brief  Read from the image at a given offset
+ *
+ * Like util_fpread(), but served from memory for cached images.
+ *
+ * \return 0 on success, -1 on error
+ */
+int fsimage_pread(fsimage_t *fsimage, void *buf, size_t num, off_t offset)
+{
+    if (fsimage->cache.data == NULL) {
+        if (archdep_fseeko(fsimage->fd, offset, SEEK_SET) < 0
+            || fread(buf, num, 1, fsimage->fd) < 1) {
+            return -1;
+        }
+        return 0;
+    }
+
+    if (offset < 0 || (size_t)offset + num > fsimage->cache.len) {
+        return -1;
+    }
+    memcpy(buf, fsimage->cache.data + offset, num);
+
+    return 0;
+}
+
+/** \brief  Write to the image at a given offset
+ *
+ * Like util_fpwrite(), but only marks the blocks dirty for cached images.
+ * Writing beyond the end of the image extends it.
+ *
+ * \return 0 on success, -1 on error
+ */
+int fsimage_pwrite(fsimage_t *fsimage, const void *buf, size_t num, off_t offset)
+{
+    size_t end, block, last;
+
+    if (fsimage->cache.data == NULL) {
+        if (archdep_fseeko(fsimage->fd, offset, SEEK_SET) < 0
+            || fwrite(buf, num, 1, fsimage->fd) < 1) {
+            return -1;
+        }
+        return 0;
+    }
+
+    if (offset < 0) {
+        return -1;
+    }
+    if (num == 0) {
+        return 0;
+    }
+
+    end = (size_t)offset + num;
+    block = (size_t)offset >> CACHE_BLOCK_SHIFT;
+
+    if (end > fsimage->cache.len) {
+        size_t blocks = fsimage_cache_blocks(end);
+
+        /* the gap reads as zeroes, like in a file */
+        fsimage->cache.data = lib_realloc(fsimage->cache.data, end);
+        memset(fsimage->cache.data + fsimage->cache.len, 0, end - fsimage->cache.len);
+        if (blocks > fsimage->cache.num_blocks) {
+            fsimage->cache.dirty = lib_realloc(fsimage->cache.dirty, blocks);
+            memset(fsimage->cache.dirty + fsimage->cache.num_blocks, 0,
+                   blocks - fsimage->cache.num_blocks);
+            fsimage->cache.num_blocks = blocks;
+        }
+        if ((fsimage->cache.len >> CACHE_BLOCK_SHIFT) < block) {
+            block = fsimage->cache.len >> CACHE_BLOCK_SHIFT;
+        }
+        fsimage->cache.len = end;
+    }
+
+    memcpy(fsimage->cache.data + offset, buf, num);
+
+    if (fsimage->cache.num_dirty == 0) {
+        fsimage->cache.dirty_since = time(NULL);
+    }
+    last = (end - 1) >> CACHE_BLOCK_SHIFT;
+    for (; block <= last; block++) {
+        if (!fsimage->cache.dirty[block]) {
+            fsimage->cache.dirty[block] = 1;
+            fsimage->cache.num_dirty++;
+        }
+    }
+
+    return 0;
+}
+
+/** \brief  Write all changes of a cached image to the file
+ *
+ * \return 0 on success, -1 on error
+ */
+int fsimage_flush(fsimage_t *fsimage)
+{
+    size_t block, end, start, stop;
+    int rc = 0;
+
+    if (fsimage->cache.data == NULL || fsimage->cache.num_dirty == 0) {
+        return 0;
+    }
+
+    /* write runs of consecutive dirty blocks at once */
+    for (block = 0; block < fsimage->cache.num_blocks; block = end) {
+        end = block + 1;
+        if (!fsimage->cache.dirty[block]) {
+            continue;
+        }
+        while (end < fsimage->cache.num_blocks && fsimage->cache.dirty[end]) {
+            end++;
+        }
+
+        start = block << CACHE_BLOCK_SHIFT;
+        stop = end << CACHE_BLOCK_SHIFT;
+        if (stop > fsimage->cache.len) {
+            stop = fsimage->cache.len;
+        }
+
+        if (archdep_fseeko(fsimage->fd, (off_t)start, SEEK_SET) < 0
+            || fwrite(fsimage->cache.data + start, stop - start, 1, fsimage->fd) < 1) {
+            log_error(fsimage_log, "Error writing back `%s'.", fsimage->name);
+            rc = -1;
+            continue;
+        }
+        memset(fsimage->cache.dirty + block, 0, end - block);
+        fsimage->cache.num_dirty -= (unsigned int)(end - block);
+    }
+
+    fflush(fsimage->fd);
+
+    return rc;
+}
+
+static void fsimage_flush_if_due(fsimage_t *fsimage)
+{
+    if (fsimage->cache.num_dirty > 0 && flush_interval > 0
+        && time(NULL) - fsimage->cache.dirty_since >= flush_interval) {
+        fsimage_flush(fsimage);
+    }
+}
+
+/** \brief  Make changes visible to other readers of the image file
+ *
+ * Called after every write. Cached images are only written back when the
+ * flush interval has passed.
+ */
+void fsimage_sync(fsimage_t *fsimage)
+{
+    if (fsimage->cache.data == NULL) {
+        fflush(fsimage->fd);
+    } else {
+        fsimage_flush_if_due(fsimage);
+    }
+}
+
+/* Write back the cached images whose flush interval has passed, called
+   regularly.  */
+void fsimage_flush_due(void)
+{
+    fsimage_t *fsimage;
+
+    for (fsimage = cached_images; fsimage != NULL; fsimage = fsimage->next_cached) {
+        fsimage_flush_if_due(fsimage);
+    }
+}
+
+/* Write back the changes of all cached images.  */
+int fsimage_flush_all(void)
+{
+    fsimage_t *fsimage;
+    int rc = 0;
+
+    for (fsimage = cached_images; fsimage != NULL; fsimage = fsimage->next_cached) {
+        if (fsimage_flush(fsimage) < 0) {
+            rc = -1;
+        }
+    }
+
+    return rc;
+}
+
 /*-----------------------------------------------------------------------*/
 
 void fsimage_media_create(disk_image_t *image)
@@ -162,6 +480,7 @@ int fsimage_open(disk_image_t *image)
     }
 
     if (fsimage_probe(image) == 0) {
+        fsimage_cache_start(image);
         return 0;
     }
 
@@ -181,6 +500,8 @@ int fsimage_close(disk_image_t *image)
         return -1;
     }
 
+    fsimage_cache_drop(fsimage);
+
     /* flush the image when closed; added by Roberto Muscedere on 20210125 */
     if (image->type == DISK_IMAGE_TYPE_P64) {
         fsimage_write_p64_image(image);
@@ -305,5 +626,67 @@ off_t fsimage_size(const disk_image_t *image)
     fsimage_t *fsimage;
 
     fsimage = image->media.fsimage;
+    if (fsimage->cache.data != NULL) {
+        return (off_t)fsimage->cache.len;
+    }
     return archdep_file_size(fsimage->fd);
 }
+
+/*-----------------------------------------------------------------------*/
+
+static int set_write_back_enabled(int val, void *param)
+{
+    write_back_enabled = val ? 1 : 0;
+
+    /* images attached from now on are cached, the others are written
+       through from now on */
+    if (!write_back_enabled) {
+        while (cached_images != NULL) {
+            fsimage_cache_drop(cached_images);
+        }
+    }
+
+    return 0;
+}
+
+static int set_flush_interval(int val, void *param)
+{
+    if (val < 0) {
+        return -1;
+    }
+    flush_interval = val;
+
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "DiskImageWriteBack", 0, RES_EVENT_NO, NULL,
+      &write_back_enabled, set_write_back_enabled, NULL },
+    { "DiskImageFlushInterval", 5, RES_EVENT_NO, NULL,
+      &flush_interval, set_flush_interval, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int fsimage_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-diskimagewriteback", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DiskImageWriteBack", (resource_value_t)1,
+      NULL, "Keep attached disk images in memory and write back changes later" },
+    { "+diskimagewriteback", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DiskImageWriteBack", (resource_value_t)0,
+      NULL, "Write changes to attached disk images immediately" },
+    { "-diskimageflushinterval", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "DiskImageFlushInterval", NULL,
+      "<seconds>", "Write back changes to disk images after <seconds> (0: only on detach)" },
+    CMDLINE_LIST_END
+};
+
+int fsimage_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
@@ -28,6 +28,7 @@
 #define VICE_FSIMAGE_H
 
 #include <stdio.h>
+#include <time.h>
 
 #include "types.h"
 
@@ -42,14 +43,27 @@ typedef struct fsimage_s {
         int dirty;
         int len;
     } error_info;
+    /* write-back cache of the whole image, see `DiskImageWriteBack' */
+    struct {
+        uint8_t *data;          /* image contents, NULL if not cached */
+        size_t len;             /* length of the image */
+        uint8_t *dirty;         /* one flag per block */
+        size_t num_blocks;      /* number of flags allocated */
+        unsigned int num_dirty; /* number of dirty blocks */
+        time_t dirty_since;     /* time of the oldest unflushed write */
+    } cache;
+    struct fsimage_s *next_cached;
 } fsimage_t;
 
 
 extern void fsimage_init(void);
+extern int fsimage_resources_init(void);
+extern int fsimage_cmdline_options_init(void);
 
 extern void fsimage_name_set(struct disk_image_s *image, const char *name);
 extern const char *fsimage_name_get(const struct disk_image_s *image);
 extern void *fsimage_fd_get(const disk_image_t *image);
+extern int fsimage_is_open(const struct disk_image_s *image);
 extern void fsimage_media_create(struct disk_image_s *image);
 extern void fsimage_media_destroy(struct disk_image_s *image);
 
@@ -61,4 +75,13 @@ extern int fsimage_write_sector(struct disk_image_s *image, const uint8_t *buf,
                                 const struct disk_addr_s *dadr);
 extern off_t fsimage_size(const disk_image_t *image);
 
+extern int fsimage_pread(fsimage_t *fsimage, void *buf, size_t num, off_t offset);
+extern int fsimage_pwrite(fsimage_t *fsimage, const void *buf, size_t num, off_t offset);
+extern void fsimage_sync(fsimage_t *fsimage);
+extern int fsimage_flush(fsimage_t *fsimage);
+extern int fsimage_flush_all(void);
+extern void fsimage_flush_due(void);
+extern void fsimage_cache_start(struct disk_image_s *image);
+extern void fsimage_cache_drop(fsimage_t *fsimage);
+
 #endif
@@ -32,6 +32,7 @@
 
 #include "drive-check.h"
 #include "drive-resources.h"
+#include "drive-thread.h"
 #include "drive.h"
 #include "drivecpu.h"
 #include "drivecpu65c02.h"
@@ -58,6 +59,8 @@
 int drive_sound_emulation;
 /* volume of the drive sound */
 int drive_sound_emulation_volume;
+/* Do the drive CPUs run on their own threads?  */
+static int drive_threads;
 
 static int set_drive_true_emulation(int val, void *param)
 {
@@ -121,6 +124,14 @@ static int set_drive_sound_emulation_volume(int val, void *param)
     return 0;
 }
 
+static int set_drive_threads(int val, void *param)
+{
+    drive_threads = val ? 1 : 0;
+    drive_thread_set_enabled(drive_threads);
+
+    return 0;
+}
+
 static int set_drive_extend_image_policy(int val, void *param)
 {
     switch (val) {
@@ -359,6 +370,8 @@ static const resource_int_t resources_int[] = {
       &drive_sound_emulation, set_drive_sound_emulation, NULL },
     { "DriveSoundEmulationVolume", 1000, RES_EVENT_NO, (resource_value_t)1000,
       &drive_sound_emulation_volume, set_drive_sound_emulation_volume, NULL },
+    { "DriveThreads", 0, RES_EVENT_NO, (resource_value_t)0,
+      &drive_threads, set_drive_threads, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -130,6 +130,10 @@ int drive_snapshot_write_module(snapshot_t *s, int save_disks, int save_roms)
     }
 
     drive_gcr_data_writeback_all();
+
+    /* the snapshot may refer to the image files instead of containing them */
+    disk_image_flush_all();
+
     rotation_table_get(rotation_table_ptr); /* FIXME: should this not be per drive rather than unit? */
 
     for (unr = 0; unr < NUM_DISK_UNITS; unr++) {
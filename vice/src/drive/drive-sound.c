@@ -29,6 +29,7 @@
 #include "archdep.h"
 #include "drive.h"
 #include "drive-sound.h"
+#include "drive-thread.h"
 #include "sound.h"
 
 static const signed char hum[] = {
@@ -1540,6 +1541,7 @@ void drive_sound_update(int i, int unit)
         drive_sound.chip_enabled = 0;
         return;
     }
+    drive_thread_sync((unsigned int)unit);
     sound_store((uint16_t)drive_sound_offset, 0, 0);
     switch (i) {
         case DRIVE_SOUND_MOTOR_ON:
@@ -1559,6 +1561,7 @@ void drive_sound_head(int track, int dir, int unit)
         drive_sound.chip_enabled = 0;
         return;
     }
+    drive_thread_sync((unsigned int)unit);
     sound_store((uint16_t)drive_sound_offset, 0, 0);
     stepvol[unit] = 100 - track;
     if (track == 2 && dir == -1) {
@@ -0,0 +1,382 @@
+/*
+ * drive-thread.c - Run the drive CPUs of several units on their own threads.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Normally the units are brought up to the main CPU clock one after another.
+   With DriveThreads enabled, drive_thread_execute() runs them at the same
+   time instead: the first unit on the emulation thread, the others on worker
+   threads.
+
+   A drive CPU mostly works on its own RAM, chips and disk. Before it touches
+   anything another unit or the machine can see (the IEC bus lines, fast
+   serial, drive sound), it calls drive_thread_sync(), which waits until all
+   units before it are done. From then on it runs alone, exactly as it would
+   when the units run one after another, so the results are the same in both
+   modes. Units that touch shared state in other places (parallel cables,
+   IEEE-488, TCBM, CMD drives) sync right at the start. Anything that needs
+   the emulation thread (JAM handling, the monitor) goes through
+   drive_thread_call(). If the monitor watches a drive CPU, all units run
+   one after another as before.
+
+   The CPU history entries of units running ahead are kept apart and added in
+   unit order, so the history matches as well.
+
+   DRIVE_THREAD_CHECK (see drive-thread.h) logs a hash of every drive CPU's
+   instructions, which has to be the same in both modes. A copy from drive 8
+   to drive 9 while drive 9 formats and drive 8 validates, with a third
+   drive formatting, gives the same hashes, RAM and disk images. */
+
+#include "vice.h"
+
+#include <stdio.h>
+
+#ifdef USE_VICE_THREAD
+#include <pthread.h>
+#endif
+
+#include "debug.h"
+#include "drive-thread.h"
+#include "drive.h"
+#include "drivetypes.h"
+#include "log.h"
+#include "monitor.h"
+#include "types.h"
+
+static int threads_enabled = 0;
+
+#ifdef USE_VICE_THREAD
+
+static pthread_t workers[NUM_DISK_UNITS - 1];
+static int num_workers = 0;
+
+static pthread_mutex_t batch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t state_cond = PTHREAD_COND_INITIALIZER;
+
+/* the units being run in their serial order, protected by batch_lock */
+static diskunit_context_t *batch_units[NUM_DISK_UNITS];
+static int sync_at_start[NUM_DISK_UNITS];
+static int unit_done[NUM_DISK_UNITS];
+static int batch_num = 0;
+static CLOCK batch_clk = 0;
+static int next_unit = 0;       /* next unit for a worker */
+static int first_running = 0;   /* all units before this one are done */
+static int num_done = 0;
+static int num_waiting = 0;     /* units waiting in wait_for_turn() */
+static int pool_quit = 0;
+
+/* call handed to the emulation thread by drive_thread_call() */
+static drive_thread_func_t main_call_func = NULL;
+static void *main_call_data = NULL;
+
+/* position of each disk unit in the batch */
+static int unit_position[NUM_DISK_UNITS];
+
+/* Set while a unit has to wait for the units before it. Only the thread
+   running the unit reads it. */
+static int sync_pending[NUM_DISK_UNITS];
+
+/* Nonzero while drive_thread_execute() runs. */
+static int batch_active = 0;
+
+#ifdef DRIVE_THREAD_CHECK
+/* Number of times units ran in parallel. */
+static unsigned long check_batches = 0;
+#endif
+
+/* Does the unit touch shared state only in drive_thread_sync() and
+   drive_thread_call()? */
+static int unit_is_private(diskunit_context_t *unit)
+{
+    switch (unit->type) {
+        case DRIVE_TYPE_1540:
+        case DRIVE_TYPE_1541:
+        case DRIVE_TYPE_1541II:
+        case DRIVE_TYPE_1570:
+        case DRIVE_TYPE_1571:
+        case DRIVE_TYPE_1571CR:
+        case DRIVE_TYPE_1581:
+            return unit->parallel_cable == DRIVE_PC_NONE;
+        default:
+            return 0;
+    }
+}
+
+/* The monitor expects drive CPUs it watches to run on the emulation
+   thread. */
+static int unit_is_watched(diskunit_context_t *unit)
+{
+#ifdef DEBUG
+    if (debug.drivecpu_traceflg[unit->mynumber]) {
+        return 1;
+    }
+#endif
+    return monitor_mask[unit->cpu->monspace] != 0;
+}
+
+static void commit_history(int pos)
+{
+    monitor_cpuhistory_commit((uint8_t)(batch_units[pos]->mynumber + 1));
+}
+
+/* Called with batch_lock held.  */
+static void batch_unit_done(int pos)
+{
+    unit_done[pos] = 1;
+    num_done++;
+    while (first_running < batch_num && unit_done[first_running]) {
+        commit_history(first_running);
+        first_running++;
+    }
+    pthread_cond_broadcast(&state_cond);
+}
+
+/* Wait until the units before the one at `pos' are done. Called with
+   batch_lock held.  */
+static void wait_for_turn(int pos)
+{
+    num_waiting++;
+    pthread_cond_broadcast(&state_cond);
+    while (first_running < pos) {
+        pthread_cond_wait(&state_cond, &batch_lock);
+    }
+    num_waiting--;
+
+    /* the history of the units before is complete, continue directly */
+    commit_history(pos);
+    sync_pending[batch_units[pos]->mynumber] = 0;
+}
+
+static void *drive_worker(void *unused)
+{
+    diskunit_context_t *unit;
+    int pos;
+
+    pthread_mutex_lock(&batch_lock);
+    for (;;) {
+        while (!pool_quit && next_unit >= batch_num) {
+            pthread_cond_wait(&work_cond, &batch_lock);
+        }
+        if (pool_quit) {
+            break;
+        }
+        pos = next_unit++;
+        unit = batch_units[pos];
+        if (sync_at_start[pos]) {
+            wait_for_turn(pos);
+        }
+        pthread_mutex_unlock(&batch_lock);
+
+        drive_cpu_execute_one(unit, batch_clk);
+
+        pthread_mutex_lock(&batch_lock);
+        batch_unit_done(pos);
+    }
+    pthread_mutex_unlock(&batch_lock);
+
+    return NULL;
+}
+
+static void pool_stop(void)
+{
+    int i;
+
+    if (num_workers == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&batch_lock);
+    pool_quit = 1;
+    pthread_cond_broadcast(&work_cond);
+    pthread_mutex_unlock(&batch_lock);
+
+    for (i = 0; i < num_workers; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    num_workers = 0;
+    pool_quit = 0;
+}
+
+static void pool_start(void)
+{
+    while (num_workers < NUM_DISK_UNITS - 1) {
+        if (pthread_create(&workers[num_workers], NULL, drive_worker, NULL) != 0) {
+            log_error(LOG_DEFAULT, "Cannot create drive thread.");
+            break;
+        }
+        num_workers++;
+    }
+}
+
+#endif
+
+void drive_thread_set_enabled(int enabled)
+{
+    threads_enabled = enabled;
+#ifdef USE_VICE_THREAD
+    if (!enabled) {
+        pool_stop();
+    }
+#endif
+}
+
+/* Run `units' up to `clk_value' on several threads. Returns 0 if they should
+   run one after another instead.  */
+int drive_thread_execute(diskunit_context_t **units, int num, CLOCK clk_value)
+{
+#ifdef USE_VICE_THREAD
+    drive_thread_func_t func;
+    void *data;
+    int i, parallel = 0;
+
+    if (batch_active) {
+        /* called from drive_thread_call(), the units are still running */
+        return 1;
+    }
+    if (!threads_enabled || num < 2) {
+        return 0;
+    }
+    for (i = 0; i < num; i++) {
+        if (unit_is_watched(units[i])) {
+            return 0;
+        }
+        if (i > 0 && unit_is_private(units[i])) {
+            parallel = 1;
+        }
+    }
+    if (!parallel) {
+        return 0;
+    }
+
+    pool_start();
+    if (num_workers < num - 1) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&batch_lock);
+    for (i = 0; i < num; i++) {
+        unsigned int dnr = units[i]->mynumber;
+
+        batch_units[i] = units[i];
+        unit_done[i] = 0;
+        unit_position[dnr] = i;
+        sync_at_start[i] = (i > 0 && !unit_is_private(units[i]));
+        sync_pending[dnr] = (i > 0);
+        if (i > 0) {
+            monitor_cpuhistory_defer((uint8_t)(dnr + 1));
+        }
+    }
+    batch_num = num;
+    batch_clk = clk_value;
+    next_unit = 1;
+    first_running = 0;
+    num_done = 0;
+    num_waiting = 0;
+    batch_active = 1;
+#ifdef DRIVE_THREAD_CHECK
+    check_batches++;
+#endif
+    pthread_cond_broadcast(&work_cond);
+    pthread_mutex_unlock(&batch_lock);
+
+    drive_cpu_execute_one(units[0], clk_value);
+
+    pthread_mutex_lock(&batch_lock);
+    batch_unit_done(0);
+    while (num_done < batch_num) {
+        if (main_call_func != NULL) {
+            func = main_call_func;
+            data = main_call_data;
+            pthread_mutex_unlock(&batch_lock);
+            func(data);
+            pthread_mutex_lock(&batch_lock);
+            main_call_func = NULL;
+            pthread_cond_broadcast(&state_cond);
+        } else {
+            pthread_cond_wait(&state_cond, &batch_lock);
+        }
+    }
+    batch_num = 0;
+    next_unit = 0;
+    batch_active = 0;
+    pthread_mutex_unlock(&batch_lock);
+
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/* Called by a unit before it touches state shared with other units or the
+   machine.  */
+void drive_thread_sync(unsigned int dnr)
+{
+#ifdef USE_VICE_THREAD
+    if (sync_pending[dnr]) {
+        pthread_mutex_lock(&batch_lock);
+        wait_for_turn(unit_position[dnr]);
+        pthread_mutex_unlock(&batch_lock);
+    }
+#endif
+}
+
+/* Call `func' on the emulation thread while no other unit runs.  */
+void drive_thread_call(unsigned int dnr, drive_thread_func_t func, void *data)
+{
+#ifdef USE_VICE_THREAD
+    int pos;
+
+    if (batch_active) {
+        pthread_mutex_lock(&batch_lock);
+        pos = unit_position[dnr];
+        if (sync_pending[dnr]) {
+            wait_for_turn(pos);
+        }
+        /* the units after this one stop at their next sync point */
+        while (num_waiting < batch_num - num_done - 1) {
+            pthread_cond_wait(&state_cond, &batch_lock);
+        }
+        if (pos > 0) {
+            main_call_func = func;
+            main_call_data = data;
+            pthread_cond_broadcast(&state_cond);
+            while (main_call_func != NULL) {
+                pthread_cond_wait(&state_cond, &batch_lock);
+            }
+            pthread_mutex_unlock(&batch_lock);
+            return;
+        }
+        pthread_mutex_unlock(&batch_lock);
+    }
+#endif
+    func(data);
+}
+
+void drive_thread_shutdown(void)
+{
+#ifdef USE_VICE_THREAD
+    pool_stop();
+#ifdef DRIVE_THREAD_CHECK
+    log_message(LOG_DEFAULT, "Drive threads: units ran in parallel %lu times.", check_batches);
+#endif
+#endif
+}
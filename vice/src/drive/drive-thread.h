@@ -0,0 +1,46 @@
+/*
+ * drive-thread.h - Run the drive CPUs of several units on their own threads.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_DRIVE_THREAD_H
+#define VICE_DRIVE_THREAD_H
+
+#include "types.h"
+
+/* Define to check that DriveThreads does not change the emulation: every
+   drive CPU hashes its instructions (clock, PC and registers) and the hash
+   is logged at exit together with the number of times the units ran in
+   parallel. The hashes must be the same with -drivethreads and
+   +drivethreads.  */
+/* #define DRIVE_THREAD_CHECK */
+
+struct diskunit_context_s;
+
+typedef void (*drive_thread_func_t)(void *data);
+
+extern void drive_thread_set_enabled(int enabled);
+extern int drive_thread_execute(struct diskunit_context_s **units, int num, CLOCK clk_value);
+extern void drive_thread_sync(unsigned int dnr);
+extern void drive_thread_call(unsigned int dnr, drive_thread_func_t func, void *data);
+extern void drive_thread_shutdown(void);
+
+#endif
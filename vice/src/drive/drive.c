@@ -51,6 +51,7 @@
 #include "diskconstants.h"
 #include "diskimage.h"
 #include "drive-check.h"
+#include "drive-thread.h"
 #include "drive.h"
 #include "drivecpu.h"
 #include "drivecpu65c02.h"
@@ -299,6 +300,8 @@ void drive_shutdown(void)
         return;
     }
 
+    drive_thread_shutdown();
+
     for (unr = 0; unr < NUM_DISK_UNITS; unr++) {
         diskunit_context_t *unit = diskunit_context[unr];
 
@@ -992,17 +995,34 @@ void drive_cpu_execute_one(diskunit_context_t *drv, CLOCK clk_value)
     }
 }
 
+/* Run the given units in this order, or on their own threads if enabled. */
+static void drive_cpu_execute_units(diskunit_context_t **units, int num,
+                                    CLOCK clk_value)
+{
+    int i;
+
+    if (drive_thread_execute(units, num, clk_value)) {
+        return;
+    }
+    for (i = 0; i < num; i++) {
+        drive_cpu_execute_one(units[i], clk_value);
+    }
+}
+
 void drive_cpu_execute_all(CLOCK clk_value)
 {
+    diskunit_context_t *units[NUM_DISK_UNITS];
     unsigned int dnr;
+    int num = 0;
 
     for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
         diskunit_context_t *unit = diskunit_context[dnr];
 
         if (unit->enable) {
-            drive_cpu_execute_one(unit, clk_value);
+            units[num++] = unit;
         }
     }
+    drive_cpu_execute_units(units, num, clk_value);
 }
 
 void drive_cpu_set_overflow(diskunit_context_t *drv)
@@ -1018,18 +1038,26 @@ void drive_cpu_set_overflow(diskunit_context_t *drv)
 /* This is called at every vsync. */
 void drive_vsync_hook(void)
 {
+    diskunit_context_t *units[NUM_DISK_UNITS];
     unsigned int dnr;
+    int num = 0;
 
     drive_update_ui_status();
 
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        diskunit_context_t *unit = diskunit_context[dnr];
+
+        if (unit->enable && unit->idling_method != DRIVE_IDLE_SKIP_CYCLES) {
+            units[num++] = unit;
+        }
+    }
+    drive_cpu_execute_units(units, num, maincpu_clk);
+
     for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
         diskunit_context_t *unit = diskunit_context[dnr];
         drive_t *drive = unit->drives[0];
 
         if (unit->enable) {
-            if (unit->idling_method != DRIVE_IDLE_SKIP_CYCLES) {
-                drive_cpu_execute_one(diskunit_context[dnr], maincpu_clk);
-            }
             if (unit->idling_method == DRIVE_IDLE_NO_IDLE) {
                 /* if drive is never idle, also rotate the disk. this prevents
                  * huge peaks in cpu usage when the drive must catch up with
@@ -1041,6 +1069,29 @@ void drive_vsync_hook(void)
             /* printf("drive_vsync_hook drv %d @clk:%d\n", dnr, maincpu_clk); */
         }
     }
+
+    /* write back disk images kept in memory */
+    disk_image_flush_due();
+}
+
+/* Is the motor of any emulated drive running?  */
+int drive_motor_is_on(void)
+{
+    unsigned int dnr, d;
+
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        diskunit_context_t *unit = diskunit_context[dnr];
+
+        if (!unit->enable) {
+            continue;
+        }
+        for (d = 0; d < NUM_DRIVES; d++) {
+            if (unit->drives[d]->byte_ready_active & BRA_MOTOR_ON) {
+                return 1;
+            }
+        }
+    }
+    return 0;
 }
 
 /* ------------------------------------------------------------------------- */
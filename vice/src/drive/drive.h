@@ -361,6 +361,7 @@ extern void drive_cpu_execute_one(struct diskunit_context_s *drv, CLOCK clk_valu
 extern void drive_cpu_execute_all(CLOCK clk_value);
 extern void drive_cpu_set_overflow(struct diskunit_context_s *drv);
 extern void drive_vsync_hook(void);
+extern int drive_motor_is_on(void);
 extern int drive_get_disk_drive_type(int dnr);
 extern void drive_enable_update_ui(struct diskunit_context_s *drv);
 extern void drive_update_ui_status(void);
@@ -39,6 +39,7 @@
 #include "drive.h"
 #include "drivecpu.h"
 #include "drive-check.h"
+#include "drive-thread.h"
 #include "drivemem.h"
 #include "drivetypes.h"
 #include "interrupt.h"
@@ -67,6 +68,37 @@ static void drivecpu_set_bank_base(void *context);
 
 static interrupt_cpu_status_t *drivecpu_int_status_ptr[NUM_DISK_UNITS];
 
+#ifdef DRIVE_THREAD_CHECK
+static uint64_t check_hash[NUM_DISK_UNITS];
+static uint64_t check_count[NUM_DISK_UNITS];
+
+/* FNV-1a over the clock and the registers after each instruction.  */
+static void drivecpu_check_instruction(unsigned int dnr, CLOCK clk, const mos6510_regs_t *regs)
+{
+    uint8_t v[16];
+    uint64_t h = check_count[dnr] ? check_hash[dnr] : 14695981039346656037u;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        v[i] = (uint8_t)(clk >> (i * 8));
+    }
+    v[8] = (uint8_t)regs->pc;
+    v[9] = (uint8_t)(regs->pc >> 8);
+    v[10] = regs->a;
+    v[11] = regs->x;
+    v[12] = regs->y;
+    v[13] = regs->sp;
+    v[14] = regs->p;
+    v[15] = (uint8_t)((regs->n & 0x80) | (regs->z == 0));
+
+    for (i = 0; i < 16; i++) {
+        h = (h ^ v[i]) * 1099511628211u;
+    }
+    check_hash[dnr] = h;
+    check_count[dnr]++;
+}
+#endif
+
 void drivecpu_setup_context(struct diskunit_context_s *drv, int i)
 {
     monitor_interface_t *mi;
@@ -226,6 +258,11 @@ void drivecpu_shutdown(diskunit_context_t *drv)
 
     cpu = drv->cpu;
 
+#ifdef DRIVE_THREAD_CHECK
+    log_message(LOG_DEFAULT, "Drive %d: %"PRIu64" instructions, trace hash %016"PRIx64".",
+                drv->mynumber + 8, check_count[drv->mynumber], check_hash[drv->mynumber]);
+#endif
+
     if (cpu->alarm_context != NULL) {
         alarm_context_destroy(cpu->alarm_context);
     }
@@ -396,6 +433,7 @@ void drivecpu_execute(diskunit_context_t *drv, CLOCK clk_value)
 #define PAGE_ONE (cpu->pageone)
 #define LAST_OPCODE_INFO (cpu->last_opcode_info)
 #define LAST_OPCODE_ADDR (cpu->last_opcode_addr)
+#define PROFILE_CONTEXT (cpu->profile)
 #define TRACEFLG (debug.drivecpu_traceflg[drv->mynumber])
 
 #define CPU_INT_STATUS (cpu->int_status)
@@ -432,6 +470,9 @@ void drivecpu_execute(diskunit_context_t *drv, CLOCK clk_value)
 #define bank_base (cpu->d_bank_base)
 
 #include "6510core.c"
+#ifdef DRIVE_THREAD_CHECK
+        drivecpu_check_instruction(drv->mynumber, CLK, &cpu->cpu_regs);
+#endif
     }
 
     cpu->last_clk = clk_value;
@@ -452,13 +493,15 @@ static void drivecpu_set_bank_base(void *context)
     JUMP(reg_pc);
 }
 
-/* Inlining this fuction makes no sense and would only bloat the code.  */
-static void drivecpu_jam(diskunit_context_t *drv)
+/* Runs on the emulation thread, also when the drive has its own thread.  */
+static void drivecpu_jam_handler(void *context)
 {
     unsigned int tmp;
     char *dname = "  Drive";
+    diskunit_context_t *drv;
     drivecpu_context_t *cpu;
 
+    drv = (diskunit_context_t *)context;
     cpu = drv->cpu;
 
     switch (drv->type) {
@@ -532,6 +575,12 @@ static void drivecpu_jam(diskunit_context_t *drv)
     }
 }
 
+/* Inlining this fuction makes no sense and would only bloat the code.  */
+static void drivecpu_jam(diskunit_context_t *drv)
+{
+    drive_thread_call(drv->mynumber, drivecpu_jam_handler, drv);
+}
+
 /* ------------------------------------------------------------------------- */
 
 #define SNAP_MAJOR 1
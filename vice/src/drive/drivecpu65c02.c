@@ -380,6 +380,7 @@ void drivecpu65c02_execute(diskunit_context_t *drv, CLOCK clk_value)
 #define PAGE_ONE (cpu->pageone)
 #define LAST_OPCODE_INFO (cpu->last_opcode_info)
 #define LAST_OPCODE_ADDR (cpu->last_opcode_addr)
+#define PROFILE_CONTEXT (cpu->profile)
 #define TRACEFLG (debug.drivecpu_traceflg[drv->mynumber])
 
 #define CPU_INT_STATUS (cpu->int_status)
@@ -43,6 +43,7 @@
 
 struct diskunit_context_s;         /* forward declaration */
 struct monitor_interface_s;
+struct mon_profile_cpu_s;
 
 /* This defines the memory access for the drive CPU.  */
 typedef uint8_t drive_read_func_t (struct diskunit_context_s *, uint16_t);
@@ -89,6 +90,9 @@ typedef struct drivecpu_context_s {
     /* Address of the last executed opcode. This is used by watchpoints. */
     unsigned int last_opcode_addr;
 
+    /* Profiler data, NULL unless the monitor profiler traces this CPU.  */
+    struct mon_profile_cpu_s *profile;
+
     /* Public copy of the registers.  */
     mos6510_regs_t cpu_regs;
     R65C02_regs_t cpu_R65C02_regs;
@@ -31,6 +31,7 @@
 
 #include "cia.h"
 #include "ciad.h"
+#include "drive-thread.h"
 #include "drivetypes.h"
 #include "iecdrive.h"
 #include "interrupt.h"
@@ -170,6 +171,7 @@ static void store_sdr(cia_context_t *cia_context, uint8_t byte)
 
     cia1571p = (drivecia1571_context_t *)(cia_context->prv);
 
+    drive_thread_sync(cia1571p->number);
     iec_fast_drive_write((uint8_t)byte, cia1571p->number);
 }
 
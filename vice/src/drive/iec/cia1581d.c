@@ -32,6 +32,7 @@
 #include "cia.h"
 #include "ciad.h"
 #include "debug.h"
+#include "drive-thread.h"
 #include "drive.h"
 #include "drivetypes.h"
 #include "iecbus.h"
@@ -150,6 +151,8 @@ static void store_ciapb(cia_context_t *cia_context, CLOCK rclk, uint8_t byte)
     cia1581p = (drivecia1581_context_t *)(cia_context->prv);
 
     if (byte != cia_context->old_pb) {
+        drive_thread_sync(cia1581p->number);
+
         if (cia1581p->iecbus != NULL) {
             uint8_t *drive_bus, *drive_data;
             unsigned int unit;
@@ -206,6 +209,8 @@ static uint8_t read_ciapb(cia_context_t *cia_context)
 
     cia1581p = (drivecia1581_context_t *)(cia_context->prv);
 
+    drive_thread_sync(cia1581p->number);
+
     if (cia1581p->iecbus != NULL) {
         uint8_t *drive_port;
 
@@ -235,6 +240,7 @@ static void store_sdr(cia_context_t *cia_context, uint8_t byte)
 
     cia1581p = (drivecia1581_context_t *)(cia_context->prv);
 
+    drive_thread_sync(cia1581p->number);
     iec_fast_drive_write(byte, cia1581p->number);
 }
 
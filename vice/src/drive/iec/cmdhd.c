@@ -288,6 +288,23 @@ static void cmdhd_scsiwrite(struct scsi_context_s *scsi)
     dc->current_half_track = (scsi->address * 200) / (hd->imagesize + 1);
 }
 
+/* The DHD image is SCSI disk 0; it is accessed through the disk image, so
+   the write-back cache is used if enabled */
+static int cmdhd_image_read(void *image, uint8_t *buf, size_t num, off_t offset)
+{
+    return disk_image_pread((disk_image_t *)image, buf, num, offset);
+}
+
+static int cmdhd_image_write(void *image, const uint8_t *buf, size_t num, off_t offset)
+{
+    return disk_image_pwrite((disk_image_t *)image, buf, num, offset);
+}
+
+static off_t cmdhd_image_size(void *image)
+{
+    return disk_image_size((disk_image_t *)image);
+}
+
 /* We don't actually format the disk, we just remove the 16 byte CMD signature */
 static void cmdhd_scsiformat(struct scsi_context_s *scsi)
 {
@@ -1093,6 +1110,9 @@ void cmdhd_setup_context(diskunit_context_t *ctxptr)
     scsi = ctxptr->cmdhd->scsi;
     scsi->p = ctxptr->cmdhd;
     scsi->myname = lib_msprintf("CMDHD%dSCSI", ctxptr->mynumber);
+    scsi->image_read = cmdhd_image_read;
+    scsi->image_write = cmdhd_image_write;
+    scsi->image_size = cmdhd_image_size;
 
     ctxptr->cmdhd->i8255a = lib_calloc(1, sizeof(i8255a_state));
     i8255a = ctxptr->cmdhd->i8255a;
@@ -1289,7 +1309,7 @@ void cmdhd_reset(cmdhd_context_t *hd)
     /* count the number of connected drives */
     unit = 0;
     for (i = 0; i < 56; i++) {
-        if (hd->scsi->file[i]) {
+        if (scsi_image_present(hd->scsi, i)) {
             unit++;
         }
     }
@@ -1308,7 +1328,7 @@ void cmdhd_reset(cmdhd_context_t *hd)
             }
         } else {
             /* remove scsi ID 0 */
-            hd->scsi->file[0] = NULL;
+            hd->scsi->image[0] = NULL;
         }
     }
 
@@ -1365,8 +1385,8 @@ int cmdhd_attach_image(disk_image_t *image, unsigned int unit)
         return -1;
     }
 
-    /* copy file FD to the scsi module */
-    hd->scsi->file[0] = image->media.fsimage->fd;
+    /* hand the image to the scsi module */
+    hd->scsi->image[0] = image;
 
     /* find the base lba */
     cmdhd_findbaselba(hd);
@@ -1474,7 +1494,7 @@ int cmdhd_detach_image(disk_image_t *image, unsigned int unit)
     hd->image = NULL;
     hd->imagesize = 0;
     hd->baselba = UINT32_MAX;
-    hd->scsi->file[0] = NULL;
+    hd->scsi->image[0] = NULL;
 
     /* close all additional SCSI ID files */
     for (i = 1; i < 56; i++) {
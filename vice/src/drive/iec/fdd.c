@@ -40,6 +40,7 @@
 const int fdd_data_rates[4] = { 500, 300, 250, 1000 }; /* kbit/s */
 #define INDEXLEN (16)
 static void fdd_flush_raw(fd_drive_t *drv);
+static void fdd_init_crc1021(void);
 static uint16_t *crc1021 = NULL;
 
 struct fd_drive_s {
@@ -95,6 +96,10 @@ fd_drive_t *fdd_init(int num, drive_t *drive)
     drv->raw.data = NULL;
     drv->raw.sync = NULL;
     drv->write_beyond = 0;
+    /* set up the table here, the drive may run on its own thread later */
+    if (!crc1021) {
+        fdd_init_crc1021();
+    }
     return drv;
 }
 
@@ -32,6 +32,7 @@
 #include <stdio.h>
 
 #include "debug.h"
+#include "drive-thread.h"
 #include "drive.h"
 #include "drivesync.h"
 #include "drivetypes.h"
@@ -157,6 +158,7 @@ static void store_pra(via_context_t *via_context, uint8_t byte, uint8_t oldpa_va
             glue1571_side_set((byte >> 2) & 1, via1p->drive);
         }
         if ((oldpa_value ^ byte) & 0x02) {
+            drive_thread_sync(via1p->number);
             iec_fast_drive_direction(byte & 2, via1p->number);
         }
     } else {
@@ -218,6 +220,8 @@ static void store_prb(via_context_t *via_context, uint8_t byte, uint8_t p_oldpb,
     if (byte != p_oldpb) {
         DEBUG_IEC_DRV_WRITE(byte);
 
+        drive_thread_sync(via1p->number);
+
         if (iecbus != NULL) {
             uint8_t *drive_data, *drive_bus;
             unsigned int unit;
@@ -331,6 +335,8 @@ static uint8_t read_prb(via_context_t *via_context)
     /* 0 for drive0, 0x20 for drive 1 */
     orval = (via1p->number << 5);
 
+    drive_thread_sync(via1p->number);
+
     if (iecbus != NULL) {
         byte = (((via_context->via[VIA_PRB] & 0x1a)
                  | iecbus->drv_port) ^ 0x85) | orval;
@@ -65,6 +65,7 @@ typedef struct gcr_header_s {
 extern void gcr_convert_sector_to_GCR(const uint8_t *buffer, uint8_t *ptr, const gcr_header_t *header,
                                       int gap, int sync, enum fdc_err_e error_code);
 extern enum fdc_err_e gcr_read_sector(const disk_track_t *raw, uint8_t *data, uint8_t sector);
+extern void gcr_read_track(const disk_track_t *raw, uint8_t *data, enum fdc_err_e *errors, unsigned int num);
 extern enum fdc_err_e gcr_write_sector(disk_track_t *raw, const uint8_t *data, uint8_t sector);
 
 extern gcr_t *gcr_create_image(void);
@@ -36,6 +36,12 @@
 #include <stdio.h>
 #include <string.h>
 
+#ifdef USE_VICE_THREAD
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#endif
+
 #include "archdep.h"
 #include "cmdline.h"
 #include "ffmpegdrv.h"
@@ -157,6 +163,57 @@ static unsigned int framecounter;
 static struct SwsContext *sws_ctx;
 #endif
 
+/* encoder jobs */
+#define FFMPEGDRV_JOB_VIDEO 0
+#define FFMPEGDRV_JOB_AUDIO 1
+
+/* A captured video frame or audio buffer waiting to be encoded. Video
+   frames hold the cropped indexed framebuffer and the palette, the
+   conversion to RGB and the pixel format of the codec is done by the
+   encoder. */
+typedef struct ffmpegdrv_job_s {
+    int type;
+    int64_t pts;
+    unsigned int skipped;   /* audio buffers dropped right before this one */
+    uint8_t *data;
+    size_t len;
+    size_t size;
+    uint8_t palette[256 * 3];
+} ffmpegdrv_job_t;
+
+/* used when encoding on the emulation thread */
+static ffmpegdrv_job_t sync_job;
+
+/* statistics, see ffmpegdrv_get_stats() */
+static ffmpegdrv_stats_t stats;
+
+/* audio buffers dropped since the last queued one */
+static unsigned int audio_skipped;
+
+/* How long the sound device may wait for a free slot before its buffer is
+   dropped, in milliseconds. */
+#define FFMPEGDRV_AUDIO_WAIT_MS 20
+
+#ifdef USE_VICE_THREAD
+/* Bounded queue of jobs, the slots are reused for the whole recording.
+   The emulation thread fills the slot behind the last queued job, the
+   encoder thread owns the slot at `queue_head' while encoding it. */
+static ffmpegdrv_job_t *queue_jobs;
+static int queue_size;
+static int queue_head;
+static int queue_count;
+static int queue_quit;
+static int queue_running;
+
+static pthread_t encode_thread;
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_not_empty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t queue_not_full = PTHREAD_COND_INITIALIZER;
+
+/* samples are collected here while the encoder uses the audio frames */
+static int16_t *audio_staging;
+#endif
+
 /* resources */
 static char *ffmpeg_format = NULL;
 static int format_index;
@@ -165,6 +222,7 @@ static int video_bitrate;
 static int audio_codec;
 static int video_codec;
 static int video_halve_framerate;
+static int encode_queue_size;
 
 static int ffmpegdrv_init_file(void);
 
@@ -242,6 +300,18 @@ static int set_video_halve_framerate(int value, void *param)
     return 0;
 }
 
+static int set_encode_queue_size(int val, void *param)
+{
+    if (val < 0 || val > 256) {
+        return -1;
+    }
+
+    /* takes effect with the next recording */
+    encode_queue_size = val;
+
+    return 0;
+}
+
 /*---------- Resources ------------------------------------------------*/
 
 static const resource_string_t resources_string[] = {
@@ -263,6 +333,8 @@ static const resource_int_t resources_int[] = {
       &video_codec, set_video_codec, NULL },
     { "FFMPEGVideoHalveFramerate", 0, RES_EVENT_NO, NULL,
       &video_halve_framerate, set_video_halve_framerate, NULL },
+    { "FFMPEGEncodeQueueSize", 16, RES_EVENT_NO, NULL,
+      &encode_queue_size, set_encode_queue_size, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -285,6 +357,9 @@ static const cmdline_option_t cmdline_options[] =
     { "-ffmpegvideobitrate", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "FFMPEGVideoBitrate", NULL,
       "<value>", "Set bitrate for video stream in media file" },
+    { "-ffmpegqueuesize", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "FFMPEGEncodeQueueSize", NULL,
+      "<frames>", "Set the number of frames buffered for the encoder thread (0: encode on the emulation thread)" },
     CMDLINE_LIST_END
 };
 
@@ -312,6 +387,92 @@ static void close_stream(OutputStream *ost)
     VICE_P_AV_FRAME_FREE(&ost->tmp_frame);
 }
 
+/* Make sure the job can hold `len' bytes. */
+static void ffmpegdrv_job_alloc(ffmpegdrv_job_t *job, size_t len)
+{
+    if (job->size < len) {
+        job->data = lib_realloc(job->data, len);
+        job->size = len;
+    }
+    job->len = len;
+}
+
+static void ffmpegdrv_job_free(ffmpegdrv_job_t *job)
+{
+    lib_free(job->data);
+    job->data = NULL;
+    job->size = 0;
+    job->len = 0;
+}
+
+#ifdef USE_VICE_THREAD
+/* Return the free slot behind the last queued job. If the queue is full,
+   wait up to `wait_ms' milliseconds for the encoder, then count the job
+   of type `type' as dropped and return NULL. */
+static ffmpegdrv_job_t *ffmpegdrv_queue_reserve(int type, int wait_ms)
+{
+    ffmpegdrv_job_t *job = NULL;
+    struct timespec deadline;
+
+    pthread_mutex_lock(&queue_lock);
+    if (wait_ms > 0 && queue_count == queue_size) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)wait_ms * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (queue_count == queue_size) {
+            if (pthread_cond_timedwait(&queue_not_full, &queue_lock, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+    }
+    if (queue_count < queue_size) {
+        job = &queue_jobs[(queue_head + queue_count) % queue_size];
+    } else if (type == FFMPEGDRV_JOB_VIDEO) {
+        stats.frames_dropped++;
+    } else {
+        stats.audio_dropped++;
+    }
+    pthread_mutex_unlock(&queue_lock);
+
+    return job;
+}
+
+/* Hand the slot returned by ffmpegdrv_queue_reserve() to the encoder. */
+static void ffmpegdrv_queue_push(const ffmpegdrv_job_t *job)
+{
+    pthread_mutex_lock(&queue_lock);
+    queue_count++;
+    if (job->type == FFMPEGDRV_JOB_VIDEO) {
+        stats.frames_recorded++;
+    }
+    if ((unsigned int)queue_count > stats.queue_max_depth) {
+        stats.queue_max_depth = (unsigned int)queue_count;
+    }
+    pthread_cond_signal(&queue_not_empty);
+    pthread_mutex_unlock(&queue_lock);
+}
+#endif
+
+/** \brief  Get the statistics of the current or last recording
+ *
+ * Can be called from any thread, e.g. by the status bar while recording.
+ *
+ * \param[out] out  statistics
+ */
+void ffmpegdrv_get_stats(ffmpegdrv_stats_t *out)
+{
+#ifdef USE_VICE_THREAD
+    pthread_mutex_lock(&queue_lock);
+#endif
+    *out = stats;
+#ifdef USE_VICE_THREAD
+    pthread_mutex_unlock(&queue_lock);
+#endif
+}
+
 /*-----------------------*/
 /* audio stream encoding */
 /*-----------------------*/
@@ -512,8 +673,9 @@ static int ffmpegmovie_init_audio(int speed, int channels, soundmovie_buffer_t *
     return 0;
 }
 
-/* triggered by soundffmpegaudio->write */
-static int ffmpegmovie_encode_audio(soundmovie_buffer_t *audio_in)
+/* Encode the samples in `job', or the ones already in the temporary audio
+   frame if `job' is NULL. */
+static int ffmpegdrv_encode_audio(int64_t pts, const ffmpegdrv_job_t *job)
 {
     int got_packet;
     int dst_nb_samples;
@@ -522,54 +684,92 @@ static int ffmpegmovie_encode_audio(soundmovie_buffer_t *audio_in)
     AVFrame *frame;
     int ret;
 
-    if (audio_st.st) {
-        audio_st.frame->pts = audio_st.next_pts;
-        audio_st.next_pts += audio_in->size;
+    if (job != NULL) {
+        memcpy(audio_st.tmp_frame->data[0], job->data, job->len);
+        /* leave a gap for dropped buffers so audio stays in sync */
+        audio_st.samples_count += (int)job->skipped * audio_st.tmp_frame->nb_samples;
+    }
 
-        VICE_P_AV_INIT_PACKET(&pkt);
-        c = audio_st.st->codec;
+    audio_st.frame->pts = pts;
+
+    VICE_P_AV_INIT_PACKET(&pkt);
+    c = audio_st.st->codec;
 
-        frame = audio_st.tmp_frame;
+    frame = audio_st.tmp_frame;
 
-        if (frame) {
-            /* convert samples from native format to destination codec format, using the resampler */
-            /* compute destination number of samples */
+    if (frame) {
+        /* convert samples from native format to destination codec format, using the resampler */
+        /* compute destination number of samples */
 #ifndef HAVE_FFMPEG_AVRESAMPLE
-            dst_nb_samples = (int)VICE_P_AV_RESCALE_RND(VICE_P_SWR_GET_DELAY(swr_ctx, c->sample_rate) + frame->nb_samples, c->sample_rate, c->sample_rate, AV_ROUND_UP);
+        dst_nb_samples = (int)VICE_P_AV_RESCALE_RND(VICE_P_SWR_GET_DELAY(swr_ctx, c->sample_rate) + frame->nb_samples, c->sample_rate, c->sample_rate, AV_ROUND_UP);
 #else
-            dst_nb_samples = (int)VICE_P_AV_RESCALE_RND(VICE_P_AVRESAMPLE_GET_DELAY(avr_ctx, c->sample_rate) + frame->nb_samples, c->sample_rate, c->sample_rate, AV_ROUND_UP);
+        dst_nb_samples = (int)VICE_P_AV_RESCALE_RND(VICE_P_AVRESAMPLE_GET_DELAY(avr_ctx, c->sample_rate) + frame->nb_samples, c->sample_rate, c->sample_rate, AV_ROUND_UP);
 #endif
 
-            /* when we pass a frame to the encoder, it may keep a reference to it
-            * internally;
-            * make sure we do not overwrite it here
-            */
-            ret = VICE_P_AV_FRAME_MAKE_WRITABLE(audio_st.frame);
-            if (ret < 0)
-                return -1;
+        /* when we pass a frame to the encoder, it may keep a reference to it
+        * internally;
+        * make sure we do not overwrite it here
+        */
+        ret = VICE_P_AV_FRAME_MAKE_WRITABLE(audio_st.frame);
+        if (ret < 0)
+            return -1;
 
-            /* convert to destination format */
+        /* convert to destination format */
 #ifndef HAVE_FFMPEG_AVRESAMPLE
-            ret = VICE_P_SWR_CONVERT(swr_ctx, audio_st.frame->data, dst_nb_samples, (const uint8_t **)frame->data, frame->nb_samples);
+        ret = VICE_P_SWR_CONVERT(swr_ctx, audio_st.frame->data, dst_nb_samples, (const uint8_t **)frame->data, frame->nb_samples);
 #else
-            ret = VICE_P_AVRESAMPLE_CONVERT(avr_ctx, audio_st.frame->data, 0, dst_nb_samples, (const uint8_t **)frame->data, 0, frame->nb_samples);
+        ret = VICE_P_AVRESAMPLE_CONVERT(avr_ctx, audio_st.frame->data, 0, dst_nb_samples, (const uint8_t **)frame->data, 0, frame->nb_samples);
 #endif
-            if (ret < 0) {
-                log_debug("ffmpegdrv_encode_audio: Error while converting audio frame");
-                return -1;
-            }
-            frame = audio_st.frame;
-            frame->pts = VICE_P_AV_RESCALE_Q(audio_st.samples_count, (AVRational){ 1, c->sample_rate }, c->time_base);
-            audio_st.samples_count += dst_nb_samples;
+        if (ret < 0) {
+            log_debug("ffmpegdrv_encode_audio: Error while converting audio frame");
+            return -1;
         }
+        frame = audio_st.frame;
+        frame->pts = VICE_P_AV_RESCALE_Q(audio_st.samples_count, (AVRational){ 1, c->sample_rate }, c->time_base);
+        audio_st.samples_count += dst_nb_samples;
+    }
 
-        ret = VICE_P_AVCODEC_ENCODE_AUDIO2(audio_st.st->codec, &pkt, audio_st.frame, &got_packet);
-        if (got_packet) {
-            if (write_frame(ffmpegdrv_oc, &c->time_base, audio_st.st, &pkt)<0)
-            {
-                log_debug("ffmpegdrv_encode_audio: Error while writing audio frame");
+    ret = VICE_P_AVCODEC_ENCODE_AUDIO2(audio_st.st->codec, &pkt, audio_st.frame, &got_packet);
+    if (got_packet) {
+        if (write_frame(ffmpegdrv_oc, &c->time_base, audio_st.st, &pkt)<0)
+        {
+            log_debug("ffmpegdrv_encode_audio: Error while writing audio frame");
+        }
+    }
+
+    return 0;
+}
+
+/* triggered by soundffmpegaudio->write */
+static int ffmpegmovie_encode_audio(soundmovie_buffer_t *audio_in)
+{
+#ifdef USE_VICE_THREAD
+    ffmpegdrv_job_t *job;
+#endif
+
+    if (audio_st.st) {
+#ifdef USE_VICE_THREAD
+        if (queue_running) {
+            /* give the encoder a moment, then drop the buffer but keep
+               its timestamp like a skipped video frame */
+            job = ffmpegdrv_queue_reserve(FFMPEGDRV_JOB_AUDIO, FFMPEGDRV_AUDIO_WAIT_MS);
+            if (job == NULL) {
+                audio_skipped++;
+            } else {
+                job->type = FFMPEGDRV_JOB_AUDIO;
+                job->pts = audio_st.next_pts;
+                job->skipped = audio_skipped;
+                audio_skipped = 0;
+                ffmpegdrv_job_alloc(job, (size_t)audio_in->size * sizeof(int16_t));
+                memcpy(job->data, audio_in->buffer, job->len);
+                ffmpegdrv_queue_push(job);
             }
+        } else
+#endif
+        {
+            ffmpegdrv_encode_audio(audio_st.next_pts, NULL);
         }
+        audio_st.next_pts += audio_in->size;
     }
 
     audio_in->used = 0;
@@ -591,35 +791,234 @@ static soundmovie_funcs_t ffmpegdrv_soundmovie_funcs = {
 /*-----------------------*/
 /* video stream encoding */
 /*-----------------------*/
-static int ffmpegdrv_fill_rgb_image(screenshot_t *screenshot, AVFrame *pic)
+/* Copy the visible part of the framebuffer and the palette into `job',
+   this is all that is done on the emulation thread for a video frame. */
+static void ffmpegdrv_capture_frame(screenshot_t *screenshot, ffmpegdrv_job_t *job)
 {
-    int x, y;
+    int y;
     int dx, dy;
-    int colnum;
     int bufferoffset;
+    unsigned int colnum;
+    unsigned int num_colors;
     int x_dim = screenshot->width;
     int y_dim = screenshot->height;
-    int pix = 0;
     /* center the screenshot in the video */
     dx = (video_width - x_dim) / 2;
     dy = (video_height - y_dim) / 2;
     bufferoffset = screenshot->x_offset + (dx < 0 ? -dx : 0)
         + (screenshot->y_offset + (dy < 0 ? -dy : 0)) * screenshot->draw_buffer_line_size;
 
+    job->type = FFMPEGDRV_JOB_VIDEO;
+    ffmpegdrv_job_alloc(job, (size_t)video_width * video_height);
+
+    for (y = 0; y < video_height; y++) {
+        memcpy(job->data + y * video_width,
+               screenshot->draw_buffer + bufferoffset, (size_t)video_width);
+        bufferoffset += screenshot->draw_buffer_line_size;
+    }
+
+    num_colors = screenshot->palette->num_entries;
+    if (num_colors > 256) {
+        num_colors = 256;
+    }
+    for (colnum = 0; colnum < num_colors; colnum++) {
+        job->palette[colnum * 3] = screenshot->palette->entries[colnum].red;
+        job->palette[colnum * 3 + 1] = screenshot->palette->entries[colnum].green;
+        job->palette[colnum * 3 + 2] = screenshot->palette->entries[colnum].blue;
+    }
+}
+
+static int ffmpegdrv_fill_rgb_image(const ffmpegdrv_job_t *job, AVFrame *pic)
+{
+    int x, y;
+    const uint8_t *src = job->data;
+    const uint8_t *rgb;
+    int pix = 0;
+
     for (y = 0; y < video_height; y++) {
         for (x = 0; x < video_width; x++) {
-            colnum = screenshot->draw_buffer[bufferoffset + x];
-            pic->data[0][pix + 3*x] = screenshot->palette->entries[colnum].red;
-            pic->data[0][pix + 3*x + 1] = screenshot->palette->entries[colnum].green;
-            pic->data[0][pix + 3*x + 2] = screenshot->palette->entries[colnum].blue;
+            rgb = &job->palette[src[x] * 3];
+            pic->data[0][pix + 3*x] = rgb[0];
+            pic->data[0][pix + 3*x + 1] = rgb[1];
+            pic->data[0][pix + 3*x + 2] = rgb[2];
         }
-        bufferoffset += screenshot->draw_buffer_line_size;
+        src += video_width;
         pix += pic->linesize[0];
     }
 
     return 0;
 }
 
+static int ffmpegdrv_encode_video(const ffmpegdrv_job_t *job)
+{
+    AVCodecContext *c;
+    int ret;
+
+    c = video_st.st->codec;
+
+    if (c->pix_fmt != VICE_AV_PIX_FMT_RGB24) {
+        ffmpegdrv_fill_rgb_image(job, video_st.tmp_frame);
+
+        if (sws_ctx != NULL) {
+            VICE_P_SWS_SCALE(sws_ctx,
+                video_st.tmp_frame->data,
+                video_st.tmp_frame->linesize, 0, c->height,
+                video_st.frame->data, video_st.frame->linesize);
+        }
+    } else {
+        ffmpegdrv_fill_rgb_image(job, video_st.frame);
+    }
+
+    video_st.frame->pts = job->pts;
+
+#ifdef AVFMT_RAWPICTURE
+    if (ffmpegdrv_oc->oformat->flags & AVFMT_RAWPICTURE) {
+        AVPacket pkt;
+        VICE_P_AV_INIT_PACKET(&pkt);
+        pkt.flags |= AV_PKT_FLAG_KEY;
+        pkt.stream_index = video_st.st->index;
+        pkt.data = (uint8_t*)video_st.frame;
+        pkt.size = sizeof(AVPicture);
+        pkt.pts = pkt.dts = video_st.frame->pts;
+
+        ret = VICE_P_AV_INTERLEAVED_WRITE_FRAME(ffmpegdrv_oc, &pkt);
+    } else
+#endif
+    {
+        AVPacket pkt = { 0 };
+        int got_packet;
+
+        VICE_P_AV_INIT_PACKET(&pkt);
+
+        /* encode the image */
+        ret = VICE_P_AVCODEC_ENCODE_VIDEO2(c, &pkt, video_st.frame, &got_packet);
+        if (ret < 0) {
+            log_debug("Error while encoding video frame");
+            return -1;
+        }
+        /* if zero size, it means the image was buffered */
+        if (got_packet) {
+            if (write_frame(ffmpegdrv_oc, &c->time_base, video_st.st, &pkt)<0)
+            {
+                log_debug("ffmpegdrv_encode_audio: Error while writing audio frame");
+            }
+        } else {
+            ret = 0;
+        }
+    }
+    if (ret < 0) {
+        log_debug("Error while writing video frame");
+        return -1;
+    }
+
+    return 0;
+}
+
+#ifdef USE_VICE_THREAD
+/*-----------------------*/
+/* encoder thread        */
+/*-----------------------*/
+
+/* All codec and muxer calls of a recording happen on this thread, in the
+   order the jobs were queued. */
+static void *ffmpegdrv_encode_thread(void *unused)
+{
+    ffmpegdrv_job_t *job;
+
+    pthread_mutex_lock(&queue_lock);
+    for (;;) {
+        while (queue_count == 0 && !queue_quit) {
+            pthread_cond_wait(&queue_not_empty, &queue_lock);
+        }
+        if (queue_count == 0) {
+            /* stopped and drained */
+            break;
+        }
+        job = &queue_jobs[queue_head];
+        pthread_mutex_unlock(&queue_lock);
+
+        if (job->type == FFMPEGDRV_JOB_VIDEO) {
+            ffmpegdrv_encode_video(job);
+        } else {
+            ffmpegdrv_encode_audio(job->pts, job);
+        }
+
+        pthread_mutex_lock(&queue_lock);
+        queue_head = (queue_head + 1) % queue_size;
+        queue_count--;
+        pthread_cond_signal(&queue_not_full);
+    }
+    pthread_mutex_unlock(&queue_lock);
+
+    return NULL;
+}
+
+static void ffmpegdrv_queue_start(void)
+{
+    queue_head = 0;
+    queue_count = 0;
+    queue_quit = 0;
+
+    if (encode_queue_size == 0) {
+        return;
+    }
+
+    queue_size = encode_queue_size;
+    queue_jobs = lib_calloc((size_t)queue_size, sizeof(ffmpegdrv_job_t));
+
+    /* the sound device keeps filling its buffer while the encoder converts
+       the previous one */
+    if (audio_is_open) {
+        audio_staging = lib_malloc((size_t)ffmpegdrv_audio_in.size * sizeof(int16_t));
+        ffmpegdrv_audio_in.buffer = audio_staging;
+    }
+
+    if (pthread_create(&encode_thread, NULL, ffmpegdrv_encode_thread, NULL) != 0) {
+        log_error(LOG_DEFAULT, "ffmpegdrv: Cannot create encoder thread, encoding on the emulation thread.");
+        if (audio_is_open) {
+            ffmpegdrv_audio_in.buffer = (int16_t *)audio_st.tmp_frame->data[0];
+        }
+        lib_free(audio_staging);
+        audio_staging = NULL;
+        lib_free(queue_jobs);
+        queue_jobs = NULL;
+        return;
+    }
+
+    queue_running = 1;
+}
+
+/* Encode all queued jobs and stop the encoder thread. */
+static void ffmpegdrv_queue_stop(void)
+{
+    int i;
+
+    if (!queue_running) {
+        return;
+    }
+
+    pthread_mutex_lock(&queue_lock);
+    queue_quit = 1;
+    pthread_cond_signal(&queue_not_empty);
+    pthread_mutex_unlock(&queue_lock);
+
+    pthread_join(encode_thread, NULL);
+    queue_running = 0;
+
+    for (i = 0; i < queue_size; i++) {
+        ffmpegdrv_job_free(&queue_jobs[i]);
+    }
+    lib_free(queue_jobs);
+    queue_jobs = NULL;
+
+    if (audio_is_open) {
+        ffmpegdrv_audio_in.buffer = (int16_t *)audio_st.tmp_frame->data[0];
+    }
+    lib_free(audio_staging);
+    audio_staging = NULL;
+}
+#endif
+
 static AVFrame* ffmpegdrv_alloc_picture(enum AVPixelFormat pix_fmt, int width, int height)
 {
     AVFrame *picture;
@@ -832,6 +1231,12 @@ static int ffmpegdrv_init_file(void)
 
     file_init_done = 1;
 
+    memset(&stats, 0, sizeof stats);
+    audio_skipped = 0;
+#ifdef USE_VICE_THREAD
+    ffmpegdrv_queue_start();
+#endif
+
     return 0;
 }
 
@@ -890,6 +1295,17 @@ static int ffmpegdrv_close(screenshot_t *screenshot)
 {
     unsigned int i;
 
+#ifdef USE_VICE_THREAD
+    ffmpegdrv_queue_stop();
+#endif
+    ffmpegdrv_job_free(&sync_job);
+
+    if (file_init_done) {
+        log_message(LOG_DEFAULT,
+                    "ffmpegdrv: %u video frames recorded, %u video frames and %u audio buffers dropped by the encoder queue (maximum depth %u).",
+                    stats.frames_recorded, stats.frames_dropped, stats.audio_dropped, stats.queue_max_depth);
+    }
+
     /* write the trailer, if any */
     if (file_init_done) {
         VICE_P_AV_WRITE_TRAILER(ffmpegdrv_oc);
@@ -923,11 +1339,29 @@ static int ffmpegdrv_close(screenshot_t *screenshot)
     return 0;
 }
 
+#ifdef USE_VICE_THREAD
+/* Show the encoder statistics in the status bar about once a second. */
+static void ffmpegdrv_show_stats(void)
+{
+    ffmpegdrv_stats_t now;
+    char text[128];
+
+    if (framecounter % 50 != 0) {
+        return;
+    }
+    ffmpegdrv_get_stats(&now);
+    snprintf(text, sizeof text,
+             "Recording: %u frames, dropped %u frames and %u audio buffers, max queue %u/%d",
+             now.frames_recorded, now.frames_dropped, now.audio_dropped,
+             now.queue_max_depth, queue_size);
+    ui_display_statustext(text, 1);
+}
+#endif
+
 /* triggered by screenshot_record */
 static int ffmpegdrv_record(screenshot_t *screenshot)
 {
-    AVCodecContext *c;
-    int ret;
+    ffmpegdrv_job_t *job;
 
     if (audio_init_done && video_init_done && !file_init_done) {
         ffmpegdrv_init_file();
@@ -948,64 +1382,36 @@ static int ffmpegdrv_record(screenshot_t *screenshot)
         return 0;
     }
 
-    c = video_st.st->codec;
-
-    if (c->pix_fmt != VICE_AV_PIX_FMT_RGB24) {
-        ffmpegdrv_fill_rgb_image(screenshot, video_st.tmp_frame);
-
-        if (sws_ctx != NULL) {
-            VICE_P_SWS_SCALE(sws_ctx,
-                video_st.tmp_frame->data,
-                video_st.tmp_frame->linesize, 0, c->height,
-                video_st.frame->data, video_st.frame->linesize);
+#ifdef USE_VICE_THREAD
+    if (queue_running) {
+        ffmpegdrv_show_stats();
+        job = ffmpegdrv_queue_reserve(FFMPEGDRV_JOB_VIDEO, 0);
+        if (job == NULL) {
+            /* the encoder is behind, skip the frame but keep its
+               timestamp so audio and video stay in sync */
+            video_st.next_pts++;
+            return 0;
         }
-    } else {
-        ffmpegdrv_fill_rgb_image(screenshot, video_st.frame);
+        ffmpegdrv_capture_frame(screenshot, job);
+        job->pts = video_st.next_pts++;
+        ffmpegdrv_queue_push(job);
+        return 0;
     }
-
-    video_st.frame->pts = video_st.next_pts++;
-
-#ifdef AVFMT_RAWPICTURE
-    if (ffmpegdrv_oc->oformat->flags & AVFMT_RAWPICTURE) {
-        AVPacket pkt;
-        VICE_P_AV_INIT_PACKET(&pkt);
-        pkt.flags |= AV_PKT_FLAG_KEY;
-        pkt.stream_index = video_st.st->index;
-        pkt.data = (uint8_t*)video_st.frame;
-        pkt.size = sizeof(AVPicture);
-        pkt.pts = pkt.dts = video_st.frame->pts;
-
-        ret = VICE_P_AV_INTERLEAVED_WRITE_FRAME(ffmpegdrv_oc, &pkt);
-    } else
 #endif
-    {
-        AVPacket pkt = { 0 };
-        int got_packet;
-
-        VICE_P_AV_INIT_PACKET(&pkt);
 
-        /* encode the image */
-        ret = VICE_P_AVCODEC_ENCODE_VIDEO2(c, &pkt, video_st.frame, &got_packet);
-        if (ret < 0) {
-            log_debug("Error while encoding video frame");
-            return -1;
-        }
-        /* if zero size, it means the image was buffered */
-        if (got_packet) {
-            if (write_frame(ffmpegdrv_oc, &c->time_base, video_st.st, &pkt)<0)
-            {
-                log_debug("ffmpegdrv_encode_audio: Error while writing audio frame");
-            }
-        } else {
-            ret = 0;
-        }
-    }
-    if (ret < 0) {
-        log_debug("Error while writing video frame");
-        return -1;
-    }
+    job = &sync_job;
+    ffmpegdrv_capture_frame(screenshot, job);
+    job->pts = video_st.next_pts++;
+#ifdef USE_VICE_THREAD
+    /* the status bar may be reading the statistics */
+    pthread_mutex_lock(&queue_lock);
+#endif
+    stats.frames_recorded++;
+#ifdef USE_VICE_THREAD
+    pthread_mutex_unlock(&queue_lock);
+#endif
 
-    return 0;
+    return ffmpegdrv_encode_video(job);
 }
 
 static int ffmpegdrv_write(screenshot_t *screenshot)
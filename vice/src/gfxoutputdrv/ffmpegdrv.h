@@ -32,6 +32,16 @@
 
 extern void gfxoutput_init_ffmpeg(int help);
 
+/* statistics of the current or last recording */
+typedef struct ffmpegdrv_stats_s {
+    unsigned int frames_recorded;   /* video frames handed to the encoder */
+    unsigned int frames_dropped;    /* video frames skipped, queue was full */
+    unsigned int audio_dropped;     /* audio buffers dropped, queue was full */
+    unsigned int queue_max_depth;   /* highest number of waiting jobs */
+} ffmpegdrv_stats_t;
+
+extern void ffmpegdrv_get_stats(ffmpegdrv_stats_t *out);
+
 /* deprecated access for UIs that do not use the gfxoutputdrv->formatlist yet: */
 extern gfxoutputdrv_format_t *ffmpegdrv_formatlist;
 
@@ -31,6 +31,8 @@
 #include <stdbool.h>
 #include <inttypes.h>
 #include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #ifdef HVSC_USE_MD5
 # include <gcrypt.h>
@@ -92,108 +94,317 @@ static bool create_md5_hash(const char *psid, unsigned char *digest)
 #endif
 
 
-#ifdef HVSC_USE_MD5
-/** \brief  Find SLDB entry by \a digest
+/** \brief  Marker for an index entry whose song lengths haven't been parsed
+ */
+#define SLDB_LENGTHS_UNPARSED   (-2)
+
+
+/** \brief  SLDB index entry
+ */
+typedef struct sldb_entry_s {
+    const char *digest;     /**< MD5 digest in text form (not nul-terminated) */
+    const char *path;       /**< HVSC path from the preceding comment */
+    char       *line;       /**< full SLDB entry, including digest and '=' */
+    long       *lengths;    /**< cached song lengths */
+    int         count;      /**< number of cached song lengths, or -1 on a
+                                 parse error, or SLDB_LENGTHS_UNPARSED */
+} sldb_entry_t;
+
+
+/** \brief  In-memory index of the SLDB
  *
- * The \a digest has to be in the same string form as the SLDB. So 32 bytes
- * representing a 16-byte hex data, in lower case.
+ * The SLDB is read once and split into lines in place, the entries point
+ * into that buffer.  Two open-addressing hash tables map MD5 digests and
+ * HVSC paths to entries (stored as index + 1, 0 meaning empty).
+ */
+typedef struct sldb_index_s {
+    char         *path;         /**< path of the indexed SLDB file */
+    time_t        mtime;        /**< modification time of the SLDB file */
+    off_t         size;         /**< size of the SLDB file */
+    char         *data;         /**< contents of the SLDB file */
+    sldb_entry_t *entries;      /**< entries */
+    size_t        num_entries;  /**< number of entries */
+    uint32_t     *by_digest;    /**< hash table on digest */
+    uint32_t     *by_path;      /**< hash table on path */
+    size_t        table_mask;   /**< size of the hash tables minus one */
+} sldb_index_t;
+
+
+/** \brief  The SLDB index, valid if `data` isn't `NULL`
+ */
+static sldb_index_t sldb_index;
+
+
+/** \brief  Calculate FNV-1a hash of \a len bytes of \a s
  *
- * \param[in]   digest  string representation of the MD5 digest (32 bytes)
+ * \param[in]   s   string
+ * \param[in]   len length of \a s
  *
- * \return  line of text from SLDB or `NULL` when not found
+ * \return  hash
  */
-static char *find_sldb_entry_md5(const char *digest)
+static uint32_t sldb_hash(const char *s, size_t len)
 {
-    hvsc_text_file_t handle;
-    const char *line;
+    uint32_t hash = 2166136261u;
+    size_t i;
 
-    if (!hvsc_text_file_open(hvsc_sldb_path, &handle)) {
-        return NULL;
+    for (i = 0; i < len; i++) {
+        hash ^= (uint8_t)s[i];
+        hash *= 16777619u;
     }
+    return hash;
+}
 
-    while (1) {
-        line = hvsc_text_file_read(&handle);
-        if (line == NULL) {
-            hvsc_text_file_close(&handle);
-            return NULL;
-        }
-#if 0
-        printf("%s\n", line);
-#endif
-        if (memcmp(digest, line, HVSC_DIGEST_SIZE * 2) == 0) {
-            /* copy the current line before closing the file */
-            char *s = hvsc_strdup(handle.buffer);
-            hvsc_text_file_close(&handle);
-            return s;
+
+/** \brief  Free the SLDB index
+ */
+void hvsc_sldb_index_free(void)
+{
+    size_t i;
+
+    if (sldb_index.entries != NULL) {
+        for (i = 0; i < sldb_index.num_entries; i++) {
+            if (sldb_index.entries[i].lengths != NULL) {
+                hvsc_free(sldb_index.entries[i].lengths);
+            }
         }
+        hvsc_free(sldb_index.entries);
     }
+    if (sldb_index.by_digest != NULL) {
+        hvsc_free(sldb_index.by_digest);
+    }
+    if (sldb_index.by_path != NULL) {
+        hvsc_free(sldb_index.by_path);
+    }
+    if (sldb_index.data != NULL) {
+        hvsc_free(sldb_index.data);
+    }
+    if (sldb_index.path != NULL) {
+        hvsc_free(sldb_index.path);
+    }
+    memset(&sldb_index, 0, sizeof sldb_index);
+}
 
-    hvsc_text_file_close(&handle);
-    hvsc_errno = HVSC_ERR_NOT_FOUND;
-    return NULL;
+
+/** \brief  Insert entry \a idx into hash \a table under \a key
+ *
+ * \param[in,out]   table   hash table
+ * \param[in]       key     key
+ * \param[in]       len     length of \a key
+ * \param[in]       idx     entry index
+ */
+static void sldb_index_insert(uint32_t *table, const char *key, size_t len,
+                              size_t idx)
+{
+    size_t slot = sldb_hash(key, len) & sldb_index.table_mask;
+
+    while (table[slot] != 0) {
+        slot = (slot + 1) & sldb_index.table_mask;
+    }
+    table[slot] = (uint32_t)(idx + 1);
 }
-#endif
 
 
-/** \brief  Find song length entry by PSID name in the comments
+/** \brief  Build the SLDB index from the file at \a path
  *
- * \param[in]   path    relative path in the HVSC to the SID
+ * Entries that appear more than once keep their first occurence, just like
+ * the old sequential scan did.
+ *
+ * \param[in]   path    path to the SLDB
+ * \param[in]   st      stat info of \a path
  *
- * \return  text line with the song length info or `NULL` on failure
+ * \return  true on success
  */
-static char *find_sldb_entry_txt(const char *path)
+static bool sldb_index_build(const char *path, const struct stat *st)
 {
-    hvsc_text_file_t handle;
-    size_t plen;
-    const char *line;
+    uint8_t *data;
+    long size;
+    char *p;
+    char *end;
+    const char *last_path = NULL;
+    size_t max_entries = 0;
+    size_t table_size = 16;
+    size_t i;
+
+    hvsc_sldb_index_free();
+
 #ifndef HVSC_STANDALONE
-    log_message(LOG_DEFAULT, "Vsid: Opening '%s'.", hvsc_sldb_path);
+    log_message(LOG_DEFAULT, "Vsid: Indexing '%s'.", path);
 #endif
-    if (!hvsc_text_file_open(hvsc_sldb_path, &handle)) {
+    size = hvsc_read_file(&data, path);
+    if (size < 0) {
 #ifndef HVSC_STANDALONE
         log_warning(LOG_DEFAULT, "Vsid: Failed to open the SLDB.");
 #endif
-        return NULL;
+        return false;
     }
+    data = hvsc_realloc(data, (size_t)size + 1);
+    data[size] = '\0';
 
-    plen = strlen(path);
-
-    while (true) {
-        line = hvsc_text_file_read(&handle);
-        if (line == NULL) {
-            hvsc_text_file_close(&handle);
-#ifndef HVSC_STANDALONE
-            log_warning(LOG_DEFAULT,
-                    "Vsid: Could not find song length data for current SID.");
-#endif
-            return NULL;
+    /* upper bound on the number of entries is the number of lines */
+    for (i = 0; i < (size_t)size; i++) {
+        if (data[i] == '\n') {
+            max_entries++;
         }
+    }
+    max_entries++;
+    while (table_size < max_entries * 2) {
+        table_size <<= 1;
+    }
 
+    sldb_index.path = hvsc_strdup(path);
+    sldb_index.mtime = st->st_mtime;
+    sldb_index.size = st->st_size;
+    sldb_index.data = (char *)data;
+    sldb_index.entries = hvsc_malloc(max_entries * sizeof *sldb_index.entries);
+    sldb_index.by_digest = hvsc_calloc(table_size, sizeof *sldb_index.by_digest);
+    sldb_index.by_path = hvsc_calloc(table_size, sizeof *sldb_index.by_path);
+    sldb_index.table_mask = table_size - 1;
+
+    /* split into lines in place, pairing "; path" comments with entries */
+    p = sldb_index.data;
+    end = sldb_index.data + size;
+    while (p < end) {
+        char *eol = memchr(p, '\n', (size_t)(end - p));
+        char *q;
+
+        if (eol == NULL) {
+            eol = end;
+        }
+        *eol = '\0';
+        /* strip trailing whitespace, including Windows CR */
+        q = eol;
+        while (q > p && isspace((int)q[-1])) {
+            *--q = '\0';
+        }
 
-        if (*line == ';') {
-            if (strncmp(path, line + 2, plen) == 0) {
-                /* next line contains the actual entry */
-                char *s;
-                line = hvsc_text_file_read(&handle);
-                if (line == NULL) {
-                    hvsc_text_file_close(&handle);
-                    return NULL;
-                }
-                s = hvsc_strdup(handle.buffer);
-                hvsc_text_file_close(&handle);
-                return s;
+        if (p[0] == ';' && p[1] == ' ') {
+            last_path = p + 2;
+        } else if (q - p > HVSC_DIGEST_SIZE * 2
+                && p[HVSC_DIGEST_SIZE * 2] == '=') {
+            sldb_entry_t *entry = &sldb_index.entries[sldb_index.num_entries];
+
+            entry->digest = p;
+            entry->path = last_path;
+            entry->line = p;
+            entry->lengths = NULL;
+            entry->count = SLDB_LENGTHS_UNPARSED;
+
+            sldb_index_insert(sldb_index.by_digest, p, HVSC_DIGEST_SIZE * 2,
+                              sldb_index.num_entries);
+            if (last_path != NULL) {
+                sldb_index_insert(sldb_index.by_path, last_path,
+                                  strlen(last_path), sldb_index.num_entries);
             }
+            sldb_index.num_entries++;
+            last_path = NULL;
         }
+        p = eol + 1;
+    }
+
+    hvsc_dbg("indexed %zu entries\n", sldb_index.num_entries);
+    return true;
+}
+
+
+/** \brief  Make sure the SLDB index is up to date
+ *
+ * The index is (re)built when the SLDB path changed or when the SLDB file
+ * changed on disk since it was indexed.
+ *
+ * \return  true if the index is usable
+ */
+static bool sldb_index_update(void)
+{
+    struct stat st;
+
+    if (hvsc_sldb_path == NULL || stat(hvsc_sldb_path, &st) != 0) {
+        hvsc_errno = HVSC_ERR_IO;
+        hvsc_sldb_index_free();
+        return false;
+    }
+    if (sldb_index.data != NULL
+            && strcmp(sldb_index.path, hvsc_sldb_path) == 0
+            && sldb_index.mtime == st.st_mtime
+            && sldb_index.size == st.st_size) {
+        return true;
+    }
+    return sldb_index_build(hvsc_sldb_path, &st);
+}
+
+
+/** \brief  Look up an entry in the SLDB index
+ *
+ * \param[in]   key     key to look for
+ * \param[in]   len     length of \a key
+ * \param[in]   by_path look up \a key as HVSC path instead of as MD5 digest
+ *
+ * \return  entry or `NULL` when not found
+ */
+static sldb_entry_t *sldb_index_find(const char *key, size_t len, bool by_path)
+{
+    const uint32_t *table;
+    size_t slot;
+
+    if (!sldb_index_update()) {
+        return NULL;
     }
 
-#if 0 /* above loop never breaks - following code can never execute */
-    hvsc_text_file_close(&handle);
+    table = by_path ? sldb_index.by_path : sldb_index.by_digest;
+    slot = sldb_hash(key, len) & sldb_index.table_mask;
+    while (table[slot] != 0) {
+        sldb_entry_t *entry = &sldb_index.entries[table[slot] - 1];
+
+        if (by_path) {
+            if (strncmp(entry->path, key, len) == 0 && entry->path[len] == '\0') {
+                return entry;
+            }
+        } else if (memcmp(entry->digest, key, len) == 0) {
+            return entry;
+        }
+        slot = (slot + 1) & sldb_index.table_mask;
+    }
     hvsc_errno = HVSC_ERR_NOT_FOUND;
     return NULL;
-#endif
 }
 
 
+#ifdef HVSC_USE_MD5
+/** \brief  Find SLDB entry by \a digest
+ *
+ * The \a digest has to be in the same string form as the SLDB. So 32 bytes
+ * representing a 16-byte hex data, in lower case.
+ *
+ * \param[in]   digest  string representation of the MD5 digest (32 bytes)
+ *
+ * \return  index entry or `NULL` when not found
+ */
+static sldb_entry_t *find_sldb_entry_md5(const char *digest)
+{
+    return sldb_index_find(digest, HVSC_DIGEST_SIZE * 2, false);
+}
+#endif
+
+
+/** \brief  Find song length entry by PSID name in the comments
+ *
+ * \param[in]   path    relative path in the HVSC to the SID
+ *
+ * \return  index entry or `NULL` on failure
+ */
+static sldb_entry_t *find_sldb_entry_txt(const char *path)
+{
+    sldb_entry_t *entry;
+
+    entry = sldb_index_find(path, strlen(path), true);
+#ifndef HVSC_STANDALONE
+    if (entry == NULL) {
+        log_warning(LOG_DEFAULT,
+                "Vsid: Could not find song length data for current SID.");
+    }
+#endif
+    return entry;
+}
+
 
 /** \brief  Parse SLDB entry
  *
@@ -245,19 +456,19 @@ static int parse_sldb_entry(char *line, long **lengths)
 
 
 #ifdef HVSC_USE_MD5
-/** \brief  Get the SLDB entry for PSID file \a psid
+/** \brief  Find the SLDB index entry for PSID file \a psid by MD5 digest
  *
  * \param[in]   psid    path to PSID file
  *
- * \return  heap-allocated entry or `NULL` on failure
+ * \return  index entry or `NULL` on failure
  */
-char *hvsc_sldb_get_entry_md5(const char *psid)
+static sldb_entry_t *get_index_entry_md5(const char *psid)
 {
     unsigned char hash[HVSC_DIGEST_SIZE];
     char hash_text[HVSC_DIGEST_SIZE * 2 + 1];
     int result;
     int i;
-    char *entry;
+    sldb_entry_t *entry;
 
     result = create_md5_hash(psid, hash);
     if (!result) {
@@ -276,30 +487,41 @@ char *hvsc_sldb_get_entry_md5(const char *psid)
     putchar('\n');
 #endif
 
-    /* parse SLDB */
+    /* look up SLDB */
     entry = find_sldb_entry_md5(hash_text);
     if (entry != NULL) {
-        hvsc_dbg("Got it: %s\n", entry);
+        hvsc_dbg("Got it: %s\n", entry->line);
     }
     return entry;
 }
 
+
+/** \brief  Get the SLDB entry for PSID file \a psid
+ *
+ * \param[in]   psid    path to PSID file
+ *
+ * \return  heap-allocated entry or `NULL` on failure
+ */
+char *hvsc_sldb_get_entry_md5(const char *psid)
+{
+    sldb_entry_t *entry = get_index_entry_md5(psid);
+
+    return entry != NULL ? hvsc_strdup(entry->line) : NULL;
+}
+
 #endif  /* ifdef HVSC_USE_MD5 */
 
 
-/** \brief  Find SLDB entry by using text lookup
- *
- * This function uses the "; /path/to/file" lines to identify the SID entry,
- * which makes using/linking against libgcrypt no longer required.
+/** \brief  Find the SLDB index entry for PSID file \a psid by HVSC path
  *
  * \param   [in]    psid    absolute path to SID in the HVSC
  *
- * \return  line of text containing the song length info or `NULL` on failure
+ * \return  index entry or `NULL` on failure
  */
-char *hvsc_sldb_get_entry_txt(const char *psid)
+static sldb_entry_t *get_index_entry_txt(const char *psid)
 {
     char *path;
-    char *entry;
+    sldb_entry_t *entry;
 
     /* strip HVSC root from path */
     path = hvsc_path_strip_root(psid);
@@ -311,16 +533,36 @@ char *hvsc_sldb_get_entry_txt(const char *psid)
     entry = find_sldb_entry_txt(path);
     hvsc_free(path);
     if (entry != NULL) {
-        /* hvsc_dbg("Got it: %s\n", entry); */
+        /* hvsc_dbg("Got it: %s\n", entry->line); */
 #ifndef HVSC_STANDALONE
-        log_message(LOG_DEFAULT, "Vsid: Song length(s): %s.", entry);
+        log_message(LOG_DEFAULT, "Vsid: Song length(s): %s.", entry->line);
 #endif
     }
     return entry;
 }
 
 
+/** \brief  Find SLDB entry by using text lookup
+ *
+ * This function uses the "; /path/to/file" lines to identify the SID entry,
+ * which makes using/linking against libgcrypt no longer required.
+ *
+ * \param   [in]    psid    absolute path to SID in the HVSC
+ *
+ * \return  line of text containing the song length info or `NULL` on failure
+ */
+char *hvsc_sldb_get_entry_txt(const char *psid)
+{
+    sldb_entry_t *entry = get_index_entry_txt(psid);
+
+    return entry != NULL ? hvsc_strdup(entry->line) : NULL;
+}
+
+
 /** \brief  Get a list of song lengths for PSID file \a psid
+ *
+ * The parsed song lengths are cached in the SLDB index, so only the first
+ * lookup of a tune parses its entry.
  *
  * \param[in]   psid    path to PSID file
  * \param[out]  lengths object to store pointer to array of song lengths
@@ -331,25 +573,30 @@ char *hvsc_sldb_get_entry_txt(const char *psid)
  */
 int hvsc_sldb_get_lengths(const char *psid, long **lengths)
 {
-    char *entry;
-    int result;
+    sldb_entry_t *entry;
 
     *lengths = NULL;
 
 #ifdef HVSC_USE_MD5
-    entry = hvsc_sldb_get_entry_md5(psid);
+    entry = get_index_entry_md5(psid);
 #else
-    entry = hvsc_sldb_get_entry_txt(psid);
+    entry = get_index_entry_txt(psid);
 #endif
     if (entry == NULL) {
         return -1;
     }
 
-    result = parse_sldb_entry(entry, lengths);
-    if (result < 0) {
-        hvsc_free(*lengths);
+    if (entry->count == SLDB_LENGTHS_UNPARSED) {
+        entry->count = parse_sldb_entry(entry->line, &entry->lengths);
+    }
+    if (entry->count < 0) {
         return -1;
     }
-    hvsc_free(entry);
-    return result;
+
+    /* hand out a copy, the cached list stays with the index */
+    *lengths = hvsc_malloc((entry->count > 0 ? entry->count : 1) * sizeof **lengths);
+    if (entry->count > 0) {
+        memcpy(*lengths, entry->lengths, entry->count * sizeof **lengths);
+    }
+    return entry->count;
 }
@@ -29,6 +29,7 @@
 
 #include "archdep.h"
 #include "attach.h"
+#include "batch.h"
 #include "cmdline.h"
 #include "console.h"
 #include "debug.h"
@@ -48,8 +49,11 @@
 #include "palette.h"
 #include "ram.h"
 #include "resources.h"
+#include "rewind.h"
+#include "runahead.h"
 #include "romset.h"
 #include "screenshot.h"
+#include "shmexport.h"
 #include "signals.h"
 #include "sysfile.h"
 #include "uiapi.h"
@@ -104,6 +108,18 @@ int init_resources(void)
         init_resource_fail("vsync");
         return -1;
     }
+    if (rewind_resources_init() < 0) {
+        init_resource_fail("rewind");
+        return -1;
+    }
+    if (runahead_resources_init() < 0) {
+        init_resource_fail("runahead");
+        return -1;
+    }
+    if (shmexport_resources_init() < 0) {
+        init_resource_fail("shmexport");
+        return -1;
+    }
     if (sound_resources_init() < 0) {
         init_resource_fail("sound");
         return -1;
@@ -187,6 +203,24 @@ int init_cmdline_options(void)
         init_cmdline_options_fail("vsync");
         return -1;
     }
+    if (machine_class != VICE_MACHINE_VSID) {
+        if (rewind_cmdline_options_init() < 0) {
+            init_cmdline_options_fail("rewind");
+            return -1;
+        }
+        if (runahead_cmdline_options_init() < 0) {
+            init_cmdline_options_fail("runahead");
+            return -1;
+        }
+        if (shmexport_cmdline_options_init() < 0) {
+            init_cmdline_options_fail("shmexport");
+            return -1;
+        }
+        if (batch_cmdline_options_init() < 0) {
+            init_cmdline_options_fail("batch");
+            return -1;
+        }
+    }
     if (sound_cmdline_options_init() < 0) {
         init_cmdline_options_fail("sound");
         return -1;
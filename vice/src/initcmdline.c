@@ -37,6 +37,7 @@
 #include "archdep.h"
 #include "attach.h"
 #include "autostart.h"
+#include "batch.h"
 #include "cartridge.h"
 #include "cmdline.h"
 #include "console.h"
@@ -553,8 +554,13 @@ void initcmdline_check_attach(void)
     if (machine_class != VICE_MACHINE_VSID) {
         /* Handle general-purpose command-line options.  */
 
+        /* `-batch' */
+        if (batch_start() < 0) {
+            archdep_vice_exit(1);
+        }
+
         /* `-autostart' */
-        if (autostart_string != NULL) {
+        if (autostart_string != NULL && !batch_is_active()) {
             if (autostart_autodetect_opt_prgname(autostart_string, 0, autostart_mode) < 0) {
                 log_error(LOG_DEFAULT,
                         "Failed to autostart '%s'", autostart_string);
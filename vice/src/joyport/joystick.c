@@ -221,6 +221,16 @@ void joystick_event_delayed_playback(void *data)
     alarm_set(joystick_alarm, maincpu_clk + joystick_delay);
 }
 
+/* Latch the host joystick state again, after the machine state has been
+   restored.  */
+void joystick_relatch_matrix(void)
+{
+    alarm_unset(joystick_alarm);
+    alarm_context_update_next_pending(joystick_alarm->context);
+
+    joystick_latch_matrix(maincpu_clk);
+}
+
 void joystick_register_machine(joystick_machine_func_t func)
 {
     joystick_machine_func = func;
@@ -1618,7 +1628,7 @@ static int joystick_snapshot_read_module(snapshot_t *s, int port)
         return -1;
     }
 
-    if (SMR_W(m, &joystick_value[port + 1]) < 0) {
+    if (SMR_W(m, &joystick_value[port]) < 0) {
         snapshot_module_close(m);
         return -1;
     }
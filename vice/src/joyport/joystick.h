@@ -56,6 +56,7 @@ extern void joystick_clear_all(void);
 extern void joystick_event_playback(CLOCK offset, void *data);
 extern void joystick_event_delayed_playback(void *data);
 extern void joystick_register_delay(unsigned int delay);
+extern void joystick_relatch_matrix(void);
 
 extern void linux_joystick_init(void);
 extern void usb_joystick_init(void);
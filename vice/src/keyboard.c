@@ -333,6 +333,13 @@ static void keyboard_latch_matrix(CLOCK offset)
     }
 }
 
+/* Latch the host keyboard state into the matrix again, after the machine
+   state has been restored.  */
+void keyboard_relatch_matrix(void)
+{
+    keyboard_latch_matrix(maincpu_clk);
+}
+
 /* update keyboard latch, returns 0 on success, -1 on error */
 static int keyboard_set_latch_keyarr(int row, int col, int pressed)
 {
@@ -1294,6 +1301,12 @@ int keyboard_snapshot_read_module(snapshot_t *s)
         return -1;
     }
 
+    /* while connected the matrix is latched from the network copy */
+    if (network_connected()) {
+        memcpy(network_keyarr, keyarr, sizeof(network_keyarr));
+        memcpy(network_rev_keyarr, rev_keyarr, sizeof(network_rev_keyarr));
+    }
+
     return snapshot_module_close(m);
 }
 
@@ -115,6 +115,7 @@ extern void keyboard_restore_event_playback(CLOCK offset, void *data);
 extern void keyboard_event_delayed_playback(void *data);
 extern void keyboard_register_delay(unsigned int delay);
 extern void keyboard_register_clear(void);
+extern void keyboard_relatch_matrix(void);
 
 /* called by the ui */
 extern void keyboard_key_pressed(signed long key, int mod);
@@ -967,6 +967,11 @@ void lib_rand_printseed(void)
     log_message(LOG_DEFAULT, "random seed was: 0x%"PRIx64, initalseed);
 }
 
+uint64_t lib_rand_get_seed(void)
+{
+    return initalseed;
+}
+
 void lib_rand_seed(uint64_t seed)
 {
     initalseed = seed;
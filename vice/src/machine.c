@@ -34,6 +34,7 @@
 #include "archdep.h"
 #include "attach.h"
 #include "autostart.h"
+#include "batch.h"
 #include "cmdline.h"
 #include "console.h"
 #include "diskimage.h"
@@ -59,6 +60,9 @@
 #include "network.h"
 #include "printer.h"
 #include "resources.h"
+#include "rewind.h"
+#include "runahead.h"
+#include "shmexport.h"
 #include "romset.h"
 #include "screenshot.h"
 #include "sound.h"
@@ -326,6 +330,12 @@ void machine_shutdown(void)
     screenshot_at_exit();
     screenshot_shutdown();
 
+    rewind_shutdown();
+    runahead_shutdown();
+    shmexport_shutdown();
+
+    batch_shutdown();
+
     file_system_detach_disk_shutdown();
 
     machine_specific_shutdown();
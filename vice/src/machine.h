@@ -142,6 +142,15 @@ extern int machine_write_snapshot(const char *name, int save_roms,
 /* Read a snapshot.  */
 extern int machine_read_snapshot(const char *name, int even_mode);
 
+/* Write a snapshot to a newly allocated buffer, free it with `lib_free()'.  */
+extern int machine_write_snapshot_memory(uint8_t **data, size_t *len,
+                                         int save_roms, int save_disks,
+                                         int event_mode);
+
+/* Read a snapshot from a buffer.  */
+extern int machine_read_snapshot_memory(const uint8_t *data, size_t len,
+                                        int event_mode);
+
 /* handle pending interrupts - needed by libsid.a.  */
 extern void machine_handle_pending_alarms(CLOCK num_write_cycles);
 
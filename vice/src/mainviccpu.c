@@ -34,6 +34,7 @@
 #include "alarm.h"
 #include "archdep.h"
 #include "autostart.h"
+#include "batch.h"
 #include "debug.h"
 #include "interrupt.h"
 #include "machine.h"
@@ -493,6 +494,7 @@ void maincpu_mainloop(void)
 #define RMW_FLAG maincpu_rmw_flag
 #define LAST_OPCODE_INFO last_opcode_info
 #define LAST_OPCODE_ADDR last_opcode_addr
+#define PROFILE_CONTEXT maincpu_profile
 #define TRACEFLG debug.maincpu_traceflg
 
 #define CPU_INT_STATUS maincpu_int_status
@@ -541,8 +543,7 @@ void maincpu_mainloop(void)
         maincpu_int_status->num_dma_per_opcode = 0;
 
         if (maincpu_clk_limit && (maincpu_clk > maincpu_clk_limit)) {
-            log_error(LOG_DEFAULT, "cycle limit reached.");
-            archdep_vice_exit(EXIT_FAILURE);
+            batch_clk_limit_reached();
         }
 
         autostart_advance();
@@ -241,8 +241,17 @@ extern void monitor_cpuhistory_store(CLOCK cycle, unsigned int addr, unsigned in
                                      uint8_t reg_a, uint8_t reg_x, uint8_t reg_y,
                                      uint8_t reg_sp, unsigned int reg_st, uint8_t origin);
 extern void monitor_cpuhistory_fix_p2(unsigned int p2);
+extern void monitor_cpuhistory_defer(uint8_t origin);
+extern void monitor_cpuhistory_commit(uint8_t origin);
 extern void monitor_memmap_store(unsigned int addr, unsigned int type);
 
+/* Profiler prototypes */
+struct mon_profile_cpu_s;
+extern struct mon_profile_cpu_s *maincpu_profile;
+extern void monitor_profile_instruction(struct mon_profile_cpu_s *p, uint16_t pc, uint8_t op, uint8_t sp, CLOCK clk);
+extern void monitor_profile_interrupt(struct mon_profile_cpu_s *p, uint16_t pc, uint8_t sp, CLOCK clk);
+extern int monitor_profile_active(void);
+
 /* memmap defines */
 #define MEMMAP_I_O_R    (1 << 8)
 #define MEMMAP_I_O_W    (1 << 7)
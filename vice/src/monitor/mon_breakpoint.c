@@ -582,6 +582,18 @@ bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned i
 
             cp->hit_count++;
 
+#ifdef HAVE_NETWORK
+            /* streamed hits are only queued, and never stop */
+            if (cp->stream) {
+                monitor_binary_stream_checkpoint(cp, mem, (uint16_t)addr,
+                                                 (uint16_t)(is_loadstore ? lastpc : addr), op);
+                if (cp->temporary) {
+                    mon_breakpoint_delete_checkpoint(cp->checknum);
+                }
+                continue;
+            }
+#endif
+
             mon_breakpoint_event(cp);
 
             if (cp->stop) {
@@ -693,6 +705,7 @@ int breakpoint_add_checkpoint(MON_ADDR start_addr, MON_ADDR end_addr,
     new_cp->check_store = memory_op & e_store;
     new_cp->check_exec = memory_op & e_exec;
     new_cp->temporary = is_temp;
+    new_cp->stream = false;
 
     mem = addr_memspace(start_addr);
     if (new_cp->check_exec) {
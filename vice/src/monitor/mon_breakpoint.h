@@ -49,6 +49,7 @@ struct mon_checkpoint_s {
     bool check_store;
     bool check_exec;
     bool temporary;
+    bool stream;        /* report hits to the binary monitor without stopping */
 };
 typedef struct mon_checkpoint_s mon_checkpoint_t;
 
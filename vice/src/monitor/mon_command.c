@@ -144,6 +144,22 @@ static const mon_cmds_t mon_cmd_array[] = {
       NO_FILENAME_ARG
     },
 
+    { "profile", "prof",
+      "[on|off|toggle|reset|<memspace>]",
+      "Control the profiler.  'on', 'off' and 'toggle' switch it, 'reset'\n"
+      "clears the collected data.  Without argument it shows the state, the\n"
+      "number of addresses executed and the subroutines using the most cycles\n"
+      "on the current device or MEMSPACE.",
+      NO_FILENAME_ARG
+    },
+
+    { "profilesave", "profsave",
+      "\"<filename>\"",
+      "Save the profile of all CPUs.  A filename ending in .pb or .pprof is\n"
+      "written for pprof, any other in the callgrind format (kcachegrind).",
+      FILENAME_ARG
+    },
+
     { "registers", "r",
       "[<reg_name> = <number> [, <reg_name> = <number>]*]",
       "Assign respective registers (use FL for status flags).  With no\n"
@@ -164,6 +180,13 @@ static const mon_cmds_t mon_cmd_array[] = {
       NO_FILENAME_ARG
     },
 
+    { "rewind", "",
+      "[<count>]",
+      "Go back to a machine state captured by the rewind buffer.  COUNT\n"
+      "selects how many states to go back, 1 being the newest one.",
+      NO_FILENAME_ARG
+    },
+
     { "screen", "sc",
       NULL,
       "Displays the contents of the screen.",
@@ -35,6 +35,7 @@
 #include <strings.h>
 #endif
 
+#include "drive.h"
 #include "lib.h"
 #include "machine.h"
 #include "mon_disassemble.h"
@@ -87,6 +88,18 @@ static cpuhistory_t *cpuhistory = NULL;
 static int cpuhistory_lines = 0;
 static int cpuhistory_i = 0;
 
+/* Entries of drive CPUs running on their own threads, kept per origin until
+   they are appended to the history. */
+typedef struct cpuhistory_deferred_s {
+    cpuhistory_t *lines;
+    int size;
+    int i;
+    int count;
+    int active;
+} cpuhistory_deferred_t;
+
+static cpuhistory_deferred_t cpuhistory_deferred[NUM_DISK_UNITS + 1];
+
 
 /** \brief  (re)allocate the buffer used for the cpu history info
  *
@@ -134,25 +147,90 @@ void monitor_cpuhistory_store(CLOCK cycle, unsigned int addr, unsigned int op,
                               unsigned int reg_st,
                               uint8_t origin)
 {
+    cpuhistory_t *h;
+
     if (machine_is_jammed()) {
         return;
     }
 
-    ++cpuhistory_i;
-    if (cpuhistory_i == cpuhistory_lines) {
-        cpuhistory_i = 0;
+    if (origin <= NUM_DISK_UNITS && cpuhistory_deferred[origin].active) {
+        cpuhistory_deferred_t *d = &cpuhistory_deferred[origin];
+
+        h = &d->lines[d->i];
+        if (++d->i == d->size) {
+            d->i = 0;
+        }
+        if (d->count < d->size) {
+            d->count++;
+        }
+    } else {
+        ++cpuhistory_i;
+        if (cpuhistory_i == cpuhistory_lines) {
+            cpuhistory_i = 0;
+        }
+        h = &cpuhistory[cpuhistory_i];
+    }
+    h->cycle = cycle;
+    h->addr = addr;
+    h->op = op;
+    h->p1 = p1;
+    h->p2 = p2;
+    h->reg_a = reg_a;
+    h->reg_x = reg_x;
+    h->reg_y = reg_y;
+    h->reg_sp = reg_sp;
+    h->reg_st = reg_st;
+    h->origin = origin;
+}
+
+/** \brief  Keep the history entries of a drive CPU apart
+ *
+ * Used while the drive CPU runs on its own thread. The entries are added to
+ * the history by monitor_cpuhistory_commit().
+ *
+ * \param[in]   origin  origin of the drive CPU (unit number - 7)
+ */
+void monitor_cpuhistory_defer(uint8_t origin)
+{
+    cpuhistory_deferred_t *d = &cpuhistory_deferred[origin];
+
+    if (d->size != cpuhistory_lines) {
+        d->lines = lib_realloc(d->lines, (size_t)cpuhistory_lines * sizeof(cpuhistory_t));
+        d->size = cpuhistory_lines;
+    }
+    d->i = 0;
+    d->count = 0;
+    d->active = 1;
+}
+
+/** \brief  Add the deferred entries of a drive CPU to the history
+ *
+ * Later entries of the drive CPU go to the history directly again.
+ *
+ * \param[in]   origin  origin of the drive CPU
+ */
+void monitor_cpuhistory_commit(uint8_t origin)
+{
+    cpuhistory_deferred_t *d = &cpuhistory_deferred[origin];
+    int n;
+
+    if (!d->active) {
+        return;
+    }
+    d->active = 0;
+
+    for (n = d->count; n > 0; n--) {
+        int j = d->i - n;
+
+        if (j < 0) {
+            j += d->size;
+        }
+        ++cpuhistory_i;
+        if (cpuhistory_i == cpuhistory_lines) {
+            cpuhistory_i = 0;
+        }
+        cpuhistory[cpuhistory_i] = d->lines[j];
     }
-    cpuhistory[cpuhistory_i].cycle = cycle;
-    cpuhistory[cpuhistory_i].addr = addr;
-    cpuhistory[cpuhistory_i].op = op;
-    cpuhistory[cpuhistory_i].p1 = p1;
-    cpuhistory[cpuhistory_i].p2 = p2;
-    cpuhistory[cpuhistory_i].reg_a = reg_a;
-    cpuhistory[cpuhistory_i].reg_x = reg_x;
-    cpuhistory[cpuhistory_i].reg_y = reg_y;
-    cpuhistory[cpuhistory_i].reg_sp = reg_sp;
-    cpuhistory[cpuhistory_i].reg_st = reg_st;
-    cpuhistory[cpuhistory_i].origin = origin;
 }
 
 void monitor_cpuhistory_fix_p2(unsigned int p2)
@@ -411,11 +489,18 @@ void mon_memmap_init(void)
 
 void mon_memmap_shutdown(void)
 {
+    int i;
+
     lib_free(mon_memmap);
     mon_memmap = NULL;
     if (cpuhistory != NULL) {
         lib_free(cpuhistory);
     }
+    for (i = 0; i <= NUM_DISK_UNITS; i++) {
+        lib_free(cpuhistory_deferred[i].lines);
+        cpuhistory_deferred[i].lines = NULL;
+        cpuhistory_deferred[i].size = 0;
+    }
 }
 
 
@@ -456,4 +541,12 @@ void mon_memmap_shutdown(void)
 {
 }
 
+void monitor_cpuhistory_defer(uint8_t origin)
+{
+}
+
+void monitor_cpuhistory_commit(uint8_t origin)
+{
+}
+
 #endif
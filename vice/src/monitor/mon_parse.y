@@ -60,6 +60,7 @@ extern char *alloca();
 #include "mon_file.h"
 #include "mon_memmap.h"
 #include "mon_memory.h"
+#include "mon_profile.h"
 #include "mon_register.h"
 #include "mon_util.h"
 #include "montypes.h"
@@ -127,7 +128,7 @@ extern int cur_len, last_len;
 %token<str> H_RANGE_GUESS D_NUMBER_GUESS O_NUMBER_GUESS B_NUMBER_GUESS
 %token<i> BAD_CMD MEM_OP IF MEM_COMP MEM_DISK8 MEM_DISK9 MEM_DISK10 MEM_DISK11 EQUALS
 %token TRAIL CMD_SEP LABEL_ASGN_COMMENT
-%token CMD_LOG CMD_LOGNAME CMD_SIDEFX CMD_DUMMY CMD_RETURN CMD_BLOCK_READ CMD_BLOCK_WRITE CMD_UP CMD_DOWN
+%token CMD_LOG CMD_LOGNAME CMD_SIDEFX CMD_DUMMY CMD_RETURN CMD_REWIND CMD_BLOCK_READ CMD_BLOCK_WRITE CMD_UP CMD_DOWN
 %token CMD_LOAD CMD_SAVE CMD_VERIFY CMD_BVERIFY CMD_IGNORE CMD_HUNT CMD_FILL CMD_MOVE
 %token CMD_GOTO CMD_REGISTERS CMD_READSPACE CMD_WRITESPACE CMD_RADIX
 %token CMD_MEM_DISPLAY CMD_BREAK CMD_TRACE CMD_IO CMD_BRMON CMD_COMPARE
@@ -143,6 +144,7 @@ extern int cur_len, last_len;
 %token CMD_ATTACH CMD_DETACH CMD_MON_RESET CMD_TAPECTRL CMD_CARTFREEZE CMD_UPDB CMD_JPDB
 %token CMD_CPUHISTORY CMD_MEMMAPZAP CMD_MEMMAPSHOW CMD_MEMMAPSAVE
 %token CMD_COMMENT CMD_LIST CMD_STOPWATCH RESET
+%token CMD_PROFILE CMD_PROFILESAVE
 %token CMD_EXPORT CMD_AUTOSTART CMD_AUTOLOAD CMD_MAINCPU_TRACE
 %token CMD_WARP
 %token<str> CMD_LABEL_ASGN
@@ -254,6 +256,10 @@ machine_state_rules: CMD_BANK end_cmd
                      { mon_write_snapshot($2,0,0,0); /* FIXME */ }
                    | CMD_UNDUMP filename end_cmd
                      { mon_read_snapshot($2, 0); }
+                   | CMD_REWIND end_cmd
+                     { mon_rewind(1); }
+                   | CMD_REWIND opt_sep expression end_cmd
+                     { mon_rewind($3); }
                    | CMD_STEP end_cmd
                      { mon_instructions_step(-1); }
                    | CMD_STEP opt_sep expression end_cmd
@@ -498,6 +504,21 @@ monitor_state_rules: CMD_SIDEFX TOGGLE end_cmd
                      { 
                         resources_set_string("MonitorLogFileName", $2);
                      }
+                   | CMD_PROFILE TOGGLE end_cmd
+                     {
+                        int profile;
+                        resources_get_int("MonitorProfile", &profile);
+                        profile = (($2 == e_TOGGLE) ? (profile ^ 1) : $2);
+                        resources_set_int("MonitorProfile", profile);
+                     }
+                   | CMD_PROFILE RESET end_cmd
+                     { mon_profile_reset(); }
+                   | CMD_PROFILE end_cmd
+                     { mon_profile_show(e_default_space); }
+                   | CMD_PROFILE memspace end_cmd
+                     { mon_profile_show($2); }
+                   | CMD_PROFILESAVE filename end_cmd
+                     { mon_profile_save($2); }
                    | CMD_RADIX RADIX_TYPE end_cmd
                      { default_radix = $2; }
                    | CMD_RADIX end_cmd
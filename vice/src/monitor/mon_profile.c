@@ -0,0 +1,1169 @@
+/*
+ * mon_profile.c - The VICE built-in monitor, 6502 profiler.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The profiler is always compiled in and costs a single pointer test per
+   instruction while it is off.  When it is on it can
+
+   - trace every instruction of the main and drive CPUs, keeping cycle exact
+     per-address costs and per-subroutine self and inclusive times by
+     following JSR/RTS, BRK/RTI and interrupts,
+   - sample the program counter (and the call stack when tracing) from an
+     alarm every few cycles.
+
+   The results can be shown in the monitor or written as a callgrind file
+   (for kcachegrind, callgrind_annotate...) or as a pprof profile.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alarm.h"
+#include "archdep.h"
+#include "cmdline.h"
+#include "drive.h"
+#include "drivetypes.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "mon_profile.h"
+#include "monitor.h"
+#include "montypes.h"
+#include "resources.h"
+#include "types.h"
+#include "util.h"
+
+
+/* Defines */
+
+#define PROFILE_ADDRS       0x10000
+#define PROFILE_ROOT        0x10000     /* pseudo function for code run outside any call */
+#define PROFILE_FUNCS       (PROFILE_ROOT + 1)
+#define PROFILE_MAX_DEPTH   256
+#define PROFILE_HASH_SIZE   4096
+#define PROFILE_TOP         20
+#define PROFILE_NONE        0xffffffff
+
+#define OP_BRK 0x00
+#define OP_JSR 0x20
+#define OP_RTI 0x40
+#define OP_RTS 0x60
+
+#define PROFILE_CURRENT(p) ((p)->depth ? (p)->frames[(p)->depth - 1].func : PROFILE_ROOT)
+
+/* Types */
+
+/* Cost of an address executed by another function than the one that
+   executed it first (shared tails, code jumped into...).  */
+typedef struct profile_cost_s {
+    uint32_t func;
+    uint16_t addr;
+    CLOCK cycles;
+    CLOCK count;
+    struct profile_cost_s *next;
+    struct profile_cost_s *list;
+} profile_cost_t;
+
+/* A call from one function to another at a given call site.  */
+typedef struct profile_arc_s {
+    uint32_t caller;
+    uint32_t callee;
+    uint16_t site;
+    CLOCK calls;
+    CLOCK cycles;
+    CLOCK count;
+    struct profile_arc_s *next;
+    struct profile_arc_s *list;
+} profile_arc_t;
+
+/* A sampled call stack, leaf first, then the call sites.  */
+typedef struct profile_stack_s {
+    unsigned int depth;
+    CLOCK samples;
+    CLOCK cycles;
+    struct profile_stack_s *next;
+    uint16_t addr[1];
+} profile_stack_t;
+
+typedef struct profile_func_s {
+    CLOCK self;
+    CLOCK total;
+    CLOCK calls;
+} profile_func_t;
+
+typedef struct profile_frame_s {
+    uint32_t func;
+    uint16_t site;
+    unsigned int sp;
+    profile_arc_t *arc;
+    CLOCK start;
+    CLOCK start_count;
+} profile_frame_t;
+
+struct mon_profile_cpu_s {
+    MEMSPACE mem;
+
+    /* Where the CPU keeps its state.  */
+    CLOCK *clk_ptr;
+    unsigned int *last_opcode_addr;
+    struct mon_profile_cpu_s **hook;
+    alarm_t *alarm;
+    CLOCK interval;
+
+    /* Per address data.  */
+    uint32_t *owner;
+    CLOCK *count;
+    CLOCK *cycles;
+    CLOCK *sampled;
+
+    profile_func_t *funcs;
+    profile_cost_t *costs[PROFILE_HASH_SIZE];
+    profile_arc_t *arcs[PROFILE_HASH_SIZE];
+    profile_stack_t *stacks[PROFILE_HASH_SIZE];
+
+    profile_frame_t frames[PROFILE_MAX_DEPTH];
+    unsigned int depth;
+
+    /* The instruction currently executing.  */
+    int valid;
+    uint16_t prev_pc;
+    uint8_t prev_op;
+    uint8_t prev_sp;
+    CLOCK prev_clk;
+
+    /* An interrupt was taken, the handler frame is pushed on its first
+       instruction.  */
+    int irq_pending;
+    uint16_t irq_pc;
+    uint8_t irq_sp;
+
+    CLOCK total_cycles;
+    CLOCK total_count;
+    CLOCK total_samples;
+    CLOCK total_sampled;
+};
+typedef struct mon_profile_cpu_s mon_profile_cpu_t;
+
+typedef struct pb_buf_s {
+    uint8_t *data;
+    size_t len;
+    size_t size;
+} pb_buf_t;
+
+typedef struct profile_strings_s {
+    char **list;
+    int num;
+    int size;
+} profile_strings_t;
+
+
+/* Globals */
+
+mon_profile_cpu_t *maincpu_profile = NULL;
+
+static mon_profile_cpu_t *profiles[NUM_MEMSPACES];
+
+static int profile_ready = 0;
+
+static int profile_enabled = 0;
+static int profile_trace = 1;
+static int profile_interval = 1000;
+static char *profile_file = NULL;
+
+static const char * const profile_root_name = "[top level]";
+
+
+/* ------------------------------------------------------------------------- */
+/* Data collection */
+
+static unsigned int profile_hash(uint32_t a, uint32_t b)
+{
+    return ((a * 0x9e3779b1U) ^ (b * 0x85ebca6bU)) >> 20 & (PROFILE_HASH_SIZE - 1);
+}
+
+static profile_cost_t *profile_cost_get(mon_profile_cpu_t *p, uint32_t func, uint16_t addr)
+{
+    unsigned int h = profile_hash(func, addr);
+    profile_cost_t *c;
+
+    for (c = p->costs[h]; c != NULL; c = c->next) {
+        if (c->func == func && c->addr == addr) {
+            return c;
+        }
+    }
+    c = lib_calloc(1, sizeof(profile_cost_t));
+    c->func = func;
+    c->addr = addr;
+    c->next = p->costs[h];
+    p->costs[h] = c;
+    return c;
+}
+
+static profile_arc_t *profile_arc_get(mon_profile_cpu_t *p, uint32_t caller, uint16_t site, uint32_t callee)
+{
+    unsigned int h = profile_hash(caller ^ (callee << 16), site);
+    profile_arc_t *a;
+
+    for (a = p->arcs[h]; a != NULL; a = a->next) {
+        if (a->caller == caller && a->callee == callee && a->site == site) {
+            return a;
+        }
+    }
+    a = lib_calloc(1, sizeof(profile_arc_t));
+    a->caller = caller;
+    a->callee = callee;
+    a->site = site;
+    a->next = p->arcs[h];
+    p->arcs[h] = a;
+    return a;
+}
+
+/* Charge `cycles' to `addr' of the function currently running.  */
+static void profile_account(mon_profile_cpu_t *p, uint16_t addr, CLOCK cycles, unsigned int count)
+{
+    uint32_t func = PROFILE_CURRENT(p);
+
+    if (p->owner[addr] == 0) {
+        p->owner[addr] = func + 1;
+    }
+    if (p->owner[addr] == func + 1) {
+        p->cycles[addr] += cycles;
+        p->count[addr] += count;
+    } else {
+        profile_cost_t *c = profile_cost_get(p, func, addr);
+
+        c->cycles += cycles;
+        c->count += count;
+    }
+    p->funcs[func].self += cycles;
+    p->total_cycles += cycles;
+    p->total_count += count;
+}
+
+static void profile_push(mon_profile_cpu_t *p, uint32_t func, uint16_t site, uint8_t sp, CLOCK start)
+{
+    profile_frame_t *frame;
+    profile_arc_t *arc;
+    unsigned int i;
+
+    arc = profile_arc_get(p, PROFILE_CURRENT(p), site, func);
+    arc->calls++;
+    p->funcs[func].calls++;
+
+    if (p->depth == PROFILE_MAX_DEPTH) {
+        return;
+    }
+
+    /* The stack pointer was reset below frames that never returned (main
+       loops calling TXS...), keep the frames ordered so only the new one is
+       removed by the next return.  */
+    for (i = p->depth; i > 0 && p->frames[i - 1].sp <= sp; i--) {
+        p->frames[i - 1].sp = sp + 1U;
+    }
+
+    frame = &p->frames[p->depth++];
+    frame->func = func;
+    frame->site = site;
+    frame->sp = sp;
+    frame->arc = arc;
+    frame->start = start;
+    frame->start_count = p->total_count;
+}
+
+/* Add the time spent in frame `i' up to `clk'.  */
+static void profile_frame_close(mon_profile_cpu_t *p, unsigned int i, CLOCK clk)
+{
+    profile_frame_t *frame = &p->frames[i];
+    CLOCK cycles = clk - frame->start;
+    unsigned int j;
+
+    frame->arc->cycles += cycles;
+    frame->arc->count += p->total_count - frame->start_count;
+
+    /* Recursive calls are only counted once in the inclusive time.  */
+    for (j = 0; j < i; j++) {
+        if (p->frames[j].func == frame->func) {
+            break;
+        }
+    }
+    if (j == i) {
+        p->funcs[frame->func].total += cycles;
+    }
+
+    frame->start = clk;
+    frame->start_count = p->total_count;
+}
+
+/* Account the instruction at prev_pc, which ended at `clk', and follow the
+   calls and returns it made.  */
+static void profile_retire(mon_profile_cpu_t *p, uint16_t pc, uint8_t sp, CLOCK clk)
+{
+    profile_account(p, p->prev_pc, clk - p->prev_clk, 1);
+
+    switch (p->prev_op) {
+        case OP_BRK:
+        case OP_JSR:
+            profile_push(p, pc, p->prev_pc, p->prev_sp, clk);
+            break;
+        case OP_RTI:
+        case OP_RTS:
+            while (p->depth > 0 && sp >= p->frames[p->depth - 1].sp) {
+                profile_frame_close(p, --p->depth, clk);
+            }
+            break;
+        default:
+            break;
+    }
+    p->prev_clk = clk;
+}
+
+void monitor_profile_instruction(mon_profile_cpu_t *p, uint16_t pc, uint8_t op, uint8_t sp, CLOCK clk)
+{
+    if (!p->valid || clk < p->prev_clk) {
+        /* First instruction, or the clock went back (snapshot).  */
+        p->valid = 1;
+        p->depth = 0;
+        p->irq_pending = 0;
+    } else if (p->irq_pending) {
+        p->irq_pending = 0;
+        profile_push(p, pc, p->irq_pc, p->irq_sp, p->prev_clk);
+        profile_account(p, pc, clk - p->prev_clk, 0);
+    } else {
+        profile_retire(p, pc, sp, clk);
+    }
+    p->prev_pc = pc;
+    p->prev_op = op;
+    p->prev_sp = sp;
+    p->prev_clk = clk;
+}
+
+void monitor_profile_interrupt(mon_profile_cpu_t *p, uint16_t pc, uint8_t sp, CLOCK clk)
+{
+    if (!p->valid || p->irq_pending || clk < p->prev_clk) {
+        return;
+    }
+    profile_retire(p, pc, sp, clk);
+    p->irq_pending = 1;
+    p->irq_pc = pc;
+    p->irq_sp = sp;
+}
+
+/* Add the time of the calls still running, so long running functions (main
+   loops...) show up.  */
+static void profile_flush(mon_profile_cpu_t *p)
+{
+    unsigned int i;
+
+    if (p->valid) {
+        for (i = 0; i < p->depth; i++) {
+            profile_frame_close(p, i, p->prev_clk);
+        }
+    }
+    p->funcs[PROFILE_ROOT].total = p->total_cycles;
+}
+
+static void profile_stack_add(mon_profile_cpu_t *p, uint16_t pc)
+{
+    uint16_t addr[PROFILE_MAX_DEPTH + 1];
+    unsigned int depth = 0, h = pc, i;
+    profile_stack_t *s;
+
+    addr[0] = pc;
+    if (p->valid && *p->hook != NULL) {
+        for (i = p->depth; i > 0; i--) {
+            addr[++depth] = p->frames[i - 1].site;
+            h = h * 31 + addr[depth];
+        }
+    }
+    h = profile_hash(h, depth);
+
+    for (s = p->stacks[h]; s != NULL; s = s->next) {
+        if (s->depth == depth && !memcmp(s->addr, addr, (depth + 1) * sizeof(uint16_t))) {
+            break;
+        }
+    }
+    if (s == NULL) {
+        s = lib_malloc(sizeof(profile_stack_t) + depth * sizeof(uint16_t));
+        s->depth = depth;
+        s->samples = 0;
+        s->cycles = 0;
+        memcpy(s->addr, addr, (depth + 1) * sizeof(uint16_t));
+        s->next = p->stacks[h];
+        p->stacks[h] = s;
+    }
+    s->samples++;
+    s->cycles += p->interval;
+}
+
+static void profile_alarm_handler(CLOCK offset, void *data)
+{
+    mon_profile_cpu_t *p = (mon_profile_cpu_t *)data;
+    uint16_t pc = (uint16_t)*p->last_opcode_addr;
+
+    p->sampled[pc] += p->interval;
+    p->total_samples++;
+    p->total_sampled += p->interval;
+    profile_stack_add(p, pc);
+
+    alarm_set(p->alarm, *p->clk_ptr - offset + p->interval);
+}
+
+static void profile_clear(mon_profile_cpu_t *p)
+{
+    profile_cost_t *c, *c_next;
+    profile_arc_t *a, *a_next;
+    profile_stack_t *s, *s_next;
+    int i;
+
+    for (i = 0; i < PROFILE_HASH_SIZE; i++) {
+        for (c = p->costs[i]; c != NULL; c = c_next) {
+            c_next = c->next;
+            lib_free(c);
+        }
+        for (a = p->arcs[i]; a != NULL; a = a_next) {
+            a_next = a->next;
+            lib_free(a);
+        }
+        for (s = p->stacks[i]; s != NULL; s = s_next) {
+            s_next = s->next;
+            lib_free(s);
+        }
+        p->costs[i] = NULL;
+        p->arcs[i] = NULL;
+        p->stacks[i] = NULL;
+    }
+    memset(p->owner, 0, PROFILE_ADDRS * sizeof(uint32_t));
+    memset(p->count, 0, PROFILE_ADDRS * sizeof(CLOCK));
+    memset(p->cycles, 0, PROFILE_ADDRS * sizeof(CLOCK));
+    memset(p->sampled, 0, PROFILE_ADDRS * sizeof(CLOCK));
+    memset(p->funcs, 0, PROFILE_FUNCS * sizeof(profile_func_t));
+
+    p->valid = 0;
+    p->depth = 0;
+    p->irq_pending = 0;
+    p->total_cycles = 0;
+    p->total_count = 0;
+    p->total_samples = 0;
+    p->total_sampled = 0;
+}
+
+static mon_profile_cpu_t *profile_new(MEMSPACE mem, CLOCK *clk_ptr, unsigned int *last_addr,
+                                      alarm_context_t *alarm_context, mon_profile_cpu_t **hook)
+{
+    mon_profile_cpu_t *p = lib_calloc(1, sizeof(mon_profile_cpu_t));
+
+    p->mem = mem;
+    p->clk_ptr = clk_ptr;
+    p->last_opcode_addr = last_addr;
+    p->hook = hook;
+    p->alarm = alarm_new(alarm_context, "MonitorProfile", profile_alarm_handler, p);
+
+    p->owner = lib_calloc(PROFILE_ADDRS, sizeof(uint32_t));
+    p->count = lib_calloc(PROFILE_ADDRS, sizeof(CLOCK));
+    p->cycles = lib_calloc(PROFILE_ADDRS, sizeof(CLOCK));
+    p->sampled = lib_calloc(PROFILE_ADDRS, sizeof(CLOCK));
+    p->funcs = lib_calloc(PROFILE_FUNCS, sizeof(profile_func_t));
+
+    return p;
+}
+
+static void profile_free(mon_profile_cpu_t *p)
+{
+    *p->hook = NULL;
+    profile_clear(p);
+    alarm_destroy(p->alarm);
+    lib_free(p->owner);
+    lib_free(p->count);
+    lib_free(p->cycles);
+    lib_free(p->sampled);
+    lib_free(p->funcs);
+    lib_free(p);
+}
+
+/* Switch profiling of one CPU according to the resources.  */
+static void profile_setup(MEMSPACE mem, CLOCK *clk_ptr, unsigned int *last_addr,
+                          alarm_context_t *alarm_context, mon_profile_cpu_t **hook)
+{
+    mon_profile_cpu_t *p = profiles[mem];
+
+    if (p == NULL) {
+        if (!profile_enabled) {
+            return;
+        }
+        p = profile_new(mem, clk_ptr, last_addr, alarm_context, hook);
+        profiles[mem] = p;
+    }
+
+    if (!profile_enabled || !profile_trace) {
+        profile_flush(p);
+        p->valid = 0;
+        p->depth = 0;
+        p->irq_pending = 0;
+    }
+    *hook = (profile_enabled && profile_trace) ? p : NULL;
+
+    if (profile_enabled && profile_interval > 0) {
+        p->interval = (CLOCK)profile_interval;
+        alarm_set(p->alarm, *clk_ptr + p->interval);
+    } else {
+        alarm_unset(p->alarm);
+    }
+}
+
+static void profile_update(void)
+{
+    unsigned int dnr;
+
+    if (!profile_ready) {
+        return;
+    }
+
+    profile_setup(e_comp_space, &maincpu_clk, &last_opcode_addr, maincpu_alarm_context, &maincpu_profile);
+
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        diskunit_context_t *drv = diskunit_context[dnr];
+
+        if (drv != NULL && drv->cpu != NULL) {
+            profile_setup(monitor_diskspace_mem(dnr), drv->clk_ptr, &drv->cpu->last_opcode_addr,
+                          drv->cpu->alarm_context, &drv->cpu->profile);
+        }
+    }
+}
+
+int monitor_profile_active(void)
+{
+    return profile_enabled;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Output */
+
+static char *profile_func_name(MEMSPACE mem, uint32_t func)
+{
+    const char *label;
+
+    if (func == PROFILE_ROOT) {
+        return lib_strdup(profile_root_name);
+    }
+    label = mon_symbol_table_lookup_name(mem, (uint16_t)func);
+    if (label != NULL) {
+        return lib_msprintf("%s ($%04x)", label, func);
+    }
+    return lib_msprintf("$%04x", func);
+}
+
+static int profile_has_data(mon_profile_cpu_t *p)
+{
+    return p != NULL && (p->total_count > 0 || p->total_samples > 0);
+}
+
+/* callgrind, see valgrind's docs/callgrind-format.  Traced CPUs give
+   cycle exact costs with calls, sampled ones only give costs per address.  */
+static void profile_write_callgrind_cpu(FILE *fp, mon_profile_cpu_t *p)
+{
+    const char *space = _mon_space_strings[p->mem];
+    uint32_t *head, *next;
+    profile_cost_t **cost_head, *c;
+    profile_arc_t **arc_head, *a;
+    uint32_t func;
+    unsigned int addr;
+    int i;
+    char *name;
+
+    fprintf(fp, "\nob=%s\nfl=%s\n", space, space);
+
+    if (p->total_count == 0) {
+        fprintf(fp, "fn=%s\n", profile_root_name);
+        for (addr = 0; addr < PROFILE_ADDRS; addr++) {
+            if (p->sampled[addr]) {
+                fprintf(fp, "0x%04x %"PRIu64" 0\n", addr, (uint64_t)p->sampled[addr]);
+            }
+        }
+        return;
+    }
+
+    /* Collect the addresses, extra costs and calls of each function.  */
+    head = lib_malloc(PROFILE_FUNCS * sizeof(uint32_t));
+    next = lib_malloc(PROFILE_ADDRS * sizeof(uint32_t));
+    cost_head = lib_calloc(PROFILE_FUNCS, sizeof(profile_cost_t *));
+    arc_head = lib_calloc(PROFILE_FUNCS, sizeof(profile_arc_t *));
+
+    for (func = 0; func < PROFILE_FUNCS; func++) {
+        head[func] = PROFILE_NONE;
+    }
+    for (addr = PROFILE_ADDRS; addr-- > 0; ) {
+        if (p->owner[addr]) {
+            func = p->owner[addr] - 1;
+            next[addr] = head[func];
+            head[func] = addr;
+        }
+    }
+    for (i = 0; i < PROFILE_HASH_SIZE; i++) {
+        for (c = p->costs[i]; c != NULL; c = c->next) {
+            c->list = cost_head[c->func];
+            cost_head[c->func] = c;
+        }
+        for (a = p->arcs[i]; a != NULL; a = a->next) {
+            a->list = arc_head[a->caller];
+            arc_head[a->caller] = a;
+        }
+    }
+
+    for (func = 0; func < PROFILE_FUNCS; func++) {
+        if (head[func] == PROFILE_NONE && cost_head[func] == NULL && arc_head[func] == NULL) {
+            continue;
+        }
+        name = profile_func_name(p->mem, func);
+        fprintf(fp, "fn=%s\n", name);
+        lib_free(name);
+
+        for (addr = head[func]; addr != PROFILE_NONE; addr = next[addr]) {
+            fprintf(fp, "0x%04x %"PRIu64" %"PRIu64"\n",
+                    addr, (uint64_t)p->cycles[addr], (uint64_t)p->count[addr]);
+        }
+        for (c = cost_head[func]; c != NULL; c = c->list) {
+            fprintf(fp, "0x%04x %"PRIu64" %"PRIu64"\n",
+                    c->addr, (uint64_t)c->cycles, (uint64_t)c->count);
+        }
+        for (a = arc_head[func]; a != NULL; a = a->list) {
+            name = profile_func_name(p->mem, a->callee);
+            fprintf(fp, "cfn=%s\ncalls=%"PRIu64" 0x%04x\n0x%04x %"PRIu64" %"PRIu64"\n",
+                    name, (uint64_t)a->calls, a->callee, a->site,
+                    (uint64_t)a->cycles, (uint64_t)a->count);
+            lib_free(name);
+        }
+    }
+
+    lib_free(head);
+    lib_free(next);
+    lib_free(cost_head);
+    lib_free(arc_head);
+}
+
+static int profile_write_callgrind(FILE *fp)
+{
+    CLOCK cycles = 0, count = 0;
+    int i;
+
+    for (i = 0; i < NUM_MEMSPACES; i++) {
+        mon_profile_cpu_t *p = profiles[i];
+
+        if (profile_has_data(p)) {
+            cycles += p->total_count ? p->total_cycles : p->total_sampled;
+            count += p->total_count;
+        }
+    }
+
+    fprintf(fp, "# callgrind format\nversion: 1\ncreator: VICE\ncmd: %s\n"
+                "positions: instr\nevents: Cycles Instructions\n"
+                "summary: %"PRIu64" %"PRIu64"\n",
+            machine_name, (uint64_t)cycles, (uint64_t)count);
+
+    for (i = 0; i < NUM_MEMSPACES; i++) {
+        if (profile_has_data(profiles[i])) {
+            profile_write_callgrind_cpu(fp, profiles[i]);
+        }
+    }
+    return ferror(fp) ? -1 : 0;
+}
+
+/* pprof, an uncompressed profile.proto message built by hand.  */
+
+static void pb_put(pb_buf_t *b, const void *data, size_t len)
+{
+    if (b->len + len > b->size) {
+        b->size = (b->len + len) * 2 + 64;
+        b->data = lib_realloc(b->data, b->size);
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+}
+
+static void pb_varint(pb_buf_t *b, uint64_t v)
+{
+    uint8_t buf[10];
+    size_t n = 0;
+
+    while (v >= 0x80) {
+        buf[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    buf[n++] = (uint8_t)v;
+    pb_put(b, buf, n);
+}
+
+static void pb_int(pb_buf_t *b, unsigned int field, uint64_t v)
+{
+    pb_varint(b, (field << 3) | 0);
+    pb_varint(b, v);
+}
+
+static void pb_bytes(pb_buf_t *b, unsigned int field, const void *data, size_t len)
+{
+    pb_varint(b, (field << 3) | 2);
+    pb_varint(b, len);
+    pb_put(b, data, len);
+}
+
+/* Append `msg' as field `field' of `b' and empty it for reuse.  */
+static void pb_message(pb_buf_t *b, unsigned int field, pb_buf_t *msg)
+{
+    pb_bytes(b, field, msg->data, msg->len);
+    msg->len = 0;
+}
+
+static uint64_t profile_strings_add(profile_strings_t *st, char *s)
+{
+    if (st->num == st->size) {
+        st->size = st->size * 2 + 64;
+        st->list = lib_realloc(st->list, st->size * sizeof(char *));
+    }
+    st->list[st->num] = s;
+    return (uint64_t)st->num++;
+}
+
+static void profile_pprof_sample(pb_buf_t *prof, pb_buf_t *locs, pb_buf_t *values, pb_buf_t *msg,
+                                 CLOCK samples, CLOCK cycles)
+{
+    pb_varint(values, samples);
+    pb_varint(values, cycles);
+    pb_message(msg, 1, locs);
+    pb_message(msg, 2, values);
+    pb_message(prof, 2, msg);
+}
+
+static int profile_write_pprof(FILE *fp)
+{
+    pb_buf_t prof = { NULL, 0, 0 }, msg = { NULL, 0, 0 }, sub = { NULL, 0, 0 }, values = { NULL, 0, 0 };
+    profile_strings_t st = { NULL, 0, 0 };
+    uint8_t *loc_used, *func_used;
+    uint64_t str_samples, str_count, str_cycles;
+    int i, j, result;
+
+    profile_strings_add(&st, lib_strdup(""));
+    str_samples = profile_strings_add(&st, lib_strdup("samples"));
+    str_count = profile_strings_add(&st, lib_strdup("count"));
+    str_cycles = profile_strings_add(&st, lib_strdup("cycles"));
+
+    pb_int(&msg, 1, str_samples);
+    pb_int(&msg, 2, str_count);
+    pb_message(&prof, 1, &msg);
+    pb_int(&msg, 1, str_cycles);
+    pb_int(&msg, 2, str_count);
+    pb_message(&prof, 1, &msg);
+
+    loc_used = lib_malloc(PROFILE_ADDRS);
+    func_used = lib_malloc(PROFILE_FUNCS);
+
+    for (i = 0; i < NUM_MEMSPACES; i++) {
+        mon_profile_cpu_t *p = profiles[i];
+        uint64_t loc_base = ((uint64_t)i << 16) + 1;
+        uint64_t func_base = ((uint64_t)i << 17) + 1;
+        uint64_t str_space;
+        unsigned int addr;
+        uint32_t func;
+
+        if (!profile_has_data(p)) {
+            continue;
+        }
+        memset(loc_used, 0, PROFILE_ADDRS);
+        memset(func_used, 0, PROFILE_FUNCS);
+
+        if (p->total_samples > 0) {
+            for (j = 0; j < PROFILE_HASH_SIZE; j++) {
+                profile_stack_t *s;
+                unsigned int k;
+
+                for (s = p->stacks[j]; s != NULL; s = s->next) {
+                    for (k = 0; k <= s->depth; k++) {
+                        pb_varint(&sub, loc_base + s->addr[k]);
+                        loc_used[s->addr[k]] = 1;
+                    }
+                    profile_pprof_sample(&prof, &sub, &values, &msg, s->samples, s->cycles);
+                }
+            }
+        } else {
+            /* Not sampled, export the traced cycles per address.  */
+            for (addr = 0; addr < PROFILE_ADDRS; addr++) {
+                if (p->cycles[addr]) {
+                    pb_varint(&sub, loc_base + addr);
+                    loc_used[addr] = 1;
+                    profile_pprof_sample(&prof, &sub, &values, &msg, 0, p->cycles[addr]);
+                }
+            }
+            for (j = 0; j < PROFILE_HASH_SIZE; j++) {
+                profile_cost_t *c;
+
+                for (c = p->costs[j]; c != NULL; c = c->next) {
+                    pb_varint(&sub, loc_base + c->addr);
+                    loc_used[c->addr] = 1;
+                    profile_pprof_sample(&prof, &sub, &values, &msg, 0, c->cycles);
+                }
+            }
+        }
+
+        for (addr = 0; addr < PROFILE_ADDRS; addr++) {
+            if (!loc_used[addr]) {
+                continue;
+            }
+            func = p->owner[addr] ? p->owner[addr] - 1 : addr;
+            func_used[func] = 1;
+            pb_int(&sub, 1, func_base + func);
+            pb_int(&sub, 2, addr);
+            pb_int(&msg, 1, loc_base + addr);
+            pb_int(&msg, 3, addr);
+            pb_message(&msg, 4, &sub);
+            pb_message(&prof, 4, &msg);
+        }
+
+        str_space = profile_strings_add(&st, lib_strdup(_mon_space_strings[p->mem]));
+        for (func = 0; func < PROFILE_FUNCS; func++) {
+            uint64_t str_name;
+            char *name;
+
+            if (!func_used[func]) {
+                continue;
+            }
+            name = profile_func_name(p->mem, func);
+            if (p->mem != e_comp_space) {
+                /* pprof merges functions by name, keep the drives apart */
+                char *tmp = name;
+
+                name = lib_msprintf("%s:%s", mon_memspace_string[p->mem], tmp);
+                lib_free(tmp);
+            }
+            str_name = profile_strings_add(&st, name);
+            pb_int(&msg, 1, func_base + func);
+            pb_int(&msg, 2, str_name);
+            pb_int(&msg, 3, str_name);
+            pb_int(&msg, 4, str_space);
+            pb_int(&msg, 5, func == PROFILE_ROOT ? 0 : func);
+            pb_message(&prof, 5, &msg);
+        }
+    }
+
+    for (j = 0; j < st.num; j++) {
+        pb_bytes(&prof, 6, st.list[j], strlen(st.list[j]));
+        lib_free(st.list[j]);
+    }
+
+    pb_int(&msg, 1, str_cycles);
+    pb_int(&msg, 2, str_count);
+    pb_message(&prof, 11, &msg);
+    pb_int(&prof, 12, (uint64_t)profile_interval);
+
+    result = (fwrite(prof.data, 1, prof.len, fp) == prof.len) ? 0 : -1;
+
+    lib_free(st.list);
+    lib_free(loc_used);
+    lib_free(func_used);
+    lib_free(prof.data);
+    lib_free(msg.data);
+    lib_free(sub.data);
+    lib_free(values.data);
+
+    return result;
+}
+
+/* Write all profiles to `filename', as pprof if it ends in .pb or .pprof,
+   as callgrind otherwise.  */
+static int profile_write(const char *filename)
+{
+    const char *ext = util_get_extension(filename);
+    FILE *fp;
+    int i, result;
+
+    for (i = 0; i < NUM_MEMSPACES; i++) {
+        if (profiles[i] != NULL) {
+            profile_flush(profiles[i]);
+        }
+    }
+
+    fp = fopen(filename, MODE_WRITE);
+    if (fp == NULL) {
+        return -1;
+    }
+    if (ext != NULL && (!util_strcasecmp(ext, "pb") || !util_strcasecmp(ext, "pprof"))) {
+        result = profile_write_pprof(fp);
+    } else {
+        result = profile_write_callgrind(fp);
+    }
+    if (fclose(fp) != 0) {
+        result = -1;
+    }
+    return result;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Monitor commands */
+
+void mon_profile_show(MEMSPACE mem)
+{
+    mon_profile_cpu_t *p;
+    uint32_t top[PROFILE_TOP];
+    unsigned int addr, used = 0;
+    uint32_t func;
+    int num = 0, i;
+
+    if (mem == e_default_space) {
+        mem = default_memspace;
+    }
+
+    if (!profile_enabled) {
+        mon_out("Profiling is off.\n");
+    } else if (!profile_trace && profile_interval <= 0) {
+        mon_out("Profiling is on, but neither tracing nor sampling.\n");
+    } else if (profile_interval <= 0) {
+        mon_out("Profiling is on (tracing).\n");
+    } else {
+        mon_out("Profiling is on (%ssampling every %d cycles).\n",
+                profile_trace ? "tracing, " : "", profile_interval);
+    }
+
+    p = profiles[mem];
+    if (!profile_has_data(p)) {
+        mon_out("No profile data for %s.\n", _mon_space_strings[mem]);
+        return;
+    }
+    profile_flush(p);
+
+    for (addr = 0; addr < PROFILE_ADDRS; addr++) {
+        if (p->owner[addr] || p->sampled[addr]) {
+            used++;
+        }
+    }
+    mon_out("%s: %"PRIu64" cycles, %"PRIu64" instructions, %"PRIu64" samples, %u addresses executed.\n",
+            _mon_space_strings[mem], (uint64_t)p->total_cycles, (uint64_t)p->total_count,
+            (uint64_t)p->total_samples, used);
+
+    if (p->total_count == 0) {
+        /* Sampled only, show the hottest addresses.  */
+        for (addr = 0; addr < PROFILE_ADDRS; addr++) {
+            if (!p->sampled[addr]) {
+                continue;
+            }
+            for (i = num; i > 0 && p->sampled[top[i - 1]] < p->sampled[addr]; i--) {
+                if (i < PROFILE_TOP) {
+                    top[i] = top[i - 1];
+                }
+            }
+            if (i < PROFILE_TOP) {
+                top[i] = addr;
+                if (num < PROFILE_TOP) {
+                    num++;
+                }
+            }
+        }
+        mon_out("   Sampled      %%  Address\n");
+        for (i = 0; i < num; i++) {
+            char *label = mon_symbol_table_lookup_name(mem, (uint16_t)top[i]);
+
+            mon_out("%10"PRIu64" %5.1f%%  $%04x %s\n", (uint64_t)p->sampled[top[i]],
+                    100.0 * (double)p->sampled[top[i]] / (double)p->total_sampled,
+                    top[i], label ? label : "");
+        }
+        return;
+    }
+
+    for (func = 0; func < PROFILE_FUNCS; func++) {
+        if (!p->funcs[func].self) {
+            continue;
+        }
+        for (i = num; i > 0 && p->funcs[top[i - 1]].self < p->funcs[func].self; i--) {
+            if (i < PROFILE_TOP) {
+                top[i] = top[i - 1];
+            }
+        }
+        if (i < PROFILE_TOP) {
+            top[i] = func;
+            if (num < PROFILE_TOP) {
+                num++;
+            }
+        }
+    }
+    mon_out("      Self      %%      Total      %%    Calls  Function\n");
+    for (i = 0; i < num; i++) {
+        profile_func_t *f = &p->funcs[top[i]];
+        char *name = profile_func_name(mem, top[i]);
+
+        mon_out("%10"PRIu64" %5.1f%% %10"PRIu64" %5.1f%% %8"PRIu64"  %s\n",
+                (uint64_t)f->self, 100.0 * (double)f->self / (double)p->total_cycles,
+                (uint64_t)f->total, 100.0 * (double)f->total / (double)p->total_cycles,
+                (uint64_t)f->calls, name);
+        lib_free(name);
+    }
+}
+
+void mon_profile_reset(void)
+{
+    int i;
+
+    for (i = 0; i < NUM_MEMSPACES; i++) {
+        if (profiles[i] != NULL) {
+            profile_clear(profiles[i]);
+        }
+    }
+    mon_out("Profile data cleared.\n");
+}
+
+void mon_profile_save(const char *filename)
+{
+    if (profile_write(filename) < 0) {
+        mon_out("Error writing profile to '%s'.\n", filename);
+    } else {
+        mon_out("Profile written to '%s'.\n", filename);
+    }
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Init/shutdown */
+
+void mon_profile_init(void)
+{
+    profile_ready = 1;
+    profile_update();
+}
+
+void mon_profile_shutdown(void)
+{
+    int i, used = 0;
+
+    for (i = 0; i < NUM_MEMSPACES; i++) {
+        used |= profile_has_data(profiles[i]);
+    }
+    if (used && profile_file != NULL && *profile_file != '\0') {
+        if (profile_write(profile_file) < 0) {
+            log_error(LOG_DEFAULT, "Error writing profile to '%s'.", profile_file);
+        } else {
+            log_message(LOG_DEFAULT, "Profile written to '%s'.", profile_file);
+        }
+    }
+
+    for (i = 0; i < NUM_MEMSPACES; i++) {
+        if (profiles[i] != NULL) {
+            profile_free(profiles[i]);
+            profiles[i] = NULL;
+        }
+    }
+    profile_ready = 0;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Resources/cmdline */
+
+static int set_profile_enabled(int val, void *param)
+{
+    profile_enabled = val ? 1 : 0;
+    profile_update();
+    return 0;
+}
+
+static int set_profile_trace(int val, void *param)
+{
+    profile_trace = val ? 1 : 0;
+    profile_update();
+    return 0;
+}
+
+static int set_profile_interval(int val, void *param)
+{
+    /* 0 means no sampling */
+    if (val < 0) {
+        val = 0;
+    }
+    profile_interval = val;
+    profile_update();
+    return 0;
+}
+
+static int set_profile_file(const char *val, void *param)
+{
+    util_string_set(&profile_file, val);
+    return 0;
+}
+
+static const resource_string_t resources_string[] = {
+    { "MonitorProfileFile", "", RES_EVENT_NO, NULL,
+      &profile_file, set_profile_file, NULL },
+    RESOURCE_STRING_LIST_END
+};
+
+static const resource_int_t resources_int[] = {
+    { "MonitorProfile", 0, RES_EVENT_NO, NULL,
+      &profile_enabled, set_profile_enabled, NULL },
+    { "MonitorProfileTrace", 1, RES_EVENT_NO, NULL,
+      &profile_trace, set_profile_trace, NULL },
+    { "MonitorProfileInterval", 1000, RES_EVENT_NO, NULL,
+      &profile_interval, set_profile_interval, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int mon_profile_resources_init(void)
+{
+    if (resources_register_string(resources_string) < 0) {
+        return -1;
+    }
+    return resources_register_int(resources_int);
+}
+
+void mon_profile_resources_shutdown(void)
+{
+    if (profile_file != NULL) {
+        lib_free(profile_file);
+        profile_file = NULL;
+    }
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-monprofile", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "MonitorProfile", (resource_value_t)1,
+      NULL, "Enable the 6502 profiler" },
+    { "+monprofile", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "MonitorProfile", (resource_value_t)0,
+      NULL, "Disable the 6502 profiler" },
+    { "-monprofiletrace", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "MonitorProfileTrace", (resource_value_t)1,
+      NULL, "Trace every instruction and subroutine call while profiling" },
+    { "+monprofiletrace", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "MonitorProfileTrace", (resource_value_t)0,
+      NULL, "Only sample the program counter while profiling" },
+    { "-monprofileinterval", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "MonitorProfileInterval", NULL,
+      "<cycles>", "Sample the program counter every <cycles> cycles while profiling (0: no sampling)" },
+    { "-monprofilefile", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "MonitorProfileFile", NULL,
+      "<Name>", "Write the profile to <Name> on exit (pprof for .pb/.pprof, callgrind otherwise)" },
+    CMDLINE_LIST_END
+};
+
+int mon_profile_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
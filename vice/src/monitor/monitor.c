@@ -66,6 +66,7 @@
 #include "mon_disassemble.h"
 #include "mon_memmap.h"
 #include "mon_memory.h"
+#include "mon_profile.h"
 #include "asm.h"
 
 #include "mon_parse.h"
@@ -82,6 +83,7 @@
 #include "joyport.h"
 
 #include "resources.h"
+#include "rewind.h"
 #include "screenshot.h"
 #include "sysfile.h"
 #include "traps.h"
@@ -1486,6 +1488,7 @@ void monitor_init(monitor_interface_t *maincpu_interface_init,
     }
 
     mon_memmap_init();
+    mon_profile_init();
 
     /* set the current bank to the CPU bank. we need to do this here since this may not be bank 0 */
     if (mon_interfaces[e_comp_space]->mem_bank_from_name != NULL) {
@@ -1514,6 +1517,8 @@ void monitor_shutdown(void)
         monitor_close(false);
     }
 
+    mon_profile_shutdown();
+
     if (last_cmd) {
         lib_free(last_cmd);
         last_cmd = NULL;
@@ -1685,7 +1690,8 @@ static const resource_int_t resources_int[] = {
 
 int monitor_resources_init(void)
 {
-    if (resources_register_string(resources_string) < 0) {
+    if (resources_register_string(resources_string) < 0
+        || mon_profile_resources_init() < 0) {
         return -1;
     }
     return resources_register_int(resources_int);
@@ -1698,6 +1704,7 @@ void monitor_resources_shutdown(void)
         lib_free(monitorlogfilename);
         monitorlogfilename = NULL;
     }
+    mon_profile_resources_shutdown();
 }
 
 
@@ -1750,6 +1757,9 @@ int monitor_cmdline_options_init(void)
     mon_cart_cmd.cartridge_trigger_freeze = NULL;
     mon_cart_cmd.cartridge_trigger_freeze_nmi_only = NULL;
 
+    if (mon_profile_cmdline_options_init() < 0) {
+        return -1;
+    }
     return cmdline_register_options(cmdline_options);
 }
 
@@ -2645,6 +2655,48 @@ int mon_read_snapshot(const char* name, int even_mode)
     return ret;
 }
 
+int mon_write_snapshot_memory(uint8_t **data, size_t *len, int save_roms, int save_disks, int even_mode)
+{
+    return machine_write_snapshot_memory(data, len, save_roms, save_disks, even_mode);
+}
+
+int mon_read_snapshot_memory(const uint8_t *data, size_t len, int even_mode)
+{
+    int ret;
+
+    ret = machine_read_snapshot_memory(data, len, even_mode);
+
+    /* Reset the current address */
+    dot_addr[e_comp_space] = new_addr(e_comp_space, ((uint16_t)((monitor_cpu_for_memspace[e_comp_space]->mon_register_get_val)(e_comp_space, e_PC))));
+
+    return ret;
+}
+
+void mon_rewind(int count)
+{
+    unsigned int num = rewind_get_num_states();
+
+    if (num == 0) {
+        mon_out("No rewind states available (see the Rewind resource).\n");
+        return;
+    }
+    if (count < 1) {
+        mon_out("Invalid count.\n");
+        return;
+    }
+
+    if (rewind_step_back((unsigned int)count) < 0) {
+        mon_out("Failed to restore the machine state.\n");
+    } else {
+        mon_out("Went back %u state(s), %u left.\n",
+                (unsigned int)count < num ? (unsigned int)count : num,
+                rewind_get_num_states());
+    }
+
+    /* Reset the current address */
+    dot_addr[e_comp_space] = new_addr(e_comp_space, ((uint16_t)((monitor_cpu_for_memspace[e_comp_space]->mon_register_get_val)(e_comp_space, e_PC))));
+}
+
 
 /* *** WATCHPOINTS *** */
 
@@ -55,6 +55,7 @@
 #include "mon_register.h"
 
 #include "version.h"
+#include "video.h"
 
 #ifdef USE_SVN_REVISION
 # include "svnversion.h"
@@ -75,6 +76,7 @@ enum t_binary_command {
 
     e_MON_CMD_MEM_GET = 0x01,
     e_MON_CMD_MEM_SET = 0x02,
+    e_MON_CMD_MEM_GET_RANGES = 0x03,
 
     e_MON_CMD_CHECKPOINT_GET = 0x11,
     e_MON_CMD_CHECKPOINT_SET = 0x12,
@@ -89,6 +91,8 @@ enum t_binary_command {
 
     e_MON_CMD_DUMP = 0x41,
     e_MON_CMD_UNDUMP = 0x42,
+    e_MON_CMD_SNAPSHOT_GET = 0x43,
+    e_MON_CMD_SNAPSHOT_SET = 0x44,
 
     e_MON_CMD_RESOURCE_GET = 0x51,
     e_MON_CMD_RESOURCE_SET = 0x52,
@@ -102,6 +106,8 @@ enum t_binary_command {
     e_MON_CMD_REGISTERS_AVAILABLE = 0x83,
     e_MON_CMD_DISPLAY_GET = 0x84,
     e_MON_CMD_VICE_INFO = 0x85,
+    e_MON_CMD_DISPLAY_STATS = 0x86,
+    e_MON_CMD_BATCH = 0x87,
 
     e_MON_CMD_PALETTE_GET = 0x91,
 
@@ -120,12 +126,14 @@ enum t_binary_response {
     e_MON_RESPONSE_INVALID = 0x00,
     e_MON_RESPONSE_MEM_GET = 0x01,
     e_MON_RESPONSE_MEM_SET = 0x02,
+    e_MON_RESPONSE_MEM_GET_RANGES = 0x03,
 
     e_MON_RESPONSE_CHECKPOINT_INFO = 0x11,
 
     e_MON_RESPONSE_CHECKPOINT_DELETE = 0x13,
     e_MON_RESPONSE_CHECKPOINT_LIST = 0x14,
     e_MON_RESPONSE_CHECKPOINT_TOGGLE = 0x15,
+    e_MON_RESPONSE_CHECKPOINT_STREAM = 0x16,
 
     e_MON_RESPONSE_CONDITION_SET = 0x22,
 
@@ -133,6 +141,8 @@ enum t_binary_response {
 
     e_MON_RESPONSE_DUMP = 0x41,
     e_MON_RESPONSE_UNDUMP = 0x42,
+    e_MON_RESPONSE_SNAPSHOT_GET = 0x43,
+    e_MON_RESPONSE_SNAPSHOT_SET = 0x44,
 
     e_MON_RESPONSE_RESOURCE_GET = 0x51,
     e_MON_RESPONSE_RESOURCE_SET = 0x52,
@@ -150,6 +160,8 @@ enum t_binary_response {
     e_MON_RESPONSE_REGISTERS_AVAILABLE = 0x83,
     e_MON_RESPONSE_DISPLAY_GET = 0x84,
     e_MON_RESPONSE_VICE_INFO = 0x85,
+    e_MON_RESPONSE_DISPLAY_STATS = 0x86,
+    e_MON_RESPONSE_BATCH = 0x87,
 
     e_MON_RESPONSE_PALETTE_GET = 0x91,
 
@@ -265,8 +277,12 @@ static int monitor_binary_data_available(void)
     return available;
 }
 
+static void monitor_binary_stream_flush(void);
+
 void monitor_check_binary(void)
 {
+    monitor_binary_stream_flush();
+
     if (monitor_binary_data_available()) {
         monitor_startup_trap();
     }
@@ -314,6 +330,31 @@ static uint16_t little_endian_to_uint16(unsigned char *input) {
     return (input[1] << 8) + input[0];
 }
 
+/* Largest response bodies of a memory get ranges command and of a batch. */
+#define MEM_GET_RANGES_MAX  0x1000000
+#define BATCH_RESPONSE_MAX  0x10000000
+
+/* Responses of the commands in a batch, collected by monitor_binary_response()
+   and sent together by monitor_binary_process_batch(). */
+static int batch_active = 0;
+static int batch_overflow = 0;
+static unsigned char *batch_buffer = NULL;
+static size_t batch_size = 0;
+static size_t batch_length = 0;
+static uint32_t batch_count = 0;
+
+static void monitor_binary_batch_append(const unsigned char *data, size_t length)
+{
+    if (batch_length + length > batch_size) {
+        while (batch_length + length > batch_size) {
+            batch_size = batch_size ? batch_size * 2 : 4096;
+        }
+        batch_buffer = lib_realloc(batch_buffer, batch_size);
+    }
+    memcpy(batch_buffer + batch_length, data, length);
+    batch_length += length;
+}
+
 static void monitor_binary_response(uint32_t length, BINARY_RESPONSE response_type, BINARY_ERROR errorcode, uint32_t request_id, unsigned char *body)
 {
     unsigned char response[12];
@@ -325,6 +366,20 @@ static void monitor_binary_response(uint32_t length, BINARY_RESPONSE response_ty
     response[7] = (uint8_t)errorcode;
     write_uint32(request_id, &response[8]);
 
+    if (batch_active) {
+        if (batch_overflow
+            || (size_t)length > BATCH_RESPONSE_MAX - sizeof response - batch_length) {
+            batch_overflow = 1;
+            return;
+        }
+        monitor_binary_batch_append(response, sizeof response);
+        if (body != NULL) {
+            monitor_binary_batch_append(body, length);
+        }
+        batch_count++;
+        return;
+    }
+
     monitor_binary_transmit(response, sizeof response);
 
     if (body != NULL) {
@@ -406,6 +461,131 @@ static uint8_t memspace_to_uint8_t(MEMSPACE mem) {
     }
 }
 
+/* *** CHECKPOINT STREAMING *** */
+
+/* Hits of checkpoints with the stream flag don't stop the machine and are
+   not reported one by one. They are queued here and sent as one
+   MON_RESPONSE_CHECKPOINT_STREAM event per frame, or whenever the queue is
+   half full.
+
+   The queue is a single producer, single consumer ring: the head is only
+   advanced by monitor_binary_stream_checkpoint(), the tail only by
+   monitor_binary_stream_flush().  */
+
+#define STREAM_QUEUE_SIZE   4096    /* must be a power of two */
+#define STREAM_QUEUE_MASK   (STREAM_QUEUE_SIZE - 1)
+#define STREAM_ENTRY_SIZE   19
+
+typedef struct stream_entry_s {
+    CLOCK clk;
+    uint32_t checknum;
+    uint16_t pc;
+    uint16_t addr;
+    uint8_t value;
+    uint8_t op;
+    uint8_t memspace;
+} stream_entry_t;
+
+static stream_entry_t stream_queue[STREAM_QUEUE_SIZE];
+static unsigned int stream_head = 0;
+static unsigned int stream_tail = 0;
+
+/* Number of hits lost since the last event because the queue was full.  */
+static uint32_t stream_dropped = 0;
+
+/* Number of entries sent in one event at most.  */
+#define STREAM_BATCH_MAX    (STREAM_QUEUE_SIZE / 2)
+
+static void monitor_binary_stream_flush(void)
+{
+    static unsigned char *body = NULL;
+    unsigned char *p;
+    unsigned int count;
+
+    while (stream_head != stream_tail || stream_dropped > 0) {
+        count = (stream_head - stream_tail) & STREAM_QUEUE_MASK;
+        if (count > STREAM_BATCH_MAX) {
+            count = STREAM_BATCH_MAX;
+        }
+
+        if (connected_socket == NULL) {
+            /* nobody is listening */
+            stream_tail = (stream_tail + count) & STREAM_QUEUE_MASK;
+            stream_dropped = 0;
+            continue;
+        }
+
+        if (body == NULL) {
+            body = lib_malloc(8 + STREAM_BATCH_MAX * STREAM_ENTRY_SIZE);
+        }
+
+        p = write_uint32(count, body);
+        p = write_uint32(stream_dropped, p);
+        stream_dropped = 0;
+
+        while (count-- > 0) {
+            stream_entry_t *e = &stream_queue[stream_tail];
+
+            p = write_uint32(e->checknum, p);
+            p = write_uint32((uint32_t)e->clk, p);
+            p = write_uint32((uint32_t)((uint64_t)e->clk >> 32), p);
+            p = write_uint16(e->pc, p);
+            p = write_uint16(e->addr, p);
+            *p++ = e->value;
+            *p++ = e->op;
+            *p++ = memspace_to_uint8_t((MEMSPACE)e->memspace);
+
+            stream_tail = (stream_tail + 1) & STREAM_QUEUE_MASK;
+        }
+
+        monitor_binary_response((uint32_t)(p - body), e_MON_RESPONSE_CHECKPOINT_STREAM,
+                                e_MON_ERR_OK, MON_EVENT_ID, body);
+    }
+}
+
+/*! \internal \brief Queue a hit of a streamed checkpoint.
+
+ \param checkpt The checkpoint
+
+ \param mem Memspace of the access
+
+ \param addr The address accessed (or executed)
+
+ \param pc Address of the instruction that did the access
+*/
+void monitor_binary_stream_checkpoint(mon_checkpoint_t *checkpt, MEMSPACE mem,
+                                      uint16_t addr, uint16_t pc, MEMORY_OP op)
+{
+    stream_entry_t *e;
+    unsigned int next = (stream_head + 1) & STREAM_QUEUE_MASK;
+    int bank = 0;
+
+    if (next == stream_tail) {
+        stream_dropped++;
+        return;
+    }
+
+    e = &stream_queue[stream_head];
+    e->clk = mon_interfaces[mem]->clk != NULL ? *mon_interfaces[mem]->clk : 0;
+    e->checknum = (uint32_t)checkpt->checknum;
+    e->pc = pc;
+    e->addr = addr;
+    e->op = (uint8_t)op;
+    e->memspace = (uint8_t)mem;
+
+    /* the value as seen by the CPU, after a store */
+    if (mon_interfaces[mem]->mem_bank_from_name != NULL) {
+        bank = mon_interfaces[mem]->mem_bank_from_name("cpu");
+    }
+    e->value = mon_get_mem_val_ex_nosfx(mem, bank, addr);
+
+    stream_head = next;
+
+    if (((stream_head - stream_tail) & STREAM_QUEUE_MASK) >= STREAM_BATCH_MAX) {
+        monitor_binary_stream_flush();
+    }
+}
+
 static void monitor_binary_response_register_info(uint32_t request_id, MEMSPACE memspace)
 {
     mon_reg_list_t *regs;
@@ -454,6 +634,9 @@ static void monitor_binary_response_register_info(uint32_t request_id, MEMSPACE
 
 /*! \internal \brief called when the monitor is opened */
 void monitor_binary_event_opened(void) {
+    /* report the streamed hits up to here first */
+    monitor_binary_stream_flush();
+
     /* FIXME */
     monitor_binary_response_register_info(MON_EVENT_ID, e_comp_space);
     monitor_binary_response_stopped(MON_EVENT_ID);
@@ -473,7 +656,7 @@ void monitor_binary_event_closed(void) {
  \param hit Is the checkpoint hit in the emulator?
 */
 void monitor_binary_response_checkpoint_info(uint32_t request_id, mon_checkpoint_t *checkpt, bool hit) {
-    unsigned char response[23];
+    unsigned char response[24];
     MEMORY_OP op = (MEMORY_OP)(
         (checkpt->check_store ? e_store : 0)
         | (checkpt->check_load ? e_load : 0)
@@ -494,6 +677,7 @@ void monitor_binary_response_checkpoint_info(uint32_t request_id, mon_checkpoint
     write_uint32((uint32_t)checkpt->ignore_count, &response[17]);
     response[21] = !!checkpt->condition;
     response[22] = memspace_to_uint8_t(addr_memspace(checkpt->start_addr));
+    response[23] = checkpt->stream;
 
     monitor_binary_response(sizeof (response), e_MON_RESPONSE_CHECKPOINT_INFO, e_MON_ERR_OK, request_id, response);
 }
@@ -561,6 +745,10 @@ static void monitor_binary_process_checkpoint_set(binary_command_t *command)
 
     checkpt = mon_breakpoint_find_checkpoint(brknum);
 
+    if (command->length >= 10) {
+        checkpt->stream = (bool)body[9];
+    }
+
     monitor_binary_response_checkpoint_info(command->request_id, checkpt, 0);
 }
 
@@ -882,6 +1070,53 @@ static void monitor_binary_process_undump(binary_command_t *command)
     monitor_binary_response(sizeof response, e_MON_RESPONSE_UNDUMP, e_MON_ERR_OK, command->request_id, response);
 }
 
+static void monitor_binary_process_snapshot_get(binary_command_t *command)
+{
+    unsigned char *body = command->body;
+    uint8_t save_roms;
+    uint8_t save_disks;
+    uint8_t *data = NULL;
+    size_t len = 0;
+
+    if (command->length < 2) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    save_roms = !!body[0];
+    save_disks = !!body[1];
+
+    if (mon_write_snapshot_memory(&data, &len, (int)save_roms, (int)save_disks, 0) < 0
+        || len > UINT32_MAX) {
+        lib_free(data);
+        monitor_binary_error(e_MON_ERR_CMD_FAILURE, command->request_id);
+        return;
+    }
+
+    /* the snapshot buffer is sent as is, without another copy */
+    monitor_binary_response((uint32_t)len, e_MON_RESPONSE_SNAPSHOT_GET, e_MON_ERR_OK, command->request_id, data);
+
+    lib_free(data);
+}
+
+static void monitor_binary_process_snapshot_set(binary_command_t *command)
+{
+    unsigned char response[2];
+    uint16_t addr;
+
+    /* the snapshot is read directly from the command buffer */
+    if (mon_read_snapshot_memory(command->body, command->length, 0) < 0) {
+        monitor_binary_error(e_MON_ERR_CMD_FAILURE, command->request_id);
+        return;
+    }
+
+    addr = ((uint16_t)((monitor_cpu_for_memspace[e_comp_space]->mon_register_get_val)(e_comp_space, e_PC)));
+
+    write_uint16(addr, response);
+
+    monitor_binary_response(sizeof response, e_MON_RESPONSE_SNAPSHOT_SET, e_MON_ERR_OK, command->request_id, response);
+}
+
 static void monitor_binary_process_resource_get(binary_command_t *command)
 {
     unsigned char* response;
@@ -1403,6 +1638,45 @@ static void monitor_binary_process_vice_info(binary_command_t *command)
     monitor_binary_response(sizeof(response), e_MON_RESPONSE_VICE_INFO, e_MON_ERR_OK, command->request_id, response);
 }
 
+static void monitor_binary_process_display_stats(binary_command_t *command)
+{
+    video_render_queue_stats_t stats;
+    struct video_canvas_s *canvas;
+    unsigned char response[32];
+    unsigned char *response_cursor = response;
+
+    uint8_t use_vic;
+
+    if (command->length < 1) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    use_vic = !!command->body[0];
+
+    if (machine_class == VICE_MACHINE_C128 && use_vic) {
+        canvas = machine_video_canvas_get(1);
+    } else {
+        canvas = machine_video_canvas_get(0);
+    }
+
+    if (canvas == NULL || video_canvas_get_render_queue_stats(canvas, &stats) < 0) {
+        monitor_binary_error(e_MON_ERR_CMD_FAILURE, command->request_id);
+        return;
+    }
+
+    response_cursor = write_uint32(stats.depth, response_cursor);
+    response_cursor = write_uint32(stats.length, response_cursor);
+    response_cursor = write_uint32(stats.frames_queued, response_cursor);
+    response_cursor = write_uint32(stats.frames_displayed, response_cursor);
+    response_cursor = write_uint32(stats.frames_dropped, response_cursor);
+    response_cursor = write_uint32(stats.latency_avg_us, response_cursor);
+    response_cursor = write_uint32(stats.latency_max_us, response_cursor);
+    response_cursor = write_uint32(stats.wait_ms, response_cursor);
+
+    monitor_binary_response(sizeof(response), e_MON_RESPONSE_DISPLAY_STATS, e_MON_ERR_OK, command->request_id, response);
+}
+
 static void monitor_binary_process_mem_get(binary_command_t *command)
 {
     unsigned char *response;
@@ -1471,6 +1745,94 @@ static void monitor_binary_process_mem_get(binary_command_t *command)
     lib_free(response);
 }
 
+static void monitor_binary_process_mem_get_ranges(binary_command_t *command)
+{
+    unsigned char *response;
+    unsigned char *response_cursor;
+
+    size_t response_size = 2;
+    int old_sidefx = sidefx;
+    MEMSPACE memspace = e_default_space;
+    unsigned int i;
+
+    unsigned char *body = command->body;
+    unsigned char *range;
+
+    uint8_t new_sidefx;
+    uint8_t requested_memspace;
+    uint16_t requested_banknum;
+    uint16_t count;
+
+    if (command->length < 6) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    new_sidefx = body[0];
+    requested_memspace = body[1];
+    requested_banknum = little_endian_to_uint16(&body[2]);
+    count = little_endian_to_uint16(&body[4]);
+
+    if (command->length < 6 + count * 4u) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    memspace = get_requested_memspace(requested_memspace);
+
+    if(memspace == e_invalid_space) {
+        monitor_binary_error(e_MON_ERR_INVALID_MEMSPACE, command->request_id);
+        log_message(LOG_DEFAULT, "monitor binary memget ranges: Unknown memspace %u", requested_memspace);
+        return;
+    }
+
+    if (mon_banknum_validate(memspace, requested_banknum) == 0) {
+        monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+        log_message(LOG_DEFAULT, "monitor binary memget ranges: Unknown bank %u", requested_banknum);
+        return;
+    }
+
+    for (i = 0, range = &body[6]; i < count; i++, range += 4) {
+        uint16_t startaddress = little_endian_to_uint16(&range[0]);
+        uint16_t endaddress = little_endian_to_uint16(&range[2]);
+
+        if (startaddress > endaddress) {
+            monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+            log_message(LOG_DEFAULT, "monitor binary memget ranges: wrong start and/or end address %04x - %04x",
+                        startaddress, endaddress);
+            return;
+        }
+        response_size += 2 + (endaddress - startaddress + 1);
+        if (response_size > MEM_GET_RANGES_MAX) {
+            monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+            log_message(LOG_DEFAULT, "monitor binary memget ranges: response larger than %u bytes",
+                        (unsigned int)MEM_GET_RANGES_MAX);
+            return;
+        }
+    }
+
+    response = lib_malloc(response_size);
+    response_cursor = response;
+
+    response_cursor = write_uint16(count, response_cursor);
+
+    sidefx = !!new_sidefx;
+    for (i = 0, range = &body[6]; i < count; i++, range += 4) {
+        uint16_t startaddress = little_endian_to_uint16(&range[0]);
+        uint16_t endaddress = little_endian_to_uint16(&range[2]);
+        uint32_t length = endaddress - startaddress + 1;
+
+        response_cursor = write_uint16(length, response_cursor);
+        mon_get_mem_block_ex(memspace, requested_banknum, startaddress, endaddress - startaddress, response_cursor);
+        response_cursor += length;
+    }
+    sidefx = old_sidefx;
+
+    monitor_binary_response((uint32_t)response_size, e_MON_RESPONSE_MEM_GET_RANGES, e_MON_ERR_OK, command->request_id, response);
+
+    lib_free(response);
+}
+
 static void monitor_binary_process_mem_set(binary_command_t *command)
 {
     unsigned int i;
@@ -1530,108 +1892,199 @@ static void monitor_binary_process_mem_set(binary_command_t *command)
 }
 
 
-static void monitor_binary_process_command(unsigned char * pbuffer)
+static void monitor_binary_process_batch(binary_command_t *command);
+
+static void monitor_binary_execute_command(binary_command_t *command)
 {
     BINARY_COMMAND command_type;
-    binary_command_t command;
-
-    command.api_version = (uint8_t)pbuffer[1];
-
-    command.request_id = little_endian_to_uint32(&pbuffer[6]);
-
-    if (command.api_version < 0x01 || command.api_version > 0x02) {
-        monitor_binary_error(e_MON_ERR_CMD_INVALID_API_VERSION, command.request_id);
-        return;
-    }
-
-    /* Ensure drive CPU emulation is up to date with main cpu CLOCK. */
-    drive_cpu_execute_all(maincpu_clk);
 
-    command.length = little_endian_to_uint32(&pbuffer[2]);
-
-    command.type = pbuffer[10];
-    command.body = &pbuffer[11];
-
-    command_type = command.type;
+    command_type = command->type;
     if (command_type == e_MON_CMD_PING) {
-        monitor_binary_process_ping(&command);
+        monitor_binary_process_ping(command);
 
     } else if (command_type == e_MON_CMD_MEM_GET) {
-        monitor_binary_process_mem_get(&command);
+        monitor_binary_process_mem_get(command);
     } else if (command_type == e_MON_CMD_MEM_SET) {
-        monitor_binary_process_mem_set(&command);
+        monitor_binary_process_mem_set(command);
+    } else if (command_type == e_MON_CMD_MEM_GET_RANGES) {
+        monitor_binary_process_mem_get_ranges(command);
 
     } else if (command_type == e_MON_CMD_CHECKPOINT_GET) {
-        monitor_binary_process_checkpoint_get(&command);
+        monitor_binary_process_checkpoint_get(command);
     } else if (command_type == e_MON_CMD_CHECKPOINT_SET) {
-        monitor_binary_process_checkpoint_set(&command);
+        monitor_binary_process_checkpoint_set(command);
     } else if (command_type == e_MON_CMD_CHECKPOINT_DELETE) {
-        monitor_binary_process_checkpoint_delete(&command);
+        monitor_binary_process_checkpoint_delete(command);
     } else if (command_type == e_MON_CMD_CHECKPOINT_LIST) {
-        monitor_binary_process_checkpoint_list(&command);
+        monitor_binary_process_checkpoint_list(command);
     } else if (command_type == e_MON_CMD_CHECKPOINT_TOGGLE) {
-        monitor_binary_process_checkpoint_toggle(&command);
+        monitor_binary_process_checkpoint_toggle(command);
 
     } else if (command_type == e_MON_CMD_CONDITION_SET) {
-        monitor_binary_process_condition_set(&command);
+        monitor_binary_process_condition_set(command);
 
     } else if (command_type == e_MON_CMD_REGISTERS_GET) {
-        monitor_binary_process_registers_get(&command);
+        monitor_binary_process_registers_get(command);
     } else if (command_type == e_MON_CMD_REGISTERS_SET) {
-        monitor_binary_process_registers_set(&command);
+        monitor_binary_process_registers_set(command);
 
     } else if (command_type == e_MON_CMD_DUMP) {
-        monitor_binary_process_dump(&command);
+        monitor_binary_process_dump(command);
     } else if (command_type == e_MON_CMD_UNDUMP) {
-        monitor_binary_process_undump(&command);
+        monitor_binary_process_undump(command);
+    } else if (command_type == e_MON_CMD_SNAPSHOT_GET) {
+        monitor_binary_process_snapshot_get(command);
+    } else if (command_type == e_MON_CMD_SNAPSHOT_SET) {
+        monitor_binary_process_snapshot_set(command);
 
     } else if (command_type == e_MON_CMD_RESOURCE_GET) {
-        monitor_binary_process_resource_get(&command);
+        monitor_binary_process_resource_get(command);
     } else if (command_type == e_MON_CMD_RESOURCE_SET) {
-        monitor_binary_process_resource_set(&command);
+        monitor_binary_process_resource_set(command);
 
     } else if (command_type == e_MON_CMD_ADVANCE_INSTRUCTIONS) {
-        monitor_binary_process_advance_instructions(&command);
+        monitor_binary_process_advance_instructions(command);
     } else if (command_type == e_MON_CMD_KEYBOARD_FEED) {
-        monitor_binary_process_keyboard_feed(&command);
+        monitor_binary_process_keyboard_feed(command);
     } else if (command_type == e_MON_CMD_EXECUTE_UNTIL_RETURN) {
-        monitor_binary_process_execute_until_return(&command);
+        monitor_binary_process_execute_until_return(command);
 
     } else if (command_type == e_MON_CMD_PALETTE_GET) {
-        monitor_binary_process_palette_get(&command);
+        monitor_binary_process_palette_get(command);
 
     } else if (command_type == e_MON_CMD_JOYPORT_SET) {
-        monitor_binary_process_joyport_set(&command);
+        monitor_binary_process_joyport_set(command);
 
     } else if (command_type == e_MON_CMD_USERPORT_SET) {
-        monitor_binary_process_userport_set(&command);
+        monitor_binary_process_userport_set(command);
 
     } else if (command_type == e_MON_CMD_BANKS_AVAILABLE) {
-        monitor_binary_process_banks_available(&command);
+        monitor_binary_process_banks_available(command);
     } else if (command_type == e_MON_CMD_REGISTERS_AVAILABLE) {
-        monitor_binary_process_registers_available(&command);
+        monitor_binary_process_registers_available(command);
     } else if (command_type == e_MON_CMD_DISPLAY_GET) {
-        monitor_binary_process_display_get(&command);
+        monitor_binary_process_display_get(command);
     } else if (command_type == e_MON_CMD_VICE_INFO) {
-        monitor_binary_process_vice_info(&command);
+        monitor_binary_process_vice_info(command);
+    } else if (command_type == e_MON_CMD_DISPLAY_STATS) {
+        monitor_binary_process_display_stats(command);
+    } else if (command_type == e_MON_CMD_BATCH) {
+        monitor_binary_process_batch(command);
 
     } else if (command_type == e_MON_CMD_EXIT) {
-        monitor_binary_process_exit(&command);
+        monitor_binary_process_exit(command);
     } else if (command_type == e_MON_CMD_QUIT) {
-        monitor_binary_process_quit(&command);
+        monitor_binary_process_quit(command);
     } else if (command_type == e_MON_CMD_RESET) {
-        monitor_binary_process_reset(&command);
+        monitor_binary_process_reset(command);
     } else if (command_type == e_MON_CMD_AUTOSTART) {
-        monitor_binary_process_autostart(&command);
+        monitor_binary_process_autostart(command);
 
     } else {
-        monitor_binary_error(e_MON_ERR_CMD_INVALID_TYPE, command.request_id);
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_TYPE, command->request_id);
         log_message(LOG_DEFAULT,
                 "monitor_network binary command: unknown command %u, "
                 "skipping command length of %u",
-                command.type, command.length);
+                command->type, command->length);
+    }
+}
+
+/* Commands that may run in a batch. Everything that resumes the machine or
+   leaves the monitor is excluded, so the whole batch sees the same state. */
+static int monitor_binary_batch_allowed(BINARY_COMMAND command_type)
+{
+    switch (command_type) {
+        case e_MON_CMD_ADVANCE_INSTRUCTIONS:
+        case e_MON_CMD_EXECUTE_UNTIL_RETURN:
+        case e_MON_CMD_EXIT:
+        case e_MON_CMD_QUIT:
+        case e_MON_CMD_RESET:
+        case e_MON_CMD_AUTOSTART:
+        case e_MON_CMD_BATCH:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+static void monitor_binary_process_batch(binary_command_t *command)
+{
+    unsigned char *body = command->body;
+    binary_command_t sub;
+    uint32_t offset, length;
+
+    /* check all commands first, a broken batch does not run at all */
+    for (offset = 0; offset < command->length; offset += 9 + length) {
+        if (command->length - offset < 9) {
+            monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+            return;
+        }
+        length = little_endian_to_uint32(&body[offset]);
+        if (length > command->length - offset - 9) {
+            monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+            return;
+        }
+        if (!monitor_binary_batch_allowed(body[offset + 8])) {
+            monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+            log_message(LOG_DEFAULT, "monitor binary batch: command %u not allowed in a batch",
+                        body[offset + 8]);
+            return;
+        }
+    }
+
+    batch_active = 1;
+    batch_overflow = 0;
+    batch_length = 0;
+    batch_count = 0;
+    monitor_binary_batch_append((const unsigned char *)"\0\0\0\0", 4);
+
+    /* stop at the first response that does not fit any more */
+    for (offset = 0; offset < command->length && !batch_overflow; offset += 9 + sub.length) {
+        sub.api_version = command->api_version;
+        sub.length = little_endian_to_uint32(&body[offset]);
+        sub.request_id = little_endian_to_uint32(&body[offset + 4]);
+        sub.type = body[offset + 8];
+        sub.body = &body[offset + 9];
+
+        monitor_binary_execute_command(&sub);
     }
 
+    batch_active = 0;
+    if (batch_overflow) {
+        batch_overflow = 0;
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        log_message(LOG_DEFAULT, "monitor binary batch: responses larger than %u bytes",
+                    (unsigned int)BATCH_RESPONSE_MAX);
+        return;
+    }
+    write_uint32(batch_count, batch_buffer);
+
+    monitor_binary_response((uint32_t)batch_length, e_MON_RESPONSE_BATCH, e_MON_ERR_OK, command->request_id, batch_buffer);
+}
+
+static void monitor_binary_process_command(unsigned char * pbuffer)
+{
+    binary_command_t command;
+
+    command.api_version = (uint8_t)pbuffer[1];
+
+    command.request_id = little_endian_to_uint32(&pbuffer[6]);
+
+    if (command.api_version < 0x01 || command.api_version > 0x02) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_API_VERSION, command.request_id);
+        return;
+    }
+
+    /* Ensure drive CPU emulation is up to date with main cpu CLOCK. */
+    drive_cpu_execute_all(maincpu_clk);
+
+    command.length = little_endian_to_uint32(&pbuffer[2]);
+
+    command.type = pbuffer[10];
+    command.body = &pbuffer[11];
+
+    monitor_binary_execute_command(&command);
+
     pbuffer[0] = 0;
 }
 
@@ -1860,6 +2313,9 @@ void monitor_binary_resources_shutdown(void)
     monitor_binary_quit();
 
     lib_free(monitor_binary_server_address);
+    lib_free(batch_buffer);
+    batch_buffer = NULL;
+    batch_size = 0;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -1948,4 +2404,8 @@ ui_jam_action_t monitor_binary_ui_jam_dialog(const char *format, ...)
 void monitor_binary_response_checkpoint_info(uint32_t request_id, mon_checkpoint_t *checkpt, bool hit) {
 }
 
+void monitor_binary_stream_checkpoint(mon_checkpoint_t *checkpt, MEMSPACE mem,
+                                      uint16_t addr, uint16_t pc, MEMORY_OP op) {
+}
+
 #endif
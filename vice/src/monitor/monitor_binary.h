@@ -41,6 +41,8 @@ extern int monitor_binary_cmdline_options_init(void);
 extern void monitor_binary_response_checkpoint_info(uint32_t request_id, mon_checkpoint_t *checkpt, bool hit);
 extern void monitor_binary_event_opened(void);
 extern void monitor_binary_event_closed(void);
+extern void monitor_binary_stream_checkpoint(mon_checkpoint_t *checkpt, MEMSPACE mem,
+                                             uint16_t addr, uint16_t pc, MEMORY_OP op);
 
 extern void monitor_check_binary(void);
 
@@ -300,6 +300,9 @@ extern void mon_delete_conditional(cond_node_t *cnode);
 extern int mon_evaluate_conditional(cond_node_t *cnode);
 extern int mon_write_snapshot(const char* name, int save_roms, int save_disks, int even_mode);
 extern int mon_read_snapshot(const char* name, int even_mode);
+extern int mon_write_snapshot_memory(uint8_t **data, size_t *len, int save_roms, int save_disks, int even_mode);
+extern int mon_read_snapshot_memory(const uint8_t *data, size_t len, int even_mode);
+extern void mon_rewind(int count);
 extern bool mon_is_valid_addr(MON_ADDR a);
 extern bool mon_is_in_range(MON_ADDR start_addr, MON_ADDR end_addr,
                             unsigned loc);
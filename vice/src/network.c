@@ -50,6 +50,7 @@
 #include "mos6510.h"
 #include "network.h"
 #include "resources.h"
+#include "snapshot.h"
 #include "types.h"
 #include "uiapi.h"
 #include "util.h"
@@ -90,6 +91,57 @@ static int current_frame, frame_to_play;
 static event_list_state_t *frame_event_list = NULL;
 static char *snapshotfilename;
 
+/* Rollback mode: local events are played back in the frame they were made,
+   the remote events of frames that did not arrive yet are predicted to be
+   empty. The machine state is kept for every frame that is not confirmed
+   by the remote host; when a prediction turns out wrong, the emulation
+   goes back to the state of that frame and re-simulates the frames since
+   then in warp mode.  */
+static int rollback_enabled;
+static int rollback_frames;
+
+/* Artificial latency and jitter added to the rollback packets we send, for
+   testing over loopback. A jitter larger than the frame time reorders the
+   packets.  */
+static int test_latency;
+static int test_jitter;
+
+typedef struct rollback_frame_s {
+    int frame;                  /* frame using this slot, -1 if unused */
+    event_list_state_t local;   /* events recorded here during the frame */
+    event_list_state_t *remote; /* events of the remote host, if received */
+    int remote_applied;         /* remote events were played back */
+    uint8_t *state;             /* machine state at the frame boundary */
+    size_t state_len;
+    uint32_t regs[5];           /* CPU registers there, for the sync test */
+} rollback_frame_t;
+
+typedef struct rollback_packet_s {
+    tick_t release;
+    uint8_t *buf;
+    int len;
+    struct rollback_packet_s *next;
+} rollback_packet_t;
+
+static int rollback_active = 0;
+static rollback_frame_t *rollback_slots = NULL;
+static int rollback_num_slots;
+static int rollback_record_frame;     /* frame the local events go to */
+static int rollback_boundary;         /* next frame boundary to process */
+static int rollback_remote_frame;     /* all remote frames up to here arrived */
+static int rollback_mispredicted;     /* earliest wrong frame, or -1 */
+static int rollback_replay_until;     /* last frame to re-simulate, or -1 */
+static int rollback_warp_saved;
+static int rollback_check_frame;      /* remote sync test waiting, or -1 */
+static uint32_t rollback_check_regs[5];
+static rollback_packet_t *rollback_send_queue = NULL;
+static uint32_t rollback_jitter_seed;
+
+/* Statistics, reported on disconnect.  */
+static unsigned long rollback_num_rollbacks;
+static unsigned long rollback_num_replayed;
+static unsigned long rollback_num_stalls;
+
 static int set_server_name(const char *val, void *param)
 {
     util_string_set(&server_name, val);
@@ -125,6 +177,40 @@ static int set_network_control(int val, void *param)
     return 0;
 }
 
+static int set_rollback_enabled(int val, void *param)
+{
+    /* only takes effect on the next connection */
+    rollback_enabled = val ? 1 : 0;
+    return 0;
+}
+
+static int set_rollback_frames(int val, void *param)
+{
+    if (val < 1 || val > 120) {
+        return -1;
+    }
+    rollback_frames = val;
+    return 0;
+}
+
+static int set_test_latency(int val, void *param)
+{
+    if (val < 0 || val > 10000) {
+        return -1;
+    }
+    test_latency = val;
+    return 0;
+}
+
+static int set_test_jitter(int val, void *param)
+{
+    if (val < 0 || val > 10000) {
+        return -1;
+    }
+    test_jitter = val;
+    return 0;
+}
+
 /*---------- Resources ------------------------------------------------*/
 
 static const resource_string_t resources_string[] = {
@@ -140,6 +226,14 @@ static const resource_int_t resources_int[] = {
       &res_server_port, set_server_port, NULL },
     { "NetworkControl", NETWORK_CONTROL_DEFAULT, RES_EVENT_SAME, NULL,
       &network_control, set_network_control, NULL },
+    { "NetworkRollback", 0, RES_EVENT_SAME, NULL,
+      &rollback_enabled, set_rollback_enabled, NULL },
+    { "NetworkRollbackFrames", 8, RES_EVENT_SAME, NULL,
+      &rollback_frames, set_rollback_frames, NULL },
+    { "NetworkTestLatency", 0, RES_EVENT_NO, NULL,
+      &test_latency, set_test_latency, NULL },
+    { "NetworkTestJitter", 0, RES_EVENT_NO, NULL,
+      &test_jitter, set_test_jitter, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -224,6 +318,21 @@ static const cmdline_option_t cmdline_options[] =
     { "-netplayctrl", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
       network_control_cmd, NULL, NULL, NULL,
       "<key,joy1,joy2,dev,rsrc>", "Set the netplay control elements (keyboard, joystick1, joystick2, devices and resources), each item takes a value (0: None, 1: Server, 2: Client, 3: Both)" },
+    { "-netplayrollback", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "NetworkRollback", (resource_value_t)1,
+      NULL, "Enable rollback netplay (the server setting is used)" },
+    { "+netplayrollback", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "NetworkRollback", (resource_value_t)0,
+      NULL, "Disable rollback netplay, run in lockstep" },
+    { "-netplayrollbackframes", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "NetworkRollbackFrames", NULL,
+      "<frames>", "Set how many frames rollback netplay may run ahead of the remote host" },
+    { "-netplaylatency", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "NetworkTestLatency", NULL,
+      "<ms>", "Delay sent rollback netplay packets by <ms> milliseconds (for testing)" },
+    { "-netplayjitter", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "NetworkTestJitter", NULL,
+      "<ms>", "Delay sent rollback netplay packets by up to <ms> more milliseconds, reordering them (for testing)" },
     CMDLINE_LIST_END
 };
 
@@ -485,6 +594,452 @@ exiterror:
     return ret;
 }
 
+/*-------------------------------------------------------------------------*/
+/* Rollback mode.
+
+   Each packet carries the events of one frame:
+
+     frame number (4), sync test frame (4), sync test registers (5 * 4),
+     event buffer
+
+   At the end of frame F the local events of F are sent and the frame
+   boundary B(F) is processed in a trap, between two instructions: the
+   machine state is saved and the events of F are played back, server
+   first. Remote events of F that did not arrive yet are predicted to be
+   empty, which means the remote host did not change its input. If they
+   arrive later and are not empty, the next boundary restores the state
+   saved at B(F) instead, plays back the real events and re-simulates the
+   frames up to the present in warp mode.
+
+   The sync test compares the CPU registers at a boundary once both hosts
+   got all events before it.  */
+
+#define ROLLBACK_HEADER_SIZE (2 * 4 + 5 * 4)
+
+static rollback_frame_t *network_rollback_slot(int frame)
+{
+    rollback_frame_t *slot = &rollback_slots[frame % rollback_num_slots];
+
+    if (slot->frame != frame) {
+        event_clear_list(&slot->local);
+        event_register_event_list(&slot->local);
+        if (slot->remote != NULL) {
+            event_clear_list(slot->remote);
+            lib_free(slot->remote);
+            slot->remote = NULL;
+        }
+        lib_free(slot->state);
+        slot->state = NULL;
+        slot->state_len = 0;
+        slot->remote_applied = 0;
+        slot->frame = frame;
+    }
+    return slot;
+}
+
+static void network_rollback_start(void)
+{
+    int i;
+
+    rollback_num_slots = 2 * rollback_frames + 8;
+    rollback_slots = lib_calloc((size_t)rollback_num_slots, sizeof(rollback_frame_t));
+    for (i = 0; i < rollback_num_slots; i++) {
+        rollback_slots[i].frame = -1;
+    }
+
+    rollback_record_frame = 0;
+    rollback_boundary = 0;
+    rollback_remote_frame = -1;
+    rollback_mispredicted = -1;
+    rollback_replay_until = -1;
+    rollback_check_frame = -1;
+    rollback_num_rollbacks = 0;
+    rollback_num_replayed = 0;
+    rollback_num_stalls = 0;
+    rollback_jitter_seed = (uint32_t)tick_now() | 1;
+
+    network_rollback_slot(0);
+    event_init_image_list();
+    rollback_active = 1;
+
+    log_message(LOG_DEFAULT, "Netplay: rollback mode, up to %d frames ahead.",
+                rollback_frames);
+    ui_display_statustext("Using rollback netplay.", 1);
+}
+
+static void network_rollback_stop(void)
+{
+    rollback_packet_t *packet;
+    int i;
+
+    if (!rollback_active) {
+        return;
+    }
+    rollback_active = 0;
+
+    if (rollback_replay_until >= 0) {
+        vsync_set_warp_mode(rollback_warp_saved);
+        rollback_replay_until = -1;
+    }
+
+    while (rollback_send_queue != NULL) {
+        packet = rollback_send_queue;
+        rollback_send_queue = packet->next;
+        lib_free(packet->buf);
+        lib_free(packet);
+    }
+
+    for (i = 0; i < rollback_num_slots; i++) {
+        event_clear_list(&rollback_slots[i].local);
+        if (rollback_slots[i].remote != NULL) {
+            event_clear_list(rollback_slots[i].remote);
+            lib_free(rollback_slots[i].remote);
+        }
+        lib_free(rollback_slots[i].state);
+    }
+    lib_free(rollback_slots);
+    rollback_slots = NULL;
+    event_destroy_image_list();
+
+    log_message(LOG_DEFAULT, "Netplay: %lu rollbacks, %lu frames re-simulated, %lu stalls.",
+                rollback_num_rollbacks, rollback_num_replayed, rollback_num_stalls);
+}
+
+/* Frames up to here have a correct state at their boundary.  */
+static int network_rollback_checkable_frame(void)
+{
+    int frame = rollback_remote_frame + 1;
+
+    if (rollback_mispredicted >= 0) {
+        return rollback_mispredicted;
+    }
+    return frame < rollback_boundary ? frame : rollback_boundary - 1;
+}
+
+static int network_rollback_send_now(const uint8_t *buf, int len)
+{
+    uint8_t len4[4];
+
+    util_int_to_le_buf4(len4, len);
+    if (network_send_buffer(network_socket, len4, 4) < 0
+        || network_send_buffer(network_socket, buf, len) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Send the queued packets that are due.  */
+static int network_rollback_flush(void)
+{
+    rollback_packet_t *packet;
+    tick_t now = tick_now();
+    int ret = 0;
+
+    while (rollback_send_queue != NULL
+           && (int32_t)(now - rollback_send_queue->release) >= 0) {
+        packet = rollback_send_queue;
+        rollback_send_queue = packet->next;
+        if (ret == 0) {
+            ret = network_rollback_send_now(packet->buf, packet->len);
+        }
+        lib_free(packet->buf);
+        lib_free(packet);
+    }
+    return ret;
+}
+
+/* Send a packet, or queue it if artificial latency is set. Takes `buf'.  */
+static int network_rollback_send(uint8_t *buf, int len)
+{
+    rollback_packet_t *packet, **prev;
+    tick_t delay;
+    int ret;
+
+    if (test_latency == 0 && test_jitter == 0) {
+        ret = network_rollback_send_now(buf, len);
+        lib_free(buf);
+        return ret;
+    }
+
+    delay = (tick_t)test_latency;
+    if (test_jitter > 0) {
+        rollback_jitter_seed ^= rollback_jitter_seed << 13;
+        rollback_jitter_seed ^= rollback_jitter_seed >> 17;
+        rollback_jitter_seed ^= rollback_jitter_seed << 5;
+        delay += rollback_jitter_seed % (uint32_t)(test_jitter + 1);
+    }
+
+    packet = lib_malloc(sizeof(rollback_packet_t));
+    packet->release = tick_now() + delay * (tick_per_second() / 1000);
+    packet->buf = buf;
+    packet->len = len;
+
+    /* keep the queue sorted by release time */
+    prev = &rollback_send_queue;
+    while (*prev != NULL && (int32_t)(packet->release - (*prev)->release) >= 0) {
+        prev = &(*prev)->next;
+    }
+    packet->next = *prev;
+    *prev = packet;
+
+    return network_rollback_flush();
+}
+
+static int network_rollback_send_frame(int frame)
+{
+    rollback_frame_t *slot = network_rollback_slot(frame);
+    uint8_t *events = NULL;
+    uint8_t *buf;
+    unsigned int events_len;
+    rollback_frame_t *check_slot = NULL;
+    int check = network_rollback_checkable_frame();
+    int i;
+
+    if (check >= 0) {
+        check_slot = &rollback_slots[check % rollback_num_slots];
+        if (check_slot->frame != check) {
+            check_slot = NULL;
+            check = -1;
+        }
+    }
+
+    events_len = network_create_event_buffer(&events, &slot->local);
+
+    buf = lib_malloc(ROLLBACK_HEADER_SIZE + events_len);
+    util_dword_to_le_buf(&buf[0], (uint32_t)frame);
+    util_dword_to_le_buf(&buf[4], (uint32_t)check);
+    for (i = 0; i < 5; i++) {
+        util_dword_to_le_buf(&buf[8 + i * 4],
+                             check_slot != NULL ? check_slot->regs[i] : 0);
+    }
+    memcpy(&buf[ROLLBACK_HEADER_SIZE], events, events_len);
+    lib_free(events);
+
+    return network_rollback_send(buf, (int)(ROLLBACK_HEADER_SIZE + events_len));
+}
+
+static void network_rollback_got_frame(uint8_t *buf)
+{
+    rollback_frame_t *slot;
+    event_list_state_t *list;
+    int frame, check, i;
+
+    frame = (int)util_le_buf_to_dword(&buf[0]);
+    check = (int)util_le_buf_to_dword(&buf[4]);
+
+    if (check > rollback_check_frame) {
+        rollback_check_frame = check;
+        for (i = 0; i < 5; i++) {
+            rollback_check_regs[i] = util_le_buf_to_dword(&buf[8 + i * 4]);
+        }
+    }
+
+    if (frame <= rollback_remote_frame
+        || frame > rollback_remote_frame + rollback_num_slots) {
+        log_error(LOG_DEFAULT, "Netplay: ignoring events of frame %d.", frame);
+        return;
+    }
+
+    slot = network_rollback_slot(frame);
+    if (slot->remote != NULL) {
+        return;
+    }
+    list = network_create_event_list(&buf[ROLLBACK_HEADER_SIZE]);
+    slot->remote = list;
+
+    while (rollback_slots[(rollback_remote_frame + 1) % rollback_num_slots].frame
+           == rollback_remote_frame + 1
+           && rollback_slots[(rollback_remote_frame + 1) % rollback_num_slots].remote != NULL) {
+        rollback_remote_frame++;
+    }
+
+    /* predicted no events, but there were some */
+    if (frame < rollback_boundary && !slot->remote_applied
+        && list->base->type != EVENT_LIST_END
+        && (rollback_mispredicted < 0 || frame < rollback_mispredicted)) {
+        rollback_mispredicted = frame;
+    }
+}
+
+/* Read all packets that arrived. Returns -1 if the connection is gone.  */
+static int network_rollback_receive(void)
+{
+    uint8_t len4[4];
+    uint8_t *buf;
+    unsigned int len;
+
+    while (vice_network_select_poll_one(network_socket) > 0) {
+        if (network_recv_buffer(network_socket, len4, 4) < 0) {
+            return -1;
+        }
+        len = (unsigned int)util_le_buf4_to_int(len4);
+        if (len == 0) {
+            /* remote host suspended emulation, we stop once we are too
+               far ahead */
+            continue;
+        }
+        if (len < ROLLBACK_HEADER_SIZE + 3 * 4) {
+            return -1;
+        }
+        buf = lib_malloc(len);
+        if (network_recv_buffer(network_socket, buf, (int)len) < 0) {
+            lib_free(buf);
+            return -1;
+        }
+        network_rollback_got_frame(buf);
+        lib_free(buf);
+    }
+    return 0;
+}
+
+static void network_rollback_sync_test(void)
+{
+    rollback_frame_t *slot;
+    int i;
+
+    if (rollback_check_frame < 0
+        || rollback_check_frame > network_rollback_checkable_frame()) {
+        return;
+    }
+
+    slot = &rollback_slots[rollback_check_frame % rollback_num_slots];
+    if (slot->frame == rollback_check_frame) {
+        for (i = 0; i < 5; i++) {
+            if (slot->regs[i] != rollback_check_regs[i]) {
+                ui_error("Network out of sync - disconnecting.");
+                network_disconnect();
+                return;
+            }
+        }
+    }
+    rollback_check_frame = -1;
+}
+
+static void network_rollback_play(rollback_frame_t *slot)
+{
+    event_list_state_t *remote = slot->remote;
+
+    if (network_mode == NETWORK_SERVER_CONNECTED) {
+        event_playback_event_list(&slot->local);
+        if (remote != NULL) {
+            event_playback_event_list(remote);
+        }
+    } else {
+        if (remote != NULL) {
+            event_playback_event_list(remote);
+        }
+        event_playback_event_list(&slot->local);
+    }
+    slot->remote_applied = (remote != NULL);
+}
+
+static void network_rollback_boundary_trap(uint16_t addr, void *data)
+{
+    rollback_frame_t *slot;
+    int frame;
+
+    if (!rollback_active) {
+        return;
+    }
+
+    if (rollback_replay_until < 0 && rollback_mispredicted >= 0) {
+        /* go back to the first mispredicted frame */
+        frame = rollback_mispredicted;
+        slot = network_rollback_slot(frame);
+        rollback_mispredicted = -1;
+
+        if (slot->state == NULL
+            || machine_read_snapshot_memory(slot->state, slot->state_len, 0) < 0) {
+            ui_error("Netplay: cannot restore the state of frame %d - disconnecting.", frame);
+            network_disconnect();
+            return;
+        }
+        rollback_num_rollbacks++;
+        rollback_num_replayed += (unsigned long)(rollback_boundary - frame);
+
+        /* the boundary of `frame' is now done again, replay the rest */
+        rollback_replay_until = rollback_boundary;
+        rollback_warp_saved = vsync_get_warp_mode();
+        vsync_set_warp_mode(1);
+    } else {
+        frame = rollback_boundary;
+        slot = network_rollback_slot(frame);
+
+        lib_free(slot->state);
+        slot->state = NULL;
+        if (machine_write_snapshot_memory(&slot->state, &slot->state_len, 0, 0, 0) < 0) {
+            snapshot_set_error(SNAPSHOT_NO_ERROR);
+            ui_error("Netplay: cannot save the state of frame %d - disconnecting.", frame);
+            network_disconnect();
+            return;
+        }
+        slot->regs[0] = (uint32_t)maincpu_get_pc();
+        slot->regs[1] = (uint32_t)maincpu_get_a();
+        slot->regs[2] = (uint32_t)maincpu_get_x();
+        slot->regs[3] = (uint32_t)maincpu_get_y();
+        slot->regs[4] = (uint32_t)maincpu_get_sp();
+    }
+
+    network_rollback_play(slot);
+    rollback_boundary = frame + 1;
+
+    if (rollback_replay_until >= 0 && frame == rollback_replay_until) {
+        /* caught up with the present */
+        rollback_replay_until = -1;
+        vsync_set_warp_mode(rollback_warp_saved);
+    }
+}
+
+static void network_rollback_hook(void)
+{
+    int frame = rollback_boundary;
+    int stalled = 0;
+
+    if (rollback_replay_until >= 0) {
+        /* re-simulating, the events are known already */
+        interrupt_maincpu_trigger_trap(network_rollback_boundary_trap, NULL);
+        return;
+    }
+
+    suspended = 0;
+
+    /* the events recorded from now on belong to the next frame */
+    rollback_record_frame = frame + 1;
+    network_rollback_slot(rollback_record_frame);
+
+    if (network_rollback_send_frame(frame) < 0
+        || network_rollback_receive() < 0) {
+        ui_display_statustext("Remote host disconnected.", 1);
+        network_disconnect();
+        return;
+    }
+
+    /* keep a state for every frame the remote host has not confirmed */
+    while (frame - rollback_remote_frame > rollback_frames) {
+        if (!stalled) {
+            rollback_num_stalls++;
+            stalled = 1;
+        }
+        tick_sleep(tick_per_second() / 1000);
+        if (network_rollback_flush() < 0
+            || network_rollback_receive() < 0) {
+            ui_display_statustext("Remote host disconnected.", 1);
+            network_disconnect();
+            return;
+        }
+    }
+    if (stalled) {
+        vsync_suspend_speed_eval();
+    }
+
+    network_rollback_sync_test();
+    if (!rollback_active) {
+        return;
+    }
+
+    interrupt_maincpu_trigger_trap(network_rollback_boundary_trap, NULL);
+}
+
 static void network_server_connect_trap(uint16_t addr, void *data)
 {
     FILE *f;
@@ -554,7 +1109,9 @@ static void network_server_connect_trap(uint16_t addr, void *data)
             return;
         }
 
-        if (network_test_delay() < 0) {
+        if (rollback_enabled) {
+            network_rollback_start();
+        } else if (network_test_delay() < 0) {
             log_error(LOG_DEFAULT, "network_test_delay failed");
         }
     } else {
@@ -612,7 +1169,9 @@ static void network_client_connect_trap(uint16_t addr, void *data)
 
     network_mode = NETWORK_CLIENT;
 
-    if (network_test_delay() < 0) {
+    if (rollback_enabled) {
+        network_rollback_start();
+    } else if (network_test_delay() < 0) {
         log_error(LOG_DEFAULT, "network_test_delay failed");
     }
     lib_free(snapshotfilename);
@@ -664,6 +1223,12 @@ void network_event_record(unsigned int type, void *data, unsigned int size)
         return;
     }
 
+    if (rollback_active) {
+        event_record_in_list(&(network_rollback_slot(rollback_record_frame)->local),
+                             type, data, size);
+        return;
+    }
+
     event_record_in_list(&(frame_event_list[current_frame]), type, data, size);
 }
 
@@ -684,6 +1249,12 @@ void network_attach_image(unsigned int unit, const char *filename)
         return;
     }
 
+    if (rollback_active) {
+        event_record_attach_in_list(&(network_rollback_slot(rollback_record_frame)->local),
+                                    unit, drive, filename, 1);
+        return;
+    }
+
     event_record_attach_in_list(&(frame_event_list[current_frame]), unit, drive, filename, 1);
 }
 
@@ -824,6 +1395,7 @@ int network_connect_client(void)
 void network_disconnect(void)
 {
     DBG(("network_disconnect (network_mode was:%u)", network_mode));
+    network_rollback_stop();
     vice_network_socket_close(network_socket);
     if (network_mode == NETWORK_SERVER_CONNECTED) {
         network_mode = NETWORK_SERVER;
@@ -988,7 +1560,9 @@ void network_hook(void)
         }
     }
 
-    if (network_connected()) {
+    if (network_connected() && rollback_active) {
+        network_rollback_hook();
+    } else if (network_connected()) {
         network_hook_connected_send();
         network_hook_connected_receive();
         DBGT(("network_hook timing: %5ld %5ld %5ld; total: %5ld",
@@ -28,6 +28,7 @@
 
 /*#include "petexport.h"*/
 #include "archdep.h"
+#include "batch.h"
 #include "cartio.h"
 #include "cartridge.h"
 #include "cmdline.h"
@@ -73,6 +74,10 @@ static io_source_list_t *debugcart_list_item = NULL;
 static void debugcart_store(uint16_t addr, uint8_t value)
 {
     int n = (int)value;
+    if (batch_is_active()) {
+        batch_program_exit(n);
+        return;
+    }
     fprintf(stdout, "DBGCART: exit(%d) cycles elapsed: %"PRIu64"\n", n, maincpu_clk);
 
     archdep_vice_exit(n);
@@ -60,18 +60,11 @@
 #define SNAP_MAJOR 1
 #define SNAP_MINOR 0
 
-int pet_snapshot_write(const char *name, int save_roms, int save_disks,
-                       int event_mode)
+static int pet_snapshot_write_to(snapshot_t *s, int save_roms, int save_disks,
+                                 int event_mode)
 {
-    snapshot_t *s;
     int ef = 0;
 
-    s = snapshot_create(name, SNAP_MAJOR, SNAP_MINOR, machine_name);
-
-    if (s == NULL) {
-        return -1;
-    }
-
     sound_snapshot_prepare();
 
     if (maincpu_snapshot_write_module(s) < 0
@@ -95,27 +88,52 @@ int pet_snapshot_write(const char *name, int save_roms, int save_disks,
         ef = acia1_snapshot_write_module(s);
     }
 
-    snapshot_close(s);
+    return ef;
+}
 
-    if (ef) {
+int pet_snapshot_write(const char *name, int save_roms, int save_disks,
+                       int event_mode)
+{
+    snapshot_t *s;
+
+    s = snapshot_create(name, SNAP_MAJOR, SNAP_MINOR, machine_name);
+    if (s == NULL) {
+        return -1;
+    }
+
+    if (pet_snapshot_write_to(s, save_roms, save_disks, event_mode) < 0) {
+        snapshot_close(s);
         archdep_remove(name);
+        return -1;
     }
 
-    return ef;
+    snapshot_close(s);
+    return 0;
 }
 
-int pet_snapshot_read(const char *name, int event_mode)
+int pet_snapshot_write_memory(uint8_t **data, size_t *len, int save_roms,
+                              int save_disks, int event_mode)
 {
     snapshot_t *s;
-    uint8_t minor, major;
-    int ef = 0;
-
-    s = snapshot_open(name, &major, &minor, machine_name);
 
+    s = snapshot_memory_create(SNAP_MAJOR, SNAP_MINOR, machine_name);
     if (s == NULL) {
         return -1;
     }
 
+    if (pet_snapshot_write_to(s, save_roms, save_disks, event_mode) < 0) {
+        snapshot_close(s);
+        return -1;
+    }
+
+    *data = snapshot_memory_close(s, len);
+    return 0;
+}
+
+static int pet_snapshot_read_from(snapshot_t *s, uint8_t major, uint8_t minor, int event_mode)
+{
+    int ef = 0;
+
     if (!snapshot_version_is_equal(major, minor, SNAP_MAJOR, SNAP_MINOR)) {
         log_error(LOG_DEFAULT, "Snapshot version (%d.%d) not valid: expecting %d.%d.", major, minor, SNAP_MAJOR, SNAP_MINOR);
         snapshot_set_error(SNAPSHOT_MODULE_INCOMPATIBLE);
@@ -154,3 +172,29 @@ int pet_snapshot_read(const char *name, int event_mode)
 
     return ef;
 }
+
+int pet_snapshot_read(const char *name, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_open(name, &major, &minor, machine_name);
+    if (s == NULL) {
+        return -1;
+    }
+
+    return pet_snapshot_read_from(s, major, minor, event_mode);
+}
+
+int pet_snapshot_read_memory(const uint8_t *data, size_t len, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_memory_open(data, len, &major, &minor, machine_name);
+    if (s == NULL) {
+        return -1;
+    }
+
+    return pet_snapshot_read_from(s, major, minor, event_mode);
+}
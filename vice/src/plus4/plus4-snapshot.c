@@ -61,17 +61,9 @@
 #define SNAP_MAJOR 2
 #define SNAP_MINOR 0
 
-int plus4_snapshot_write(const char *name, int save_roms, int save_disks,
-                         int event_mode)
+static int plus4_snapshot_write_to(snapshot_t *s, int save_roms, int save_disks,
+                                   int event_mode)
 {
-    snapshot_t *s;
-
-    s = snapshot_create(name, ((uint8_t)(SNAP_MAJOR)), ((uint8_t)(SNAP_MINOR)),
-                        machine_name);
-    if (s == NULL) {
-        return -1;
-    }
-
     sound_snapshot_prepare();
 
     /* Execute drive CPUs to get in sync with the main CPU.  */
@@ -88,27 +80,54 @@ int plus4_snapshot_write(const char *name, int save_roms, int save_disks,
         || joyport_snapshot_write_module(s, JOYPORT_1) < 0
         || joyport_snapshot_write_module(s, JOYPORT_2) < 0
         || userport_snapshot_write_module(s) < 0) {
-        snapshot_close(s);
-        archdep_remove(name);
         DBG(("error writing snapshot modules.\n"));
         return -1;
     }
     DBG(("all snapshots written.\n"));
-    snapshot_close(s);
     return 0;
 }
 
-int plus4_snapshot_read(const char *name, int event_mode)
+int plus4_snapshot_write(const char *name, int save_roms, int save_disks,
+                         int event_mode)
 {
     snapshot_t *s;
-    uint8_t minor, major;
 
-    s = snapshot_open(name, &major, &minor, machine_name);
+    s = snapshot_create(name, ((uint8_t)(SNAP_MAJOR)), ((uint8_t)(SNAP_MINOR)), machine_name);
+    if (s == NULL) {
+        return -1;
+    }
+
+    if (plus4_snapshot_write_to(s, save_roms, save_disks, event_mode) < 0) {
+        snapshot_close(s);
+        archdep_remove(name);
+        return -1;
+    }
+
+    snapshot_close(s);
+    return 0;
+}
+
+int plus4_snapshot_write_memory(uint8_t **data, size_t *len, int save_roms,
+                                int save_disks, int event_mode)
+{
+    snapshot_t *s;
 
+    s = snapshot_memory_create(((uint8_t)(SNAP_MAJOR)), ((uint8_t)(SNAP_MINOR)), machine_name);
     if (s == NULL) {
         return -1;
     }
 
+    if (plus4_snapshot_write_to(s, save_roms, save_disks, event_mode) < 0) {
+        snapshot_close(s);
+        return -1;
+    }
+
+    *data = snapshot_memory_close(s, len);
+    return 0;
+}
+
+static int plus4_snapshot_read_from(snapshot_t *s, uint8_t major, uint8_t minor, int event_mode)
+{
     if (!snapshot_version_is_equal(major, minor, SNAP_MAJOR, SNAP_MINOR)) {
         log_error(LOG_DEFAULT, "Snapshot version (%d.%d) not valid: expecting %d.%d.", major, minor, SNAP_MAJOR, SNAP_MINOR);
         snapshot_set_error(SNAPSHOT_MODULE_INCOMPATIBLE);
@@ -150,3 +169,29 @@ fail:
     DBG(("error loading snapshot modules.\n"));
     return -1;
 }
+
+int plus4_snapshot_read(const char *name, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_open(name, &major, &minor, machine_name);
+    if (s == NULL) {
+        return -1;
+    }
+
+    return plus4_snapshot_read_from(s, major, minor, event_mode);
+}
+
+int plus4_snapshot_read_memory(const uint8_t *data, size_t len, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_memory_open(data, len, &major, &minor, machine_name);
+    if (s == NULL) {
+        return -1;
+    }
+
+    return plus4_snapshot_read_from(s, major, minor, event_mode);
+}
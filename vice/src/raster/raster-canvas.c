@@ -28,6 +28,7 @@
 #include "vice.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #include "videoarch.h"
 
@@ -39,6 +40,38 @@
 #include "viewport.h"
 #include "vsync.h"
 
+/* Everything besides the draw buffer contents that affects the picture. */
+struct raster_canvas_config_s {
+    int rendermode;
+    int scalex;
+    int scaley;
+    int doublescan;
+    int filter;
+    int crt_type;
+    unsigned int first_x;
+    unsigned int first_line;
+    unsigned int last_line;
+    unsigned int x_offset;
+    unsigned int y_offset;
+    unsigned int border_left;
+    unsigned int draw_buffer_width;
+    unsigned int draw_buffer_height;
+    unsigned int canvas_width;
+    unsigned int canvas_height;
+    video_resources_t video_resources;
+};
+typedef struct raster_canvas_config_s raster_canvas_config_t;
+
+/* Copy of the visible lines of the draw buffer as they were at the last
+   refresh. The raster code redraws every line of each frame, so comparing
+   against this copy is what tells which lines actually changed. */
+struct raster_canvas_shadow_s {
+    uint8_t *lines;
+    unsigned int size;
+    int valid;
+    raster_canvas_config_t config;
+};
+
 inline static void refresh_canvas(raster_t *raster)
 {
     raster_canvas_area_t *update_area;
@@ -105,6 +138,114 @@ inline static void refresh_canvas(raster_t *raster)
     update_area->is_null = 1;
 }
 
+/* Refresh only the lines of the frame that changed since the last refresh.
+   An unchanged frame is refreshed with a height of 0. */
+static void refresh_changed_lines(raster_t *raster)
+{
+    raster_canvas_shadow_t *shadow = raster->shadow;
+    video_canvas_t *canvas = raster->canvas;
+    draw_buffer_t *draw_buffer = canvas->draw_buffer;
+    viewport_t *viewport = canvas->viewport;
+    geometry_t *geometry = canvas->geometry;
+    raster_canvas_config_t config;
+    unsigned int pitch, size, line, first, last, x, w, yy;
+    uint8_t *src, *dst;
+
+    if (viewport->last_line < viewport->first_line
+        || viewport->last_line >= draw_buffer->draw_buffer_height) {
+        video_canvas_refresh_all(canvas);
+        return;
+    }
+
+    memset(&config, 0, sizeof(config));
+    config.rendermode = canvas->videoconfig->rendermode;
+    config.scalex = canvas->videoconfig->scalex;
+    config.scaley = canvas->videoconfig->scaley;
+    config.doublescan = canvas->videoconfig->doublescan;
+    config.filter = canvas->videoconfig->filter;
+    config.crt_type = viewport->crt_type;
+    config.first_x = viewport->first_x;
+    config.first_line = viewport->first_line;
+    config.last_line = viewport->last_line;
+    config.x_offset = viewport->x_offset;
+    config.y_offset = viewport->y_offset;
+    config.border_left = geometry->extra_offscreen_border_left;
+    config.draw_buffer_width = draw_buffer->draw_buffer_width;
+    config.draw_buffer_height = draw_buffer->draw_buffer_height;
+    config.canvas_width = draw_buffer->canvas_width;
+    config.canvas_height = draw_buffer->canvas_height;
+    config.video_resources = canvas->videoconfig->video_resources;
+
+    pitch = draw_buffer->draw_buffer_width;
+    size = pitch * (viewport->last_line - viewport->first_line + 1);
+    src = draw_buffer->draw_buffer + pitch * viewport->first_line;
+
+    if (shadow->size != size) {
+        lib_free(shadow->lines);
+        shadow->lines = lib_malloc(size);
+        shadow->size = size;
+        shadow->valid = 0;
+    }
+
+    /* A new palette, color setting or geometry changes every line */
+    if (!shadow->valid
+        || draw_buffer->refresh_all_pending
+        || !canvas->videoconfig->color_tables.updated
+        || viewport->crt_type != canvas->crt_type
+        || memcmp(&config, &shadow->config, sizeof(config)) != 0) {
+        memcpy(shadow->lines, src, size);
+        shadow->config = config;
+        shadow->valid = 1;
+        video_canvas_refresh_all(canvas);
+        draw_buffer->refresh_all_pending = 0;
+        return;
+    }
+
+    first = viewport->last_line + 1;
+    last = 0;
+    dst = shadow->lines;
+    for (line = viewport->first_line; line <= viewport->last_line; line++) {
+        if (memcmp(dst, src, pitch) != 0) {
+            memcpy(dst, src, pitch);
+            if (first > line) {
+                first = line;
+            }
+            last = line;
+        }
+        src += pitch;
+        dst += pitch;
+    }
+
+    x = viewport->first_x + geometry->extra_offscreen_border_left;
+    w = MIN(draw_buffer->canvas_width, geometry->screen_size.width - viewport->first_x);
+
+    if (first > last) {
+        /* Nothing changed, the arch only has to show the frame again */
+        video_canvas_refresh(canvas, x, viewport->first_line,
+                             viewport->x_offset, viewport->y_offset, w, 0);
+        return;
+    }
+
+    /* The filters blend each line with its neighbours */
+    if (config.filter != VIDEO_FILTER_NONE) {
+        if (first > viewport->first_line) {
+            first--;
+        }
+        if (last < viewport->last_line) {
+            last++;
+        }
+    }
+
+    yy = first - viewport->first_line;
+    if (yy >= draw_buffer->canvas_height) {
+        return;
+    }
+
+    video_canvas_refresh(canvas, x, first,
+                         viewport->x_offset, viewport->y_offset + yy,
+                         w, MIN(draw_buffer->canvas_height - yy, last - first + 1));
+}
+
 void raster_canvas_handle_end_of_frame(raster_t *raster)
 {
     if (video_disabled_mode) {
@@ -120,7 +261,13 @@ void raster_canvas_handle_end_of_frame(raster_t *raster)
     }
 
     if (raster->dont_cache) {
-        video_canvas_refresh_all(raster->canvas);
+        if (raster->canvas->draw_buffer->refresh_partial
+            && !raster->canvas->videoconfig->interlaced) {
+            refresh_changed_lines(raster);
+        } else {
+            raster->shadow->valid = 0;
+            video_canvas_refresh_all(raster->canvas);
+        }
     } else {
         refresh_canvas(raster);
     }
@@ -138,9 +285,13 @@ void raster_canvas_init(raster_t *raster)
     raster->update_area = lib_malloc(sizeof(raster_canvas_area_t));
 
     raster->update_area->is_null = 1;
+
+    raster->shadow = lib_calloc(1, sizeof(raster_canvas_shadow_t));
 }
 
 void raster_canvas_shutdown(raster_t *raster)
 {
     lib_free(raster->update_area);
+    lib_free(raster->shadow->lines);
+    lib_free(raster->shadow);
 }
@@ -39,6 +39,9 @@ struct raster_canvas_area_s {
 };
 typedef struct raster_canvas_area_s raster_canvas_area_t;
 
+/* Copy of the last refreshed frame, see raster-canvas.c */
+typedef struct raster_canvas_shadow_s raster_canvas_shadow_t;
+
 extern void raster_canvas_init(struct raster_s *raster);
 extern void raster_canvas_shutdown(struct raster_s *raster);
 
@@ -161,6 +161,9 @@ struct raster_s {
     /* Area to update.  */
     struct raster_canvas_area_s *update_area;
 
+    /* Lines of the last refreshed frame, to find the lines that changed.  */
+    struct raster_canvas_shadow_s *shadow;
+
     /* This is a bit mask representing each pixel on the screen (1 =
        foreground, 0 = background) and is used both for sprite-background
        collision checking and background sprite drawing.  When cache is
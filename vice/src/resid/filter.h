@@ -348,6 +348,9 @@ class Filter
 public:
   Filter();
 
+  // Cache file for the model tables, set before the first Filter is created.
+  static void set_model_cache(const char* path);
+
   void enable_filter(bool enable);
   void adjust_filter_bias(double dac_bias);
   void set_chip_model(chip_model model);
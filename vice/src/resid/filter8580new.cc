@@ -27,7 +27,9 @@
 #include "filter8580new.h"
 #include "dac.h"
 #include "spline.h"
+#include "tablecache.h"
 #include <math.h>
+#include <string.h>
 
 namespace reSID
 {
@@ -243,6 +245,38 @@ static double log1p(double x)
 
 Filter::model_filter_t Filter::model_filter[2];
 
+// Bump when the calculation of the model tables changes.
+static const unsigned int model_cache_version = 1;
+
+static char* model_cache_path = 0;
+
+// Identifies the model tables: everything they are calculated from, except
+// for the code itself.
+static unsigned int model_cache_key()
+{
+  unsigned int key = table_cache_hash(0, &model_cache_version, sizeof(model_cache_version));
+  key = table_cache_hash(key, resid_version_string, (unsigned int)strlen(resid_version_string));
+  key = table_cache_hash(key, opamp_voltage_6581, sizeof(opamp_voltage_6581));
+  key = table_cache_hash(key, opamp_voltage_8580, sizeof(opamp_voltage_8580));
+  key = table_cache_hash(key, resGain, sizeof(resGain));
+  for (int m = 0; m < 2; m++) {
+    model_filter_init_t& fi = model_filter_init[m];
+    key = table_cache_hash(key, &fi.opamp_voltage_size,
+      (unsigned int)(sizeof(fi) - ((char*)&fi.opamp_voltage_size - (char*)&fi)));
+  }
+  return key;
+}
+
+void Filter::set_model_cache(const char* path)
+{
+  delete[] model_cache_path;
+  model_cache_path = 0;
+  if (path) {
+    model_cache_path = new char[strlen(path) + 1];
+    strcpy(model_cache_path, path);
+  }
+}
+
 
 // ----------------------------------------------------------------------------
 // Constructor.
@@ -251,6 +285,28 @@ Filter::Filter()
 {
   static bool class_init;
 
+  // The model tables take a while to calculate, load them from the cache
+  // file if possible.
+  table_cache_block model_cache[] = {
+    { model_filter, sizeof(model_filter) },
+    { vcr_kVg, sizeof(vcr_kVg) },
+    { vcr_n_Ids_term, sizeof(vcr_n_Ids_term) },
+    { &n_snake, sizeof(n_snake) },
+    { &n_param, sizeof(n_param) }
+  };
+  const int model_cache_size = sizeof(model_cache)/sizeof(*model_cache);
+
+  if (!class_init && model_cache_path
+      && table_cache_load(model_cache_path, model_cache_key(), model_cache, model_cache_size)) {
+    // Set up as when calculating the tables below.
+    model_filter_init_t& fi = model_filter_init[1];
+    double Vgt = (fi.voice_DC_voltage * 1.6) - fi.Vth;
+    nVgt = (int)(model_filter[1].vo_N16 * (Vgt - fi.opamp_voltage[0][0]) + 0.5);
+    Vw_bias = 0;
+
+    class_init = true;
+  }
+
   if (!class_init) {
     double tmp_n_param[2];
 
@@ -612,6 +668,10 @@ Filter::Filter()
     delete[] voltages;
     delete[] opamp;
 
+    if (model_cache_path) {
+      table_cache_save(model_cache_path, model_cache_key(), model_cache, model_cache_size);
+    }
+
     class_init = true;
   }
 
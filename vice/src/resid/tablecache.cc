@@ -0,0 +1,149 @@
+//  ---------------------------------------------------------------------------
+//  This file is part of reSID, a MOS6581 SID emulator engine.
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//  ---------------------------------------------------------------------------
+
+#define RESID_TABLECACHE_CC
+
+#ifdef _M_ARM
+#undef _ARM_WINAPI_PARTITION_DESKTOP_SDK_AVAILABLE
+#define _ARM_WINAPI_PARTITION_DESKTOP_SDK_AVAILABLE 1
+#endif
+
+#include "tablecache.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <process.h>
+#define table_cache_getpid() _getpid()
+#else
+#include <unistd.h>
+#define table_cache_getpid() getpid()
+#endif
+
+namespace reSID
+{
+
+// ----------------------------------------------------------------------------
+// Cache files for lookup tables which are expensive to calculate.
+// ----------------------------------------------------------------------------
+
+// The file starts with a header identifying the contents, followed by the
+// blocks in the order given. The key must change whenever the contents
+// would; it is up to the caller to include everything the tables are
+// calculated from. The file is only ever used on the machine which wrote it,
+// so everything is stored in native byte order.
+
+typedef struct {
+  char magic[8];
+  unsigned int key;
+  unsigned int size;
+} table_cache_header;
+
+static const char table_cache_magic[8] = { 'r', 'e', 'S', 'I', 'D', 't', 'b', 'l' };
+
+static unsigned int table_cache_size(const table_cache_block* blocks, int n)
+{
+  unsigned int size = 0;
+  for (int i = 0; i < n; i++) {
+    size += blocks[i].size;
+  }
+  return size;
+}
+
+// FNV-1a.
+unsigned int table_cache_hash(unsigned int hash, const void* data, unsigned int size)
+{
+  const unsigned char* p = (const unsigned char*)data;
+
+  if (hash == 0) {
+    hash = 2166136261u;
+  }
+  for (unsigned int i = 0; i < size; i++) {
+    hash = (hash ^ p[i])*16777619u;
+  }
+  return hash;
+}
+
+// Read the blocks from the cache file. Returns false, leaving the blocks in
+// an undefined state, if the file is missing or does not match.
+bool table_cache_load(const char* path, unsigned int key, const table_cache_block* blocks, int n)
+{
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    return false;
+  }
+
+  table_cache_header header;
+  bool ok = fread(&header, sizeof(header), 1, f) == 1
+    && memcmp(header.magic, table_cache_magic, sizeof(header.magic)) == 0
+    && header.key == key
+    && header.size == table_cache_size(blocks, n);
+
+  for (int i = 0; ok && i < n; i++) {
+    ok = fread(blocks[i].data, 1, blocks[i].size, f) == blocks[i].size;
+  }
+  // The file must end here.
+  ok = ok && fgetc(f) == EOF;
+
+  fclose(f);
+  return ok;
+}
+
+// Write the blocks to the cache file. The file is written under a temporary
+// name first, so that a concurrent or interrupted run never sees a partial
+// file. The temporary name includes the process id, as several emulators
+// (e.g. batch workers) may write the same cache at once. Errors are ignored,
+// the tables are calculated again next time.
+void table_cache_save(const char* path, unsigned int key, const table_cache_block* blocks, int n)
+{
+  size_t len = strlen(path) + 32;
+  char* tmp = new char[len];
+  snprintf(tmp, len, "%s.%ld.tmp", path, (long)table_cache_getpid());
+
+  FILE* f = fopen(tmp, "wb");
+  if (!f) {
+    delete[] tmp;
+    return;
+  }
+
+  table_cache_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, table_cache_magic, sizeof(header.magic));
+  header.key = key;
+  header.size = table_cache_size(blocks, n);
+
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+  for (int i = 0; ok && i < n; i++) {
+    ok = fwrite(blocks[i].data, 1, blocks[i].size, f) == blocks[i].size;
+  }
+  ok = (fclose(f) == 0) && ok;
+
+  if (ok) {
+#ifdef _WIN32
+    // rename() does not replace an existing file here.
+    remove(path);
+#endif
+    ok = rename(tmp, path) == 0;
+  }
+  if (!ok) {
+    remove(tmp);
+  }
+  delete[] tmp;
+}
+
+} // namespace reSID
@@ -0,0 +1,37 @@
+//  ---------------------------------------------------------------------------
+//  This file is part of reSID, a MOS6581 SID emulator engine.
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//  ---------------------------------------------------------------------------
+
+#ifndef RESID_TABLECACHE_H
+#define RESID_TABLECACHE_H
+
+namespace reSID
+{
+
+// One lookup table, or any other block of memory, stored in a cache file.
+typedef struct {
+  void* data;
+  unsigned int size;
+} table_cache_block;
+
+unsigned int table_cache_hash(unsigned int hash, const void* data, unsigned int size);
+bool table_cache_load(const char* path, unsigned int key, const table_cache_block* blocks, int n);
+void table_cache_save(const char* path, unsigned int key, const table_cache_block* blocks, int n);
+
+} // namespace reSID
+
+#endif // not RESID_TABLECACHE_H
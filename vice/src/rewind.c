@@ -0,0 +1,284 @@
+/*
+ * rewind.c - In-memory rewind buffer.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Every `RewindInterval' frames the machine state is written to a memory
+   snapshot and added to a snapshot chain, which only keeps the pages that
+   changed since the previous state. The oldest states are dropped when the
+   chain grows beyond `RewindBufferSize'.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "interrupt.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "resources.h"
+#include "snapshot.h"
+#include "types.h"
+#include "vsync.h"
+
+#include "rewind.h"
+
+/* Flag: capture states for rewinding?  */
+static int rewind_enabled = 0;
+
+/* Number of frames between two captured states.  */
+static int rewind_interval = 50;
+
+/* Memory budget of the rewind buffer, in MiB.  */
+static int rewind_buffer_size = 64;
+
+static snapshot_chain_t *rewind_chain = NULL;
+
+static int frames_until_capture = 0;
+static int capture_pending = 0;
+
+/* Statistics, reported on shutdown.  */
+static unsigned long num_captures = 0;
+static uint64_t capture_ticks = 0;
+
+/* ------------------------------------------------------------------------- */
+
+static void rewind_trim(void)
+{
+    size_t budget = (size_t)rewind_buffer_size * 1024 * 1024;
+
+    /* always keep the newest state */
+    while (snapshot_chain_count(rewind_chain) > 1
+           && snapshot_chain_size(rewind_chain) > budget) {
+        snapshot_chain_drop_oldest(rewind_chain, 1);
+    }
+}
+
+static void rewind_capture_trap(uint16_t addr, void *data)
+{
+    uint8_t *buf;
+    size_t len;
+    tick_t start;
+
+    capture_pending = 0;
+
+    if (!rewind_enabled) {
+        return;
+    }
+
+    start = tick_now();
+
+    if (rewind_chain == NULL) {
+        rewind_chain = snapshot_chain_new();
+    }
+
+    /* the state is written over the newest one, which saves copying and
+       comparing it */
+    snapshot_chain_begin_append(rewind_chain);
+    if (machine_write_snapshot_memory(&buf, &len, 0, 0, 0) < 0) {
+        log_error(LOG_DEFAULT, "Rewind: cannot capture the machine state.");
+        snapshot_set_error(SNAPSHOT_NO_ERROR);
+        return;
+    }
+    snapshot_chain_append(rewind_chain, buf, len);
+    rewind_trim();
+
+    num_captures++;
+    capture_ticks += tick_now_delta(start);
+}
+
+/* Called at the end of every frame.  */
+void rewind_vsync_hook(void)
+{
+    if (!rewind_enabled || capture_pending) {
+        return;
+    }
+
+    if (--frames_until_capture > 0) {
+        return;
+    }
+    frames_until_capture = rewind_interval;
+
+    /* the state can only be written between two instructions */
+    capture_pending = 1;
+    interrupt_maincpu_trigger_trap(rewind_capture_trap, NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+
+unsigned int rewind_get_num_states(void)
+{
+    return rewind_chain != NULL ? snapshot_chain_count(rewind_chain) : 0;
+}
+
+size_t rewind_get_buffer_size(void)
+{
+    return rewind_chain != NULL ? snapshot_chain_size(rewind_chain) : 0;
+}
+
+void rewind_clear(void)
+{
+    if (rewind_chain != NULL) {
+        snapshot_chain_clear(rewind_chain);
+    }
+    frames_until_capture = rewind_interval;
+}
+
+/* Go back to the `states'th newest captured state, 1 being the newest one.
+   The restored state and all newer ones are removed from the buffer, so
+   calling this repeatedly goes further back in time. Must be called between
+   two instructions, e.g. from the monitor or a CPU trap.  */
+int rewind_step_back(unsigned int states)
+{
+    unsigned int count = rewind_get_num_states();
+    unsigned int index;
+    uint8_t *data;
+    size_t len;
+    int ret;
+
+    if (count == 0) {
+        return -1;
+    }
+
+    if (states == 0) {
+        states = 1;
+    }
+    index = states >= count ? 0 : count - states;
+
+    data = snapshot_chain_get(rewind_chain, index, &len);
+    if (index > 0) {
+        snapshot_chain_truncate(rewind_chain, index - 1);
+    } else {
+        snapshot_chain_clear(rewind_chain);
+    }
+
+    ret = machine_read_snapshot_memory(data, len, 0);
+    lib_free(data);
+
+    frames_until_capture = rewind_interval;
+
+    return ret;
+}
+
+static void rewind_step_back_trap(uint16_t addr, void *data)
+{
+    if (rewind_step_back((unsigned int)vice_ptr_to_uint(data)) < 0) {
+        log_warning(LOG_DEFAULT, "Rewind: no state to go back to.");
+    }
+}
+
+/* Go back in time from anywhere, the state is restored before the next
+   instruction.  */
+void rewind_trigger_step_back(unsigned int states)
+{
+    interrupt_maincpu_trigger_trap(rewind_step_back_trap, uint_to_void_ptr(states));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_rewind_enabled(int val, void *param)
+{
+    rewind_enabled = val ? 1 : 0;
+
+    if (!rewind_enabled && rewind_chain != NULL) {
+        snapshot_chain_clear(rewind_chain);
+    }
+    frames_until_capture = rewind_interval;
+
+    return 0;
+}
+
+static int set_rewind_interval(int val, void *param)
+{
+    if (val < 1) {
+        return -1;
+    }
+    rewind_interval = val;
+    frames_until_capture = rewind_interval;
+
+    return 0;
+}
+
+static int set_rewind_buffer_size(int val, void *param)
+{
+    if (val < 1) {
+        return -1;
+    }
+    rewind_buffer_size = val;
+
+    if (rewind_chain != NULL) {
+        rewind_trim();
+    }
+
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "Rewind", 0, RES_EVENT_NO, NULL,
+      &rewind_enabled, set_rewind_enabled, NULL },
+    { "RewindInterval", 50, RES_EVENT_NO, NULL,
+      &rewind_interval, set_rewind_interval, NULL },
+    { "RewindBufferSize", 64, RES_EVENT_NO, NULL,
+      &rewind_buffer_size, set_rewind_buffer_size, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int rewind_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-rewind", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "Rewind", (resource_value_t)1,
+      NULL, "Enable capturing machine states for rewinding" },
+    { "+rewind", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "Rewind", (resource_value_t)0,
+      NULL, "Disable capturing machine states for rewinding" },
+    { "-rewindinterval", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "RewindInterval", NULL,
+      "<frames>", "Capture a machine state for rewinding every <frames> frames" },
+    { "-rewindbuffersize", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "RewindBufferSize", NULL,
+      "<MiB>", "Set the maximum memory used for rewind states" },
+    CMDLINE_LIST_END
+};
+
+int rewind_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void rewind_shutdown(void)
+{
+    if (num_captures > 0) {
+        log_message(LOG_DEFAULT,
+                    "Rewind: %lu states captured, %.1f us per state (%.2f us per frame).",
+                    num_captures,
+                    (double)capture_ticks * 1000000.0 / tick_per_second() / num_captures,
+                    (double)capture_ticks * 1000000.0 / tick_per_second() / num_captures / rewind_interval);
+    }
+    snapshot_chain_free(rewind_chain);
+    rewind_chain = NULL;
+}
@@ -0,0 +1,41 @@
+/*
+ * rewind.h - In-memory rewind buffer.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_REWIND_H
+#define VICE_REWIND_H
+
+#include "types.h"
+
+extern int rewind_resources_init(void);
+extern int rewind_cmdline_options_init(void);
+extern void rewind_shutdown(void);
+
+extern void rewind_vsync_hook(void);
+
+extern unsigned int rewind_get_num_states(void);
+extern size_t rewind_get_buffer_size(void);
+extern int rewind_step_back(unsigned int states);
+extern void rewind_trigger_step_back(unsigned int states);
+extern void rewind_clear(void);
+
+#endif
@@ -0,0 +1,277 @@
+/*
+ * runahead.c - Show frames emulated ahead to hide input latency.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With `RunAhead' set to N, the machine state is written to memory at the
+   end of every frame. The emulation then runs N frames ahead with the
+   current input, unpaced and without sound, only the last of these frames
+   is shown. Then the state is read back and the next real frame is
+   emulated, without showing it. The screen is always N frames ahead of the
+   emulation, so a program reacting to input in the next frame seems to
+   react at once.
+
+   When the host needs more than the frame time for this, run-ahead is
+   switched off.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "drive.h"
+#include "interrupt.h"
+#include "joystick.h"
+#include "keyboard.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "monitor.h"
+#include "network.h"
+#include "resources.h"
+#include "runahead.h"
+#include "snapshot.h"
+#include "sound.h"
+#include "types.h"
+#include "uiapi.h"
+#include "vice-event.h"
+#include "vsync.h"
+#include "vsyncapi.h"
+
+/* Number of frames to run ahead, 0 to disable.  */
+static int runahead_frames = 0;
+
+/* Machine state at the end of the last real frame.  */
+static uint8_t *saved_state = NULL;
+static size_t saved_state_len = 0;
+
+/* Frames still to emulate ahead, 0 while running real frames.  */
+static int frames_left = 0;
+
+/* Flag: is the screen showing the frames emulated ahead?  */
+static int showing_ahead = 0;
+
+static int trap_pending = 0;
+static tick_t ahead_start;
+
+/* Frame time budget: run-ahead is switched off when more than half of the
+   last BUDGET_WINDOW frames needed more than 90% of the frame time.  */
+#define BUDGET_WINDOW 50
+static int budget_frames = 0;
+static int budget_over = 0;
+
+/* Statistics, reported on shutdown.  */
+static unsigned long num_runs = 0;
+static uint64_t run_ticks = 0;
+
+/* ------------------------------------------------------------------------- */
+
+/* Things that must not see the frames emulated ahead.  */
+static int runahead_possible(void)
+{
+    return runahead_frames > 0
+           && !vsync_get_warp_mode()
+           && !network_connected()
+           && !event_record_active()
+           && !event_playback_active()
+           && monitor_mask[e_comp_space] == 0
+           /* the profiler would count the emulated frames twice */
+           && !monitor_profile_active()
+           /* disk writes can not be undone */
+           && !drive_motor_is_on();
+}
+
+static void runahead_disable(const char *reason)
+{
+    log_warning(LOG_DEFAULT, "Run-ahead switched off: %s.", reason);
+    ui_display_statustext("Run-ahead switched off.", 1);
+    resources_set_int("RunAhead", 0);
+}
+
+static void runahead_check_budget(tick_t ticks)
+{
+    tick_t frame_ticks = (tick_t)(tick_per_second() / vsync_get_refresh_frequency());
+
+    if (runahead_frames == 0) {
+        return;
+    }
+
+    /* the real frame costs about as much as one emulated ahead */
+    ticks += ticks / (tick_t)runahead_frames;
+
+    if (ticks > frame_ticks / 10 * 9) {
+        budget_over++;
+    }
+    if (++budget_frames < BUDGET_WINDOW) {
+        return;
+    }
+    if (budget_over > BUDGET_WINDOW / 2) {
+        runahead_disable("the host cannot keep up");
+    }
+    budget_frames = 0;
+    budget_over = 0;
+}
+
+static void runahead_save_trap(uint16_t addr, void *data)
+{
+    trap_pending = 0;
+
+    if (!runahead_possible()) {
+        showing_ahead = 0;
+        return;
+    }
+
+    ahead_start = tick_now();
+
+    lib_free(saved_state);
+    saved_state = NULL;
+    if (machine_write_snapshot_memory(&saved_state, &saved_state_len, 0, 0, 0) < 0) {
+        snapshot_set_error(SNAPSHOT_NO_ERROR);
+        runahead_disable("cannot save the machine state");
+        return;
+    }
+
+    sound_speculation_begin();
+    frames_left = runahead_frames;
+    showing_ahead = 1;
+}
+
+static void runahead_restore_trap(uint16_t addr, void *data)
+{
+    int ret;
+    tick_t ticks;
+
+    trap_pending = 0;
+
+    ret = machine_read_snapshot_memory(saved_state, saved_state_len, 0);
+    sound_speculation_end();
+
+    /* input that arrived while running ahead belongs to the real frame */
+    keyboard_relatch_matrix();
+    joystick_relatch_matrix();
+
+    if (ret < 0) {
+        snapshot_set_error(SNAPSHOT_NO_ERROR);
+        runahead_disable("cannot restore the machine state");
+        return;
+    }
+
+    ticks = tick_now_delta(ahead_start);
+    num_runs++;
+    run_ticks += ticks;
+
+    runahead_check_budget(ticks);
+}
+
+/* Called at the end of every frame, real or emulated ahead.  */
+void runahead_vsync_hook(void)
+{
+    if (trap_pending) {
+        return;
+    }
+
+    if (frames_left > 0) {
+        if (--frames_left == 0) {
+            /* back to the end of the real frame */
+            trap_pending = 1;
+            interrupt_maincpu_trigger_trap(runahead_restore_trap, NULL);
+        }
+        return;
+    }
+
+    if (!runahead_possible()) {
+        showing_ahead = 0;
+        return;
+    }
+
+    /* the state can only be written between two instructions */
+    trap_pending = 1;
+    interrupt_maincpu_trigger_trap(runahead_save_trap, NULL);
+}
+
+/* Is the current frame emulated ahead?  */
+int runahead_is_speculating(void)
+{
+    return frames_left > 0;
+}
+
+/* Is the current frame hidden? Only the last frame emulated ahead is shown.  */
+int runahead_skip_frame(void)
+{
+    return showing_ahead && frames_left != 1;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_runahead_frames(int val, void *param)
+{
+    if (val < 0 || val > 10) {
+        return -1;
+    }
+    runahead_frames = val;
+
+    if (runahead_frames == 0 && frames_left == 0 && !trap_pending) {
+        showing_ahead = 0;
+        lib_free(saved_state);
+        saved_state = NULL;
+    }
+    budget_frames = 0;
+    budget_over = 0;
+
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "RunAhead", 0, RES_EVENT_NO, NULL,
+      &runahead_frames, set_runahead_frames, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int runahead_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-runahead", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "RunAhead", NULL,
+      "<frames>", "Show the frame <frames> frames ahead of the emulation to hide input latency (0: off, 1..10)" },
+    CMDLINE_LIST_END
+};
+
+int runahead_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void runahead_shutdown(void)
+{
+    if (num_runs > 0) {
+        log_message(LOG_DEFAULT,
+                    "Run-ahead: %lu runs, %.1f us per run.",
+                    num_runs,
+                    (double)run_ticks * 1000000.0 / tick_per_second() / num_runs);
+    }
+    lib_free(saved_state);
+    saved_state = NULL;
+}
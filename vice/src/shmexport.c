@@ -0,0 +1,396 @@
+/*
+ * shmexport.c - Export the machine state to shared memory.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With `ShmExport' enabled, a POSIX shared memory segment called
+   `ShmExportName' is updated at the end of every frame with the RAM, the I/O
+   registers, the palette and the indexed frame buffer. See shmexport.h for
+   the layout. External tools can map the segment and read a consistent frame
+   without stopping the emulation.
+
+   Without a name the segment is called `/vice-<pid>', so that several
+   emulators (or batch mode workers) each get their own. The segment is
+   always created exclusively, an existing segment of the same name is
+   never truncated or removed.  */
+
+#include "vice.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(HAVE_SHM_OPEN) && defined(HAVE_SYS_MMAN_H)
+#define SHMEXPORT_SUPPORTED
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "cmdline.h"
+#include "lib.h"
+#include "log.h"
+#include "machine-video.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "mem.h"
+#include "palette.h"
+#include "resources.h"
+#include "types.h"
+#include "util.h"
+#include "video.h"
+#include "videoarch.h"
+
+#include "shmexport.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SHMEXPORT_BARRIER() __sync_synchronize()
+#else
+#define SHMEXPORT_BARRIER()
+#endif
+
+/* Flag: export the machine state to shared memory?  */
+static int shmexport_enabled = 0;
+
+/* Name of the shared memory segment, empty for the default name.  */
+static char *shmexport_name = NULL;
+
+static shmexport_header_t *segment = NULL;
+static size_t segment_size = 0;
+
+#ifdef SHMEXPORT_SUPPORTED
+/* Name the segment was created with, and the process that created it.  */
+static char *segment_name = NULL;
+static pid_t segment_pid = 0;
+#endif
+
+/* Set when the segment could not be created, cleared when the resources
+   change.  */
+static int open_failed = 0;
+
+/* memory banks to read from, -1 if the machine has none */
+static int ram_bank = -1;
+static int io_bank = -1;
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef SHMEXPORT_SUPPORTED
+
+/* The I/O area of each machine, in the `io' bank.  */
+static void shmexport_get_io_area(uint32_t *address, uint32_t *size)
+{
+    switch (machine_class) {
+        case VICE_MACHINE_C64:
+        case VICE_MACHINE_C64SC:
+        case VICE_MACHINE_C64DTV:
+        case VICE_MACHINE_SCPU64:
+        case VICE_MACHINE_C128:
+        case VICE_MACHINE_VSID:
+            *address = 0xd000;
+            *size = 0x1000;
+            break;
+        case VICE_MACHINE_CBM5x0:
+        case VICE_MACHINE_CBM6x0:
+            *address = 0xd800;
+            *size = 0x800;
+            break;
+        case VICE_MACHINE_PET:
+            *address = 0xe800;
+            *size = 0x800;
+            break;
+        case VICE_MACHINE_PLUS4:
+            *address = 0xfd00;
+            *size = 0x300;
+            break;
+        default:
+            *address = 0;
+            *size = 0;
+            break;
+    }
+}
+
+static void shmexport_close(void)
+{
+    if (segment != NULL) {
+        munmap(segment, segment_size);
+        segment = NULL;
+        /* a forked child only inherited the mapping, the segment belongs to
+           the parent */
+        if (segment_pid == getpid()) {
+            shm_unlink(segment_name);
+        }
+    }
+    lib_free(segment_name);
+    segment_name = NULL;
+    open_failed = 0;
+}
+
+static int shmexport_open(void)
+{
+    shmexport_header_t header;
+    int fd;
+    void *p;
+
+    memset(&header, 0, sizeof header);
+    header.magic = SHMEXPORT_MAGIC;
+    header.version = SHMEXPORT_VERSION;
+    header.machine_class = machine_class;
+
+    header.ram_offset = 4096;
+    header.ram_size = SHMEXPORT_RAM_SIZE;
+    header.io_offset = header.ram_offset + header.ram_size;
+    shmexport_get_io_area(&header.io_address, &header.io_size);
+    header.palette_offset = header.io_offset + SHMEXPORT_IO_SIZE_MAX;
+    header.screen_offset = header.palette_offset + SHMEXPORT_PALETTE_MAX * 3;
+    header.size = header.screen_offset + SHMEXPORT_SCREEN_MAX;
+
+    ram_bank = mem_bank_from_name("ram");
+    io_bank = header.io_size ? mem_bank_from_name("io") : -1;
+    if (io_bank < 0) {
+        header.io_address = 0;
+        header.io_size = 0;
+    }
+
+    if (shmexport_name == NULL || *shmexport_name == '\0') {
+        segment_name = lib_msprintf("/vice-%ld", (long)getpid());
+    } else {
+        segment_name = lib_strdup(shmexport_name);
+    }
+
+    fd = shm_open(segment_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        if (errno == EEXIST) {
+            log_error(LOG_DEFAULT, "ShmExport: shared memory `%s' already exists.", segment_name);
+        } else {
+            log_error(LOG_DEFAULT, "ShmExport: cannot create shared memory `%s'.", segment_name);
+        }
+        lib_free(segment_name);
+        segment_name = NULL;
+        return -1;
+    }
+    if (ftruncate(fd, header.size) < 0) {
+        log_error(LOG_DEFAULT, "ShmExport: cannot resize shared memory `%s'.", segment_name);
+        close(fd);
+        shm_unlink(segment_name);
+        lib_free(segment_name);
+        segment_name = NULL;
+        return -1;
+    }
+    p = mmap(NULL, header.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        log_error(LOG_DEFAULT, "ShmExport: cannot map shared memory `%s'.", segment_name);
+        shm_unlink(segment_name);
+        lib_free(segment_name);
+        segment_name = NULL;
+        return -1;
+    }
+
+    segment = p;
+    segment_size = header.size;
+    segment_pid = getpid();
+    memcpy(segment, &header, sizeof header);
+
+    log_message(LOG_DEFAULT, "ShmExport: exporting to shared memory `%s' (%u bytes).",
+                segment_name, header.size);
+    return 0;
+}
+
+static void shmexport_update_screen(void)
+{
+    struct video_canvas_s *canvas = machine_video_canvas_get(0);
+    draw_buffer_t *db;
+    uint8_t *base = (uint8_t *)segment;
+    unsigned int i, width, height;
+
+    if (canvas == NULL || canvas->draw_buffer == NULL || canvas->draw_buffer->draw_buffer == NULL) {
+        segment->screen_width = segment->screen_height = segment->screen_pitch = 0;
+        return;
+    }
+    db = canvas->draw_buffer;
+
+    width = db->draw_buffer_width;
+    height = db->draw_buffer_height;
+    if (width > SHMEXPORT_SCREEN_MAX) {
+        width = SHMEXPORT_SCREEN_MAX;
+    }
+    if (width * height > SHMEXPORT_SCREEN_MAX) {
+        height = SHMEXPORT_SCREEN_MAX / width;
+    }
+    for (i = 0; i < height; i++) {
+        memcpy(base + segment->screen_offset + i * width,
+               db->draw_buffer + i * db->draw_buffer_pitch, width);
+    }
+    segment->screen_width = width;
+    segment->screen_height = height;
+    segment->screen_pitch = width;
+
+    if (canvas->palette != NULL) {
+        palette_t *palette = canvas->palette;
+        uint8_t *p = base + segment->palette_offset;
+        unsigned int num = palette->num_entries;
+
+        if (num > SHMEXPORT_PALETTE_MAX) {
+            num = SHMEXPORT_PALETTE_MAX;
+        }
+        for (i = 0; i < num; i++) {
+            *p++ = palette->entries[i].red;
+            *p++ = palette->entries[i].green;
+            *p++ = palette->entries[i].blue;
+        }
+        segment->palette_entries = num;
+    }
+}
+
+#endif
+
+/* Called at the end of every frame.  */
+void shmexport_vsync_hook(void)
+{
+#ifdef SHMEXPORT_SUPPORTED
+    uint8_t *ram, *io;
+    unsigned int addr;
+
+    if (!shmexport_enabled) {
+        return;
+    }
+    /* a forked child must not write into the segment of its parent */
+    if (segment != NULL && segment_pid != getpid()) {
+        shmexport_close();
+    }
+    /* created here, so that all resources are set */
+    if (segment == NULL) {
+        if (open_failed || shmexport_open() < 0) {
+            open_failed = 1;
+            return;
+        }
+    }
+
+    segment->sequence++;
+    SHMEXPORT_BARRIER();
+
+    ram = (uint8_t *)segment + segment->ram_offset;
+    for (addr = 0; addr < SHMEXPORT_RAM_SIZE; addr++) {
+        ram[addr] = mem_bank_peek(ram_bank < 0 ? 0 : ram_bank, (uint16_t)addr, NULL);
+    }
+    io = (uint8_t *)segment + segment->io_offset;
+    for (addr = 0; addr < segment->io_size; addr++) {
+        io[addr] = mem_bank_peek(io_bank, (uint16_t)(segment->io_address + addr), NULL);
+    }
+    shmexport_update_screen();
+    segment->clock = maincpu_clk;
+    segment->frame++;
+
+    SHMEXPORT_BARRIER();
+    segment->sequence++;
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_shmexport_enabled(int val, void *param)
+{
+    val = val ? 1 : 0;
+
+#ifdef SHMEXPORT_SUPPORTED
+    if (!val) {
+        shmexport_close();
+    }
+#else
+    if (val) {
+        log_error(LOG_DEFAULT, "ShmExport: shared memory is not supported on this platform.");
+        return -1;
+    }
+#endif
+    shmexport_enabled = val;
+
+    return 0;
+}
+
+static int set_shmexport_name(const char *val, void *param)
+{
+    if (val == NULL) {
+        val = "";
+    }
+    if (val[0] != '\0' && (val[0] != '/' || strchr(val + 1, '/') != NULL)) {
+        log_error(LOG_DEFAULT, "ShmExport: the name must start with a `/' and contain no other.");
+        return -1;
+    }
+    if (shmexport_name != NULL && strcmp(val, shmexport_name) == 0) {
+        return 0;
+    }
+
+#ifdef SHMEXPORT_SUPPORTED
+    shmexport_close();
+#endif
+    util_string_set(&shmexport_name, val);
+
+    return 0;
+}
+
+static const resource_string_t resources_string[] = {
+    { "ShmExportName", "", RES_EVENT_NO, NULL,
+      &shmexport_name, set_shmexport_name, NULL },
+    RESOURCE_STRING_LIST_END
+};
+
+static const resource_int_t resources_int[] = {
+    { "ShmExport", 0, RES_EVENT_NO, NULL,
+      &shmexport_enabled, set_shmexport_enabled, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int shmexport_resources_init(void)
+{
+    if (resources_register_string(resources_string) < 0) {
+        return -1;
+    }
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-shmexport", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "ShmExport", (resource_value_t)1,
+      NULL, "Export RAM, I/O and screen to shared memory every frame" },
+    { "+shmexport", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "ShmExport", (resource_value_t)0,
+      NULL, "Do not export RAM, I/O and screen to shared memory" },
+    { "-shmexportname", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "ShmExportName", NULL,
+      "</name>", "Set the name of the shared memory segment" },
+    CMDLINE_LIST_END
+};
+
+int shmexport_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void shmexport_shutdown(void)
+{
+#ifdef SHMEXPORT_SUPPORTED
+    shmexport_close();
+#endif
+    lib_free(shmexport_name);
+    shmexport_name = NULL;
+}
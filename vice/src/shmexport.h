@@ -0,0 +1,74 @@
+/*
+ * shmexport.h - Export the machine state to shared memory.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_SHMEXPORT_H
+#define VICE_SHMEXPORT_H
+
+#include "types.h"
+
+#define SHMEXPORT_MAGIC     0x45434956  /* "VICE" */
+#define SHMEXPORT_VERSION   1
+
+#define SHMEXPORT_RAM_SIZE      0x10000
+#define SHMEXPORT_IO_SIZE_MAX   0x1000
+#define SHMEXPORT_PALETTE_MAX   256
+#define SHMEXPORT_SCREEN_MAX    (1024 * 1024)
+
+/* Start of the shared memory segment. All offsets are from the start of the
+   segment, all values are in host byte order.
+
+   `sequence' is odd while the emulator updates the segment. A consumer reads
+   it, copies what it needs and reads it again. If both values are the same
+   and even, the copy is a consistent frame.  */
+typedef struct shmexport_header_s {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;              /* of the whole segment */
+    volatile uint32_t sequence;
+    uint32_t frame;             /* frames exported so far */
+    uint32_t machine_class;     /* VICE_MACHINE_xxx */
+    uint64_t clock;             /* main CPU clock at the end of the frame */
+
+    uint32_t ram_offset;
+    uint32_t ram_size;
+
+    uint32_t io_offset;
+    uint32_t io_address;        /* address of the first I/O byte */
+    uint32_t io_size;           /* 0 if the machine has no I/O bank */
+
+    uint32_t palette_offset;    /* 3 bytes per entry: red, green, blue */
+    uint32_t palette_entries;
+
+    uint32_t screen_offset;     /* one palette index per pixel */
+    uint32_t screen_width;
+    uint32_t screen_height;
+    uint32_t screen_pitch;      /* bytes per line */
+} shmexport_header_t;
+
+extern int shmexport_resources_init(void);
+extern int shmexport_cmdline_options_init(void);
+extern void shmexport_shutdown(void);
+
+extern void shmexport_vsync_hook(void);
+
+#endif
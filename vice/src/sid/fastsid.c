@@ -229,6 +229,11 @@ struct sound_s {
     uint8_t filterType;
     uint8_t filterCurType;
     uint16_t filterValue;
+
+    /* temporary buffer for sampling factors other than 1000; kept per chip
+       so that several chips can be rendered in parallel */
+    int16_t *buf;
+    int blen;
 };
 
 /* XXX: check these */
@@ -256,19 +261,16 @@ static signed char ampMod1x8[256];
 
 /* manage temporary buffers. if the requested size is smaller or equal to the
  * size of the already allocated buffer, reuse it.  */
-static int16_t *buf = NULL;
-static int blen = 0;
-
-static int16_t *getbuf(int len)
+static int16_t *getbuf(sound_t *psid, int len)
 {
-    if ((buf == NULL) || (blen < len)) {
-        if (buf) {
-            lib_free(buf);
+    if ((psid->buf == NULL) || (psid->blen < len)) {
+        if (psid->buf) {
+            lib_free(psid->buf);
         }
-        blen = len;
-        buf = lib_calloc(len, 1);
+        psid->blen = len;
+        psid->buf = lib_calloc(len, 1);
     }
-    return buf;
+    return psid->buf;
 }
 
 inline static void dofilter(voice_t *pVoice)
@@ -777,7 +779,7 @@ static int fastsid_calculate_samples(sound_t *psid, int16_t *pbuf, int nr,
         }
         return nr;
     }
-    tmp_buf = getbuf(2 * nr * psid->factor / 1000);
+    tmp_buf = getbuf(psid, 2 * nr * psid->factor / 1000);
     for (i = 0; i < (nr * psid->factor / 1000); i++) {
         tmp_buf[i * interleave] = fastsid_calculate_single_sample(psid, i);
     }
@@ -952,12 +954,10 @@ static int fastsid_init(sound_t *psid, int speed, int cycles_per_sec, int factor
 
 static void fastsid_close(sound_t *psid)
 {
-    lib_free(psid);
-
-    if (buf) {
-        lib_free(buf);
-        buf = NULL;
+    if (psid->buf) {
+        lib_free(psid->buf);
     }
+    lib_free(psid);
 }
 
 
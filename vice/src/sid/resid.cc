@@ -38,12 +38,14 @@ extern "C" {
 #include <string.h>
 
 #include "sid/sid.h" /* sid_engine_t */
+#include "archdep.h"
 #include "lib.h"
 #include "log.h"
 #include "resid.h"
 #include "resources.h"
 #include "sid-snapshot.h"
 #include "types.h"
+#include "util.h"
 
 } // extern "C"
 
@@ -61,34 +63,53 @@ struct sound_s
 
     /* resid sid implementation */
     reSID::SID *sid;
+
+    /* temporary buffer for sampling factors other than 1000; kept per chip
+       so that several chips can be rendered in parallel */
+    short *buf;
+    int blen;
 };
 
 typedef struct sound_s sound_t;
 
 /* manage temporary buffers. if the requested size is smaller or equal to the
  * size of the already allocated buffer, reuse it.  */
-static short *buf = NULL;
-static int blen = 0;
-
-static short *getbuf(int len)
+static short *getbuf(sound_t *psid, int len)
 {
-    if ((buf == NULL) || (blen < len)) {
-        if (buf) {
-            lib_free(buf);
+    if ((psid->buf == NULL) || (psid->blen < len)) {
+        if (psid->buf) {
+            lib_free(psid->buf);
         }
-        blen = len;
-        buf = (short *)lib_calloc(len, 1);
+        psid->blen = len;
+        psid->buf = (short *)lib_calloc(len, 1);
     }
-    return buf;
+    return psid->buf;
 }
 
+/* name of the file in the user cache dir holding the filter model tables */
+#define RESID_FILTER_CACHE_NAME "resid-filter.bin"
+
 static sound_t *resid_open(uint8_t *sidstate)
 {
+    static int filter_cache_set = 0;
     sound_t *psid;
+    char *path;
     int i;
 
+    /* The first reSID::SID calculates the filter model tables, which takes
+       a noticeable part of the startup time. Keep them in the cache dir so
+       later runs can just load them. */
+    if (!filter_cache_set) {
+        path = util_join_paths(archdep_user_cache_path(), RESID_FILTER_CACHE_NAME, NULL);
+        reSID::Filter::set_model_cache(path);
+        lib_free(path);
+        filter_cache_set = 1;
+    }
+
     psid = new sound_t;
     psid->sid = new reSID::SID;
+    psid->buf = NULL;
+    psid->blen = 0;
 
     for (i = 0x00; i <= 0x18; i++) {
         psid->sid->write(i, sidstate[i]);
@@ -236,13 +257,11 @@ static int resid_init(sound_t *psid, int speed, int cycles_per_sec, int factor)
 
 static void resid_close(sound_t *psid)
 {
+    if (psid->buf) {
+        lib_free(psid->buf);
+    }
     delete psid->sid;
     delete psid;
-
-    if (buf) {
-        lib_free(buf);
-        buf = NULL;
-    }
 }
 
 static uint8_t resid_read(sound_t *psid, uint16_t addr)
@@ -276,7 +295,7 @@ static int resid_calculate_samples(sound_t *psid, short *pbuf, int nr,
         return retval;
     }
 
-    tmp_buf = getbuf(2 * nr * psid->factor / 1000);
+    tmp_buf = getbuf(psid, 2 * nr * psid->factor / 1000);
     retval = psid->sid->clock(int_delta_t, tmp_buf, nr * psid->factor / 1000, interleave) * 1000 / psid->factor;
     (*delta_t) += int_delta_t - int_delta_t_original;
     memcpy(pbuf, tmp_buf, 2 * nr);
@@ -244,6 +244,12 @@ static cmdline_option_t stereo_cmdline_options[] =
     { "-sid8address", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "Sid8AddressStart", NULL,
       "<Base address>", NULL },
+    { "-sidparallel", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SidParallel", (void *)1,
+      NULL, "Render multiple SID chips on parallel threads" },
+    { "+sidparallel", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SidParallel", (void *)0,
+      NULL, "Render multiple SID chips one after another" },
     CMDLINE_LIST_END
 };
 
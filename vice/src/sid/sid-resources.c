@@ -65,6 +65,7 @@ static int sid_resid_8580_filter_bias;
 static int sid_resid_enable_raw_output;
 #endif
 int sid_stereo = 0;
+int sid_parallel = 0;
 int checking_sid_stereo;
 unsigned int sid2_address_start;
 unsigned int sid2_address_end;
@@ -178,6 +179,13 @@ static int set_sid_stereo(int val, void *param)
     return 0;
 }
 
+static int set_sid_parallel(int val, void *param)
+{
+    sid_parallel = val ? 1 : 0;
+
+    return 0;
+}
+
 #define SET_SIDx_ADDRESS(sid_nr)                                        \
     int sid_set_sid##sid_nr##_address(int val, void *param)             \
     {                                                                   \
@@ -434,6 +442,8 @@ static const resource_int_t hardsid_resources_int[] = {
 static const resource_int_t stereo_resources_int[] = {
     { "SidStereo", 0, RES_EVENT_SAME, NULL,
       &sid_stereo, set_sid_stereo, NULL },
+    { "SidParallel", 0, RES_EVENT_NO, NULL,
+      &sid_parallel, set_sid_parallel, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -45,6 +45,7 @@ extern int sid_set_sid7_address(int val, void *param);
 extern int sid_set_sid8_address(int val, void *param);
 
 extern int sid_stereo;
+extern int sid_parallel;
 extern int checking_sid_stereo;
 extern unsigned int sid2_address_start;
 extern unsigned int sid2_address_end;
@@ -487,45 +487,22 @@ sound_t *sid_sound_machine_open(int chipno)
 
 /* manage temporary buffers. if the requested size is smaller or equal to the
  * size of the already allocated buffer, reuse it.  */
-static int16_t *buf1 = NULL;
-static int16_t *buf2 = NULL;
-static int16_t *buf3 = NULL;
-static int16_t *buf4 = NULL;
-static int16_t *buf5 = NULL;
-static int16_t *buf6 = NULL;
-static int16_t *buf7 = NULL;
-
-static int blen1 = 0;
-static int blen2 = 0;
-static int blen3 = 0;
-static int blen4 = 0;
-static int blen5 = 0;
-static int blen6 = 0;
-static int blen7 = 0;
-
-#define GETBUFx(nr)                                 \
-    static int16_t *getbuf##nr(int len)             \
-    {                                               \
-        if (buf##nr != NULL) {                      \
-            if (blen##nr >= len) {                  \
-                /* large enough */                  \
-                return buf##nr;                     \
-            }                                       \
-            lib_free(buf##nr);                      \
-        }                                           \
-        buf##nr = lib_calloc(len, sizeof(int16_t)); \
-        blen##nr = len;                             \
-        return buf##nr;                             \
-    }
-
+static int16_t *chip_buf[SOUND_SIDS_MAX];
+static int chip_blen[SOUND_SIDS_MAX];
 
-GETBUFx(1)
-GETBUFx(2)
-GETBUFx(3)
-GETBUFx(4)
-GETBUFx(5)
-GETBUFx(6)
-GETBUFx(7)
+static int16_t *getbuf(int chipno, int len)
+{
+    if (chip_buf[chipno] != NULL) {
+        if (chip_blen[chipno] >= len) {
+            /* large enough */
+            return chip_buf[chipno];
+        }
+        lib_free(chip_buf[chipno]);
+    }
+    chip_buf[chipno] = lib_calloc(len, sizeof(int16_t));
+    chip_blen[chipno] = len;
+    return chip_buf[chipno];
+}
 
 int sid_sound_machine_init_vbr(sound_t *psid, int speed, int cycles_per_sec, int factor)
 {
@@ -539,42 +516,16 @@ int sid_sound_machine_init(sound_t *psid, int speed, int cycles_per_sec)
 
 void sid_sound_machine_close(sound_t *psid)
 {
+    int i;
+
     sid_engine.close(psid);
     /* free the temp. buffers */
-    if (buf1) {
-        lib_free(buf1);
-        blen1 = 0;
-        buf1 = NULL;
-    }
-    if (buf2) {
-        lib_free(buf2);
-        blen2 = 0;
-        buf2 = NULL;
-    }
-    if (buf3) {
-        lib_free(buf3);
-        blen3 = 0;
-        buf3 = NULL;
-    }
-    if (buf4) {
-        lib_free(buf4);
-        blen4 = 0;
-        buf4 = NULL;
-    }
-    if (buf5) {
-        lib_free(buf5);
-        blen5 = 0;
-        buf5 = NULL;
-    }
-    if (buf6) {
-        lib_free(buf6);
-        blen6 = 0;
-        buf6 = NULL;
-    }
-    if (buf7) {
-        lib_free(buf7);
-        blen7 = 0;
-        buf7 = NULL;
+    for (i = 0; i < SOUND_SIDS_MAX; i++) {
+        if (chip_buf[i]) {
+            lib_free(chip_buf[i]);
+            chip_blen[i] = 0;
+            chip_buf[i] = NULL;
+        }
     }
 }
 
@@ -593,296 +544,84 @@ void sid_sound_machine_reset(sound_t *psid, CLOCK cpu_clk)
     sid_engine.reset(psid, cpu_clk);
 }
 
-int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, CLOCK *delta_t)
+/* Mix the rendered samples of chip `chipno' into `pbuf', writing every
+   `interleave'th sample.  */
+static void sid_sound_mix_chip(int16_t *pbuf, const int16_t *src, int nr, int interleave)
 {
     int i;
-    int16_t *tmp_buf1;
-    int16_t *tmp_buf2;
-    int16_t *tmp_buf3;
-    int16_t *tmp_buf4;
-    int16_t *tmp_buf5;
-    int16_t *tmp_buf6;
-    int16_t *tmp_buf7;
-    int tmp_nr = 0;
-    CLOCK tmp_delta_t = *delta_t;
-
-    if (soc == 1 && scc == 1) {
-        return sid_engine.calculate_samples(psid[0], pbuf, nr, 1, delta_t);
-    }
-    if (soc == 1 && scc == 2) {
-        tmp_buf1 = getbuf1(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, 1, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, 1, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
-        }
-        return tmp_nr;
-    }
-    if (soc == 1 && scc == 3) {
-        tmp_buf1 = getbuf1(2 * nr);
-        tmp_buf2 = getbuf2(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, 1, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, 1, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
-        }
-        return tmp_nr;
-    }
-    if (soc == 1 && scc == 4) {
-        tmp_buf1 = getbuf1(2 * nr);
-        tmp_buf2 = getbuf2(2 * nr);
-        tmp_buf3 = getbuf3(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, 1, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, 1, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf3[i]);
-        }
-        return tmp_nr;
-    }
-    if (soc == 1 && scc == 5) {
-        tmp_buf1 = getbuf1(2 * nr);
-        tmp_buf2 = getbuf2(2 * nr);
-        tmp_buf3 = getbuf3(2 * nr);
-        tmp_buf4 = getbuf4(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf4, nr, 1, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, 1, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf3[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf4[i]);
-        }
-        return tmp_nr;
-    }
-    if (soc == 1 && scc == 6) {
-        tmp_buf1 = getbuf1(2 * nr);
-        tmp_buf2 = getbuf2(2 * nr);
-        tmp_buf3 = getbuf3(2 * nr);
-        tmp_buf4 = getbuf4(2 * nr);
-        tmp_buf5 = getbuf5(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf4, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf5, nr, 1, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, 1, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf3[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf4[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf5[i]);
-        }
-        return tmp_nr;
-    }
-    if (soc == 1 && scc == 7) {
-        tmp_buf1 = getbuf1(2 * nr);
-        tmp_buf2 = getbuf2(2 * nr);
-        tmp_buf3 = getbuf3(2 * nr);
-        tmp_buf4 = getbuf4(2 * nr);
-        tmp_buf5 = getbuf5(2 * nr);
-        tmp_buf6 = getbuf6(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf4, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf5, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[6], tmp_buf6, nr, 1, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, 1, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf3[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf4[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf5[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf6[i]);
+
+    if (interleave == 1) {
+        for (i = 0; i < nr; i++) {
+            pbuf[i] = sound_audio_mix(pbuf[i], src[i]);
         }
-        return tmp_nr;
-    }
-    if (soc == 1 && scc == 8) {
-        tmp_buf1 = getbuf1(2 * nr);
-        tmp_buf2 = getbuf2(2 * nr);
-        tmp_buf3 = getbuf3(2 * nr);
-        tmp_buf4 = getbuf4(2 * nr);
-        tmp_buf5 = getbuf5(2 * nr);
-        tmp_buf6 = getbuf6(2 * nr);
-        tmp_buf7 = getbuf7(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf4, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf5, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[6], tmp_buf6, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[7], tmp_buf7, nr, 1, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, 1, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf3[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf4[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf5[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf6[i]);
-            pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf7[i]);
+    } else {
+        for (i = 0; i < nr; i++) {
+            pbuf[i * interleave] = sound_audio_mix(pbuf[i * interleave], src[i]);
         }
-        return tmp_nr;
     }
-    if (soc == 2 && scc == 1) {
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, 2, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[(i * 2) + 1] = pbuf[i * 2];
+}
+
+int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, CLOCK *delta_t)
+{
+    int i;
+    int chip_nr[SOUND_SIDS_MAX];
+    CLOCK chip_delta_t[SOUND_SIDS_MAX];
+    int16_t *dest[SOUND_SIDS_MAX];
+
+    if (scc == 1) {
+        int tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, soc, delta_t);
+
+        if (soc == 2) {
+            for (i = 0; i < tmp_nr; i++) {
+                pbuf[(i * 2) + 1] = pbuf[i * 2];
+            }
         }
         return tmp_nr;
     }
-    if (soc == 2 && scc == 2) {
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, 2, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, 2, delta_t);
-        return tmp_nr;
-    }
-    if (soc == 2 && scc == 3) {
-        tmp_buf1 = getbuf1(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, 2, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, 2, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i]);
-            pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf1[i]);
-        }
-    }
-    if (soc == 2 && scc == 4) {
-        tmp_buf1 = getbuf1(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf1 + 1, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, 2, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, 2, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
-            pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf1[(i * 2) + 1]);
-        }
+
+    /* Every chip is clocked over the same interval, so each one gets its own
+       copy of delta_t and renders into its own buffer.  Register writes have
+       already been applied by sound_store() before we got here, so the chips
+       are independent of each other and can be rendered in parallel.  */
+    for (i = 0; i < scc; i++) {
+        chip_delta_t[i] = *delta_t;
+        dest[i] = getbuf(i, nr);
     }
-    if (soc == 2 && scc == 5) {
-        tmp_buf1 = getbuf1(2 * nr);
-        tmp_buf2 = getbuf2(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf1 + 1, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf2, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, 2, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, 2, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
-            pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf2[i]);
-            pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf1[(i * 2) + 1]);
-            pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf2[i]);
-        }
+
+#pragma omp parallel for if (sid_parallel) schedule(static, 1)
+    for (i = 0; i < scc; i++) {
+        chip_nr[i] = sid_engine.calculate_samples(psid[i], dest[i], nr, 1, &chip_delta_t[i]);
     }
-    if (soc == 2 && scc == 6) {
-        tmp_buf1 = getbuf1(2 * nr);
-        tmp_buf2 = getbuf2(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf1 + 1, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf2, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf2 + 1, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, 2, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, 2, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
-            pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf2[i * 2]);
-            pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf1[(i * 2) + 1]);
-            pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf2[(i * 2) + 1]);
+
+    /* The first two chips are the base of the output, the second one is
+       where the result and the remaining delta_t have always come from.  */
+    *delta_t = chip_delta_t[1];
+    nr = chip_nr[1];
+
+    if (soc == 1) {
+        memcpy(pbuf, dest[1], nr * sizeof(int16_t));
+        sid_sound_mix_chip(pbuf, dest[0], nr, 1);
+        for (i = 2; i < scc; i++) {
+            sid_sound_mix_chip(pbuf, dest[i], nr, 1);
         }
+        return nr;
     }
-    if (soc == 2 && scc == 7) {
-        tmp_buf1 = getbuf1(2 * nr);
-        tmp_buf2 = getbuf2(2 * nr);
-        tmp_buf3 = getbuf3(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf1 + 1, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf2, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf2 + 1, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[6], tmp_buf3, nr, 1, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, 2, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, 2, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
-            pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf2[i * 2]);
-            pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf3[i]);
-            pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf1[(i * 2) + 1]);
-            pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf2[(i * 2) + 1]);
-            pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf3[i]);
-        }
+
+    /* Stereo: even chips go left, odd chips go right, and an unpaired last
+       chip goes to both channels.  */
+    for (i = 0; i < nr; i++) {
+        pbuf[i * 2] = dest[0][i];
+        pbuf[(i * 2) + 1] = dest[1][i];
     }
-    if (soc == 2 && scc == 8) {
-        tmp_buf1 = getbuf1(2 * nr);
-        tmp_buf2 = getbuf2(2 * nr);
-        tmp_buf3 = getbuf3(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf1 + 1, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf2, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf2 + 1, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[6], tmp_buf3, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[7], tmp_buf3 + 1, nr, 2, &tmp_delta_t);
-        tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, 2, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, 2, delta_t);
-        for (i = 0; i < tmp_nr; i++) {
-            pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
-            pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf2[i * 2]);
-            pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf3[i * 2]);
-            pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf1[(i * 2) + 1]);
-            pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf2[(i * 2) + 1]);
-            pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf3[(i * 2) + 1]);
+    for (i = 2; i < scc; i++) {
+        if ((i & 1) == 0 && i == scc - 1) {
+            sid_sound_mix_chip(pbuf, dest[i], nr, 2);
+            sid_sound_mix_chip(pbuf + 1, dest[i], nr, 2);
+        } else {
+            sid_sound_mix_chip(pbuf + (i & 1), dest[i], nr, 2);
         }
     }
-    return tmp_nr;
+    return nr;
 }
 
 char *sid_sound_machine_dump_state(sound_t *psid)
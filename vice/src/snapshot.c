@@ -67,10 +67,47 @@ static const char snapshot_version_magic_string[] = "VICE Version\032";
 #define SNAPSHOT_MAGIC_LEN              19
 #define SNAPSHOT_VERSION_MAGIC_LEN      13
 
-struct snapshot_module_s {
-    /* File descriptor.  */
+/* Name used in error messages for snapshots held in memory.  */
+#define SNAPSHOT_MEMORY_NAME            ((char *)"<memory>")
+
+/* Initial size of the buffer of a memory snapshot.  */
+#define SNAPSHOT_MEMORY_INITIAL_SIZE    0x10000
+
+typedef struct snapshot_delta_s snapshot_delta_t;
+
+/* Backing store of a snapshot: either a stdio file or a memory buffer.  */
+typedef struct snapshot_stream_s {
+    /* File descriptor, NULL for memory snapshots.  */
     FILE *file;
 
+    /* Memory buffer; owned by the stream only when writing.  */
+    uint8_t *data;
+
+    /* Number of valid bytes in the memory buffer.  */
+    size_t len;
+
+    /* Allocated size of the memory buffer.  */
+    size_t size;
+
+    /* Current position in the memory buffer.  */
+    size_t pos;
+
+    /* Chain the snapshot is written for, see
+       `snapshot_chain_begin_append()'.  */
+    snapshot_chain_t *chain;
+
+    /* When the newest state of `chain' is overwritten in place: the delta
+       collecting every page of it before it is changed, the length of that
+       state and which of its pages are already in the delta.  */
+    snapshot_delta_t *delta;
+    size_t old_len;
+    uint8_t *saved;
+} snapshot_stream_t;
+
+struct snapshot_module_s {
+    /* Stream of the snapshot this module belongs to.  */
+    snapshot_stream_t *stream;
+
     /* Flag: are we writing it?  */
     int write_mode;
 
@@ -82,11 +119,14 @@ struct snapshot_module_s {
 
     /* Offset of the size field in the file.  */
     long size_offset;
+
+    /* Size the module had in the state being overwritten.  */
+    uint32_t old_size;
 };
 
 struct snapshot_s {
-    /* File descriptor.  */
-    FILE *file;
+    /* File or memory buffer.  */
+    snapshot_stream_t stream;
 
     /* Offset of the first module.  */
     long first_module_offset;
@@ -95,12 +135,110 @@ struct snapshot_s {
     int write_mode;
 };
 
+static void snapshot_stream_save_pages(snapshot_stream_t *f, const uint8_t *data, size_t num);
+static int snapshot_stream_write_tracked(snapshot_stream_t *f, const uint8_t *data, size_t num);
+static void snapshot_stream_enter_chain(snapshot_stream_t *f);
+static void snapshot_stream_leave_chain(snapshot_stream_t *f);
+static void snapshot_stream_finish_chain(snapshot_stream_t *f);
+
+/* ------------------------------------------------------------------------- */
+
+static long snapshot_stream_tell(snapshot_stream_t *f)
+{
+    if (f->file != NULL) {
+        return ftell(f->file);
+    }
+    return (long)f->pos;
+}
+
+static int snapshot_stream_seek(snapshot_stream_t *f, long offset)
+{
+    if (f->file != NULL) {
+        return fseek(f->file, offset, SEEK_SET);
+    }
+    if (offset < 0) {
+        return -1;
+    }
+    /* like fseek(), seeking past the end is fine, reading there is not */
+    f->pos = (size_t)offset;
+    return 0;
+}
+
+static int snapshot_stream_write(snapshot_stream_t *f, const uint8_t *data, size_t num)
+{
+    if (f->file != NULL) {
+        return fwrite(data, num, 1, f->file) < 1 ? -1 : 0;
+    }
+
+    if (f->pos + num > f->size) {
+        size_t size = f->size ? f->size : SNAPSHOT_MEMORY_INITIAL_SIZE;
+
+        while (f->pos + num > size) {
+            size *= 2;
+        }
+        f->data = lib_realloc(f->data, size);
+        f->size = size;
+    }
+    if (f->pos > f->len) {
+        size_t pos = f->pos;
+
+        if (f->delta != NULL) {
+            f->pos = f->len;
+            snapshot_stream_save_pages(f, NULL, pos - f->len);
+            f->pos = pos;
+        }
+        memset(f->data + f->len, 0, pos - f->len);
+    }
+    if (f->delta != NULL) {
+        snapshot_stream_save_pages(f, data, num);
+    }
+    memcpy(f->data + f->pos, data, num);
+    f->pos += num;
+    if (f->pos > f->len) {
+        f->len = f->pos;
+    }
+    return 0;
+}
+
+static int snapshot_stream_read(snapshot_stream_t *f, uint8_t *data, size_t num)
+{
+    if (f->file != NULL) {
+        return fread(data, num, 1, f->file) < 1 ? -1 : 0;
+    }
+
+    if (f->pos > f->len || num > f->len - f->pos) {
+        return -1;
+    }
+    memcpy(data, f->data + f->pos, num);
+    f->pos += num;
+    return 0;
+}
+
+static int snapshot_stream_putc(snapshot_stream_t *f, uint8_t c)
+{
+    if (f->file != NULL) {
+        return fputc(c, f->file);
+    }
+    return snapshot_stream_write(f, &c, 1) < 0 ? EOF : c;
+}
+
+static int snapshot_stream_getc(snapshot_stream_t *f)
+{
+    if (f->file != NULL) {
+        return fgetc(f->file);
+    }
+    if (f->pos >= f->len) {
+        return EOF;
+    }
+    return f->data[f->pos++];
+}
+
 /* ------------------------------------------------------------------------- */
 
-static int snapshot_write_byte(FILE *f, uint8_t data)
+static int snapshot_write_byte(snapshot_stream_t *f, uint8_t data)
 {
-    current_fpos = ftell(f);
-    if (fputc(data, f) == EOF) {
+    current_fpos = snapshot_stream_tell(f);
+    if (snapshot_stream_putc(f, data) == EOF) {
         snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
         return -1;
     }
@@ -108,9 +246,9 @@ static int snapshot_write_byte(FILE *f, uint8_t data)
     return 0;
 }
 
-static int snapshot_write_word(FILE *f, uint16_t data)
+static int snapshot_write_word(snapshot_stream_t *f, uint16_t data)
 {
-    current_fpos = ftell(f);
+    current_fpos = snapshot_stream_tell(f);
     if (snapshot_write_byte(f, (uint8_t)(data & 0xff)) < 0
         || snapshot_write_byte(f, (uint8_t)(data >> 8)) < 0) {
         return -1;
@@ -119,9 +257,9 @@ static int snapshot_write_word(FILE *f, uint16_t data)
     return 0;
 }
 
-static int snapshot_write_dword(FILE *f, uint32_t data)
+static int snapshot_write_dword(snapshot_stream_t *f, uint32_t data)
 {
-    current_fpos = ftell(f);
+    current_fpos = snapshot_stream_tell(f);
     if (snapshot_write_word(f, (uint16_t)(data & 0xffff)) < 0
         || snapshot_write_word(f, (uint16_t)(data >> 16)) < 0) {
         return -1;
@@ -130,9 +268,9 @@ static int snapshot_write_dword(FILE *f, uint32_t data)
     return 0;
 }
 
-static int snapshot_write_qword(FILE *f, uint64_t data)
+static int snapshot_write_qword(snapshot_stream_t *f, uint64_t data)
 {
-    current_fpos = ftell(f);
+    current_fpos = snapshot_stream_tell(f);
     if (snapshot_write_dword(f, (uint32_t)(data & 0xffffffff)) < 0
         || snapshot_write_dword(f, (uint32_t)(data >> 32)) < 0) {
         return -1;
@@ -141,12 +279,12 @@ static int snapshot_write_qword(FILE *f, uint64_t data)
     return 0;
 }
 
-static int snapshot_write_double(FILE *f, double data)
+static int snapshot_write_double(snapshot_stream_t *f, double data)
 {
     uint8_t *byte_data = (uint8_t *)&data;
     int i;
 
-    current_fpos = ftell(f);
+    current_fpos = snapshot_stream_tell(f);
     for (i = 0; i < sizeof(double); i++) {
         if (snapshot_write_byte(f, byte_data[i]) < 0) {
             return -1;
@@ -155,13 +293,13 @@ static int snapshot_write_double(FILE *f, double data)
     return 0;
 }
 
-static int snapshot_write_padded_string(FILE *f, const char *s, uint8_t pad_char,
+static int snapshot_write_padded_string(snapshot_stream_t *f, const char *s, uint8_t pad_char,
                                         int len)
 {
     int i, found_zero;
     uint8_t c;
 
-    current_fpos = ftell(f);
+    current_fpos = snapshot_stream_tell(f);
     for (i = found_zero = 0; i < len; i++) {
         if (!found_zero && s[i] == 0) {
             found_zero = 1;
@@ -175,10 +313,13 @@ static int snapshot_write_padded_string(FILE *f, const char *s, uint8_t pad_char
     return 0;
 }
 
-static int snapshot_write_byte_array(FILE *f, const uint8_t *data, unsigned int num)
+static int snapshot_write_byte_array(snapshot_stream_t *f, const uint8_t *data, unsigned int num)
 {
-    current_fpos = ftell(f);
-    if (num > 0 && fwrite(data, (size_t)num, 1, f) < 1) {
+    current_fpos = snapshot_stream_tell(f);
+    if (f->chain != NULL && snapshot_stream_write_tracked(f, data, (size_t)num)) {
+        return 0;
+    }
+    if (num > 0 && snapshot_stream_write(f, data, (size_t)num) < 0) {
         snapshot_error = SNAPSHOT_WRITE_BYTE_ARRAY_ERROR;
         return -1;
     }
@@ -186,11 +327,11 @@ static int snapshot_write_byte_array(FILE *f, const uint8_t *data, unsigned int
     return 0;
 }
 
-static int snapshot_write_word_array(FILE *f, const uint16_t *data, unsigned int num)
+static int snapshot_write_word_array(snapshot_stream_t *f, const uint16_t *data, unsigned int num)
 {
     unsigned int i;
 
-    current_fpos = ftell(f);
+    current_fpos = snapshot_stream_tell(f);
     for (i = 0; i < num; i++) {
         if (snapshot_write_word(f, data[i]) < 0) {
             return -1;
@@ -200,11 +341,11 @@ static int snapshot_write_word_array(FILE *f, const uint16_t *data, unsigned int
     return 0;
 }
 
-static int snapshot_write_dword_array(FILE *f, const uint32_t *data, unsigned int num)
+static int snapshot_write_dword_array(snapshot_stream_t *f, const uint32_t *data, unsigned int num)
 {
     unsigned int i;
 
-    current_fpos = ftell(f);
+    current_fpos = snapshot_stream_tell(f);
     for (i = 0; i < num; i++) {
         if (snapshot_write_dword(f, data[i]) < 0) {
             return -1;
@@ -215,13 +356,13 @@ static int snapshot_write_dword_array(FILE *f, const uint32_t *data, unsigned in
 }
 
 
-static int snapshot_write_string(FILE *f, const char *s)
+static int snapshot_write_string(snapshot_stream_t *f, const char *s)
 {
     size_t len, i;
 
     len = s ? (strlen(s) + 1) : 0;      /* length includes nullbyte */
 
-    current_fpos = ftell(f);
+    current_fpos = snapshot_stream_tell(f);
     if (snapshot_write_word(f, (uint16_t)len) < 0) {
         return -1;
     }
@@ -235,12 +376,12 @@ static int snapshot_write_string(FILE *f, const char *s)
     return (int)(len + sizeof(uint16_t));
 }
 
-static int snapshot_read_byte(FILE *f, uint8_t *b_return)
+static int snapshot_read_byte(snapshot_stream_t *f, uint8_t *b_return)
 {
     int c;
 
-    current_fpos = ftell(f);
-    c = fgetc(f);
+    current_fpos = snapshot_stream_tell(f);
+    c = snapshot_stream_getc(f);
     if (c == EOF) {
         snapshot_error = SNAPSHOT_READ_EOF_ERROR;
         return -1;
@@ -249,11 +390,11 @@ static int snapshot_read_byte(FILE *f, uint8_t *b_return)
     return 0;
 }
 
-static int snapshot_read_word(FILE *f, uint16_t *w_return)
+static int snapshot_read_word(snapshot_stream_t *f, uint16_t *w_return)
 {
     uint8_t lo, hi;
 
-    current_fpos = ftell(f);
+    current_fpos = snapshot_stream_tell(f);
     if (snapshot_read_byte(f, &lo) < 0 || snapshot_read_byte(f, &hi) < 0) {
         return -1;
     }
@@ -262,11 +403,11 @@ static int snapshot_read_word(FILE *f, uint16_t *w_return)
     return 0;
 }
 
-static int snapshot_read_dword(FILE *f, uint32_t *dw_return)
+static int snapshot_read_dword(snapshot_stream_t *f, uint32_t *dw_return)
 {
     uint16_t lo, hi;
 
-    current_fpos = ftell(f);
+    current_fpos = snapshot_stream_tell(f);
     if (snapshot_read_word(f, &lo) < 0 || snapshot_read_word(f, &hi) < 0) {
         return -1;
     }
@@ -275,11 +416,11 @@ static int snapshot_read_dword(FILE *f, uint32_t *dw_return)
     return 0;
 }
 
-static int snapshot_read_qword(FILE *f, uint64_t *qw_return)
+static int snapshot_read_qword(snapshot_stream_t *f, uint64_t *qw_return)
 {
     uint32_t lo, hi;
 
-    current_fpos = ftell(f);
+    current_fpos = snapshot_stream_tell(f);
     if (snapshot_read_dword(f, &lo) < 0 || snapshot_read_dword(f, &hi) < 0) {
         return -1;
     }
@@ -288,16 +429,16 @@ static int snapshot_read_qword(FILE *f, uint64_t *qw_return)
     return 0;
 }
 
-static int snapshot_read_double(FILE *f, double *d_return)
+static int snapshot_read_double(snapshot_stream_t *f, double *d_return)
 {
     int i;
     int c;
     double val;
     uint8_t *byte_val = (uint8_t *)&val;
 
-    current_fpos = ftell(f);
+    current_fpos = snapshot_stream_tell(f);
     for (i = 0; i < sizeof(double); i++) {
-        c = fgetc(f);
+        c = snapshot_stream_getc(f);
         if (c == EOF) {
             snapshot_error = SNAPSHOT_READ_EOF_ERROR;
             return -1;
@@ -308,10 +449,10 @@ static int snapshot_read_double(FILE *f, double *d_return)
     return 0;
 }
 
-static int snapshot_read_byte_array(FILE *f, uint8_t *b_return, unsigned int num)
+static int snapshot_read_byte_array(snapshot_stream_t *f, uint8_t *b_return, unsigned int num)
 {
-    current_fpos = ftell(f);
-    if (num > 0 && fread(b_return, (size_t)num, 1, f) < 1) {
+    current_fpos = snapshot_stream_tell(f);
+    if (num > 0 && snapshot_stream_read(f, b_return, (size_t)num) < 0) {
         snapshot_error = SNAPSHOT_READ_BYTE_ARRAY_ERROR;
         return -1;
     }
@@ -319,11 +460,11 @@ static int snapshot_read_byte_array(FILE *f, uint8_t *b_return, unsigned int num
     return 0;
 }
 
-static int snapshot_read_word_array(FILE *f, uint16_t *w_return, unsigned int num)
+static int snapshot_read_word_array(snapshot_stream_t *f, uint16_t *w_return, unsigned int num)
 {
     unsigned int i;
 
-    current_fpos = ftell(f);
+    current_fpos = snapshot_stream_tell(f);
     for (i = 0; i < num; i++) {
         if (snapshot_read_word(f, w_return + i) < 0) {
             return -1;
@@ -333,11 +474,11 @@ static int snapshot_read_word_array(FILE *f, uint16_t *w_return, unsigned int nu
     return 0;
 }
 
-static int snapshot_read_dword_array(FILE *f, uint32_t *dw_return, unsigned int num)
+static int snapshot_read_dword_array(snapshot_stream_t *f, uint32_t *dw_return, unsigned int num)
 {
     unsigned int i;
 
-    current_fpos = ftell(f);
+    current_fpos = snapshot_stream_tell(f);
     for (i = 0; i < num; i++) {
         if (snapshot_read_dword(f, dw_return + i) < 0) {
             return -1;
@@ -347,7 +488,7 @@ static int snapshot_read_dword_array(FILE *f, uint32_t *dw_return, unsigned int
     return 0;
 }
 
-static int snapshot_read_string(FILE *f, char **s)
+static int snapshot_read_string(snapshot_stream_t *f, char **s)
 {
     int i, len;
     uint16_t w;
@@ -357,7 +498,7 @@ static int snapshot_read_string(FILE *f, char **s)
     lib_free(*s);
     *s = NULL;      /* don't leave a bogus pointer */
 
-    current_fpos = ftell(f);
+    current_fpos = snapshot_stream_tell(f);
     if (snapshot_read_word(f, &w) < 0) {
         return -1;
     }
@@ -383,7 +524,7 @@ static int snapshot_read_string(FILE *f, char **s)
 
 int snapshot_module_write_byte(snapshot_module_t *m, uint8_t b)
 {
-    if (snapshot_write_byte(m->file, b) < 0) {
+    if (snapshot_write_byte(m->stream, b) < 0) {
         return -1;
     }
 
@@ -393,7 +534,7 @@ int snapshot_module_write_byte(snapshot_module_t *m, uint8_t b)
 
 int snapshot_module_write_word(snapshot_module_t *m, uint16_t w)
 {
-    if (snapshot_write_word(m->file, w) < 0) {
+    if (snapshot_write_word(m->stream, w) < 0) {
         return -1;
     }
 
@@ -403,7 +544,7 @@ int snapshot_module_write_word(snapshot_module_t *m, uint16_t w)
 
 int snapshot_module_write_dword(snapshot_module_t *m, uint32_t dw)
 {
-    if (snapshot_write_dword(m->file, dw) < 0) {
+    if (snapshot_write_dword(m->stream, dw) < 0) {
         return -1;
     }
 
@@ -413,7 +554,7 @@ int snapshot_module_write_dword(snapshot_module_t *m, uint32_t dw)
 
 int snapshot_module_write_qword(snapshot_module_t *m, uint64_t qw)
 {
-    if (snapshot_write_qword(m->file, qw) < 0) {
+    if (snapshot_write_qword(m->stream, qw) < 0) {
         return -1;
     }
 
@@ -423,7 +564,7 @@ int snapshot_module_write_qword(snapshot_module_t *m, uint64_t qw)
 
 int snapshot_module_write_double(snapshot_module_t *m, double db)
 {
-    if (snapshot_write_double(m->file, db) < 0) {
+    if (snapshot_write_double(m->stream, db) < 0) {
         return -1;
     }
 
@@ -433,7 +574,7 @@ int snapshot_module_write_double(snapshot_module_t *m, double db)
 
 int snapshot_module_write_padded_string(snapshot_module_t *m, const char *s, uint8_t pad_char, int len)
 {
-    if (snapshot_write_padded_string(m->file, s, (uint8_t)pad_char, len) < 0) {
+    if (snapshot_write_padded_string(m->stream, s, (uint8_t)pad_char, len) < 0) {
         return -1;
     }
 
@@ -443,7 +584,7 @@ int snapshot_module_write_padded_string(snapshot_module_t *m, const char *s, uin
 
 int snapshot_module_write_byte_array(snapshot_module_t *m, const uint8_t *b, unsigned int num)
 {
-    if (snapshot_write_byte_array(m->file, b, num) < 0) {
+    if (snapshot_write_byte_array(m->stream, b, num) < 0) {
         return -1;
     }
 
@@ -453,7 +594,7 @@ int snapshot_module_write_byte_array(snapshot_module_t *m, const uint8_t *b, uns
 
 int snapshot_module_write_word_array(snapshot_module_t *m, const uint16_t *w, unsigned int num)
 {
-    if (snapshot_write_word_array(m->file, w, num) < 0) {
+    if (snapshot_write_word_array(m->stream, w, num) < 0) {
         return -1;
     }
 
@@ -463,7 +604,7 @@ int snapshot_module_write_word_array(snapshot_module_t *m, const uint16_t *w, un
 
 int snapshot_module_write_dword_array(snapshot_module_t *m, const uint32_t *dw, unsigned int num)
 {
-    if (snapshot_write_dword_array(m->file, dw, num) < 0) {
+    if (snapshot_write_dword_array(m->stream, dw, num) < 0) {
         return -1;
     }
 
@@ -474,7 +615,7 @@ int snapshot_module_write_dword_array(snapshot_module_t *m, const uint32_t *dw,
 int snapshot_module_write_string(snapshot_module_t *m, const char *s)
 {
     int len;
-    len = snapshot_write_string(m->file, s);
+    len = snapshot_write_string(m->stream, s);
     if (len < 0) {
         snapshot_error = SNAPSHOT_ILLEGAL_STRING_LENGTH_ERROR;
         return -1;
@@ -488,100 +629,104 @@ int snapshot_module_write_string(snapshot_module_t *m, const char *s)
 
 int snapshot_module_read_byte(snapshot_module_t *m, uint8_t *b_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint8_t) > m->offset + m->size) {
+    current_fpos = snapshot_stream_tell(m->stream);
+    if (snapshot_stream_tell(m->stream) + sizeof(uint8_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_byte(m->file, b_return);
+    return snapshot_read_byte(m->stream, b_return);
 }
 
 int snapshot_module_read_word(snapshot_module_t *m, uint16_t *w_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint16_t) > m->offset + m->size) {
+    current_fpos = snapshot_stream_tell(m->stream);
+    if (snapshot_stream_tell(m->stream) + sizeof(uint16_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_word(m->file, w_return);
+    return snapshot_read_word(m->stream, w_return);
 }
 
 int snapshot_module_read_dword(snapshot_module_t *m, uint32_t *dw_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint32_t) > m->offset + m->size) {
+    current_fpos = snapshot_stream_tell(m->stream);
+    if (snapshot_stream_tell(m->stream) + sizeof(uint32_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_dword(m->file, dw_return);
+    return snapshot_read_dword(m->stream, dw_return);
 }
 
 int snapshot_module_read_qword(snapshot_module_t *m, uint64_t *qw_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint64_t) > m->offset + m->size) {
+    current_fpos = snapshot_stream_tell(m->stream);
+    if (snapshot_stream_tell(m->stream) + sizeof(uint64_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_qword(m->file, qw_return);
+    return snapshot_read_qword(m->stream, qw_return);
 }
 
 int snapshot_module_read_double(snapshot_module_t *m, double *db_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(double) > m->offset + m->size) {
+    current_fpos = snapshot_stream_tell(m->stream);
+    if (snapshot_stream_tell(m->stream) + sizeof(double) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_double(m->file, db_return);
+    return snapshot_read_double(m->stream, db_return);
 }
 
 int snapshot_module_read_byte_array(snapshot_module_t *m, uint8_t *b_return, unsigned int num)
 {
-    current_fpos = ftell(m->file);
-    if ((long)(ftell(m->file) + num) > (long)(m->offset + m->size)) {
+    current_fpos = snapshot_stream_tell(m->stream);
+    if ((long)(snapshot_stream_tell(m->stream) + num) > (long)(m->offset + m->size)) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_byte_array(m->file, b_return, num);
+    if (snapshot_read_byte_array(m->stream, b_return, num) < 0) {
+        return -1;
+    }
+    snapshot_dirty_mark(b_return, num);
+    return 0;
 }
 
 int snapshot_module_read_word_array(snapshot_module_t *m, uint16_t *w_return, unsigned int num)
 {
-    if ((long)(ftell(m->file) + num * sizeof(uint16_t)) > (long)(m->offset + m->size)) {
+    if ((long)(snapshot_stream_tell(m->stream) + num * sizeof(uint16_t)) > (long)(m->offset + m->size)) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_word_array(m->file, w_return, num);
+    return snapshot_read_word_array(m->stream, w_return, num);
 }
 
 int snapshot_module_read_dword_array(snapshot_module_t *m, uint32_t *dw_return, unsigned int num)
 {
-    current_fpos = ftell(m->file);
-    if ((long)(ftell(m->file) + num * sizeof(uint32_t)) > (long)(m->offset + m->size)) {
+    current_fpos = snapshot_stream_tell(m->stream);
+    if ((long)(snapshot_stream_tell(m->stream) + num * sizeof(uint32_t)) > (long)(m->offset + m->size)) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_dword_array(m->file, dw_return, num);
+    return snapshot_read_dword_array(m->stream, dw_return, num);
 }
 
 int snapshot_module_read_string(snapshot_module_t *m, char **charp_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint16_t) > m->offset + m->size) {
+    current_fpos = snapshot_stream_tell(m->stream);
+    if (snapshot_stream_tell(m->stream) + sizeof(uint16_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_string(m->file, charp_return);
+    return snapshot_read_string(m->stream, charp_return);
 }
 
 int snapshot_module_read_byte_into_int(snapshot_module_t *m, int *value_return)
@@ -681,24 +826,33 @@ snapshot_module_t *snapshot_module_create(snapshot_t *s, const char *name, uint8
     current_module = (char *)name;
 
     m = lib_malloc(sizeof(snapshot_module_t));
-    m->file = s->file;
-    m->offset = ftell(s->file);
+    m->stream = &s->stream;
+    m->offset = snapshot_stream_tell(&s->stream);
     if (m->offset == -1) {
         snapshot_error = SNAPSHOT_ILLEGAL_OFFSET_ERROR;
         lib_free(m);
         return NULL;
     }
     m->write_mode = 1;
+    m->old_size = 0;
+
+    if (s->stream.delta != NULL
+        && s->stream.pos + SNAPSHOT_MODULE_NAME_LEN + 2 + 4 <= s->stream.old_len) {
+        const uint8_t *p = s->stream.data + s->stream.pos + SNAPSHOT_MODULE_NAME_LEN + 2;
+
+        m->old_size = (uint32_t)p[0] | ((uint32_t)p[1] << 8)
+                      | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
 
-    if (snapshot_write_padded_string(s->file, name, (uint8_t)0, SNAPSHOT_MODULE_NAME_LEN) < 0
-        || snapshot_write_byte(s->file, major_version) < 0
-        || snapshot_write_byte(s->file, minor_version) < 0
-        || snapshot_write_dword(s->file, 0) < 0) {
+    if (snapshot_write_padded_string(&s->stream, name, (uint8_t)0, SNAPSHOT_MODULE_NAME_LEN) < 0
+        || snapshot_write_byte(&s->stream, major_version) < 0
+        || snapshot_write_byte(&s->stream, minor_version) < 0
+        || snapshot_write_dword(&s->stream, 0) < 0) {
         return NULL;
     }
 
-    m->size = (uint32_t)(ftell(s->file) - m->offset);
-    m->size_offset = ftell(s->file) - sizeof(uint32_t);
+    m->size = (uint32_t)(snapshot_stream_tell(&s->stream) - m->offset);
+    m->size_offset = snapshot_stream_tell(&s->stream) - sizeof(uint32_t);
 
     return m;
 }
@@ -711,14 +865,14 @@ snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t
 
     current_module = (char *)name;
 
-    if (fseek(s->file, s->first_module_offset, SEEK_SET) < 0) {
+    if (snapshot_stream_seek(&s->stream, s->first_module_offset) < 0) {
         snapshot_error = SNAPSHOT_FIRST_MODULE_NOT_FOUND_ERROR;
         DBG(("snapshot_module_open error: name: '%s' NOT found\n", name));
         return NULL;
     }
 
     m = lib_malloc(sizeof(snapshot_module_t));
-    m->file = s->file;
+    m->stream = &s->stream;
     m->write_mode = 0;
 
     m->offset = s->first_module_offset;
@@ -728,11 +882,11 @@ snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t
     /* Search for the module name.  This is quite inefficient, but I don't
        think we care.  */
     while (1) {
-        if (snapshot_read_byte_array(s->file, (uint8_t *)n,
+        if (snapshot_read_byte_array(&s->stream, (uint8_t *)n,
                                      SNAPSHOT_MODULE_NAME_LEN) < 0
-            || snapshot_read_byte(s->file, major_version_return) < 0
-            || snapshot_read_byte(s->file, minor_version_return) < 0
-            || snapshot_read_dword(s->file, &m->size)) {
+            || snapshot_read_byte(&s->stream, major_version_return) < 0
+            || snapshot_read_byte(&s->stream, minor_version_return) < 0
+            || snapshot_read_dword(&s->stream, &m->size)) {
             snapshot_error = SNAPSHOT_MODULE_HEADER_READ_ERROR;
             goto fail;
         }
@@ -744,13 +898,13 @@ snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t
         }
 
         m->offset += m->size;
-        if (fseek(s->file, m->offset, SEEK_SET) < 0) {
+        if (snapshot_stream_seek(&s->stream, m->offset) < 0) {
             snapshot_error = SNAPSHOT_MODULE_NOT_FOUND_ERROR;
             goto fail;
         }
     }
 
-    m->size_offset = ftell(s->file) - sizeof(uint32_t);
+    m->size_offset = snapshot_stream_tell(&s->stream) - sizeof(uint32_t);
 #if 0
     /* HACK: if any of the errors *this* function can produce is still pending
              in snapshot_error, clear it out - else we might fail for no reason
@@ -766,7 +920,7 @@ snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t
     return m;
 
 fail:
-    fseek(s->file, s->first_module_offset, SEEK_SET);
+    snapshot_stream_seek(&s->stream, s->first_module_offset);
     lib_free(m);
     DBG(("snapshot_module_open error: name: '%s' NOT found\n", name));
     return NULL;
@@ -775,17 +929,23 @@ fail:
 int snapshot_module_close(snapshot_module_t *m)
 {
     DBG(("snapshot_module_close name: '%s'\n", current_module));
+    /* A module that changed its size moves everything behind it, which is
+       better left to `snapshot_chain_append()' than overwritten in place.  */
+    if (m->write_mode && m->stream->delta != NULL && m->size != m->old_size) {
+        snapshot_stream_leave_chain(m->stream);
+    }
+
     /* Backpatch module size if writing.  */
     if (m->write_mode
-        && (fseek(m->file, m->size_offset, SEEK_SET) < 0
-            || snapshot_write_dword(m->file, m->size) < 0)) {
+        && (snapshot_stream_seek(m->stream, m->size_offset) < 0
+            || snapshot_write_dword(m->stream, m->size) < 0)) {
         snapshot_error = SNAPSHOT_MODULE_CLOSE_ERROR;
         DBG(("snapshot_module_close error\n"));
         return -1;
     }
 
     /* Skip module.  */
-    if (fseek(m->file, m->offset + m->size, SEEK_SET) < 0) {
+    if (snapshot_stream_seek(m->stream, m->offset + m->size) < 0) {
         snapshot_error = SNAPSHOT_MODULE_SKIP_ERROR;
         DBG(("snapshot_module_close error\n"));
         return -1;
@@ -798,43 +958,33 @@ int snapshot_module_close(snapshot_module_t *m)
 
 /* ------------------------------------------------------------------------- */
 
-snapshot_t *snapshot_create(const char *filename, uint8_t major_version, uint8_t minor_version, const char *snapshot_machine_name)
+static int snapshot_write_header(snapshot_stream_t *f, uint8_t major_version, uint8_t minor_version, const char *snapshot_machine_name)
 {
-    FILE *f;
-    snapshot_t *s;
     unsigned char viceversion[4] = { VERSION_RC_NUMBER };
 
-    current_filename = (char *)filename;
-
-    f = fopen(filename, MODE_WRITE);
-    if (f == NULL) {
-        snapshot_error = SNAPSHOT_CANNOT_CREATE_SNAPSHOT_ERROR;
-        return NULL;
-    }
-
     /* Magic string.  */
     if (snapshot_write_padded_string(f, snapshot_magic_string, (uint8_t)0, SNAPSHOT_MAGIC_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_MAGIC_STRING_ERROR;
-        goto fail;
+        return -1;
     }
 
     /* Version number.  */
     if (snapshot_write_byte(f, major_version) < 0
         || snapshot_write_byte(f, minor_version) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_VERSION_ERROR;
-        goto fail;
+        return -1;
     }
 
     /* Machine.  */
     if (snapshot_write_padded_string(f, snapshot_machine_name, (uint8_t)0, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_MACHINE_NAME_ERROR;
-        goto fail;
+        return -1;
     }
 
     /* VICE version and revision */
     if (snapshot_write_padded_string(f, snapshot_version_magic_string, (uint8_t)0, SNAPSHOT_VERSION_MAGIC_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_MAGIC_STRING_ERROR;
-        goto fail;
+        return -1;
     }
 
     if (snapshot_write_byte(f, viceversion[0]) < 0
@@ -847,62 +997,91 @@ snapshot_t *snapshot_create(const char *filename, uint8_t major_version, uint8_t
         || snapshot_write_dword(f, 0) < 0) {
 #endif
         snapshot_error = SNAPSHOT_CANNOT_WRITE_VERSION_ERROR;
-        goto fail;
+        return -1;
+    }
+
+    return 0;
+}
+
+snapshot_t *snapshot_create(const char *filename, uint8_t major_version, uint8_t minor_version, const char *snapshot_machine_name)
+{
+    FILE *f;
+    snapshot_t *s;
+
+    current_filename = (char *)filename;
+
+    f = fopen(filename, MODE_WRITE);
+    if (f == NULL) {
+        snapshot_error = SNAPSHOT_CANNOT_CREATE_SNAPSHOT_ERROR;
+        return NULL;
     }
 
-    s = lib_malloc(sizeof(snapshot_t));
-    s->file = f;
-    s->first_module_offset = ftell(f);
+    s = lib_calloc(1, sizeof(snapshot_t));
+    s->stream.file = f;
     s->write_mode = 1;
 
+    if (snapshot_write_header(&s->stream, major_version, minor_version, snapshot_machine_name) < 0) {
+        fclose(f);
+        archdep_remove(filename);
+        lib_free(s);
+        return NULL;
+    }
+
+    s->first_module_offset = snapshot_stream_tell(&s->stream);
+
     return s;
+}
 
-fail:
-    fclose(f);
-    archdep_remove(filename);
-    return NULL;
+/* Create a snapshot that is written to a growing memory buffer instead of a
+   file. The buffer is retrieved with `snapshot_memory_close()'.  */
+snapshot_t *snapshot_memory_create(uint8_t major_version, uint8_t minor_version, const char *snapshot_machine_name)
+{
+    snapshot_t *s;
+
+    current_filename = SNAPSHOT_MEMORY_NAME;
+
+    s = lib_calloc(1, sizeof(snapshot_t));
+    s->write_mode = 1;
+    snapshot_stream_enter_chain(&s->stream);
+
+    if (snapshot_write_header(&s->stream, major_version, minor_version, snapshot_machine_name) < 0) {
+        snapshot_close(s);
+        return NULL;
+    }
+
+    s->first_module_offset = snapshot_stream_tell(&s->stream);
+
+    return s;
 }
 
 /* informal only, used by the error message created below */
 static unsigned char snapshot_viceversion[4];
 static uint32_t snapshot_vicerevision;
 
-snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name)
+static int snapshot_read_header(snapshot_stream_t *f, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name)
 {
-    FILE *f;
     char magic[SNAPSHOT_MAGIC_LEN];
-    snapshot_t *s = NULL;
     int machine_name_len;
-    size_t offs;
-
-    current_machine_name = (char *)snapshot_machine_name;
-    current_filename = (char *)filename;
-    current_module = NULL;
-
-    f = zfile_fopen(filename, MODE_READ);
-    if (f == NULL) {
-        snapshot_error = SNAPSHOT_CANNOT_OPEN_FOR_READ_ERROR;
-        return NULL;
-    }
+    long offs;
 
     /* Magic string.  */
     if (snapshot_read_byte_array(f, (uint8_t *)magic, SNAPSHOT_MAGIC_LEN) < 0
         || memcmp(magic, snapshot_magic_string, SNAPSHOT_MAGIC_LEN) != 0) {
         snapshot_error = SNAPSHOT_MAGIC_STRING_MISMATCH_ERROR;
-        goto fail;
+        return -1;
     }
 
     /* Version number.  */
     if (snapshot_read_byte(f, major_version_return) < 0
         || snapshot_read_byte(f, minor_version_return) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_READ_VERSION_ERROR;
-        goto fail;
+        return -1;
     }
 
     /* Machine.  */
     if (snapshot_read_byte_array(f, (uint8_t *)read_name, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_READ_MACHINE_NAME_ERROR;
-        goto fail;
+        return -1;
     }
 
     /* Check machine name.  */
@@ -911,18 +1090,18 @@ snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, u
         || (machine_name_len != SNAPSHOT_MODULE_NAME_LEN
             && read_name[machine_name_len] != 0)) {
         snapshot_error = SNAPSHOT_MACHINE_MISMATCH_ERROR;
-        goto fail;
+        return -1;
     }
 
     /* VICE version and revision */
     memset(snapshot_viceversion, 0, 4);
     snapshot_vicerevision = 0;
-    offs = ftell(f);
+    offs = snapshot_stream_tell(f);
 
     if (snapshot_read_byte_array(f, (uint8_t *)magic, SNAPSHOT_VERSION_MAGIC_LEN) < 0
         || memcmp(magic, snapshot_version_magic_string, SNAPSHOT_VERSION_MAGIC_LEN) != 0) {
         /* old snapshots do not contain VICE version */
-        fseek(f, offs, SEEK_SET);
+        snapshot_stream_seek(f, offs);
         log_warning(LOG_DEFAULT, "attempting to load pre 2.4.30 snapshot");
     } else {
         /* actually read the version */
@@ -932,40 +1111,89 @@ snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, u
             || snapshot_read_byte(f, &snapshot_viceversion[3]) < 0
             || snapshot_read_dword(f, &snapshot_vicerevision) < 0) {
             snapshot_error = SNAPSHOT_CANNOT_READ_VERSION_ERROR;
-            goto fail;
+            return -1;
         }
     }
 
-    s = lib_malloc(sizeof(snapshot_t));
-    s->file = f;
-    s->first_module_offset = ftell(f);
+    return 0;
+}
+
+snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name)
+{
+    FILE *f;
+    snapshot_t *s;
+
+    current_machine_name = (char *)snapshot_machine_name;
+    current_filename = (char *)filename;
+    current_module = NULL;
+
+    f = zfile_fopen(filename, MODE_READ);
+    if (f == NULL) {
+        snapshot_error = SNAPSHOT_CANNOT_OPEN_FOR_READ_ERROR;
+        return NULL;
+    }
+
+    s = lib_calloc(1, sizeof(snapshot_t));
+    s->stream.file = f;
     s->write_mode = 0;
 
+    if (snapshot_read_header(&s->stream, major_version_return, minor_version_return, snapshot_machine_name) < 0) {
+        zfile_fclose(f);
+        lib_free(s);
+        return NULL;
+    }
+
+    s->first_module_offset = snapshot_stream_tell(&s->stream);
+
     vsync_suspend_speed_eval();
     return s;
+}
 
-fail:
-    fclose(f);
-    return NULL;
+/* Open a snapshot held in memory. The data is not copied, it has to stay
+   valid until the snapshot is closed.  */
+snapshot_t *snapshot_memory_open(const uint8_t *data, size_t len, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name)
+{
+    snapshot_t *s;
+
+    current_machine_name = (char *)snapshot_machine_name;
+    current_filename = SNAPSHOT_MEMORY_NAME;
+    current_module = NULL;
+
+    s = lib_calloc(1, sizeof(snapshot_t));
+    s->stream.data = (uint8_t *)data;
+    s->stream.len = len;
+    s->stream.size = len;
+    s->write_mode = 0;
+
+    if (snapshot_read_header(&s->stream, major_version_return, minor_version_return, snapshot_machine_name) < 0) {
+        lib_free(s);
+        return NULL;
+    }
+
+    s->first_module_offset = snapshot_stream_tell(&s->stream);
+
+    return s;
 }
 
 int snapshot_close(snapshot_t *s)
 {
-    int retval;
+    int retval = 0;
 
-    if (!s->write_mode) {
-        if (zfile_fclose(s->file) == EOF) {
+    if (s->stream.file == NULL) {
+        if (s->write_mode) {
+            /* hands the newest state back to the chain, if it was used */
+            snapshot_stream_leave_chain(&s->stream);
+            lib_free(s->stream.data);
+        }
+    } else if (!s->write_mode) {
+        if (zfile_fclose(s->stream.file) == EOF) {
             snapshot_error = SNAPSHOT_READ_CLOSE_EOF_ERROR;
             retval = -1;
-        } else {
-            retval = 0;
         }
     } else {
-        if (fclose(s->file) == EOF) {
+        if (fclose(s->stream.file) == EOF) {
             snapshot_error = SNAPSHOT_WRITE_CLOSE_EOF_ERROR;
             retval = -1;
-        } else {
-            retval = 0;
         }
     }
 
@@ -973,6 +1201,24 @@ int snapshot_close(snapshot_t *s)
     return retval;
 }
 
+/* Close a snapshot created with `snapshot_memory_create()' and hand over its
+   buffer, which must be freed with `lib_free()'. Returns NULL for any other
+   kind of snapshot.  */
+uint8_t *snapshot_memory_close(snapshot_t *s, size_t *len_return)
+{
+    uint8_t *data = NULL;
+
+    *len_return = 0;
+    if (s->stream.file == NULL && s->write_mode) {
+        snapshot_stream_finish_chain(&s->stream);
+        data = s->stream.data;
+        *len_return = s->stream.len;
+        s->stream.data = NULL;
+    }
+    snapshot_close(s);
+    return data;
+}
+
 static void display_error_with_vice_version(char *text, char *filename)
 {
     char *vmessage = lib_malloc(0x100);
@@ -1184,3 +1430,774 @@ int snapshot_version_is_smaller(uint8_t major_version, uint8_t minor_version,
 
     return 0;
 }
+
+/* ------------------------------------------------------------------------- */
+/* Incremental snapshots.
+
+   A chain keeps the newest state as a full snapshot (the head) and, for every
+   older state, a delta that turns the next newer state back into it.
+
+   The delta is built module by module: a module of the older state that is
+   also found in the newer one (same name and size) is taken over from there,
+   wherever it is now, and only its SNAPSHOT_PAGE_SIZE sized pages that differ
+   are stored. Modules that are new, gone or changed their size are stored
+   whole. A module growing or shrinking therefore only costs itself, not
+   everything behind it, and the memory used per state scales with the amount
+   of change.  Restoring walks back from the head, which makes the most
+   recent states the cheapest to get.
+
+   A state captured with `snapshot_chain_begin_append()' is written over the
+   head in place: every page of the head is saved into the new delta the
+   first time a differing byte is written to it, and nothing is copied or
+   compared afterwards. Large memories registered with
+   `snapshot_dirty_register()' (main RAM, RAM expansions) are not even
+   serialized again: their owners mark the SNAPSHOT_PAGE_SIZE sized pages
+   they write to, and the pages not written since the head was captured are
+   left as they are. Everything else, including memories whose owners do
+   not mark their writes (drives, for instance), is serialized and compared
+   as before; a module that changes its size makes the capture fall back to
+   building the delta by comparing the complete states.  */
+
+#define SNAPSHOT_PAGE_SIZE      0x100
+
+/* Bytes before the first module: magic, version, machine name and VICE
+   version.  */
+#define SNAPSHOT_HEADER_LEN     (SNAPSHOT_MAGIC_LEN + 2 + SNAPSHOT_MACHINE_NAME_LEN \
+                                 + SNAPSHOT_VERSION_MAGIC_LEN + 4 + 4)
+
+/* Bytes of a module header: name, version and size.  */
+#define SNAPSHOT_MODULE_HEADER_LEN      (SNAPSHOT_MODULE_NAME_LEN + 2 + 4)
+
+/* Part of the older state that is taken over from the newer one.  */
+typedef struct snapshot_delta_copy_s {
+    uint32_t dst;       /* offset in the older state */
+    uint32_t src;       /* offset in the newer state */
+    uint32_t len;
+} snapshot_delta_copy_t;
+
+struct snapshot_delta_s {
+    /* Length of the snapshot this delta restores.  */
+    size_t len;
+
+    /* Parts taken over from the newer state.  */
+    snapshot_delta_copy_t *copies;
+    unsigned int num_copies;
+    unsigned int max_copies;
+
+    /* Offsets, lengths and contents of the stored pages.  */
+    uint32_t *page_offset;
+    uint16_t *page_len;
+    uint8_t *pages;
+    unsigned int num_pages;
+    unsigned int max_pages;
+    size_t pages_len;
+};
+
+/* A module found in a serialized snapshot.  */
+typedef struct snapshot_delta_module_s {
+    size_t offset;
+    size_t size;
+} snapshot_delta_module_t;
+
+struct snapshot_chain_s {
+    /* The newest state.  */
+    uint8_t *head;
+    size_t head_len;
+    size_t head_size;
+
+    /* Set by `snapshot_memory_close()' for the state the chain was prepared
+       for: its allocated size and, if it was written over the head, the
+       delta restoring the head.  */
+    int captured;
+    size_t captured_size;
+    snapshot_delta_t *captured_delta;
+
+    /* deltas[0] restores the oldest state.  */
+    snapshot_delta_t **deltas;
+    unsigned int num_deltas;
+    unsigned int max_deltas;
+
+    /* Memory used by the deltas.  */
+    size_t delta_size;
+};
+
+/* Find the modules of the snapshot `data'. Returns the number of modules;
+   `*end_return' is set to the end of the last one, anything after it could
+   not be parsed.  */
+static unsigned int snapshot_delta_find_modules(const uint8_t *data, size_t len,
+                                                snapshot_delta_module_t **modules_return,
+                                                size_t *end_return)
+{
+    snapshot_delta_module_t *modules = NULL;
+    unsigned int num = 0, max = 0;
+    size_t offset = SNAPSHOT_HEADER_LEN;
+
+    while (offset + SNAPSHOT_MODULE_HEADER_LEN <= len) {
+        const uint8_t *p = data + offset + SNAPSHOT_MODULE_NAME_LEN + 2;
+        size_t size = (size_t)p[0] | ((size_t)p[1] << 8)
+                      | ((size_t)p[2] << 16) | ((size_t)p[3] << 24);
+
+        if (size < SNAPSHOT_MODULE_HEADER_LEN || size > len - offset) {
+            break;
+        }
+        if (num == max) {
+            max = max ? max * 2 : 64;
+            modules = lib_realloc(modules, max * sizeof(snapshot_delta_module_t));
+        }
+        modules[num].offset = offset;
+        modules[num].size = size;
+        num++;
+        offset += size;
+    }
+
+    *modules_return = modules;
+    *end_return = offset < len ? offset : len;
+    return num;
+}
+
+static void snapshot_delta_add_copy(snapshot_delta_t *d, size_t dst, size_t src, size_t len)
+{
+    snapshot_delta_copy_t *last = d->num_copies ? &d->copies[d->num_copies - 1] : NULL;
+
+    /* modules that stayed together are taken over in one go */
+    if (last != NULL && last->dst + last->len == dst && last->src + last->len == src) {
+        last->len += (uint32_t)len;
+        return;
+    }
+    if (d->num_copies == d->max_copies) {
+        d->max_copies = d->max_copies ? d->max_copies * 2 : 16;
+        d->copies = lib_realloc(d->copies, d->max_copies * sizeof(snapshot_delta_copy_t));
+    }
+    d->copies[d->num_copies].dst = (uint32_t)dst;
+    d->copies[d->num_copies].src = (uint32_t)src;
+    d->copies[d->num_copies].len = (uint32_t)len;
+    d->num_copies++;
+}
+
+static void snapshot_delta_add_page(snapshot_delta_t *d, const uint8_t *old, size_t offset, size_t len)
+{
+    if (d->num_pages == d->max_pages) {
+        d->max_pages = d->max_pages ? d->max_pages * 2 : 16;
+        d->page_offset = lib_realloc(d->page_offset, d->max_pages * sizeof(uint32_t));
+        d->page_len = lib_realloc(d->page_len, d->max_pages * sizeof(uint16_t));
+        d->pages = lib_realloc(d->pages, d->max_pages * SNAPSHOT_PAGE_SIZE);
+    }
+    d->page_offset[d->num_pages] = (uint32_t)offset;
+    d->page_len[d->num_pages] = (uint16_t)len;
+    memcpy(d->pages + d->pages_len, old + offset, len);
+    d->pages_len += len;
+    d->num_pages++;
+}
+
+/* Store the pages of `old' from `offset' to `offset' + `len' that differ
+   from `cur' at `cur_offset'; `cur' is NULL if there is nothing to compare
+   with.  */
+static void snapshot_delta_add_range(snapshot_delta_t *d, const uint8_t *old, size_t offset,
+                                     const uint8_t *cur, size_t cur_offset, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i += SNAPSHOT_PAGE_SIZE) {
+        size_t n = len - i;
+
+        if (n > SNAPSHOT_PAGE_SIZE) {
+            n = SNAPSHOT_PAGE_SIZE;
+        }
+        if (cur == NULL || memcmp(old + offset + i, cur + cur_offset + i, n) != 0) {
+            snapshot_delta_add_page(d, old, offset + i, n);
+        }
+    }
+}
+
+/* Return the module of `cur' matching the module `m' of `old', or -1. The
+   search starts at `hint', where the module is normally found.  */
+static int snapshot_delta_match_module(const uint8_t *old, const snapshot_delta_module_t *m,
+                                       const uint8_t *cur, const snapshot_delta_module_t *modules,
+                                       unsigned int num, unsigned int hint)
+{
+    unsigned int i, j;
+
+    for (i = 0; i < num; i++) {
+        j = (hint + i) % num;
+        if (modules[j].size == m->size
+            && memcmp(cur + modules[j].offset, old + m->offset, SNAPSHOT_MODULE_NAME_LEN) == 0) {
+            return (int)j;
+        }
+    }
+    return -1;
+}
+
+/* Give back what was over-allocated.  */
+static void snapshot_delta_shrink(snapshot_delta_t *d)
+{
+    d->copies = lib_realloc(d->copies, (d->num_copies + 1) * sizeof(snapshot_delta_copy_t));
+    d->page_offset = lib_realloc(d->page_offset, (d->num_pages + 1) * sizeof(uint32_t));
+    d->page_len = lib_realloc(d->page_len, (d->num_pages + 1) * sizeof(uint16_t));
+    d->pages = lib_realloc(d->pages, d->pages_len + 1);
+    d->max_copies = d->num_copies;
+    d->max_pages = d->num_pages;
+}
+
+/* Return the delta turning `cur' back into `old'.  */
+static snapshot_delta_t *snapshot_delta_create(const uint8_t *old, size_t old_len,
+                                               const uint8_t *cur, size_t cur_len)
+{
+    snapshot_delta_t *d;
+    snapshot_delta_module_t *old_modules, *cur_modules;
+    unsigned int old_num, cur_num, i, hint = 0;
+    size_t old_end, cur_end;
+
+    d = lib_calloc(1, sizeof(snapshot_delta_t));
+    d->len = old_len;
+
+    old_num = snapshot_delta_find_modules(old, old_len, &old_modules, &old_end);
+    cur_num = snapshot_delta_find_modules(cur, cur_len, &cur_modules, &cur_end);
+
+    if (old_len >= SNAPSHOT_HEADER_LEN && cur_len >= SNAPSHOT_HEADER_LEN) {
+        snapshot_delta_add_copy(d, 0, 0, SNAPSHOT_HEADER_LEN);
+        snapshot_delta_add_range(d, old, 0, cur, 0, SNAPSHOT_HEADER_LEN);
+    } else {
+        snapshot_delta_add_range(d, old, 0, NULL, 0,
+                                 old_len < SNAPSHOT_HEADER_LEN ? old_len : SNAPSHOT_HEADER_LEN);
+    }
+
+    for (i = 0; i < old_num; i++) {
+        const snapshot_delta_module_t *m = &old_modules[i];
+        int j = snapshot_delta_match_module(old, m, cur, cur_modules, cur_num, hint);
+
+        if (j < 0) {
+            snapshot_delta_add_range(d, old, m->offset, NULL, 0, m->size);
+            continue;
+        }
+        snapshot_delta_add_copy(d, m->offset, cur_modules[j].offset, m->size);
+        snapshot_delta_add_range(d, old, m->offset, cur, cur_modules[j].offset, m->size);
+        hint = (unsigned int)j + 1;
+    }
+
+    /* whatever could not be parsed is stored as it is */
+    snapshot_delta_add_range(d, old, old_end, NULL, 0, old_len - old_end);
+
+    lib_free(old_modules);
+    lib_free(cur_modules);
+
+    snapshot_delta_shrink(d);
+    return d;
+}
+
+static size_t snapshot_delta_size(const snapshot_delta_t *d)
+{
+    return sizeof(snapshot_delta_t) + d->num_copies * sizeof(snapshot_delta_copy_t)
+           + d->num_pages * (sizeof(uint32_t) + sizeof(uint16_t)) + d->pages_len;
+}
+
+static void snapshot_delta_apply_pages(const snapshot_delta_t *d, uint8_t *data)
+{
+    const uint8_t *page = d->pages;
+    unsigned int i;
+
+    for (i = 0; i < d->num_pages; i++) {
+        memcpy(data + d->page_offset[i], page, d->page_len[i]);
+        page += d->page_len[i];
+    }
+}
+
+/* Turn `*data' (of `*len' bytes, `*size' allocated) into the state `d' was
+   made from.  */
+static void snapshot_delta_apply(const snapshot_delta_t *d, uint8_t **data, size_t *len, size_t *size)
+{
+    unsigned int i;
+    int in_place = 1;
+
+    for (i = 0; i < d->num_copies; i++) {
+        if (d->copies[i].dst != d->copies[i].src) {
+            in_place = 0;
+            break;
+        }
+    }
+
+    if (in_place) {
+        /* no module has moved, only the pages need to be written */
+        if (d->len > *size) {
+            *data = lib_realloc(*data, d->len);
+            *size = d->len;
+        }
+    } else {
+        uint8_t *old = lib_malloc(d->len);
+
+        for (i = 0; i < d->num_copies; i++) {
+            memcpy(old + d->copies[i].dst, *data + d->copies[i].src, d->copies[i].len);
+        }
+        lib_free(*data);
+        *data = old;
+        *size = d->len;
+    }
+    *len = d->len;
+
+    snapshot_delta_apply_pages(d, *data);
+}
+
+static void snapshot_delta_free(snapshot_delta_t *d)
+{
+    lib_free(d->copies);
+    lib_free(d->page_offset);
+    lib_free(d->page_len);
+    lib_free(d->pages);
+    lib_free(d);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* A memory whose writes are tracked by its owner.  */
+typedef struct snapshot_dirty_region_s {
+    const uint8_t *mem;
+    size_t size;
+
+    /* One byte per SNAPSHOT_PAGE_SIZE sized page, set when it is written.  */
+    uint8_t *map;
+
+    /* Tells the owner to start or stop marking its writes, may be NULL.  */
+    void (*enable)(int on);
+
+    /* Where the memory is in the head of `dirty_chain', -1 if it is not
+       there or has changed in ways the map does not tell.  */
+    long offset;
+
+    /* Where the memory is in the state being captured, -1 if it is not.  */
+    long new_offset;
+} snapshot_dirty_region_t;
+
+static snapshot_dirty_region_t *dirty_regions = NULL;
+static unsigned int num_dirty_regions = 0;
+
+/* The chain the offsets of the regions refer to, NULL if none.  */
+static snapshot_chain_t *dirty_chain = NULL;
+
+/* Flag: are the owners marking their writes?  */
+static int dirty_enabled = 0;
+
+/* The chain the next memory snapshot is written for.  */
+static snapshot_chain_t *append_chain = NULL;
+
+static void snapshot_dirty_enable(int on)
+{
+    unsigned int i;
+
+    if (dirty_enabled == on) {
+        return;
+    }
+    dirty_enabled = on;
+    for (i = 0; i < num_dirty_regions; i++) {
+        if (dirty_regions[i].enable != NULL) {
+            dirty_regions[i].enable(on);
+        }
+    }
+}
+
+/* Forget where the regions are in the head of `c'.  */
+static void snapshot_dirty_invalidate(const snapshot_chain_t *c)
+{
+    unsigned int i;
+
+    if (c != dirty_chain) {
+        return;
+    }
+    for (i = 0; i < num_dirty_regions; i++) {
+        dirty_regions[i].offset = -1;
+    }
+}
+
+/* Register the memory `mem' of `size' bytes, whose owner marks every page it
+   writes to in the returned map (`map[offset >> 8] = 1') while enabled by
+   `enable'. All pages start out dirty. The map stays valid until
+   `snapshot_dirty_unregister()' is called, which must be done before `mem'
+   is freed.  */
+uint8_t *snapshot_dirty_register(const uint8_t *mem, size_t size, void (*enable)(int on))
+{
+    snapshot_dirty_region_t *r;
+    size_t pages = (size + SNAPSHOT_PAGE_SIZE - 1) / SNAPSHOT_PAGE_SIZE;
+
+    snapshot_dirty_unregister(mem);
+
+    dirty_regions = lib_realloc(dirty_regions, (num_dirty_regions + 1) * sizeof(snapshot_dirty_region_t));
+    r = &dirty_regions[num_dirty_regions++];
+    r->mem = mem;
+    r->size = size;
+    r->map = lib_malloc(pages + 1);
+    memset(r->map, 1, pages + 1);
+    r->enable = enable;
+    r->offset = -1;
+    r->new_offset = -1;
+
+    if (dirty_enabled && enable != NULL) {
+        enable(1);
+    }
+    return r->map;
+}
+
+void snapshot_dirty_unregister(const uint8_t *mem)
+{
+    unsigned int i;
+
+    for (i = 0; i < num_dirty_regions; i++) {
+        if (dirty_regions[i].mem == mem) {
+            if (dirty_enabled && dirty_regions[i].enable != NULL) {
+                dirty_regions[i].enable(0);
+            }
+            lib_free(dirty_regions[i].map);
+            dirty_regions[i] = dirty_regions[--num_dirty_regions];
+            return;
+        }
+    }
+}
+
+/* Mark `len' bytes at `p' as written, if they belong to a registered
+   memory. For writes that do not go through the owner's handlers, e.g.
+   loading an image or restoring a snapshot.  */
+void snapshot_dirty_mark(const uint8_t *p, size_t len)
+{
+    unsigned int i;
+
+    if (len == 0) {
+        return;
+    }
+    for (i = 0; i < num_dirty_regions; i++) {
+        snapshot_dirty_region_t *r = &dirty_regions[i];
+
+        if (p >= r->mem && p < r->mem + r->size) {
+            size_t offset = (size_t)(p - r->mem);
+            size_t end = len < r->size - offset ? offset + len : r->size;
+
+            memset(r->map + offset / SNAPSHOT_PAGE_SIZE, 1,
+                   (end - 1) / SNAPSHOT_PAGE_SIZE - offset / SNAPSHOT_PAGE_SIZE + 1);
+        }
+    }
+}
+
+/* The state of `c' has been captured; if that was done by
+   `snapshot_memory_close()', the regions are clean from now on.  */
+static void snapshot_dirty_commit(snapshot_chain_t *c)
+{
+    unsigned int i;
+
+    if (c != dirty_chain) {
+        return;
+    }
+    for (i = 0; i < num_dirty_regions; i++) {
+        snapshot_dirty_region_t *r = &dirty_regions[i];
+
+        r->offset = c->captured ? r->new_offset : -1;
+        if (r->offset >= 0) {
+            memset(r->map, 0, (r->size + SNAPSHOT_PAGE_SIZE - 1) / SNAPSHOT_PAGE_SIZE);
+        }
+    }
+    snapshot_dirty_enable(1);
+}
+
+/* Save the pages of the head in `num' bytes from the current position that
+   are about to be changed by `data', or by anything if `data' is NULL.  */
+static void snapshot_stream_save_pages(snapshot_stream_t *f, const uint8_t *data, size_t num)
+{
+    size_t pos = f->pos;
+    size_t end;
+
+    if (pos >= f->old_len) {
+        return;
+    }
+    end = num < f->old_len - pos ? pos + num : f->old_len;
+
+    while (pos < end) {
+        size_t page = pos / SNAPSHOT_PAGE_SIZE;
+        size_t next = (page + 1) * SNAPSHOT_PAGE_SIZE;
+
+        if (next > end) {
+            next = end;
+        }
+        if (!f->saved[page]
+            && (data == NULL || memcmp(f->data + pos, data + (pos - f->pos), next - pos) != 0)) {
+            size_t offset = page * SNAPSHOT_PAGE_SIZE;
+            size_t len = f->old_len - offset;
+
+            snapshot_delta_add_page(f->delta, f->data, offset,
+                                    len < SNAPSHOT_PAGE_SIZE ? len : SNAPSHOT_PAGE_SIZE);
+            f->saved[page] = 1;
+        }
+        pos = next;
+    }
+}
+
+/* Write a registered memory, leaving out the pages that are already in the
+   head. Returns 0 if `data' is to be written as usual instead.  */
+static int snapshot_stream_write_tracked(snapshot_stream_t *f, const uint8_t *data, size_t num)
+{
+    snapshot_dirty_region_t *r = NULL;
+    unsigned int i;
+    size_t n;
+
+    for (i = 0; i < num_dirty_regions; i++) {
+        if (dirty_regions[i].mem == data && dirty_regions[i].size == num) {
+            r = &dirty_regions[i];
+            break;
+        }
+    }
+    if (r == NULL) {
+        return 0;
+    }
+    r->new_offset = (long)f->pos;
+
+    if (f->delta == NULL || r->offset != (long)f->pos || f->pos != f->len
+        || num > f->old_len - f->pos) {
+        return 0;
+    }
+
+    for (i = 0; i < (num + SNAPSHOT_PAGE_SIZE - 1) / SNAPSHOT_PAGE_SIZE; i++) {
+        n = num - (size_t)i * SNAPSHOT_PAGE_SIZE;
+        if (n > SNAPSHOT_PAGE_SIZE) {
+            n = SNAPSHOT_PAGE_SIZE;
+        }
+        if (r->map[i]) {
+            snapshot_stream_write(f, data + (size_t)i * SNAPSHOT_PAGE_SIZE, n);
+        } else {
+            f->pos += n;
+            f->len = f->pos;
+        }
+    }
+    return 1;
+}
+
+/* Start writing the state `snapshot_chain_begin_append()' was called for,
+   over the head of the chain if it has one.  */
+static void snapshot_stream_enter_chain(snapshot_stream_t *f)
+{
+    snapshot_chain_t *c = append_chain;
+    unsigned int i;
+
+    if (c == NULL) {
+        return;
+    }
+    append_chain = NULL;
+    f->chain = c;
+
+    if (c != dirty_chain) {
+        snapshot_dirty_invalidate(dirty_chain);
+        dirty_chain = c;
+        snapshot_dirty_invalidate(c);
+    }
+    for (i = 0; i < num_dirty_regions; i++) {
+        dirty_regions[i].new_offset = -1;
+    }
+
+    if (c->head != NULL) {
+        f->data = c->head;
+        f->size = c->head_size;
+        f->old_len = c->head_len;
+        f->delta = lib_calloc(1, sizeof(snapshot_delta_t));
+        f->saved = lib_calloc(1, f->old_len / SNAPSHOT_PAGE_SIZE + 1);
+        c->head = NULL;
+    }
+}
+
+/* Stop overwriting the head: restore it and continue in a buffer of its
+   own.  */
+static void snapshot_stream_leave_chain(snapshot_stream_t *f)
+{
+    snapshot_chain_t *c = f->chain;
+    uint8_t *data;
+
+    if (f->delta == NULL) {
+        return;
+    }
+
+    data = lib_malloc(f->size);
+    memcpy(data, f->data, f->len);
+
+    snapshot_delta_apply_pages(f->delta, f->data);
+    c->head = f->data;
+    c->head_size = f->size;
+
+    snapshot_delta_free(f->delta);
+    lib_free(f->saved);
+    f->delta = NULL;
+    f->saved = NULL;
+    f->data = data;
+}
+
+/* The state is complete, hand it over to `snapshot_chain_append()'.  */
+static void snapshot_stream_finish_chain(snapshot_stream_t *f)
+{
+    snapshot_chain_t *c = f->chain;
+    snapshot_delta_t *d = f->delta;
+    size_t len = f->len;
+
+    if (c == NULL) {
+        return;
+    }
+
+    if (d != NULL) {
+        /* whatever the head had beyond the end of the new state */
+        if (len < f->old_len) {
+            f->pos = len;
+            snapshot_stream_save_pages(f, NULL, f->old_len - len);
+        }
+        d->len = f->old_len;
+        snapshot_delta_add_copy(d, 0, 0, len < f->old_len ? len : f->old_len);
+        snapshot_delta_shrink(d);
+        lib_free(f->saved);
+        f->delta = NULL;
+        f->saved = NULL;
+    }
+
+    c->captured = 1;
+    c->captured_size = f->size;
+    c->captured_delta = d;
+    f->chain = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+snapshot_chain_t *snapshot_chain_new(void)
+{
+    return lib_calloc(1, sizeof(snapshot_chain_t));
+}
+
+void snapshot_chain_free(snapshot_chain_t *c)
+{
+    if (c == NULL) {
+        return;
+    }
+    snapshot_chain_clear(c);
+    if (append_chain == c) {
+        append_chain = NULL;
+    }
+    lib_free(c->deltas);
+    lib_free(c);
+}
+
+/* Drop all states.  */
+void snapshot_chain_clear(snapshot_chain_t *c)
+{
+    unsigned int i;
+
+    for (i = 0; i < c->num_deltas; i++) {
+        snapshot_delta_free(c->deltas[i]);
+    }
+    c->num_deltas = 0;
+    c->delta_size = 0;
+    lib_free(c->head);
+    c->head = NULL;
+    c->head_len = 0;
+    c->head_size = 0;
+
+    if (c == dirty_chain) {
+        snapshot_dirty_invalidate(c);
+        snapshot_dirty_enable(0);
+        dirty_chain = NULL;
+    }
+}
+
+/* Have the next memory snapshot, e.g. the one written by
+   `machine_write_snapshot_memory()', written over the newest state of `c'.
+   Its buffer must then be passed to `snapshot_chain_append()', which takes
+   it over without having to compare it with the newest state.  */
+void snapshot_chain_begin_append(snapshot_chain_t *c)
+{
+    append_chain = c;
+}
+
+/* Add a new state to the chain. The chain takes over `data', which must have
+   been allocated with `lib_malloc()', e.g. by
+   `machine_write_snapshot_memory()'.  */
+void snapshot_chain_append(snapshot_chain_t *c, uint8_t *data, size_t len)
+{
+    snapshot_delta_t *d = c->captured_delta;
+
+    if (d == NULL && c->head != NULL) {
+        d = snapshot_delta_create(c->head, c->head_len, data, len);
+        lib_free(c->head);
+    }
+    if (d != NULL) {
+        if (c->num_deltas == c->max_deltas) {
+            c->max_deltas = c->max_deltas ? c->max_deltas * 2 : 16;
+            c->deltas = lib_realloc(c->deltas, c->max_deltas * sizeof(snapshot_delta_t *));
+        }
+        c->deltas[c->num_deltas++] = d;
+        c->delta_size += snapshot_delta_size(d);
+    }
+    c->head = data;
+    c->head_len = len;
+    c->head_size = c->captured ? c->captured_size : len;
+
+    snapshot_dirty_commit(c);
+    c->captured = 0;
+    c->captured_delta = NULL;
+}
+
+/* Return the number of states in the chain, 0 is the oldest.  */
+unsigned int snapshot_chain_count(const snapshot_chain_t *c)
+{
+    return c->head != NULL ? c->num_deltas + 1 : 0;
+}
+
+/* Return the memory used by the chain.  */
+size_t snapshot_chain_size(const snapshot_chain_t *c)
+{
+    return c->head_len + c->delta_size;
+}
+
+/* Forget the `num' oldest states.  */
+void snapshot_chain_drop_oldest(snapshot_chain_t *c, unsigned int num)
+{
+    unsigned int i;
+
+    if (num >= snapshot_chain_count(c)) {
+        snapshot_chain_clear(c);
+        return;
+    }
+
+    for (i = 0; i < num; i++) {
+        c->delta_size -= snapshot_delta_size(c->deltas[i]);
+        snapshot_delta_free(c->deltas[i]);
+    }
+    c->num_deltas -= num;
+    memmove(c->deltas, c->deltas + num, c->num_deltas * sizeof(snapshot_delta_t *));
+}
+
+/* Make state `index' the newest one, dropping everything after it.  */
+int snapshot_chain_truncate(snapshot_chain_t *c, unsigned int index)
+{
+    if (index >= snapshot_chain_count(c)) {
+        return -1;
+    }
+
+    while (c->num_deltas > index) {
+        snapshot_delta_t *d = c->deltas[--c->num_deltas];
+
+        snapshot_delta_apply(d, &c->head, &c->head_len, &c->head_size);
+        c->delta_size -= snapshot_delta_size(d);
+        snapshot_delta_free(d);
+    }
+    snapshot_dirty_invalidate(c);
+    return 0;
+}
+
+/* Rebuild state `index' into a new buffer, free it with `lib_free()'.  */
+uint8_t *snapshot_chain_get(const snapshot_chain_t *c, unsigned int index, size_t *len_return)
+{
+    uint8_t *data;
+    size_t len, size;
+    unsigned int i;
+
+    if (index >= snapshot_chain_count(c)) {
+        return NULL;
+    }
+
+    len = size = c->head_len;
+    data = lib_malloc(size);
+    memcpy(data, c->head, len);
+
+    for (i = c->num_deltas; i > index; i--) {
+        snapshot_delta_apply(c->deltas[i - 1], &data, &len, &size);
+    }
+
+    *len_return = len;
+    return data;
+}
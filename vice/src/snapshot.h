@@ -67,6 +67,7 @@
 
 typedef struct snapshot_module_s snapshot_module_t;
 typedef struct snapshot_s snapshot_t;
+typedef struct snapshot_chain_s snapshot_chain_t;
 
 extern void snapshot_display_error(void);
 
@@ -164,6 +165,32 @@ extern snapshot_t *snapshot_open(const char *filename,
                                  const char *snapshot_machine_name);
 extern int snapshot_close(snapshot_t *s);
 
+extern snapshot_t *snapshot_memory_create(uint8_t major_version,
+                                          uint8_t minor_version,
+                                          const char *snapshot_machine_name);
+extern snapshot_t *snapshot_memory_open(const uint8_t *data, size_t len,
+                                        uint8_t *major_version_return,
+                                        uint8_t *minor_version_return,
+                                        const char *snapshot_machine_name);
+extern uint8_t *snapshot_memory_close(snapshot_t *s, size_t *len_return);
+
+extern snapshot_chain_t *snapshot_chain_new(void);
+extern void snapshot_chain_free(snapshot_chain_t *c);
+extern void snapshot_chain_clear(snapshot_chain_t *c);
+extern void snapshot_chain_begin_append(snapshot_chain_t *c);
+extern void snapshot_chain_append(snapshot_chain_t *c, uint8_t *data, size_t len);
+extern unsigned int snapshot_chain_count(const snapshot_chain_t *c);
+extern size_t snapshot_chain_size(const snapshot_chain_t *c);
+extern void snapshot_chain_drop_oldest(snapshot_chain_t *c, unsigned int num);
+extern int snapshot_chain_truncate(snapshot_chain_t *c, unsigned int index);
+extern uint8_t *snapshot_chain_get(const snapshot_chain_t *c,
+                                   unsigned int index, size_t *len_return);
+
+extern uint8_t *snapshot_dirty_register(const uint8_t *mem, size_t size,
+                                        void (*enable)(int on));
+extern void snapshot_dirty_unregister(const uint8_t *mem);
+extern void snapshot_dirty_mark(const uint8_t *p, size_t len);
+
 extern void snapshot_set_error(int error);
 extern int snapshot_get_error(void);
 
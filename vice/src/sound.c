@@ -681,6 +681,13 @@ typedef struct {
 
 static snddata_t snddata;
 
+/* Flag: are the frames being emulated thrown away afterwards?  */
+static int speculating = 0;
+
+/* Sample position and clock where the speculation started.  */
+static int speculation_bufptr;
+static soundclk_t speculation_fclk;
+
 /* device registration code */
 #define MAX_SOUND_DEVICES 24
 
@@ -1251,6 +1258,12 @@ bool sound_flush(void)
         goto done;
     }
 
+    if (speculating) {
+        /* the chips must run, but nobody hears these samples */
+        snddata.bufptr = speculation_bufptr;
+        goto done;
+    }
+
     if (sid_state_changed) {
         if (sid_init() != 0) {
             goto done;
@@ -1546,6 +1559,29 @@ void sound_snapshot_finish(void)
     snddata.lastclk = maincpu_clk;
 }
 
+/* The samples generated from now on are dropped. Used while emulating frames
+   that are thrown away by restoring the machine state afterwards.  */
+void sound_speculation_begin(void)
+{
+    sound_run_sound();
+    speculation_bufptr = snddata.bufptr;
+    speculation_fclk = snddata.fclk;
+    speculating = 1;
+}
+
+/* Called after the machine state from sound_speculation_begin() has been
+   restored, the sound continues from there.  */
+void sound_speculation_end(void)
+{
+    if (!speculating) {
+        return;
+    }
+    snddata.bufptr = speculation_bufptr;
+    snddata.fclk = speculation_fclk;
+    snddata.lastclk = maincpu_clk;
+    speculating = 0;
+}
+
 void sound_dac_init(sound_dac_t *dac, int speed)
 {
     /* 20 dB/Decade high pass filter, cutoff at 5 Hz. For DC offset filtering. */
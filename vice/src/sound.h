@@ -172,6 +172,8 @@ extern void sound_set_warp_mode(int value);
 extern void sound_set_machine_parameter(long clock_rate, long ticks_per_frame);
 extern void sound_snapshot_prepare(void);
 extern void sound_snapshot_finish(void);
+extern void sound_speculation_begin(void);
+extern void sound_speculation_end(void);
 
 extern int sound_resources_init(void);
 extern void sound_resources_shutdown(void);
@@ -42,6 +42,7 @@
 #include "maincpu.h"
 #include "mem.h"
 #include "network.h"
+#include "snapshot.h"
 #include "t64.h"
 #include "tap.h"
 #include "tape-internal.h"
@@ -256,6 +257,7 @@ int tape_find_header_trap(void)
     if (err) {
         cassette_buffer[CAS_TYPE_OFFSET] = TAPE_CAS_TYPE_EOF;
     }
+    snapshot_dirty_mark(cassette_buffer, CAS_NAME_OFFSET + T64_REC_CBMNAME_LEN);
 
     mem_store(st_addr, 0);      /* Clear the STATUS word.  */
     mem_store(verify_flag_addr, 0);
@@ -373,6 +375,9 @@ int tape_receive_trap(void)
 
                 len = (int)(end - start);
                 amount = t64_read((t64_t *)tape_image_dev[TAPEPORT_PORT_1]->data, mem_ram + (int)start, len);
+                if (amount > 0) {
+                    snapshot_dirty_mark(mem_ram + (int)start, (size_t)amount);
+                }
                 if (amount == len) {
                     st = 0x40;  /* EOF */
                 } else {
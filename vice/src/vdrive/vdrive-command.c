@@ -3322,7 +3322,7 @@ int vdrive_command_format(struct vdrive_s *vdrive, const char *disk_name)
     }
 
     if (vdrive->image->device == DISK_IMAGE_DEVICE_FS) {
-        if (disk_image_fsimage_fd_get(vdrive->image) == NULL) {
+        if (!disk_image_fsimage_is_open(vdrive->image)) {
             return CBMDOS_IPE_NOT_READY;
         }
     }
@@ -114,6 +114,11 @@ struct draw_buffer_s {
     unsigned int visible_width;
     /* Height of the visible subset of draw_buffer, in pixels */
     unsigned int visible_height;
+    /* Set by the arch when video_canvas_refresh() keeps the parts of the canvas
+    outside the refreshed area, so that only lines which changed need to be refreshed */
+    int refresh_partial;
+    /* Set when the next refresh must cover the whole canvas */
+    int refresh_all_pending;
 };
 typedef struct draw_buffer_s draw_buffer_t;
 
@@ -150,6 +155,15 @@ typedef struct video_chip_cap_s video_chip_cap_t;
 
 #define VIDEO_MAX_OUTPUT_WIDTH  2048
 
+/* Line buffers the CRT emulation renderers carry from one line to the next.
+   Bands of a frame rendered in parallel each need their own. */
+struct video_render_scratch_s {
+    int32_t line_yuv_0[VIDEO_MAX_OUTPUT_WIDTH * 3];
+    int16_t prevrgbline[VIDEO_MAX_OUTPUT_WIDTH * 3];
+    uint8_t rgbscratchbuffer[VIDEO_MAX_OUTPUT_WIDTH * 4];
+};
+typedef struct video_render_scratch_s video_render_scratch_t;
+
 struct video_render_color_tables_s {
     int updated;                /* tables here are up to date */
     uint32_t physical_colors[256];
@@ -167,9 +181,7 @@ struct video_render_color_tables_s {
     /* YUV table for hardware rendering: (Y << 16) | (U << 8) | V */
     int yuv_updated;            /* yuv table updated for packed mode */
     uint32_t yuv_table[512];
-    int32_t line_yuv_0[VIDEO_MAX_OUTPUT_WIDTH * 3];
-    int16_t prevrgbline[VIDEO_MAX_OUTPUT_WIDTH * 3];
-    uint8_t rgbscratchbuffer[VIDEO_MAX_OUTPUT_WIDTH * 4];
+    video_render_scratch_t scratch;
 
     /*
      * All values below here formerly were globals in video-color.h.
@@ -254,6 +266,18 @@ extern void video_render_setrawrgb(video_render_color_tables_t *color_tab, unsig
 extern void video_render_setrawalpha(video_render_color_tables_t *color_tab, uint32_t a);
 extern void video_render_initraw(struct video_render_config_s *videoconfig);
 
+/* Statistics of the queue of frames waiting to be displayed by the UI */
+typedef struct video_render_queue_stats_s {
+    unsigned int depth;             /* frames allowed to wait */
+    unsigned int length;            /* frames waiting now */
+    unsigned int frames_queued;     /* frames passed to the queue */
+    unsigned int frames_displayed;  /* frames taken for display */
+    unsigned int frames_dropped;    /* frames discarded before display */
+    unsigned int latency_avg_us;    /* average time a frame waited for display */
+    unsigned int latency_max_us;    /* longest time a frame waited for display */
+    unsigned int wait_ms;           /* time the emulation waited for the queue */
+} video_render_queue_stats_t;
+
 /**************************************************************/
 
 extern int video_arch_cmdline_options_init(void);
@@ -283,6 +307,8 @@ extern void video_canvas_destroy(struct video_canvas_s *canvas);
 extern void video_canvas_map(struct video_canvas_s *canvas);
 extern void video_canvas_unmap(struct video_canvas_s *canvas);
 extern void video_canvas_resize(struct video_canvas_s *canvas, char resize_canvas);
+extern int video_canvas_get_render_queue_stats(struct video_canvas_s *canvas,
+                                               video_render_queue_stats_t *stats);
 extern void video_canvas_render(struct video_canvas_s *canvas, uint8_t *trg,
                                 int width, int height, int xs, int ys,
                                 int xt, int yt, int pitcht);
@@ -70,7 +70,8 @@ void store_pixel_4(video_render_color_tables_t *color_tab, uint8_t *trg, int32_t
 
 /* PAL 1x1 renderers */
 static inline void
-render_generic_1x1_pal(video_render_color_tables_t *color_tab, const uint8_t *src, uint8_t *trg,
+render_generic_1x1_pal(video_render_color_tables_t *color_tab,
+                       video_render_scratch_t *scratch, const uint8_t *src, uint8_t *trg,
                        unsigned int width, const unsigned int height,
                        unsigned int xs, const unsigned int ys,
                        unsigned int xt, const unsigned int yt,
@@ -99,7 +100,7 @@ render_generic_1x1_pal(video_render_color_tables_t *color_tab, const uint8_t *sr
     src = src + pitchs * ys + xs - 2;
     trg = trg + pitcht * yt + (xt >> 1) * pixelstride;
 
-    line = color_tab->line_yuv_0;
+    line = scratch->line_yuv_0;
     tmpsrc = ys > 0 ? src - pitchs : src;
 
     /* is the previous line odd or even? (inverted condition!) */
@@ -132,7 +133,7 @@ render_generic_1x1_pal(video_render_color_tables_t *color_tab, const uint8_t *sr
         tmpsrc = src;
         tmptrg = trg;
 
-        line = color_tab->line_yuv_0;
+        line = scratch->line_yuv_0;
 
         if (y & 1) { /* odd sourceline */
             off_flip = off;
@@ -185,13 +186,14 @@ render_generic_1x1_pal(video_render_color_tables_t *color_tab, const uint8_t *sr
 
 void
 render_32_1x1_pal(video_render_color_tables_t *color_tab,
+                  video_render_scratch_t *scratch,
                   const uint8_t *src, uint8_t *trg,
                   const unsigned int width, const unsigned int height,
                   const unsigned int xs, const unsigned int ys,
                   const unsigned int xt, const unsigned int yt,
                   const unsigned int pitchs, const unsigned int pitcht, video_render_config_t *config)
 {
-    render_generic_1x1_pal(color_tab, src, trg, width, height, xs, ys, xt, yt,
+    render_generic_1x1_pal(color_tab, scratch, src, trg, width, height, xs, ys, xt, yt,
                            pitchs, pitcht,
                            8, 0, config);
 }
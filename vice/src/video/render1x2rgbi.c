@@ -155,7 +155,7 @@ void render_generic_1x2_rgbi(video_render_color_tables_t *color_tab,
             if (y == yys || y <= (unsigned int)first_line || y > (unsigned int)(last_line + 1)) {
                 break;
             }
-            tmptrg = &color_tab->rgbscratchbuffer[0];
+            tmptrg = &color_tab->scratch.rgbscratchbuffer[0];
             tmptrgscanline = trg - pitcht;
             if (y == (unsigned int)(last_line + 1)) {
                 /* src would point after the source area, so rewind one line */
@@ -170,7 +170,7 @@ void render_generic_1x2_rgbi(video_render_color_tables_t *color_tab,
              * yet initialized and scanline data would be bogus! */
             tmptrgscanline = y != yys && y > (unsigned int)first_line && y <= (unsigned int)last_line
                              ? trg - pitcht
-                             : &color_tab->rgbscratchbuffer[0];
+                             : &color_tab->scratch.rgbscratchbuffer[0];
         }
 
         /* current source image for YUV xform */
@@ -188,7 +188,7 @@ void render_generic_1x2_rgbi(video_render_color_tables_t *color_tab,
         tmpsrc += 1;
 
         /* actual line */
-        prevrgblineptr = &color_tab->prevrgbline[0];
+        prevrgblineptr = &color_tab->scratch.prevrgbline[0];
         if (wfirst) {
             l2 = ytablel[tmpsrc[1]] + ytableh[tmpsrc[2]] + ytablel[tmpsrc[3]];
             unew += cbtable[tmpsrc[3]];
@@ -90,6 +90,7 @@ void get_yuv_from_video(
 
 static inline
 void render_generic_2x2_pal_u(video_render_color_tables_t *color_tab,
+                              video_render_scratch_t *scratch,
                             const uint8_t *src, uint8_t *trg,
                             unsigned int width, const unsigned int height,
                             unsigned int xs, const unsigned int ys,
@@ -118,7 +119,7 @@ void render_generic_2x2_pal_u(video_render_color_tables_t *color_tab,
     wlast = width & 1;
     width >>= 1;
 
-    line = color_tab->line_yuv_0;
+    line = scratch->line_yuv_0;
     /* get previous line into buffer. */
     tmpsrc = ys > 0 ? src - pitchs : src;
 
@@ -166,7 +167,7 @@ void render_generic_2x2_pal_u(video_render_color_tables_t *color_tab,
                 break;
             }
 
-            tmptrg = &color_tab->rgbscratchbuffer[0];
+            tmptrg = &scratch->rgbscratchbuffer[0];
             tmptrgscanline = trg - pitcht;
             if (y == (unsigned int)(last_line + 1)) {
                 /* src would point after the source area, so rewind one line */
@@ -181,13 +182,13 @@ void render_generic_2x2_pal_u(video_render_color_tables_t *color_tab,
              * yet initialized and scanline data would be bogus! */
             tmptrgscanline = y != yys && y > (unsigned int)first_line && y <= (unsigned int)last_line
                              ? trg - pitcht
-                             : &color_tab->rgbscratchbuffer[0];
+                             : &scratch->rgbscratchbuffer[0];
         }
 
         /* current source image for YUV xform */
         tmpsrc = src;
         /* prev line's YUV-xformed data */
-        line = color_tab->line_yuv_0;
+        line = scratch->line_yuv_0;
 
         if (y & 2) { /* odd sourceline */
             off_flip = off;
@@ -209,7 +210,7 @@ void render_generic_2x2_pal_u(video_render_color_tables_t *color_tab,
         line += 2;
 
         /* actual line */
-        prevrgblineptr = &color_tab->prevrgbline[0];
+        prevrgblineptr = &scratch->prevrgbline[0];
         if (wfirst) {
             l2 = ytablel[tmpsrc[1]] + ytableh[tmpsrc[2]] + ytablel[tmpsrc[3]];
             unew += cbtable[tmpsrc[3]];
@@ -267,6 +268,7 @@ void render_generic_2x2_pal_u(video_render_color_tables_t *color_tab,
 }
 
 void render_32_2x2_pal_u(video_render_color_tables_t *color_tab,
+                         video_render_scratch_t *scratch,
                        const uint8_t *src, uint8_t *trg,
                        unsigned int width, const unsigned int height,
                        const unsigned int xs, const unsigned int ys,
@@ -275,7 +277,7 @@ void render_32_2x2_pal_u(video_render_color_tables_t *color_tab,
                        unsigned int viewport_first_line, unsigned int viewport_last_line,
                        video_render_config_t *config)
 {
-    render_generic_2x2_pal_u(color_tab, src, trg, width, height, xs, ys,
+    render_generic_2x2_pal_u(color_tab, scratch, src, trg, width, height, xs, ys,
                            xt, yt, pitchs, pitcht, viewport_first_line, viewport_last_line,
                            4, 1, config);
 }
@@ -136,7 +136,7 @@ void render_generic_2x4_rgbi(video_render_color_tables_t *color_tab,
             if ((y + 1) == yys || (y + 1) <= (viewport_first_line * 4) || (y + 1) > (viewport_last_line * 4)) {
                 break;
             }
-            tmptrg2 = &color_tab->rgbscratchbuffer[0];
+            tmptrg2 = &color_tab->scratch.rgbscratchbuffer[0];
             tmptrgscanline2 = trg - pitcht;
         } else {
             /* pixel data to surface */
@@ -147,7 +147,7 @@ void render_generic_2x4_rgbi(video_render_color_tables_t *color_tab,
              * yet initialized and scanline data would be bogus! */
             tmptrgscanline2 = ((y + 0) != yys) && ((y + 0) > viewport_first_line * 4) && ((y + 0) <= viewport_last_line * 4)
                               ? trg - pitcht
-                              : &color_tab->rgbscratchbuffer[0];
+                              : &color_tab->scratch.rgbscratchbuffer[0];
         }
         if (y == yys + height) {
             /* no place to put scanline in: we are outside viewport or still
@@ -155,7 +155,7 @@ void render_generic_2x4_rgbi(video_render_color_tables_t *color_tab,
             if (y == yys || y <= viewport_first_line * 4 || y > viewport_last_line * 4) {
                 break;
             }
-            tmptrg1 = &color_tab->rgbscratchbuffer[0];
+            tmptrg1 = &color_tab->scratch.rgbscratchbuffer[0];
             tmptrgscanline1 = trg - (pitcht * 2);
         } else {
             /* pixel data to surface */
@@ -166,7 +166,7 @@ void render_generic_2x4_rgbi(video_render_color_tables_t *color_tab,
              * yet initialized and scanline data would be bogus! */
             tmptrgscanline1 = (y != yys) && (y > viewport_first_line * 4) && (y <= viewport_last_line * 4)
                               ? trg - (pitcht * 2)
-                              : &color_tab->rgbscratchbuffer[0];
+                              : &color_tab->scratch.rgbscratchbuffer[0];
         }
 
         /* current source image for YUV xform */
@@ -184,7 +184,7 @@ void render_generic_2x4_rgbi(video_render_color_tables_t *color_tab,
         tmpsrc += 1;
 
         /* actual line */
-        prevrgblineptr = &color_tab->prevrgbline[0];
+        prevrgblineptr = &color_tab->scratch.prevrgbline[0];
         if (wfirst) {
             l2 = ytablel[tmpsrc[1]] + ytableh[tmpsrc[2]] + ytablel[tmpsrc[3]];
             unew += cbtable[tmpsrc[3]];
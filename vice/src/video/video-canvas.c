@@ -164,6 +164,9 @@ void video_canvas_refresh_all(video_canvas_t *canvas)
     viewport = canvas->viewport;
     geometry = canvas->geometry;
 
+    /* the draw buffer may not match what the last partial refresh was based on */
+    canvas->draw_buffer->refresh_all_pending = 1;
+
     video_canvas_refresh(canvas,
                          viewport->first_x
                          + geometry->extra_offscreen_border_left,
@@ -199,6 +202,8 @@ int video_canvas_palette_set(struct video_canvas_s *canvas,
         video_color_palette_free(old_palette);
     }
 
+    canvas->draw_buffer->refresh_all_pending = 1;
+
 #if 0 /* WTF this was causing each frame to be rendered twice */
    if (canvas->created) {
        video_canvas_refresh_all(canvas);
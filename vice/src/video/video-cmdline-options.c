@@ -36,8 +36,20 @@
 #include "util.h"
 #include "video.h"
 
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-videorenderthreads", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "VideoRenderThreads", NULL,
+      "<threads>", "Set the number of threads for CRT emulation rendering (1: no extra threads (default), 0: one per CPU)" },
+    CMDLINE_LIST_END
+};
+
 int video_cmdline_options_init(void)
 {
+    if (cmdline_register_options(cmdline_options) < 0) {
+        return -1;
+    }
+
     return video_arch_cmdline_options_init();
 }
 
@@ -0,0 +1,222 @@
+/*
+ * video-render-bands.c - Render horizontal bands of a frame in parallel.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The renderers split a frame into bands and call video_render_bands_run(),
+   which renders one band on the calling thread and hands the others to a
+   small pool of worker threads. The call returns when all bands are done,
+   so the renderers stay synchronous. Without USE_VICE_THREAD all bands are
+   rendered on the calling thread. */
+
+#include "vice.h"
+
+#include <stdio.h>
+
+#ifdef USE_VICE_THREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "lib.h"
+#include "log.h"
+#include "types.h"
+#include "video-render-bands.h"
+#include "video.h"
+
+/* Configured number of threads, 0 = one per CPU. */
+static int render_threads = 1;
+
+/* line buffers of the renderers, one set per band */
+static video_render_scratch_t *band_scratch[VIDEO_RENDER_BANDS_MAX];
+
+#ifdef USE_VICE_THREAD
+
+static pthread_t workers[VIDEO_RENDER_BANDS_MAX - 1];
+static int num_workers = 0;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+
+/* the frame being rendered, protected by pool_lock */
+static video_render_band_func_t job_func = NULL;
+static void *job_data = NULL;
+static int job_bands = 0;
+static int next_band = 0;
+static int bands_done = 0;
+static int pool_quit = 0;
+
+static void *band_worker(void *unused)
+{
+    int band;
+
+    pthread_mutex_lock(&pool_lock);
+    for (;;) {
+        while (!pool_quit && next_band >= job_bands) {
+            pthread_cond_wait(&work_cond, &pool_lock);
+        }
+        if (pool_quit) {
+            break;
+        }
+        band = next_band++;
+        pthread_mutex_unlock(&pool_lock);
+
+        job_func(job_data, band);
+
+        pthread_mutex_lock(&pool_lock);
+        if (++bands_done == job_bands) {
+            pthread_cond_signal(&done_cond);
+        }
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    return NULL;
+}
+
+static void pool_stop(void)
+{
+    int i;
+
+    if (num_workers == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    pool_quit = 1;
+    pthread_cond_broadcast(&work_cond);
+    pthread_mutex_unlock(&pool_lock);
+
+    for (i = 0; i < num_workers; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    num_workers = 0;
+    pool_quit = 0;
+}
+
+static void pool_start(int count)
+{
+    while (num_workers < count) {
+        if (pthread_create(&workers[num_workers], NULL, band_worker, NULL) != 0) {
+            log_error(LOG_DEFAULT, "Cannot create render thread, using %d.", num_workers + 1);
+            break;
+        }
+        num_workers++;
+    }
+}
+
+#endif
+
+void video_render_bands_set_threads(int threads)
+{
+    render_threads = threads;
+}
+
+/* Number of bands a frame should be split into. */
+int video_render_bands_get_count(void)
+{
+    int count = render_threads;
+
+#ifdef USE_VICE_THREAD
+    if (count == 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+        count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    }
+#else
+    count = 1;
+#endif
+    if (count < 1) {
+        count = 1;
+    }
+    if (count > VIDEO_RENDER_BANDS_MAX) {
+        count = VIDEO_RENDER_BANDS_MAX;
+    }
+    return count;
+}
+
+video_render_scratch_t *video_render_bands_get_scratch(int band)
+{
+    if (band_scratch[band] == NULL) {
+        band_scratch[band] = lib_malloc(sizeof(video_render_scratch_t));
+    }
+    return band_scratch[band];
+}
+
+/* Call `func' for the bands 0 to `bands' - 1 and wait until all of them are
+   done. Bands must not write to the same memory. */
+void video_render_bands_run(video_render_band_func_t func, void *data, int bands)
+{
+    int band;
+
+#ifdef USE_VICE_THREAD
+    if (bands > 1) {
+        if (num_workers != video_render_bands_get_count() - 1) {
+            pool_stop();
+            pool_start(video_render_bands_get_count() - 1);
+        }
+    }
+
+    if (bands > 1 && num_workers > 0) {
+        pthread_mutex_lock(&pool_lock);
+        job_func = func;
+        job_data = data;
+        job_bands = bands;
+        next_band = 0;
+        bands_done = 0;
+        pthread_cond_broadcast(&work_cond);
+
+        /* help out instead of just waiting */
+        while (next_band < job_bands) {
+            band = next_band++;
+            pthread_mutex_unlock(&pool_lock);
+            func(data, band);
+            pthread_mutex_lock(&pool_lock);
+            bands_done++;
+        }
+        while (bands_done < job_bands) {
+            pthread_cond_wait(&done_cond, &pool_lock);
+        }
+        job_bands = 0;
+        next_band = 0;
+        pthread_mutex_unlock(&pool_lock);
+        return;
+    }
+#endif
+
+    for (band = 0; band < bands; band++) {
+        func(data, band);
+    }
+}
+
+void video_render_bands_shutdown(void)
+{
+    int i;
+
+#ifdef USE_VICE_THREAD
+    pool_stop();
+#endif
+
+    for (i = 0; i < VIDEO_RENDER_BANDS_MAX; i++) {
+        lib_free(band_scratch[i]);
+        band_scratch[i] = NULL;
+    }
+}
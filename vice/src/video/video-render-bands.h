@@ -0,0 +1,39 @@
+/*
+ * video-render-bands.h - Render horizontal bands of a frame in parallel.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_VIDEO_RENDER_BANDS_H
+#define VICE_VIDEO_RENDER_BANDS_H
+
+#include "video.h"
+
+#define VIDEO_RENDER_BANDS_MAX  16
+
+typedef void (*video_render_band_func_t)(void *data, int band);
+
+extern void video_render_bands_set_threads(int threads);
+extern int video_render_bands_get_count(void);
+extern video_render_scratch_t *video_render_bands_get_scratch(int band);
+extern void video_render_bands_run(video_render_band_func_t func, void *data, int bands);
+extern void video_render_bands_shutdown(void);
+
+#endif
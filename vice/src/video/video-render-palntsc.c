@@ -43,9 +43,141 @@
 #include "renderscale2x.h"
 #include "resources.h"
 #include "types.h"
+#include "video-render-bands.h"
 #include "video-render.h"
 #include "video.h"
 
+/* Source lines below which a frame is not split any further. */
+#define CRT_BAND_MIN_LINES  16
+
+enum {
+    CRT_RENDER_1X1_PAL,
+    CRT_RENDER_1X1_NTSC,
+    CRT_RENDER_2X2_PAL,
+    CRT_RENDER_2X2_PAL_U,
+    CRT_RENDER_2X2_NTSC
+};
+
+/* A frame for the CRT emulation renderers, split into bands of source
+   lines. Every band starts from the line above it just like a complete
+   frame does, so the output does not depend on the number of bands. */
+typedef struct crt_render_job_s {
+    int renderer;
+    video_render_config_t *config;
+    const uint8_t *src;
+    uint8_t *trg;
+    int width, height, xs, ys, xt, yt, pitchs, pitcht;
+    unsigned int viewport_first_line, viewport_last_line;
+    int band_start[VIDEO_RENDER_BANDS_MAX + 1];
+    video_render_scratch_t *scratch[VIDEO_RENDER_BANDS_MAX];
+} crt_render_job_t;
+
+static void crt_render_band(void *data, int band)
+{
+    crt_render_job_t *job = (crt_render_job_t *)data;
+    video_render_color_tables_t *colortab = &job->config->color_tables;
+    video_render_scratch_t *scratch = job->scratch[band];
+    int first = job->band_start[band];
+    int lines = job->band_start[band + 1] - first;
+
+    switch (job->renderer) {
+        case CRT_RENDER_1X1_PAL:
+            render_32_1x1_pal(colortab, scratch, job->src, job->trg,
+                              job->width, lines, job->xs, job->ys + first,
+                              job->xt, job->yt + first, job->pitchs, job->pitcht,
+                              job->config);
+            break;
+        case CRT_RENDER_1X1_NTSC:
+            render_32_1x1_ntsc(colortab, job->src, job->trg,
+                               job->width, lines, job->xs, job->ys + first,
+                               job->xt, job->yt + first, job->pitchs, job->pitcht);
+            break;
+        /* the 2x2 renderers count target lines, two per source line */
+        case CRT_RENDER_2X2_PAL:
+            render_32_2x2_pal(colortab, scratch, job->src, job->trg,
+                              job->width, lines, job->xs, job->ys + first / 2,
+                              job->xt, job->yt + first, job->pitchs, job->pitcht,
+                              job->viewport_first_line, job->viewport_last_line,
+                              job->config);
+            break;
+        case CRT_RENDER_2X2_PAL_U:
+            render_32_2x2_pal_u(colortab, scratch, job->src, job->trg,
+                                job->width, lines, job->xs, job->ys + first / 2,
+                                job->xt, job->yt + first, job->pitchs, job->pitcht,
+                                job->viewport_first_line, job->viewport_last_line,
+                                job->config);
+            break;
+        case CRT_RENDER_2X2_NTSC:
+            render_32_2x2_ntsc(colortab, scratch, job->src, job->trg,
+                               job->width, lines, job->xs, job->ys + first / 2,
+                               job->xt, job->yt + first, job->pitchs, job->pitcht,
+                               job->viewport_first_line, job->viewport_last_line,
+                               job->config);
+            break;
+    }
+}
+
+static void crt_render(int renderer, video_render_config_t *config,
+                       uint8_t *src, uint8_t *trg,
+                       int width, int height, int xs, int ys, int xt,
+                       int yt, int pitchs, int pitcht,
+                       unsigned int viewport_first_line, unsigned int viewport_last_line)
+{
+    crt_render_job_t job;
+    int doubled = renderer >= CRT_RENDER_2X2_PAL;
+    int lines = doubled ? height / 2 : height;
+    int bands = video_render_bands_get_count();
+    int band, num_bands, start, scanline_y;
+
+    if (bands > lines / CRT_BAND_MIN_LINES) {
+        bands = lines / CRT_BAND_MIN_LINES;
+    }
+    if (bands < 1) {
+        bands = 1;
+    }
+
+    job.renderer = renderer;
+    job.config = config;
+    job.src = src;
+    job.trg = trg;
+    job.width = width;
+    job.height = height;
+    job.xs = xs;
+    job.ys = ys;
+    job.xt = xt;
+    job.yt = yt;
+    job.pitchs = pitchs;
+    job.pitcht = pitcht;
+    job.viewport_first_line = viewport_first_line;
+    job.viewport_last_line = viewport_last_line;
+
+    num_bands = 0;
+    job.band_start[0] = 0;
+    for (band = 1; band < bands; band++) {
+        start = lines * band / bands;
+        if (doubled) {
+            /* The 2x2 renderers finish a band with the scanline below its
+               last line. Right below the viewport a complete frame leaves
+               that scanline alone, so never end a band there. */
+            scanline_y = (((ys + start) << 1) | (yt & 1));
+            if (scanline_y == (int)(viewport_last_line * 2) + 2) {
+                start--;
+            }
+            start *= 2;
+        }
+        if (start > job.band_start[num_bands]) {
+            job.band_start[++num_bands] = start;
+        }
+    }
+    job.band_start[++num_bands] = height;
+
+    job.scratch[0] = &config->color_tables.scratch;
+    for (band = 1; band < num_bands; band++) {
+        job.scratch[band] = video_render_bands_get_scratch(band);
+    }
+
+    video_render_bands_run(crt_render_band, &job, num_bands);
+}
 
 void video_render_pal_ntsc_main(video_render_config_t *config,
                            uint8_t *src, uint8_t *trg,
@@ -83,14 +215,16 @@ void video_render_pal_ntsc_main(video_render_config_t *config,
             if (crtemulation) {
                 switch (crt_type) {
                     case VIDEO_CRT_TYPE_NTSC:
-                        render_32_1x1_ntsc(colortab, src, trg, width, height,
-                                        xs, ys, xt, yt, pitchs, pitcht);
+                        crt_render(CRT_RENDER_1X1_NTSC, config, src, trg, width, height,
+                                   xs, ys, xt, yt, pitchs, pitcht,
+                                   viewport_first_line, viewport_last_line);
                         return;
                     default:
                         /* fall through */
                     case VIDEO_CRT_TYPE_PAL:
-                        render_32_1x1_pal(colortab, src, trg, width, height,
-                                        xs, ys, xt, yt, pitchs, pitcht, config);
+                        crt_render(CRT_RENDER_1X1_PAL, config, src, trg, width, height,
+                                   xs, ys, xt, yt, pitchs, pitcht,
+                                   viewport_first_line, viewport_last_line);
                         return;
                 }
             } else {
@@ -103,23 +237,23 @@ void video_render_pal_ntsc_main(video_render_config_t *config,
             if (crtemulation) {
                 switch (crt_type) {
                     case VIDEO_CRT_TYPE_NTSC:
-                        render_32_2x2_ntsc(colortab, src, trg, width, height,
-                                           xs, ys, xt, yt, pitchs, pitcht,
-                                           viewport_first_line, viewport_last_line, config);
+                        crt_render(CRT_RENDER_2X2_NTSC, config, src, trg, width, height,
+                                   xs, ys, xt, yt, pitchs, pitcht,
+                                   viewport_first_line, viewport_last_line);
                         return;
                     default:
                         /* fall through */
                     case VIDEO_CRT_TYPE_PAL:
                         if (config->video_resources.delaylinetype == 1) {
                             /* delay U only (1084 style) */
-                            render_32_2x2_pal_u(colortab, src, trg, width, height,
-                                                xs, ys, xt, yt, pitchs, pitcht,
-                                                viewport_first_line, viewport_last_line, config);
+                            crt_render(CRT_RENDER_2X2_PAL_U, config, src, trg, width, height,
+                                       xs, ys, xt, yt, pitchs, pitcht,
+                                       viewport_first_line, viewport_last_line);
                             return;
                         }
-                        render_32_2x2_pal(colortab, src, trg, width, height,
-                                          xs, ys, xt, yt, pitchs, pitcht,
-                                          viewport_first_line, viewport_last_line, config);
+                        crt_render(CRT_RENDER_2X2_PAL, config, src, trg, width, height,
+                                   xs, ys, xt, yt, pitchs, pitcht,
+                                   viewport_first_line, viewport_last_line);
                         return;
                 }
             } else if (scale2x) {
@@ -47,6 +47,7 @@
 #include "machine.h"
 #include "resources.h"
 #include "video-color.h"
+#include "video-render-bands.h"
 #include "video.h"
 #include "viewport.h"
 #include "util.h"
@@ -55,13 +56,37 @@
 /*-----------------------------------------------------------------------*/
 /* global resources.  */
 
+static int video_render_threads = 1;
+
+static int set_video_render_threads(int val, void *param)
+{
+    if (val < 0 || val > VIDEO_RENDER_BANDS_MAX) {
+        return -1;
+    }
+    video_render_threads = val;
+    video_render_bands_set_threads(val);
+
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "VideoRenderThreads", 1, RES_EVENT_NO, NULL,
+      &video_render_threads, set_video_render_threads, NULL },
+    RESOURCE_INT_LIST_END
+};
+
 int video_resources_init(void)
 {
+    if (resources_register_int(resources_int) < 0) {
+        return -1;
+    }
+
     return video_arch_resources_init();
 }
 
 void video_resources_shutdown(void)
 {
+    video_render_bands_shutdown();
     video_arch_resources_shutdown();
 }
 
@@ -50,6 +50,7 @@
 #endif
 
 #include "archdep.h"
+#include "batch.h"
 #include "cmdline.h"
 #include "debug.h"
 #include "joystick.h"
@@ -64,6 +65,9 @@
 #endif
 #include "network.h"
 #include "resources.h"
+#include "rewind.h"
+#include "runahead.h"
+#include "shmexport.h"
 #include "sound.h"
 #include "types.h"
 #include "videoarch.h"
@@ -513,6 +517,12 @@ void vsync_do_end_of_line(void)
         return;
     }
 
+    if (runahead_is_speculating()) {
+        /* run the sound chips, but neither pace nor read input */
+        sound_flush();
+        return;
+    }
+
     /* deal with any accumulated sound immediately */
     tick_based_sync_timing = sound_flush();
 
@@ -625,6 +635,17 @@ bool vsync_should_skip_frame(struct video_canvas_s *canvas)
         return true;
     }
 
+    /* Nobody is watching a batch run, but every frame is rendered if
+       screenshots are taken, so that they don't depend on the host speed */
+    if (batch_is_active()) {
+        return batch_skip_frames();
+    }
+
+    /* With run-ahead only the last frame emulated ahead is shown */
+    if (runahead_skip_frame()) {
+        return true;
+    }
+
     /*
      * Limit rendering fps if we're in warp mode.
      * It's ugly enough for dqh to weep but makes warp faster.
@@ -662,6 +683,12 @@ void vsync_do_vsync(struct video_canvas_s *c)
     tick_t now;
     tick_t network_hook_time = 0;
 
+    if (runahead_is_speculating()) {
+        /* nothing outside the emulation sees the frames run ahead */
+        runahead_vsync_hook();
+        return;
+    }
+
     monitor_vsync_hook();
 
     /*
@@ -704,6 +731,10 @@ void vsync_do_vsync(struct video_canvas_s *c)
 
     execute_vsync_callbacks();
 
+    rewind_vsync_hook();
+    shmexport_vsync_hook();
+    runahead_vsync_hook();
+
     kbdbuf_flush();
 
     last_vsync = now;
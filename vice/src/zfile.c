@@ -39,6 +39,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #ifdef HAVE_ERRNO_H
 #include <errno.h>
@@ -93,11 +96,37 @@ struct zfile_s {
     struct zfile_s *prev, *next; /* Link to the previous and next nodes.  */
     zfile_action_t action;       /* action on close */
     char *request_string;        /* ui string for action=ZFILE_REQUEST */
+    uint8_t *mem_buf;            /* Buffer behind a memory stream.  */
 };
 typedef struct zfile_s zfile_t;
 
 static zfile_t *zfile_list = NULL;
 
+/* The uncompressed contents of the compressed files that have been opened
+   are kept in memory, so that opening the same file again (which happens a
+   lot when attaching and autostarting images) does not need to uncompress
+   it again.  An entry is only used as long as the size and modification
+   time of the compressed file are unchanged; the least recently used
+   entries are dropped when the total size exceeds `ZFILE_CACHE_SIZE'.  */
+#define ZFILE_CACHE_SIZE (64 * 1024 * 1024)
+
+/* Size of the blocks uncompressed data is read in.  */
+#define ZFILE_BLOCK_SIZE 0x10000
+
+struct zfile_cache_s {
+    char *orig_name;             /* Complete path of the compressed file.  */
+    off_t orig_size;             /* Size of the compressed file.  */
+    time_t orig_mtime;           /* Modification time of the compressed file.  */
+    enum compression_type type;  /* Compression algorithm.  */
+    uint8_t *data;               /* Uncompressed contents.  */
+    size_t len;                  /* Length of the uncompressed contents.  */
+    struct zfile_cache_s *prev, *next; /* Most recently used first.  */
+};
+typedef struct zfile_cache_s zfile_cache_t;
+
+static zfile_cache_t *zfile_cache = NULL;
+static size_t zfile_cache_total = 0;
+
 static log_t zlog = LOG_ERR;
 
 /* ------------------------------------------------------------------------- */
@@ -127,6 +156,120 @@ static int file_is_gzip(const char *name)
 }
 
 
+/* Unlink cache entry `e' and free it.  */
+static void zfile_cache_remove(zfile_cache_t *e)
+{
+    if (e->prev != NULL) {
+        e->prev->next = e->next;
+    } else {
+        zfile_cache = e->next;
+    }
+    if (e->next != NULL) {
+        e->next->prev = e->prev;
+    }
+
+    zfile_cache_total -= e->len;
+    lib_free(e->orig_name);
+    lib_free(e->data);
+    lib_free(e);
+}
+
+static void zfile_cache_destroy(void)
+{
+    while (zfile_cache != NULL) {
+        zfile_cache_remove(zfile_cache);
+    }
+}
+
+/* Return the cache entry for the complete path `orig_name', or NULL if there
+   is none or the file has changed since it was added.  */
+static zfile_cache_t *zfile_cache_lookup(const char *orig_name)
+{
+    zfile_cache_t *e;
+    struct stat st;
+
+    for (e = zfile_cache; e != NULL; e = e->next) {
+        if (!strcmp(e->orig_name, orig_name)) {
+            break;
+        }
+    }
+    if (e == NULL) {
+        return NULL;
+    }
+
+    if (stat(orig_name, &st) < 0
+        || st.st_size != e->orig_size || st.st_mtime != e->orig_mtime) {
+        ZDEBUG(("zfile_cache_lookup: `%s' has changed", orig_name));
+        zfile_cache_remove(e);
+        return NULL;
+    }
+
+    /* Move the entry to the front of the list.  */
+    if (e->prev != NULL) {
+        e->prev->next = e->next;
+        if (e->next != NULL) {
+            e->next->prev = e->prev;
+        }
+        e->prev = NULL;
+        e->next = zfile_cache;
+        zfile_cache->prev = e;
+        zfile_cache = e;
+    }
+    return e;
+}
+
+/* Add the `len' bytes at `data' as the uncompressed contents of the file
+   with the complete path `orig_name'.  On success the cache takes over
+   `data' and 0 is returned; otherwise the caller keeps it.  */
+static int zfile_cache_add(const char *orig_name, enum compression_type type,
+                           uint8_t *data, size_t len)
+{
+    zfile_cache_t *e;
+    struct stat st;
+
+    if (len > ZFILE_CACHE_SIZE / 2 || stat(orig_name, &st) < 0) {
+        return -1;
+    }
+
+    /* The modification time only has a resolution of one second, so a file
+       modified in the current second could still change without changing
+       its modification time.  */
+    if (st.st_mtime >= time(NULL)) {
+        return -1;
+    }
+
+    for (e = zfile_cache; e != NULL; e = e->next) {
+        if (!strcmp(e->orig_name, orig_name)) {
+            zfile_cache_remove(e);
+            break;
+        }
+    }
+
+    /* Drop the least recently used entries to make room.  */
+    while (zfile_cache != NULL && zfile_cache_total + len > ZFILE_CACHE_SIZE) {
+        for (e = zfile_cache; e->next != NULL; e = e->next) {
+        }
+        zfile_cache_remove(e);
+    }
+
+    e = lib_malloc(sizeof(zfile_cache_t));
+    e->orig_name = lib_strdup(orig_name);
+    e->orig_size = st.st_size;
+    e->orig_mtime = st.st_mtime;
+    e->type = type;
+    e->data = data;
+    e->len = len;
+    e->prev = NULL;
+    e->next = zfile_cache;
+    if (zfile_cache != NULL) {
+        zfile_cache->prev = e;
+    }
+    zfile_cache = e;
+    zfile_cache_total += len;
+
+    return 0;
+}
+
 static void zfile_list_destroy(void)
 {
     zfile_t *p;
@@ -158,7 +301,7 @@ static int zinit(void)
 
 /* Add one zfile to the list.  `orig_name' is automatically expanded to the
    complete path.  */
-static void zfile_list_add(const char *tmp_name,
+static zfile_t *zfile_list_add(const char *tmp_name,
                            const char *orig_name,
                            enum compression_type type,
                            int write_mode,
@@ -177,72 +320,161 @@ static void zfile_list_add(const char *tmp_name,
     new_zfile->type = type;
     new_zfile->action = ZFILE_KEEP;
     new_zfile->request_string = NULL;
+    new_zfile->mem_buf = NULL;
     new_zfile->next = zfile_list;
     new_zfile->prev = NULL;
     if (zfile_list != NULL) {
         zfile_list->prev = new_zfile;
     }
     zfile_list = new_zfile;
+
+    return new_zfile;
 }
 
 void zfile_shutdown(void)
 {
     zfile_list_destroy();
+    zfile_cache_destroy();
 }
 
 /* ------------------------------------------------------------------------ */
 
 /* Uncompression.  */
 
-/* If `name' has a gzip-like extension, try to uncompress it into a temporary
-   file using gzip or zlib if available.  If this succeeds, return the name
-   of the temporary file; return NULL otherwise.  */
-static char *try_uncompress_with_gzip(const char *name)
+/* Read the whole file `name' into memory.  Return the data and store its
+   length in `len'; return NULL on error.  */
+static uint8_t *load_file(const char *name, size_t *len)
 {
-#ifdef HAVE_ZLIB
-    FILE *fddest;
-    gzFile fdsrc;
+    FILE *fd;
+    uint8_t *data;
+    size_t size = ZFILE_BLOCK_SIZE;
+    size_t n;
+
+    fd = fopen(name, MODE_READ);
+    if (fd == NULL) {
+        return NULL;
+    }
+
+    data = lib_malloc(size);
+    *len = 0;
+    do {
+        if (size - *len < ZFILE_BLOCK_SIZE) {
+            size *= 2;
+            data = lib_realloc(data, size);
+        }
+        n = fread(data + *len, 1, ZFILE_BLOCK_SIZE, fd);
+        *len += n;
+    } while (n == ZFILE_BLOCK_SIZE);
+
+    if (ferror(fd)) {
+        fclose(fd);
+        lib_free(data);
+        return NULL;
+    }
+    fclose(fd);
+
+    return data;
+}
+
+/* Write `len' bytes at `data' into a new temporary file.  Return the name of
+   the temporary file, or NULL on error.  */
+static char *write_tmp_file(const uint8_t *data, size_t len)
+{
+    FILE *fd;
     char *tmp_name = NULL;
-    int len;
 
-    if (!file_is_gzip(name)) {
+    fd = archdep_mkstemp_fd(&tmp_name, MODE_WRITE);
+    if (fd == NULL) {
         return NULL;
     }
 
-    fddest = archdep_mkstemp_fd(&tmp_name, MODE_WRITE);
+    if (fwrite(data, 1, len, fd) < len) {
+        fclose(fd);
+        archdep_remove(tmp_name);
+        lib_free(tmp_name);
+        return NULL;
+    }
+    fclose(fd);
 
-    if (fddest == NULL) {
+    return tmp_name;
+}
+
+/* Open a read-only stream on a private copy of the `len' bytes at `data',
+   which is returned in `buf' and must be freed after closing the stream.
+   Return NULL if memory streams are not available.  */
+static FILE *open_memory_stream(const uint8_t *data, size_t len,
+                                uint8_t **buf)
+{
+#ifdef HAVE_FMEMOPEN
+    FILE *stream;
+
+    if (len == 0) {
+        return NULL;
+    }
+
+    *buf = lib_malloc(len);
+    memcpy(*buf, data, len);
+    stream = fmemopen(*buf, len, MODE_READ);
+    if (stream == NULL) {
+        lib_free(*buf);
+        *buf = NULL;
+    }
+    return stream;
+#else
+    return NULL;
+#endif
+}
+
+#ifdef HAVE_ZLIB
+/* If `name' has a gzip-like extension, try to uncompress it into memory
+   using zlib.  If this succeeds, return the uncompressed data and store its
+   length in `len'; return NULL otherwise.  */
+static uint8_t *try_uncompress_with_gzip(const char *name, size_t *len)
+{
+    gzFile fdsrc;
+    uint8_t *data;
+    size_t size = ZFILE_BLOCK_SIZE;
+    int n;
+
+    if (!file_is_gzip(name)) {
         return NULL;
     }
 
     fdsrc = gzopen(name, MODE_READ);
     if (fdsrc == NULL) {
-        fclose(fddest);
-        archdep_remove(tmp_name);
-        lib_free(tmp_name);
         return NULL;
     }
+#if ZLIB_VERNUM >= 0x1240
+    gzbuffer(fdsrc, ZFILE_BLOCK_SIZE);
+#endif
 
+    data = lib_malloc(size);
+    *len = 0;
     do {
-        char buf[256];
-
-        len = gzread(fdsrc, (void *)buf, 256);
-        if (len > 0) {
-            if (fwrite((void *)buf, 1, (size_t)len, fddest) < len) {
-                gzclose(fdsrc);
-                fclose(fddest);
-                archdep_remove(tmp_name);
-                lib_free(tmp_name);
-                return NULL;
-            }
+        if (size - *len < ZFILE_BLOCK_SIZE) {
+            size *= 2;
+            data = lib_realloc(data, size);
         }
-    } while (len > 0);
+        n = gzread(fdsrc, (void *)(data + *len), ZFILE_BLOCK_SIZE);
+        if (n > 0) {
+            *len += (size_t)n;
+        }
+    } while (n > 0);
 
     gzclose(fdsrc);
-    fclose(fddest);
 
-    return tmp_name;
+    if (n < 0) {
+        lib_free(data);
+        return NULL;
+    }
+    return data;
+}
 #else
+/* If `name' has a gzip-like extension, try to uncompress it into a temporary
+   file using gzip.  If this succeeds, return the name of the temporary file;
+   return NULL otherwise.  */
+static char *try_uncompress_with_gzip(const char *name)
+{
     char *tmp_name = NULL;
     int exit_status;
     char *argv[4];
@@ -273,8 +505,8 @@ static char *try_uncompress_with_gzip(const char *name)
         lib_free(tmp_name);
         return NULL;
     }
-#endif
 }
+#endif
 
 /* If `name' has a bzip-like extension, try to uncompress it into a temporary
    file using bzip.  If this succeeds, return the name of the temporary file;
@@ -770,17 +1002,20 @@ static const valid_archives_t valid_archives[] = {
 };
 
 /* Try to uncompress file `name' using the algorithms we know of.  If this is
-   not possible, return `COMPR_NONE'.  Otherwise, uncompress the file into a
-   temporary file, return the type of algorithm used and the name of the
-   temporary file in `tmp_name'.  If `write_mode' is non-zero and the
-   returned `tmp_name' has zero length, then the file cannot be accessed in
-   write mode.  */
+   not possible, return `COMPR_NONE'.  Otherwise, uncompress the file either
+   into memory, returning the data in `data' and its length in `len', or into
+   a temporary file, returning its name in `tmp_name', and return the type of
+   algorithm used.  If `write_mode' is non-zero and the returned `tmp_name'
+   has zero length, then the file cannot be accessed in write mode.  */
 static enum compression_type try_uncompress(const char *name,
                                             char **tmp_name,
+                                            uint8_t **data, size_t *len,
                                             int write_mode)
 {
     int i;
 
+    *data = NULL;
+
     for (i = 0; valid_archives[i].program; i++) {
         if ((*tmp_name = try_uncompress_archive(name, write_mode,
                                                 valid_archives[i].program,
@@ -794,9 +1029,15 @@ static enum compression_type try_uncompress(const char *name,
     }
 
     /* need this order or .tar.gz is misunderstood */
+#ifdef HAVE_ZLIB
+    if ((*data = try_uncompress_with_gzip(name, len)) != NULL) {
+        return COMPR_GZIP;
+    }
+#else
     if ((*tmp_name = try_uncompress_with_gzip(name)) != NULL) {
         return COMPR_GZIP;
     }
+#endif
 
     if ((*tmp_name = try_uncompress_with_bzip(name)) != NULL) {
         return COMPR_BZIP;
@@ -828,29 +1069,38 @@ static int compress_with_gzip(const char *src, const char *dest)
     FILE *fdsrc;
     gzFile fddest;
     size_t len;
+    char *buf;
+    int retval = 0;
 
-    fdsrc = fopen(dest, MODE_READ);
+    fdsrc = fopen(src, MODE_READ);
     if (fdsrc == NULL) {
         return -1;
     }
 
-    fddest = gzopen(src, MODE_WRITE "9");
+    fddest = gzopen(dest, MODE_WRITE "9");
     if (fddest == NULL) {
         fclose(fdsrc);
         return -1;
     }
 
+    buf = lib_malloc(ZFILE_BLOCK_SIZE);
     do {
-        char buf[256];
-        len = fread((void *)buf, 256, 1, fdsrc);
-        if (len > 0) {
-            gzwrite(fddest, (void *)buf, (unsigned int)len);
+        len = fread((void *)buf, 1, ZFILE_BLOCK_SIZE, fdsrc);
+        if (len > 0 && gzwrite(fddest, (void *)buf, (unsigned int)len) != (int)len) {
+            retval = -1;
         }
-    } while (len > 0);
+    } while (len > 0 && retval == 0);
+    lib_free(buf);
 
-    gzclose(fddest);
+    if (gzclose(fddest) != Z_OK) {
+        retval = -1;
+    }
     fclose(fdsrc);
 
+    if (retval < 0) {
+        return -1;
+    }
+
     ZDEBUG(("compress with zlib: OK."));
 
     return 0;
@@ -1026,12 +1276,26 @@ static int zfile_compress(const char *src, const char *dest,
    When a file that was opened for writing is closed, we re-compress the
    uncompressed version and update the original file.  */
 
+/* Return non-zero if files compressed with `type' can be opened for
+   writing.  */
+static int compression_is_writable(enum compression_type type)
+{
+    return type != COMPR_ARCHIVE && type != COMPR_ZIPCODE && type != COMPR_LYNX;
+}
+
 /* `fopen()' wrapper.  */
 FILE *zfile_fopen(const char *name, const char *mode)
 {
-    char *tmp_name;
-    FILE *stream;
+    char *tmp_name = NULL;
+    char *full_name = NULL;
+    uint8_t *data = NULL;
+    uint8_t *contents;
+    uint8_t *mem_buf = NULL;
+    size_t len = 0;
+    FILE *stream = NULL;
     enum compression_type type;
+    zfile_cache_t *cached;
+    zfile_t *z;
     int write_mode = 0;
 
     if (!zinit_done) {
@@ -1052,26 +1316,82 @@ FILE *zfile_fopen(const char *name, const char *mode)
         return NULL;
     }
 
-    type = try_uncompress(name, &tmp_name, write_mode);
-    if (type == COMPR_NONE) {
-        stream = fopen(name, mode);
-        if (stream == NULL) {
+    archdep_expand_path(&full_name, name);
+
+    cached = zfile_cache_lookup(full_name);
+    if (cached != NULL) {
+        ZDEBUG(("zfile_fopen: using cached contents of `%s'", full_name));
+        if (write_mode && !compression_is_writable(cached->type)) {
+            lib_free(full_name);
+            errno = EACCES;
             return NULL;
         }
-        zfile_list_add(NULL, name, type, write_mode, stream, NULL);
-        return stream;
-    } else if (*tmp_name == '\0') {
-        errno = EACCES;
-        return NULL;
+        type = cached->type;
+    } else {
+        type = try_uncompress(name, &tmp_name, &data, &len, write_mode);
+        if (type == COMPR_NONE) {
+            lib_free(full_name);
+            stream = fopen(name, mode);
+            if (stream == NULL) {
+                return NULL;
+            }
+            zfile_list_add(NULL, name, type, write_mode, stream, NULL);
+            return stream;
+        } else if (tmp_name != NULL && *tmp_name == '\0') {
+            lib_free(full_name);
+            errno = EACCES;
+            return NULL;
+        }
+
+        /* Keep the uncompressed contents for the next time.  */
+        if (data == NULL) {
+            data = load_file(tmp_name, &len);
+        }
+        if (data != NULL && zfile_cache_add(full_name, type, data, len) == 0) {
+            cached = zfile_cache;
+            data = NULL;
+        }
     }
+    lib_free(full_name);
+
+    if (cached != NULL) {
+        contents = cached->data;
+        len = cached->len;
+    } else {
+        contents = data;
+    }
+
+    /* Read-only files are opened in memory if possible, otherwise the
+       uncompressed version is opened from a temporary file.  */
+    if (contents != NULL && !write_mode) {
+        stream = open_memory_stream(contents, len, &mem_buf);
+    }
+    if (stream != NULL) {
+        if (tmp_name != NULL) {
+            archdep_remove(tmp_name);
+            lib_free(tmp_name);
+            tmp_name = NULL;
+        }
+    } else {
+        if (tmp_name == NULL && contents != NULL) {
+            tmp_name = write_tmp_file(contents, len);
+        }
+        if (tmp_name != NULL) {
+            stream = fopen(tmp_name, mode);
+        }
+    }
+    lib_free(data);
 
-    /* Open the uncompressed version of the file.  */
-    stream = fopen(tmp_name, mode);
     if (stream == NULL) {
+        if (tmp_name != NULL) {
+            archdep_remove(tmp_name);
+            lib_free(tmp_name);
+        }
         return NULL;
     }
 
-    zfile_list_add(tmp_name, name, type, write_mode, stream, NULL);
+    z = zfile_list_add(tmp_name, name, type, write_mode, stream, NULL);
+    z->mem_buf = mem_buf;
 
     /* now we don't need the archdep_tmpnam allocation any more */
     lib_free(tmp_name);
@@ -1104,6 +1424,40 @@ static int handle_close_action(zfile_t *ptr)
     return 0;
 }
 
+/* Recompress the temporary file of `ptr' into the original file if it was
+   changed, and update the cache.  */
+static int handle_close_compress(zfile_t *ptr)
+{
+    zfile_cache_t *cached;
+    uint8_t *data;
+    size_t len = 0;
+
+    data = load_file(ptr->tmp_name, &len);
+    cached = zfile_cache_lookup(ptr->orig_name);
+
+    if (data != NULL && cached != NULL && cached->len == len
+        && !memcmp(cached->data, data, len)) {
+        ZDEBUG(("handle_close_compress: `%s' is unchanged", ptr->orig_name));
+        lib_free(data);
+        return 0;
+    }
+
+    if (cached != NULL) {
+        zfile_cache_remove(cached);
+    }
+
+    if (zfile_compress(ptr->tmp_name, ptr->orig_name, ptr->type)) {
+        lib_free(data);
+        return -1;
+    }
+
+    if (data != NULL
+        && zfile_cache_add(ptr->orig_name, ptr->type, data, len) < 0) {
+        lib_free(data);
+    }
+    return 0;
+}
+
 /* Handle close of a (compressed file). `ptr' points to the zfile to close.  */
 static int handle_close(zfile_t *ptr)
 {
@@ -1112,10 +1466,9 @@ static int handle_close(zfile_t *ptr)
             ptr->orig_name, ptr->write_mode));
 
     if (ptr->tmp_name) {
-        /* Recompress into the original file.  */
-        if (ptr->orig_name
-            && ptr->write_mode
-            && zfile_compress(ptr->tmp_name, ptr->orig_name, ptr->type)) {
+        /* Recompress into the original file, unless the contents did not
+           change.  */
+        if (ptr->orig_name && ptr->write_mode && handle_close_compress(ptr)) {
             return -1;
         }
 
@@ -1147,6 +1500,9 @@ static int handle_close(zfile_t *ptr)
     if (ptr->request_string) {
         lib_free(ptr->request_string);
     }
+    if (ptr->mem_buf) {
+        lib_free(ptr->mem_buf);
+    }
 
     lib_free(ptr);
 